@@ -1,7 +1,7 @@
 /**
  * @file FRAM.c
  * @author  Thomas Barth <thomas@barth-dev.de>
- * @version 1.0
+ * @version 2.0
  */
 
 /*******************************************************************************
@@ -14,151 +14,893 @@
 /*******************************************************************************
 **                      Macros                                                **
 *******************************************************************************/
-#define I2C_API(F)          _CONCAT(I2C_INSTANCE,F)
-#define _CONCAT(a,b)        CONCAT(a,b)
-#define CONCAT(a,b)         a##b
-
-#define FRAM_ADR_BYTES      2
-#define FRAM_PS_SHIFT       15
+#define FRAM_PS_SHIFT       16
 #define FRAM_MSB_SHIFT      8
 #define FRAM_PS_MASK        0x10000
 
+#define FRAM_LOCK           1
+#define FRAM_UNLOCK         0
+
 /*******************************************************************************
 **                      Locals                                                **
 *******************************************************************************/
-static uint32_t FRAM_current_adr=FRAM_INVALID_ADR;
-static uint32_t FRAM_prep_adr(uint32_t adr, uint8_t * const adr_ary);
+static uint32_t FRAM_prep_adr(const FRAM_t * const fram, uint32_t adr, uint8_t * const adr_ary);
+static void     FRAM_bus_complete(FRAM_bus_t * const bus);
+static void     FRAM_lock_devices(FRAM_t * const * const devices, uint8_t count, uint8_t lock);
+static uint32_t FRAM_raw_array_read_from_adr(const FRAM_array_t * const array, uint32_t adr, uint8_t * const buffer, uint32_t count);
+static uint32_t FRAM_raw_array_write_to_adr(const FRAM_array_t * const array, uint32_t adr, uint8_t * const buffer, uint32_t count);
+static uint32_t FRAM_raw_stripe_read_from_adr(const FRAM_stripe_t * const stripe, uint32_t adr, uint8_t * const buffer, uint32_t count);
+static uint32_t FRAM_raw_stripe_write_to_adr(const FRAM_stripe_t * const stripe, uint32_t adr, uint8_t * const buffer, uint32_t count);
+static uint32_t FRAM_raw_mirror_read_from_adr(FRAM_mirror_t * const mirror, uint32_t adr, uint8_t * const buffer, uint32_t count);
+static uint32_t FRAM_raw_mirror_write_to_adr(FRAM_mirror_t * const mirror, uint32_t adr, uint8_t * const buffer, uint32_t count);
+static uint32_t FRAM_raw_mirror_verify(FRAM_mirror_t * const mirror, uint32_t adr, uint32_t count);
+static uint32_t FRAM_raw_mirror_resync(FRAM_mirror_t * const mirror);
+static uint32_t FRAM_raw_set_adr(FRAM_t * const fram, uint32_t adr, FRAM_wait_t wait);
+static uint32_t FRAM_raw_read_current_adr(FRAM_t * const fram, uint8_t * const buffer, uint32_t count, FRAM_wait_t wait);
+static uint32_t FRAM_raw_read_from_adr(FRAM_t * const fram, uint32_t adr, uint8_t * const buffer, uint32_t count);
+static uint32_t FRAM_raw_write(FRAM_t * const fram, uint32_t adr, uint8_t * const buffer, uint32_t count, FRAM_wait_t wait);
+static uint32_t FRAM_raw_write_parts(FRAM_t * const fram, uint32_t adr, const FRAM_part_t * const parts, uint8_t count, FRAM_wait_t wait);
+static uint32_t FRAM_stripe_map(const FRAM_stripe_t * const stripe, uint32_t adr, FRAM_t ** const dev);
+static uint8_t  FRAM_mirror_pick(FRAM_mirror_t * const mirror, uint32_t adr);
+static void     FRAM_mirror_mark(FRAM_mirror_t * const mirror, uint8_t src, uint32_t first, uint32_t last);
+static uint32_t FRAM_mirror_finish(FRAM_mirror_t * const mirror);
+static uint32_t FRAM_mirror_adr_max(const FRAM_mirror_t * const mirror);
 
 /*******************************************************************************
 **                      Definitions                                           **
 *******************************************************************************/
-void FRAM_Start(void){ I2C_API(_Start();)}
+void FRAM_bus_init(FRAM_bus_t * const bus, const FRAM_i2c_t * const i2c){
+
+    bus->i2c=i2c;
+    bus->pending=0;
+    bus->tx_buf=NULL;
+    bus->lock=NULL;
+}
+
+void FRAM_bus_set_lock(FRAM_bus_t * const bus, FRAM_lock_t * const lock){bus->lock=lock;}
+
+void FRAM_init(FRAM_t * const fram, FRAM_bus_t * const bus, uint8_t slave_adr){
+
+    fram->bus=bus;
+    fram->slave_adr=slave_adr;
+    fram->adr_max=FRAM_ADR_MAX;
+
+    //the content of the address latch is unknown after power up
+    fram->current_adr=FRAM_INVALID_ADR;
+
+    FRAM_clear_stats(fram);
+}
+
+void FRAM_Start(FRAM_t * const fram){ fram->bus->i2c->Start(); }
+
+uint32_t FRAM_get_adr(const FRAM_t * const fram){return fram->current_adr;}
+
+uint8_t FRAM_get_slave_adr(const FRAM_t * const fram){return fram->slave_adr;}
+
+uint32_t FRAM_I2C_Status(const FRAM_t * const fram){return fram->bus->i2c->MasterStatus();}
+
+const FRAM_stats_t* FRAM_get_stats(const FRAM_t * const fram){return &fram->stats;}
+
+void FRAM_clear_stats(FRAM_t * const fram){
+
+    fram->stats.reads=0;
+    fram->stats.writes=0;
+    fram->stats.set_adrs=0;
+    fram->stats.latch_hits=0;
+    fram->stats.bytes_read=0;
+    fram->stats.bytes_written=0;
+    fram->stats.errors=0;
+}
+
+void FRAM_store32(uint8_t * const out, uint32_t value){
+
+    out[0]=value;
+    out[1]=value>>8;
+    out[2]=value>>16;
+    out[3]=value>>24;
+}
+
+void FRAM_store16(uint8_t * const out, uint16_t value){
+
+    out[0]=value;
+    out[1]=value>>8;
+}
+
+uint32_t FRAM_load32(const uint8_t * const in){return in[0]|(uint32_t)in[1]<<8|(uint32_t)in[2]<<16|(uint32_t)in[3]<<24;}
+
+uint16_t FRAM_load16(const uint8_t * const in){return in[0]|in[1]<<8;}
+
+uint32_t FRAM_set_adr(FRAM_t * const fram, uint32_t adr, FRAM_wait_t wait){
+
+    uint32_t result;
+
+    FRAM_lock_acquire(fram->bus->lock,FRAM_PRIO_NORMAL);
+    result=FRAM_raw_set_adr(fram,adr,wait);
+    FRAM_lock_release(fram->bus->lock);
+
+    return result;
+}
+
+uint32_t FRAM_read_current_adr(FRAM_t * const fram, uint8_t * const buffer, uint32_t count, FRAM_wait_t wait){
+
+    uint32_t result;
+
+    FRAM_lock_acquire(fram->bus->lock,FRAM_PRIO_NORMAL);
+    result=FRAM_raw_read_current_adr(fram,buffer,count,wait);
+    FRAM_lock_release(fram->bus->lock);
+
+    return result;
+}
+
+uint32_t FRAM_read_from_adr(FRAM_t * const fram, uint32_t adr, uint8_t * const buffer, uint32_t count){return FRAM_read_from_adr_prio(fram,FRAM_PRIO_NORMAL,adr,buffer,count);}
+
+uint32_t FRAM_write_to_adr(FRAM_t * const fram, uint32_t adr, uint8_t * const buffer, uint32_t count){return FRAM_write_to_adr_prio(fram,FRAM_PRIO_NORMAL,adr,buffer,count);}
+
+uint32_t FRAM_read_from_adr_prio(FRAM_t * const fram, FRAM_prio_t prio, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    FRAM_lock_t * const lock=fram->bus->lock;
+    uint32_t result=FRAM_NO_ERROR;
+    uint32_t part;
+    uint32_t done;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0)
+        return FRAM_PARAMTER_ERROR;
+
+    FRAM_lock_acquire(lock,prio);
+
+    //without a lock nobody can use the bus in between, so the read is not split
+    for(done=0;done<count&&result==FRAM_NO_ERROR;done+=part){
+
+        part=lock!=NULL&&count-done>FRAM_CHUNK_SIZE?FRAM_CHUNK_SIZE:count-done;
+
+        //a higher class may use the bus between two chunks, the read sets the address latch again if it moved meanwhile
+        if(done>0)
+            FRAM_lock_yield(lock);
+
+        result=FRAM_raw_read_from_adr(fram,done>0?(adr+done)%(fram->adr_max+1):adr,buffer+done,part);
+    }
+
+    FRAM_lock_release(lock);
+
+    return result;
+}
+
+uint32_t FRAM_write_to_adr_prio(FRAM_t * const fram, FRAM_prio_t prio, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    FRAM_lock_t * const lock=fram->bus->lock;
+    uint32_t result=FRAM_NO_ERROR;
+    uint32_t part;
+    uint32_t done;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0)
+        return FRAM_PARAMTER_ERROR;
+
+    FRAM_lock_acquire(lock,prio);
+
+    //without a lock nobody can use the bus in between, so the write is not split
+    for(done=0;done<count&&result==FRAM_NO_ERROR;done+=part){
+
+        part=lock!=NULL&&count-done>FRAM_CHUNK_SIZE?FRAM_CHUNK_SIZE:count-done;
 
-uint32_t FRAM_get_adr(void){return FRAM_current_adr;}
+        //a higher class may use the bus between two chunks, every chunk carries its own address
+        if(done>0)
+            FRAM_lock_yield(lock);
+
+        result=FRAM_raw_write(fram,done>0?(adr+done)%(fram->adr_max+1):adr,buffer+done,part,FRAM_WAIT);
+    }
+
+    FRAM_lock_release(lock);
+
+    return result;
+}
+
+uint32_t FRAM_write_parts_to_adr(FRAM_t * const fram, uint32_t adr, const FRAM_part_t * const parts, uint8_t count){
+
+    uint32_t result;
+
+    FRAM_lock_acquire(fram->bus->lock,FRAM_PRIO_NORMAL);
+    result=FRAM_raw_write_parts(fram,adr,parts,count,FRAM_WAIT);
+    FRAM_lock_release(fram->bus->lock);
+
+    return result;
+}
+
+uint32_t FRAM_array_read_from_adr(const FRAM_array_t * const array, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t result;
+
+    FRAM_lock_devices(array->devices,array->count,FRAM_LOCK);
+    result=FRAM_raw_array_read_from_adr(array,adr,buffer,count);
+    FRAM_lock_devices(array->devices,array->count,FRAM_UNLOCK);
+
+    return result;
+}
+
+uint32_t FRAM_array_write_to_adr(const FRAM_array_t * const array, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t result;
+
+    FRAM_lock_devices(array->devices,array->count,FRAM_LOCK);
+    result=FRAM_raw_array_write_to_adr(array,adr,buffer,count);
+    FRAM_lock_devices(array->devices,array->count,FRAM_UNLOCK);
+
+    return result;
+}
 
-uint8_t FRAM_get_slave_adr(void){return FRAM_SLAVE_ADR;}
+uint32_t FRAM_stripe_read_from_adr(const FRAM_stripe_t * const stripe, uint32_t adr, uint8_t * const buffer, uint32_t count){
 
-uint32_t FRAM_I2C_Status(void){return I2C_API(_I2CMasterStatus();)};
+    uint32_t result;
+
+    FRAM_lock_devices(stripe->devices,stripe->count,FRAM_LOCK);
+    result=FRAM_raw_stripe_read_from_adr(stripe,adr,buffer,count);
+    FRAM_lock_devices(stripe->devices,stripe->count,FRAM_UNLOCK);
+
+    return result;
+}
+
+uint32_t FRAM_stripe_write_to_adr(const FRAM_stripe_t * const stripe, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t result;
+
+    FRAM_lock_devices(stripe->devices,stripe->count,FRAM_LOCK);
+    result=FRAM_raw_stripe_write_to_adr(stripe,adr,buffer,count);
+    FRAM_lock_devices(stripe->devices,stripe->count,FRAM_UNLOCK);
+
+    return result;
+}
+
+uint32_t FRAM_mirror_read_from_adr(FRAM_mirror_t * const mirror, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t result;
+
+    FRAM_lock_devices(mirror->copy,2,FRAM_LOCK);
+    result=FRAM_raw_mirror_read_from_adr(mirror,adr,buffer,count);
+    FRAM_lock_devices(mirror->copy,2,FRAM_UNLOCK);
+
+    return result;
+}
+
+uint32_t FRAM_mirror_write_to_adr(FRAM_mirror_t * const mirror, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t result;
+
+    FRAM_lock_devices(mirror->copy,2,FRAM_LOCK);
+    result=FRAM_raw_mirror_write_to_adr(mirror,adr,buffer,count);
+    FRAM_lock_devices(mirror->copy,2,FRAM_UNLOCK);
+
+    return result;
+}
+
+uint32_t FRAM_mirror_verify(FRAM_mirror_t * const mirror, uint32_t adr, uint32_t count){
+
+    uint32_t result;
+
+    FRAM_lock_devices(mirror->copy,2,FRAM_LOCK);
+    result=FRAM_raw_mirror_verify(mirror,adr,count);
+    FRAM_lock_devices(mirror->copy,2,FRAM_UNLOCK);
+
+    return result;
+}
+
+uint32_t FRAM_mirror_resync(FRAM_mirror_t * const mirror){
+
+    uint32_t result;
+
+    FRAM_lock_devices(mirror->copy,2,FRAM_LOCK);
+    result=FRAM_raw_mirror_resync(mirror);
+    FRAM_lock_devices(mirror->copy,2,FRAM_UNLOCK);
+
+    return result;
+}
+
+static uint32_t FRAM_raw_set_adr(FRAM_t * const fram, uint32_t adr, FRAM_wait_t wait){
 
-uint32_t FRAM_set_adr(uint32_t adr, FRAM_wait_t wait){
-        
     uint8_t adr_ary[FRAM_ADR_BYTES+1];
     uint32_t i2c_result;
-    
+    FRAM_bus_t * const bus=fram->bus;
+
     //check adress and prepare bytes
-    if(FRAM_prep_adr(adr,adr_ary)!=FRAM_NO_ERROR)
+    if(FRAM_prep_adr(fram,adr,adr_ary)!=FRAM_NO_ERROR)
         return FRAM_PARAMTER_ERROR;
-    
-    //set adr    
-    i2c_result= I2C_API(_I2CMasterWriteBuf(adr_ary[FRAM_ADR_BYTES],adr_ary,FRAM_ADR_BYTES,I2C_API(_I2C_MODE_COMPLETE_XFER)));
-    
-    //wait for Master to complete previous transfer
-    if(wait==FRAM_WAIT)
-        while (0u == (I2C_API(_I2CMasterStatus()) & I2C_API(_I2C_MSTAT_WR_CMPLT)))   {/* busy wait */ }
-    
+
+    //the bus can only run one transfer at a time
+    FRAM_bus_complete(bus);
+
+    bus->adr[0]=adr_ary[0];
+    bus->adr[1]=adr_ary[1];
+
+    //set adr
+    i2c_result=bus->i2c->MasterWriteBuf(adr_ary[FRAM_ADR_BYTES],bus->adr,FRAM_ADR_BYTES,bus->i2c->mode_complete_xfer);
+
     //if the I2C Operation succeeded: safe the set address as current
-    if(!(i2c_result& I2C_API(_I2C_MSTR_NO_ERROR )))
-        FRAM_current_adr=adr;
-    
+    if(i2c_result==bus->i2c->mstr_no_error){
+        bus->pending=bus->i2c->mstat_wr_cmplt;
+        fram->current_adr=adr;
+        fram->stats.set_adrs++;
+    }
+    else
+        fram->stats.errors++;
+
+    //wait for Master to complete the transfer
+    if(wait==FRAM_WAIT)
+        FRAM_bus_complete(bus);
+
     //return result of I2C operation
     return i2c_result;
 }
 
-uint32_t FRAM_read_current_adr(uint8_t * const buffer, uint32_t count, FRAM_wait_t wait){
-    
+static uint32_t FRAM_raw_read_current_adr(FRAM_t * const fram, uint8_t * const buffer, uint32_t count, FRAM_wait_t wait){
+
     uint32_t i2c_result;
-    
+    FRAM_bus_t * const bus=fram->bus;
+
     //check if parameters are valid
     if(buffer==NULL||count==0)
         return FRAM_PARAMTER_ERROR;
-    
+
+    //the bus can only run one transfer at a time
+    FRAM_bus_complete(bus);
+
     //read from FRAM
-    i2c_result=I2C_API(_I2CMasterReadBuf(FRAM_SLAVE_ADR,buffer,count,I2C_API(_I2C_MODE_COMPLETE_XFER) ));
-    
-    //if the operation was successfull, the internal address will be updated
-    if(!(i2c_result& I2C_API(_I2C_MSTR_NO_ERROR )))
-        FRAM_current_adr=(FRAM_current_adr+count)%FRAM_ADR_MAX;
-    
+    i2c_result=bus->i2c->MasterReadBuf(fram->slave_adr,buffer,count,bus->i2c->mode_complete_xfer);
+
+    //if the operation was successfull, the internal address will be updated. The latch wraps around at the end of the chip.
+    if(i2c_result==bus->i2c->mstr_no_error){
+        bus->pending=bus->i2c->mstat_rd_cmplt;
+        if(fram->current_adr!=FRAM_INVALID_ADR)
+            fram->current_adr=(fram->current_adr+count)%(fram->adr_max+1);
+        fram->stats.reads++;
+        fram->stats.bytes_read+=count;
+    }
+    else
+        fram->stats.errors++;
+
     if(wait==FRAM_WAIT)
-        while (0u == (I2C_API(_I2CMasterStatus()) & I2C_API(_I2C_MSTAT_RD_CMPLT)))   {/* busy wait */ }
-    
+        FRAM_bus_complete(bus);
+
     //return result of I2C operation
     return i2c_result;
 }
 
-uint32_t  FRAM_read_from_adr(uint32_t adr, uint8_t * const buffer, uint32_t count){
+static uint32_t FRAM_raw_read_from_adr(FRAM_t * const fram, uint32_t adr, uint8_t * const buffer, uint32_t count){
 
     uint32_t i2c_result;
-    
+
     //check if we are maybe already at the right address
-    if(FRAM_current_adr!=adr)
+    if(fram->current_adr!=adr)
     {
         //set the address latch
-        i2c_result=FRAM_set_adr(adr,FRAM_WAIT);
+        i2c_result=FRAM_raw_set_adr(fram,adr,FRAM_WAIT);
 
         //if there was an error, return
-        if(i2c_result!= I2C_API(_I2C_MSTR_NO_ERROR ))
+        if(i2c_result!=FRAM_NO_ERROR)
             return i2c_result;
     }
-        
+    else
+        fram->stats.latch_hits++;
+
     //read the data
-    return FRAM_read_current_adr(buffer,count,FRAM_WAIT);
+    return FRAM_raw_read_current_adr(fram,buffer,count,FRAM_WAIT);
+
+}
+
+uint32_t FRAM_array_get_adr_max(const FRAM_array_t * const array){
+
+    uint32_t adr_max=0;
+    uint8_t i;
+
+    for(i=0;i<array->count;i++)
+        adr_max+=array->devices[i]->adr_max+1;
+
+    return adr_max-1;
+}
+
+static uint32_t FRAM_raw_array_read_from_adr(const FRAM_array_t * const array, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t i2c_result;
+    uint32_t part;
+    uint32_t done;
+    uint8_t i=0;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>FRAM_array_get_adr_max(array)||count-1>FRAM_array_get_adr_max(array)-adr)
+        return FRAM_PARAMTER_ERROR;
+
+    //find the chip holding the first address
+    while(adr>array->devices[i]->adr_max){
+        adr-=array->devices[i]->adr_max+1;
+        i++;
+    }
+
+    //read chip by chip, each part ends at the latest at the end of its chip
+    for(done=0;done<count;done+=part,adr=0,i++){
+
+        part=array->devices[i]->adr_max-adr+1;
+        if(part>count-done)
+            part=count-done;
 
+        i2c_result=FRAM_raw_read_from_adr(array->devices[i],adr,buffer+done,part);
+
+        if(i2c_result!=FRAM_NO_ERROR)
+            return i2c_result;
+    }
+
+    return FRAM_NO_ERROR;
 }
 
-uint32_t FRAM_write_to_adr(uint32_t adr, uint8_t * const buffer, uint32_t count){
-    
+static uint32_t FRAM_raw_array_write_to_adr(const FRAM_array_t * const array, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t i2c_result;
+    uint32_t part;
+    uint32_t done;
+    uint8_t i=0;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>FRAM_array_get_adr_max(array)||count-1>FRAM_array_get_adr_max(array)-adr)
+        return FRAM_PARAMTER_ERROR;
+
+    //find the chip holding the first address
+    while(adr>array->devices[i]->adr_max){
+        adr-=array->devices[i]->adr_max+1;
+        i++;
+    }
+
+    //write chip by chip, each part ends at the latest at the end of its chip
+    for(done=0;done<count;done+=part,adr=0,i++){
+
+        part=array->devices[i]->adr_max-adr+1;
+        if(part>count-done)
+            part=count-done;
+
+        i2c_result=FRAM_raw_write(array->devices[i],adr,buffer+done,part,FRAM_WAIT);
+
+        if(i2c_result!=FRAM_NO_ERROR)
+            return i2c_result;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_raw_stripe_read_from_adr(const FRAM_stripe_t * const stripe, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t i2c_result=FRAM_NO_ERROR;
+    uint32_t adr_max=stripe->count*(stripe->devices[0]->adr_max+1)-1;
+    uint32_t dev_adr;
+    uint32_t part;
+    uint32_t done;
+    FRAM_t *dev;
+    uint8_t i;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>adr_max||count-1>adr_max-adr||stripe->stripe_size==0||(stripe->devices[0]->adr_max+1)%stripe->stripe_size!=0)
+        return FRAM_PARAMTER_ERROR;
+
+    //start the read of every unit without waiting, the reads of the previous units keep the other buses busy meanwhile
+    for(done=0;done<count&&i2c_result==FRAM_NO_ERROR;done+=part){
+
+        part=stripe->stripe_size-(adr+done)%stripe->stripe_size;
+        if(part>count-done)
+            part=count-done;
+
+        dev_adr=FRAM_stripe_map(stripe,adr+done,&dev);
+
+        //the units of a chip are back to back, so the latch only has to be set for the first unit of every chip
+        if(dev->current_adr!=dev_adr)
+            i2c_result=FRAM_raw_set_adr(dev,dev_adr,FRAM_WAIT);
+        else
+            dev->stats.latch_hits++;
+
+        if(i2c_result==FRAM_NO_ERROR)
+            i2c_result=FRAM_raw_read_current_adr(dev,buffer+done,part,FRAM_DONT_WAIT);
+    }
+
+    //wait for the reads still running
+    for(i=0;i<stripe->count;i++)
+        FRAM_bus_complete(stripe->devices[i]->bus);
+
+    return i2c_result;
+}
+
+static uint32_t FRAM_raw_stripe_write_to_adr(const FRAM_stripe_t * const stripe, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t i2c_result=FRAM_NO_ERROR;
+    uint32_t adr_max=stripe->count*(stripe->devices[0]->adr_max+1)-1;
+    uint32_t dev_adr;
+    uint32_t part;
+    uint32_t done;
+    FRAM_t *dev;
+    uint8_t i;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>adr_max||count-1>adr_max-adr||stripe->stripe_size==0||(stripe->devices[0]->adr_max+1)%stripe->stripe_size!=0)
+        return FRAM_PARAMTER_ERROR;
+
+    //start the write of every unit without waiting, the writes of the previous units keep the other buses busy meanwhile
+    for(done=0;done<count&&i2c_result==FRAM_NO_ERROR;done+=part){
+
+        part=stripe->stripe_size-(adr+done)%stripe->stripe_size;
+        if(part>count-done)
+            part=count-done;
+
+        dev_adr=FRAM_stripe_map(stripe,adr+done,&dev);
+
+        i2c_result=FRAM_raw_write(dev,dev_adr,buffer+done,part,FRAM_DONT_WAIT);
+    }
+
+    //wait for the writes still running
+    for(i=0;i<stripe->count;i++)
+        FRAM_bus_complete(stripe->devices[i]->bus);
+
+    return i2c_result;
+}
+
+void FRAM_mirror_init(FRAM_mirror_t * const mirror, FRAM_t * const primary, FRAM_t * const secondary){
+
+    mirror->copy[0]=primary;
+    mirror->copy[1]=secondary;
+    mirror->src=0;
+    mirror->next=0;
+    mirror->resync_adr=FRAM_INVALID_ADR;
+    mirror->resync_end=0;
+}
+
+static uint32_t FRAM_raw_mirror_read_from_adr(FRAM_mirror_t * const mirror, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t i2c_result=FRAM_NO_ERROR;
+    uint32_t adr_max=FRAM_mirror_adr_max(mirror);
+    uint32_t start[2];
+    uint32_t part[2];
+    uint8_t first;
+    FRAM_t *dev;
+    uint8_t i;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>adr_max||count-1>adr_max-adr)
+        return FRAM_PARAMTER_ERROR;
+
+    //during a resync the addresses not copied yet are only valid in the copy it copies from
+    if(mirror->resync_adr!=FRAM_INVALID_ADR&&adr<=mirror->resync_end&&adr+count-1>=mirror->resync_adr)
+        return FRAM_raw_read_from_adr(mirror->copy[mirror->src],adr,buffer,count);
+
+    first=FRAM_mirror_pick(mirror,adr);
+
+    //small reads and copies sharing a bus gain nothing from splitting
+    if(count<FRAM_MIRROR_SPLIT_MIN||mirror->copy[0]->bus==mirror->copy[1]->bus)
+        return FRAM_raw_read_from_adr(mirror->copy[first],adr,buffer,count);
+
+    //the picked copy reads the first half, the other copy the second half
+    part[0]=count/2;
+    part[1]=count-part[0];
+    start[0]=adr;
+    start[1]=adr+part[0];
+
+    //set the address latches and start the reads on both buses without waiting
+    for(i=0;i<2&&i2c_result==FRAM_NO_ERROR;i++){
+        dev=mirror->copy[first^i];
+        if(dev->current_adr!=start[i])
+            i2c_result=FRAM_raw_set_adr(dev,start[i],FRAM_DONT_WAIT);
+        else
+            dev->stats.latch_hits++;
+    }
+
+    for(i=0;i<2&&i2c_result==FRAM_NO_ERROR;i++)
+        i2c_result=FRAM_raw_read_current_adr(mirror->copy[first^i],buffer+(start[i]-adr),part[i],FRAM_DONT_WAIT);
+
+    //wait for both halves
+    for(i=0;i<2;i++)
+        FRAM_bus_complete(mirror->copy[i]->bus);
+
+    return i2c_result;
+}
+
+static uint32_t FRAM_raw_mirror_write_to_adr(FRAM_mirror_t * const mirror, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t i2c_result[2];
+    uint32_t result;
+    uint32_t adr_max=FRAM_mirror_adr_max(mirror);
+    uint8_t i;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>adr_max||count-1>adr_max-adr)
+        return FRAM_PARAMTER_ERROR;
+
+    //start both writes without waiting, copies on different buses are written in parallel
+    for(i=0;i<2;i++)
+        i2c_result[i]=FRAM_raw_write(mirror->copy[i],adr,buffer,count,FRAM_DONT_WAIT);
+
+    for(i=0;i<2;i++)
+        FRAM_bus_complete(mirror->copy[i]->bus);
+
+    //the range of a copy that could not be written has to be restored from the other one
+    for(i=0;i<2;i++){
+        if(i2c_result[i]!=FRAM_NO_ERROR&&i2c_result[i^1]==FRAM_NO_ERROR){
+
+            //a running resync from the failed copy may overwrite the range, so it is finished and the range written again
+            if(mirror->resync_adr!=FRAM_INVALID_ADR&&mirror->src==i){
+                result=FRAM_mirror_finish(mirror);
+                if(result==FRAM_NO_ERROR)
+                    result=FRAM_raw_write(mirror->copy[i^1],adr,buffer,count,FRAM_WAIT);
+                if(result!=FRAM_NO_ERROR)
+                    return result;
+            }
+
+            FRAM_mirror_mark(mirror,i^1,adr,adr+count-1);
+        }
+    }
+
+    return i2c_result[0]!=FRAM_NO_ERROR?i2c_result[0]:i2c_result[1];
+}
+
+static uint32_t FRAM_raw_mirror_verify(FRAM_mirror_t * const mirror, uint32_t adr, uint32_t count){
+
+    uint8_t chunk[2][FRAM_MIRROR_CHUNK];
+    uint32_t i2c_result;
+    uint32_t adr_max=FRAM_mirror_adr_max(mirror);
+    uint32_t first=FRAM_INVALID_ADR;
+    uint32_t last=0;
+    uint32_t part;
+    uint32_t done;
+    uint32_t j;
+    uint8_t i;
+
+    //check if parameters are valid
+    if(count==0||adr>adr_max||count-1>adr_max-adr)
+        return FRAM_PARAMTER_ERROR;
+
+    //the copies differ in the range of a running resync, so it is finished first
+    i2c_result=FRAM_mirror_finish(mirror);
+    if(i2c_result!=FRAM_NO_ERROR)
+        return i2c_result;
+
+    for(done=0;done<count;done+=part){
+
+        part=count-done<FRAM_MIRROR_CHUNK?count-done:FRAM_MIRROR_CHUNK;
+
+        for(i=0;i<2;i++){
+            i2c_result=FRAM_raw_read_from_adr(mirror->copy[i],adr+done,chunk[i],part);
+            if(i2c_result!=FRAM_NO_ERROR)
+                return i2c_result;
+        }
+
+        for(j=0;j<part;j++){
+            if(chunk[0][j]!=chunk[1][j]){
+                if(first==FRAM_INVALID_ADR)
+                    first=adr+done+j;
+                last=adr+done+j;
+            }
+        }
+    }
+
+    if(first==FRAM_INVALID_ADR)
+        return FRAM_NO_ERROR;
+
+    //on a mismatch the primary copy wins
+    FRAM_mirror_mark(mirror,0,first,last);
+
+    return FRAM_MIRROR_MISMATCH;
+}
+
+static uint32_t FRAM_raw_mirror_resync(FRAM_mirror_t * const mirror){
+
+    uint8_t chunk[FRAM_MIRROR_CHUNK];
+    uint32_t i2c_result;
+    uint32_t adr=mirror->resync_adr;
+    uint32_t end=mirror->resync_end;
+    uint32_t part;
+
+    //nothing to do if the copies are in sync
+    if(adr==FRAM_INVALID_ADR)
+        return FRAM_NO_ERROR;
+
+    part=end-adr+1<FRAM_MIRROR_CHUNK?end-adr+1:FRAM_MIRROR_CHUNK;
+
+    i2c_result=FRAM_raw_read_from_adr(mirror->copy[mirror->src],adr,chunk,part);
+
+    if(i2c_result==FRAM_NO_ERROR)
+        i2c_result=FRAM_raw_write(mirror->copy[mirror->src^1],adr,chunk,part,FRAM_WAIT);
+
+    //only advance if the chunk was copied, a failed chunk is retried by the next call
+    if(i2c_result==FRAM_NO_ERROR&&mirror->resync_adr==adr)
+        mirror->resync_adr=adr+part>end?FRAM_INVALID_ADR:adr+part;
+
+    return i2c_result;
+}
+
+uint32_t FRAM_mirror_get_resync_adr(const FRAM_mirror_t * const mirror){return mirror->resync_adr;}
+
+static uint32_t FRAM_mirror_adr_max(const FRAM_mirror_t * const mirror){
+
+    //the mirror ends with the smaller chip
+    return mirror->copy[0]->adr_max<mirror->copy[1]->adr_max?mirror->copy[0]->adr_max:mirror->copy[1]->adr_max;
+}
+
+static uint8_t FRAM_mirror_pick(FRAM_mirror_t * const mirror, uint32_t adr){
+
+    const FRAM_i2c_t *i2c;
+    uint8_t copy;
+
+    //a copy whose latch already points to the address saves setting the address
+    for(copy=0;copy<2;copy++)
+        if(mirror->copy[copy]->current_adr==adr)
+            return copy;
+
+    //otherwise alternate between the copies, unless the bus of the preferred one is busy
+    copy=mirror->next;
+    mirror->next^=1;
+
+    i2c=mirror->copy[copy]->bus->i2c;
+    if(i2c->MasterStatus()&i2c->mstat_xfer_inp)
+        copy^=1;
+
+    return copy;
+}
+
+static void FRAM_mirror_mark(FRAM_mirror_t * const mirror, uint8_t src, uint32_t first, uint32_t last){
+
+    //a resync from the same copy is extended to span both ranges, copying the addresses in between does no harm
+    if(mirror->resync_adr!=FRAM_INVALID_ADR&&mirror->src==src){
+        if(first>mirror->resync_adr)
+            first=mirror->resync_adr;
+        if(last<mirror->resync_end)
+            last=mirror->resync_end;
+    }
+
+    mirror->src=src;
+    mirror->resync_adr=first;
+    mirror->resync_end=last;
+}
+
+static uint32_t FRAM_mirror_finish(FRAM_mirror_t * const mirror){
+
+    uint32_t i2c_result=FRAM_NO_ERROR;
+
+    while(mirror->resync_adr!=FRAM_INVALID_ADR&&i2c_result==FRAM_NO_ERROR)
+        i2c_result=FRAM_raw_mirror_resync(mirror);
+
+    return i2c_result;
+}
+
+static uint32_t FRAM_stripe_map(const FRAM_stripe_t * const stripe, uint32_t adr, FRAM_t ** const dev){
+
+    uint32_t unit=adr/stripe->stripe_size;
+
+    //the units are dealt out to the chips round robin
+    *dev=stripe->devices[unit%stripe->count];
+
+    return (unit/stripe->count)*stripe->stripe_size+adr%stripe->stripe_size;
+}
+
+static void FRAM_lock_devices(FRAM_t * const * const devices, uint8_t count, uint8_t lock){
+
+    FRAM_lock_t *last=NULL;
+    FRAM_lock_t *next;
+    uint8_t i;
+
+    //visit every distinct lock once, in the order of their addresses, so tasks locking overlapping sets of buses can not deadlock
+    do{
+        next=NULL;
+        for(i=0;i<count;i++){
+            FRAM_lock_t * const l=devices[i]->bus->lock;
+            if(l!=NULL&&(last==NULL||(uintptr_t)l>(uintptr_t)last)&&(next==NULL||(uintptr_t)l<(uintptr_t)next))
+                next=l;
+        }
+
+        if(next!=NULL){
+            if(lock==FRAM_LOCK)
+                FRAM_lock_acquire(next,FRAM_PRIO_NORMAL);
+            else
+                FRAM_lock_release(next);
+        }
+
+        last=next;
+    }while(next!=NULL);
+}
+
+static void FRAM_bus_complete(FRAM_bus_t * const bus){
+
+    //wait for Master to complete the running transfer
+    if(bus->pending!=0)
+        while (0u == (bus->i2c->MasterStatus() & bus->pending))   {/* busy wait */ }
+
+    bus->pending=0;
+
+    //the transfer is done, the output array is not needed anymore
+    free(bus->tx_buf);
+    bus->tx_buf=NULL;
+}
+
+static uint32_t FRAM_raw_write(FRAM_t * const fram, uint32_t adr, uint8_t * const buffer, uint32_t count, FRAM_wait_t wait){
+
+    FRAM_part_t part;
+
+    part.buffer=buffer;
+    part.count=count;
+
+    return FRAM_raw_write_parts(fram,adr,&part,1,wait);
+}
+
+static uint32_t FRAM_raw_write_parts(FRAM_t * const fram, uint32_t adr, const FRAM_part_t * const parts, uint8_t count, FRAM_wait_t wait){
+
     uint8_t adr_ary[FRAM_ADR_BYTES+1];
     uint32_t i2c_result;
     uint8_t* data_out;
-    uint8_t i,j;
-    
+    uint32_t total=0;
+    uint32_t i,j;
+    uint8_t p;
+    FRAM_bus_t * const bus=fram->bus;
+
     //check if parameters are valid
-    if(buffer==NULL||count==0)
+    if(parts==NULL||count==0)
+        return FRAM_PARAMTER_ERROR;
+
+    for(p=0;p<count;p++){
+        if(parts[p].buffer==NULL&&parts[p].count!=0)
+            return FRAM_PARAMTER_ERROR;
+        total+=parts[p].count;
+    }
+
+    if(total==0)
         return FRAM_PARAMTER_ERROR;
-    
+
     //check adress and prepare bytes
-    if(FRAM_prep_adr(adr,adr_ary)!=FRAM_NO_ERROR)
+    if(FRAM_prep_adr(fram,adr,adr_ary)!=FRAM_NO_ERROR)
         return FRAM_PARAMTER_ERROR;
-    
+
     //allocate memory for output array
-    data_out=malloc((count+FRAM_ADR_BYTES)*sizeof(uint8_t));
-    
-    //copy data into output array
+    data_out=malloc((total+FRAM_ADR_BYTES)*sizeof(uint8_t));
+    if(data_out==NULL)
+        return FRAM_MEMORY_ERROR;
+
+    //copy address and parts into output array
     for(i=0;i<FRAM_ADR_BYTES;i++)
         data_out[i]=adr_ary[i];
-    
-    for(j=0;i<FRAM_ADR_BYTES+count;i++,j++)
-        data_out[i]=buffer[j];
-        
-    //write to FRAM
-    i2c_result= I2C_API(_I2CMasterWriteBuf(adr_ary[FRAM_ADR_BYTES],data_out,FRAM_ADR_BYTES+count,I2C_API(_I2C_MODE_COMPLETE_XFER)));
-    
-    //wait for Master to complete previous transfer
-    while (0u == (I2C_API(_I2CMasterStatus()) & I2C_API(_I2C_MSTAT_WR_CMPLT)))   {/* busy wait */ }
-    
-    //if the I2C Operation succeeded: safe the set address as current
-    if(!(i2c_result& I2C_API(_I2C_MSTR_NO_ERROR )))
-        FRAM_current_adr=adr+count;
-    
+
+    for(p=0;p<count;p++)
+        for(j=0;j<parts[p].count;i++,j++)
+            data_out[i]=parts[p].buffer[j];
+
+    //the bus can only run one transfer at a time
+    FRAM_bus_complete(bus);
+
+    //write to FRAM, the output array is freed when the transfer completed
+    i2c_result=bus->i2c->MasterWriteBuf(adr_ary[FRAM_ADR_BYTES],data_out,FRAM_ADR_BYTES+total,bus->i2c->mode_complete_xfer);
+    bus->tx_buf=data_out;
+
+    //if the I2C Operation succeeded: safe the set address as current. The latch wraps around at the end of the chip.
+    if(i2c_result==bus->i2c->mstr_no_error){
+        bus->pending=bus->i2c->mstat_wr_cmplt;
+        fram->current_adr=(adr+total)%(fram->adr_max+1);
+        fram->stats.writes++;
+        fram->stats.bytes_written+=total;
+    }
+    else
+        fram->stats.errors++;
+
+    //wait for Master to complete the transfer
+    if(wait==FRAM_WAIT)
+        FRAM_bus_complete(bus);
+
     return i2c_result;
 }
 
-static uint32_t FRAM_prep_adr(uint32_t adr, uint8_t * const adr_ary){
-    
+static uint32_t FRAM_prep_adr(const FRAM_t * const fram, uint32_t adr, uint8_t * const adr_ary){
+
     //check if adress is in range
-    if(adr>FRAM_ADR_MAX)
+    if(adr>fram->adr_max)
         return FRAM_PARAMTER_ERROR;
-    
+
     //Address MSB
     adr_ary[0]=adr>>FRAM_MSB_SHIFT;
-    
+
     //Address LSB
     adr_ary[1]=adr;
-    
-    //modify slave adr to include the Page Select (PS) bit
-    adr_ary[2]=FRAM_SLAVE_ADR|((adr&FRAM_PS_MASK)>>FRAM_PS_SHIFT);
-    
+
+    //modify slave adr to include the Page Select (PS) bit. It only loads bit 16 of the latch when the transfer starts,
+    //the latch counts on across 0x10000 like at any other address, so a transfer crossing it is not split.
+    adr_ary[2]=fram->slave_adr|((adr&FRAM_PS_MASK)>>FRAM_PS_SHIFT);
+
     return FRAM_NO_ERROR;
 }
 
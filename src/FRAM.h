@@ -1,7 +1,7 @@
 /**
  * @file FRAM.h
  * @author  Thomas Barth <thomas@barth-dev.de>
- * @version 1.0
+ * @version 2.0
  *
  * @section LICENSE
  *
@@ -29,16 +29,33 @@
 **                      Includes                                              **
 *******************************************************************************/
 #include <stdint.h>
+#include "FRAM_lock.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
 
 /*******************************************************************************
 **                      Macros                                                **
 *******************************************************************************/
-#define I2C_INSTANCE            I2C                     //Name of the I2C Instance to be used
 #define FRAM_SLAVE_ADR          0x50                    //I2C Slave address of the FRAM On the PSoC4 CY8CKIT-042-BLE Pioneer Kit the slave adress is 0x50. The user can change the Slave-Address by relocating R32/36 and R33/37.
 #define FRAM_ADR_MAX            0x1ffff                 //the highest address of the FRAM
+#define FRAM_DEVICE_SIZE        (FRAM_ADR_MAX+1u)       //number of bytes of one FRAM chip
+#define FRAM_ADR_BYTES          2                       //number of address bytes send in front of the data of a write
+
+#define FRAM_CHUNK_SIZE         256u                    //reads and writes of buses with a lock are split into chunks of this many bytes, higher priority classes may use the bus between two chunks
+
+#define FRAM_MIRROR_SPLIT_MIN   64u                     //mirrored reads of at least this many bytes are split between both copies if they are connected to different I2C instances
+#define FRAM_MIRROR_CHUNK       32u                     //number of bytes compared by "FRAM_mirror_verify" and copied by "FRAM_mirror_resync" per transfer
+
+#define FRAM_I2C(inst)          _FRAM_I2C(inst)         //initializer of a FRAM_i2c_t for the I2C instance inst, e.g. "static const FRAM_i2c_t i2c=FRAM_I2C(I2C);"
+#define _FRAM_I2C(inst)         {inst##_Start,inst##_I2CMasterWriteBuf,inst##_I2CMasterReadBuf,inst##_I2CMasterStatus, \
+                                 inst##_I2C_MODE_COMPLETE_XFER,inst##_I2C_MSTAT_WR_CMPLT,inst##_I2C_MSTAT_RD_CMPLT,inst##_I2C_MSTAT_XFER_INP,inst##_I2C_MSTR_NO_ERROR}
 
 #define FRAM_INVALID_ADR        0xffffffff              //address given back by "FRAM_get_adr" if the value of the FRAM address latch is unknown to the driver.
 #define FRAM_PARAMTER_ERROR     0x200u                  //indicates a parameter error of a function
+#define FRAM_MEMORY_ERROR       0x400u                  //indicates that a function could not allocate its transfer buffer
+#define FRAM_MIRROR_MISMATCH    0x800u                  //indicates that the two copies of the mirror differ
 #define FRAM_NO_ERROR           0                       //indicates that a function succeeded
 
 /*******************************************************************************
@@ -46,18 +63,157 @@
 *******************************************************************************/
 typedef enum {FRAM_WAIT, FRAM_DONT_WAIT} FRAM_wait_t;   //TODO
 
+/**
+API of an I2C instance
+
+Holds the functions and constants of one I2C instance generated by PSoC Creator. Use FRAM_I2C to fill it.
+*/
+typedef struct {
+    void        (*Start)(void);
+    uint32_t    (*MasterWriteBuf)(uint32_t slaveAddress, uint8_t * wrData, uint32_t cnt, uint32_t mode);
+    uint32_t    (*MasterReadBuf)(uint32_t slaveAddress, uint8_t * rdData, uint32_t cnt, uint32_t mode);
+    uint32_t    (*MasterStatus)(void);
+    uint32_t    mode_complete_xfer;                     //"_I2C_MODE_COMPLETE_XFER"
+    uint32_t    mstat_wr_cmplt;                         //"_I2C_MSTAT_WR_CMPLT"
+    uint32_t    mstat_rd_cmplt;                         //"_I2C_MSTAT_RD_CMPLT"
+    uint32_t    mstat_xfer_inp;                         //"_I2C_MSTAT_XFER_INP"
+    uint32_t    mstr_no_error;                          //"_I2C_MSTR_NO_ERROR"
+} FRAM_i2c_t;
+
+/**
+An I2C bus
+
+Shared by all FRAM chips connected to the same I2C instance. The bus runs one transfer at a time.
+Initialise it with "FRAM_bus_init", the members are private to the driver.
+If several tasks use the bus, give it a lock with "FRAM_bus_set_lock": every function of the driver then holds the lock of all buses it uses for its whole run,
+e.g. "FRAM_read_from_adr" can not be interleaved with another task between setting the address and reading.
+*/
+typedef struct {
+    const FRAM_i2c_t *i2c;                              //API of the I2C instance
+    uint32_t    pending;                                //status flag the running transfer completes with, 0 if the bus is idle
+    uint8_t     adr[FRAM_ADR_BYTES];                    //address bytes of a running "FRAM_set_adr", they have to outlive the call
+    uint8_t     *tx_buf;                                //output array of a running write, freed when the transfer completed
+    FRAM_lock_t *lock;                                  //lock serialising the tasks using the bus, NULL if the bus is used by one task only
+} FRAM_bus_t;
+
+/**
+Transfer statistics of a FRAM chip
+*/
+typedef struct {
+    uint32_t    reads;                                  //number of read transfers
+    uint32_t    writes;                                 //number of write transfers, without the ones of "FRAM_set_adr"
+    uint32_t    set_adrs;                               //number of transfers setting the address latch
+    uint32_t    latch_hits;                             //number of reads that could skip setting the address latch
+    uint32_t    bytes_read;                             //number of data bytes read
+    uint32_t    bytes_written;                          //number of data bytes written
+    uint32_t    errors;                                 //number of transfers the I2C module refused
+} FRAM_stats_t;
+
+/**
+A FRAM chip
+
+Carries the bus the chip is connected to, its slave address and size, the driver's copy of the address latch and the statistics.
+Initialise it with "FRAM_init", the members are private to the driver.
+Any number of chips can be driven at the same time, the functions only touch the chip and bus handed to them.
+*/
+typedef struct {
+    FRAM_bus_t  *bus;                                   //bus the chip is connected to
+    uint8_t     slave_adr;                              //I2C Slave address of the chip
+    uint32_t    adr_max;                                //the highest address of the chip
+    uint32_t    current_adr;                            //address the internal latch is pointing to, FRAM_INVALID_ADR if unknown
+    FRAM_stats_t stats;                                 //transfer statistics
+} FRAM_t;
+
+/**
+Linear address space over several FRAM chips
+
+Chip n of devices holds the addresses following the last address of chip n-1.
+*/
+typedef struct {
+    FRAM_t * const *devices;                            //the chips in address order
+    uint8_t     count;                                  //number of chips
+} FRAM_array_t;
+
+/**
+Striped address space over several FRAM chips
+
+The addresses are dealt out to the chips in units of stripe_size bytes:
+unit 0 is stored on the first chip, unit 1 on the second chip and so on, wrapping around to the first chip after the last one.
+*/
+typedef struct {
+    FRAM_t * const *devices;                            //the striped chips, best connected to different I2C instances
+    uint8_t     count;                                  //number of chips
+    uint32_t    stripe_size;                            //number of consecutive bytes placed on one chip. Has to divide the size of the chips.
+} FRAM_stripe_t;
+
+/**
+Mirrored pair of FRAM chips
+
+Initialise it with "FRAM_mirror_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *copy[2];                               //the chips holding the copies, copy[0] holds the primary copy
+    uint8_t     src;                                    //copy "FRAM_mirror_resync" copies from
+    uint8_t     next;                                   //copy the next balanced read prefers
+    uint32_t    resync_adr;                             //next address "FRAM_mirror_resync" copies, FRAM_INVALID_ADR if the copies are in sync
+    uint32_t    resync_end;                             //last address "FRAM_mirror_resync" copies
+} FRAM_mirror_t;
+
+/**
+One buffer of a gather write, see "FRAM_write_parts_to_adr"
+*/
+typedef struct {
+    const uint8_t *buffer;                              //pointer to the data of the part
+    uint32_t    count;                                  //number of bytes of the part
+} FRAM_part_t;
+
 /*******************************************************************************
 **                      Declarations                                          **
 *******************************************************************************/
+/**
+Initialise an I2C bus
+
+Binds the bus to an I2C instance. Call it once for every I2C instance before initialising the chips connected to it.
+
+@param bus the bus to be initialised
+@param i2c API of the I2C instance, see FRAM_I2C
+@return void
+*/
+void        FRAM_bus_init(FRAM_bus_t * const bus, const FRAM_i2c_t * const i2c);
+
+/**
+Set the lock of an I2C bus
+
+Makes every function of the driver using the bus atomic towards the other tasks using it. See "FRAM_lock.h".
+Several buses may share one lock. Call it before the bus is used by more than one task.
+
+@param bus the bus
+@param lock the lock, NULL to use the bus without locking
+@return void
+*/
+void        FRAM_bus_set_lock(FRAM_bus_t * const bus, FRAM_lock_t * const lock);
+
+/**
+Initialise a FRAM chip
+
+The chip is an FM24V10 with the size FRAM_ADR_MAX+1. Its address latch is unknown until the first transfer.
+
+@param fram the chip to be initialised
+@param bus the bus the chip is connected to
+@param slave_adr the I2C Slave address of the chip, e.g. FRAM_SLAVE_ADR
+@return void
+*/
+void        FRAM_init(FRAM_t * const fram, FRAM_bus_t * const bus, uint8_t slave_adr);
+
 /**
 Start the I2C instance
 
-Calls the "Start" Function of the I2C instance given by I2C_INSTANCE
+Calls the "Start" Function of the I2C instance the chip is connected to
 
-@param  void
+@param fram the chip
 @return void
 */
-void        FRAM_Start(void);
+void        FRAM_Start(FRAM_t * const fram);
 
 /**
 Gets the address the FRAM internaly is currently pointing to
@@ -68,31 +224,47 @@ This function returns the address that was calculated based on the called functi
 Note that this value might be corrupted if the FRAM is repowered or similar.
 If you are unsure if the internal adress is valid, use "FRAM_set_adr" to set the address manually.
 
-@param  void
+@param fram the chip
 @return the current address. Is FRAM_INVALID_ADR if the address could not be determined
 */
-uint32_t    FRAM_get_adr(void);
+uint32_t    FRAM_get_adr(const FRAM_t * const fram);
 
 /**
 Get the I2C Slave ID of the FRAM
 
-Returns the I2C Slave address of the FRAM defined in FRAM_SLAVE_ADR. On the PSoC4 CY8CKIT-042-BLE Pioneer Kit the slave adress is 0x50. 
+Returns the I2C Slave address the chip was initialised with. On the PSoC4 CY8CKIT-042-BLE Pioneer Kit the slave adress is 0x50.
 The user can change the Slave-Address by relocating R32/36 and R33/37.
 
-@param  void
+@param fram the chip
 @return the current I2C slave address of the FRAM.
 */
-uint8_t     FRAM_get_slave_adr(void);
+uint8_t     FRAM_get_slave_adr(const FRAM_t * const fram);
 
 /**
 Get the I2C Master Status
 
-Returns the result of the function "_I2CMasterStatus" executed on the I2C instance I2C_INSTANCE
+Returns the result of the function "_I2CMasterStatus" executed on the I2C instance the chip is connected to
 
-@param  void
+@param fram the chip
 @return result of "_I2CMasterStatus"
 */
-uint32_t    FRAM_I2C_Status(void);
+uint32_t    FRAM_I2C_Status(const FRAM_t * const fram);
+
+/**
+Get the transfer statistics of the FRAM
+
+@param fram the chip
+@return the statistics collected since "FRAM_init" or the last "FRAM_clear_stats"
+*/
+const FRAM_stats_t* FRAM_get_stats(const FRAM_t * const fram);
+
+/**
+Clear the transfer statistics of the FRAM
+
+@param fram the chip
+@return void
+*/
+void        FRAM_clear_stats(FRAM_t * const fram);
 
 /**
 Set the address the FRAM is pointing to
@@ -101,13 +273,14 @@ The FRAM has an internal address latch which determines the datacell that is wri
 With this function the user can set the value of this address latch.
 The information about the current address will be updated if the operation succeeded
 
-@param adr the address to be set 
+@param fram the chip
+@param adr the address to be set
 TODO
-@return FRAM_PARAMTER_ERROR if the address is bigger than FRAM_ADR_MAX
+@return FRAM_PARAMTER_ERROR if the address is bigger than the highest address of the chip
         FRAM_NO_ERROR if the operation succeeded
         any other value is the output of "_I2CMasterWriteBuf" and indicates an error in the I2C module
 */
-uint32_t    FRAM_set_adr(uint32_t adr, FRAM_wait_t wait);
+uint32_t    FRAM_set_adr(FRAM_t * const fram, uint32_t adr, FRAM_wait_t wait);
 
 /**
 Reads data from the current address
@@ -117,6 +290,7 @@ With this function the user can read data based on the value of th address latch
 The user might want to use "FRAM_get_adr" to get the current address or use "FRAM_set_adr" to set it.
 The information about the current address will be updated if the operation succeeded.
 
+@param fram the chip
 @param buffer pointer to the memory where the received data will be stored
 @param count number of bytes to be read
 TODO
@@ -124,41 +298,293 @@ TODO
         FRAM_NO_ERROR if the operation succeeded
         any other value is the output of "_I2CMasterReadBuf" and indicates an error in the I2C module
 */
-uint32_t    FRAM_read_current_adr(uint8_t * const buffer, uint32_t count, FRAM_wait_t wait);
+uint32_t    FRAM_read_current_adr(FRAM_t * const fram, uint8_t * const buffer, uint32_t count, FRAM_wait_t wait);
 
 /**
 Reads data from a given address
 
 With this function the user can read a number of bytes at a given address.
 The information about the current address will be updated if the operation succeeded.
-This function relies on the address saved in the driver. 
+This function relies on the address saved in the driver.
 If the calculated address of the internal address latch matches the given address, this funktion skipps "FRAM_set_adr" which results in a faster execution.
 If the user can not rely on the calculated address, it is safer to first call FRAM_set_adr manually to make sure the driver-value and the value of the internal address latch match.
 
+@param fram the chip
 @param adr address to be read
 @param buffer pointer to the memory where the received data will be stored
 @param count number of bytes to be read
 TODO
-@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0 or the address is bigger than FRAM_ADR_MAX
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0 or the address is bigger than the highest address of the chip
         FRAM_NO_ERROR if the operation succeeded
         any other value is the output of "_I2CMasterReadBuf" ( if "FRAM_set_adr" is called internally, the output might also come from "_I2CMasterWriteBuf") and indicates an error in the I2C module.
 */
-uint32_t    FRAM_read_from_adr(uint32_t adr, uint8_t * const buffer, uint32_t count);
+uint32_t    FRAM_read_from_adr(FRAM_t * const fram, uint32_t adr, uint8_t * const buffer, uint32_t count);
 
 /**
 Writes data to a given address
 
 With this function the user can write a number of bytes at a given address.
 
+@param fram the chip
 @param adr address to be written
 @param buffer pointer to the memory where the data to be send is stored
 @param count number of bytes to be written
 TODO
-@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0 or the address is bigger than FRAM_ADR_MAX
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0 or the address is bigger than the highest address of the chip
+        FRAM_MEMORY_ERROR if the transfer buffer could not be allocated
+        FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "_I2CMasterWriteBuf" and indicates an error in the I2C module.
+*/
+uint32_t    FRAM_write_to_adr(FRAM_t * const fram, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Reads data from a given address with a priority class
+
+Same as "FRAM_read_from_adr", which uses FRAM_PRIO_NORMAL. If the bus has a lock, the read is split into chunks of FRAM_CHUNK_SIZE bytes
+and waiting tasks of higher classes get the bus between two chunks. If one of them moved the address latch, it is set again before the next chunk.
+The read keeps its place meanwhile: tasks of the same and lower classes only get the bus once it is complete.
+See "FRAM_lock.h".
+
+@param fram the chip
+@param prio the priority class of the read
+@param adr address to be read
+@param buffer pointer to the memory where the received data will be stored
+@param count number of bytes to be read
+@return see "FRAM_read_from_adr". If a chunk fails, the remaining chunks are not read.
+*/
+uint32_t    FRAM_read_from_adr_prio(FRAM_t * const fram, FRAM_prio_t prio, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Writes data to a given address with a priority class
+
+Same as "FRAM_write_to_adr", which uses FRAM_PRIO_NORMAL. If the bus has a lock, the write is split into chunks of FRAM_CHUNK_SIZE bytes
+and waiting tasks of higher classes get the bus between two chunks. The write keeps its place meanwhile: tasks of the same
+and lower classes only get the bus once it is complete. See "FRAM_lock.h".
+
+@param fram the chip
+@param prio the priority class of the write
+@param adr address to be written
+@param buffer pointer to the memory where the data to be send is stored
+@param count number of bytes to be written
+@return see "FRAM_write_to_adr". If a chunk fails, the remaining chunks are not written.
+*/
+uint32_t    FRAM_write_to_adr_prio(FRAM_t * const fram, FRAM_prio_t prio, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Writes several buffers to consecutive addresses in one transfer
+
+The parts are written back to back starting at adr, e.g. a record header and its payload without copying them together first.
+The write is never split into chunks, so it costs a single I2C transfer.
+
+@param fram the chip
+@param adr address the first part is written to
+@param parts the buffers to be written
+@param count number of parts
+@return FRAM_PARAMTER_ERROR if either parts points to NULL, count is 0, a part with data has a NULL buffer, all parts are empty or the address is bigger than the highest address of the chip
+        FRAM_MEMORY_ERROR if the transfer buffer could not be allocated
         FRAM_NO_ERROR if the operation succeeded
         any other value is the output of "_I2CMasterWriteBuf" and indicates an error in the I2C module.
 */
-uint32_t    FRAM_write_to_adr(uint32_t adr, uint8_t * const buffer, uint32_t count);
+uint32_t    FRAM_write_parts_to_adr(FRAM_t * const fram, uint32_t adr, const FRAM_part_t * const parts, uint8_t count);
+
+/**
+Get the highest address of a linear address space
+
+@param array the chips forming the address space
+@return the highest address of the address space
+*/
+uint32_t    FRAM_array_get_adr_max(const FRAM_array_t * const array);
+
+/**
+Reads data from a linear address space over several chips
+
+A read that crosses the end of a chip is split into one read per chip.
+Like "FRAM_read_from_adr", setting the address is skipped for every chip whose address latch already points to the right address.
+
+@param array the chips forming the address space
+@param adr address in the linear address space to be read
+@param buffer pointer to the memory where the received data will be stored
+@param count number of bytes to be read
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0 or the range exceeds the address space
+        FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of the I2C module of the first failing chip. The chips after it are not read.
+*/
+uint32_t    FRAM_array_read_from_adr(const FRAM_array_t * const array, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Writes data to a linear address space over several chips
+
+A write that crosses the end of a chip is split into one write per chip.
+
+@param array the chips forming the address space
+@param adr address in the linear address space to be written
+@param buffer pointer to the memory where the data to be send is stored
+@param count number of bytes to be written
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0 or the range exceeds the address space
+        FRAM_MEMORY_ERROR if the transfer buffer could not be allocated
+        FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of the I2C module of the first failing chip. The chips after it are not written.
+*/
+uint32_t    FRAM_array_write_to_adr(const FRAM_array_t * const array, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Reads data from a striped address space
+
+The units of one chip are stored back to back, so a read only has to set the address latch once per chip.
+The read of a unit is started without waiting for the read of the previous unit if both chips are connected to different I2C instances,
+so the chips are read in parallel.
+The chips have to be of the same size, the address space ends at count times the size of a chip.
+
+@param stripe the striped chips
+@param adr address in the striped address space to be read
+@param buffer pointer to the memory where the received data will be stored
+@param count number of bytes to be read
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0, the range exceeds the address space or the stripe size does not divide the size of the chips
+        FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of the I2C module of the first failing chip. The remaining units are not read.
+*/
+uint32_t    FRAM_stripe_read_from_adr(const FRAM_stripe_t * const stripe, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Writes data to a striped address space
+
+See "FRAM_stripe_read_from_adr" for the address layout. The units of chips connected to different I2C instances are written in parallel.
+
+@param stripe the striped chips
+@param adr address in the striped address space to be written
+@param buffer pointer to the memory where the data to be send is stored
+@param count number of bytes to be written
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0, the range exceeds the address space or the stripe size does not divide the size of the chips
+        FRAM_MEMORY_ERROR if a transfer buffer could not be allocated
+        FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of the I2C module of the first failing chip. The remaining units are not written.
+*/
+uint32_t    FRAM_stripe_write_to_adr(const FRAM_stripe_t * const stripe, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Initialise a mirrored pair of FRAM chips
+
+Both chips hold identical copies of the addresses 0 to the highest address of the smaller chip.
+The copies are assumed to be in sync, call "FRAM_mirror_verify" if unsure.
+
+@param mirror the mirror to be initialised
+@param primary the chip holding the primary copy
+@param secondary the chip holding the secondary copy, best connected to a different I2C instance than the primary one
+@return void
+*/
+void        FRAM_mirror_init(FRAM_mirror_t * const mirror, FRAM_t * const primary, FRAM_t * const secondary);
+
+/**
+Reads data from a mirror
+
+The copy to be read is the one whose address latch already points to the given address. If there is none, the reads alternate between both copies,
+skipping a copy whose I2C instance is busy.
+Reads of at least FRAM_MIRROR_SPLIT_MIN bytes are split in half if the copies are connected to different I2C instances: both halves are read in parallel.
+While "FRAM_mirror_resync" is restoring a copy, addresses it did not reach yet are only read from the copy it copies from.
+
+@param mirror the mirror
+@param adr address to be read
+@param buffer pointer to the memory where the received data will be stored
+@param count number of bytes to be read
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0 or the range exceeds the mirror
+        FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of the I2C module and indicates an error in the I2C module.
+*/
+uint32_t    FRAM_mirror_read_from_adr(FRAM_mirror_t * const mirror, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Writes data to a mirror
+
+Writes both copies of the mirror, in parallel if they are connected to different I2C instances.
+If only one copy could be written, a resync of the written range from the written copy is started. See "FRAM_mirror_resync".
+If a resync from the copy that failed is still running, it is finished first and the range is written again to the other copy.
+
+@param mirror the mirror
+@param adr address to be written
+@param buffer pointer to the memory where the data to be send is stored
+@param count number of bytes to be written
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0 or the range exceeds the mirror
+        FRAM_MEMORY_ERROR if a transfer buffer could not be allocated
+        FRAM_NO_ERROR if both copies were written
+        any other value is the output of the I2C module of the first failing copy.
+*/
+uint32_t    FRAM_mirror_write_to_adr(FRAM_mirror_t * const mirror, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Compares both copies of a mirror
+
+Reads a range from both copies in chunks of FRAM_MIRROR_CHUNK bytes and compares them. A running resync is finished first.
+On a mismatch, a resync from the primary copy of the addresses from the first to the last mismatch is started. See "FRAM_mirror_resync".
+
+@param mirror the mirror
+@param adr first address to be compared
+@param count number of bytes to be compared
+@return FRAM_PARAMTER_ERROR if the count is 0 or the range exceeds the mirror
+        FRAM_MIRROR_MISMATCH if the copies differ
+        FRAM_NO_ERROR if the copies are equal
+        any other value is the output of the I2C module and indicates an error in the I2C module.
+*/
+uint32_t    FRAM_mirror_verify(FRAM_mirror_t * const mirror, uint32_t adr, uint32_t count);
+
+/**
+Continues restoring a copy of a mirror
+
+After a mismatch or a failed write, the affected range of one copy of the mirror is restored from the other one.
+Ranges of several failures are merged into one range spanning all of them.
+Every call copies the next FRAM_MIRROR_CHUNK bytes, so the resync can run in the background, e.g. from the idle loop, between the other FRAM operations.
+The call does nothing if the copies are in sync.
+
+@param mirror the mirror
+@return FRAM_NO_ERROR if the operation succeeded or there was nothing to do
+        any other value is the output of the I2C module and indicates an error in the I2C module. The chunk is retried by the next call.
+*/
+uint32_t    FRAM_mirror_resync(FRAM_mirror_t * const mirror);
+
+/**
+Gets the progress of the resync of a mirror
+
+@param mirror the mirror
+@return the next address to be copied by "FRAM_mirror_resync", the copies differ at most up to the end of the affected range. Is FRAM_INVALID_ADR if the copies are in sync.
+*/
+uint32_t    FRAM_mirror_get_resync_adr(const FRAM_mirror_t * const mirror);
+
+/**
+Store a 32 bit value in little endian byte order, the byte order of the records the modules keep on the chip
+
+@param out pointer to the 4 bytes the value is stored to
+@param value the value
+@return void
+*/
+void        FRAM_store32(uint8_t * const out, uint32_t value);
+
+/**
+Store a 16 bit value in little endian byte order
+
+@param out pointer to the 2 bytes the value is stored to
+@param value the value
+@return void
+*/
+void        FRAM_store16(uint8_t * const out, uint16_t value);
+
+/**
+Load a 32 bit value stored in little endian byte order
+
+@param in pointer to the 4 bytes of the value
+@return the value
+*/
+uint32_t    FRAM_load32(const uint8_t * const in);
+
+/**
+Load a 16 bit value stored in little endian byte order
+
+@param in pointer to the 2 bytes of the value
+@return the value
+*/
+uint16_t    FRAM_load16(const uint8_t * const in);
+
+#if defined(__cplusplus)
+}
+#endif
 
 #endif /* (FRAM_H) */
 
@@ -0,0 +1,436 @@
+/**
+ * @file FRAM.hpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Header-only C++17 front-end of the FRAM driver.
+ * fram::Fram<Device,Bus> drives one FRAM chip. The chip (size, address width, page select bits) and the I2C instance are template parameters,
+ * so address preparation and range checks of constant addresses are done by the compiler and the I2C functions are called directly instead of through pointers.
+ * Short writes use a transfer buffer inside the object instead of the heap, longer ones send the address and then the buffer of the caller byte by byte in one transfer.
+ * set_adr, read_current and write_chunk can return before the transfer is done (FRAM_DONT_WAIT), buffers have to stay valid until then.
+ * The next call using the bus waits for such a transfer first, like the C driver does, so the transfer buffer is never overwritten while it is sent.
+ * It uses the same error codes as the C driver and does not need FRAM.c.
+ */
+
+#if !defined(FRAM_HPP)
+#define FRAM_HPP
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#if __cplusplus>=202002L && __has_include(<span>)
+#include <span>
+#endif
+#include "FRAM.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+//defines the bus policy "name" for the I2C instance inst generated by PSoC Creator, e.g. "FRAM_CPP_BUS(I2cBus,I2C)"
+#define FRAM_CPP_BUS(name,inst)     _FRAM_CPP_BUS(name,inst)
+#define _FRAM_CPP_BUS(name,inst)                                                                                                \
+    struct name {                                                                                                               \
+        static void     start(void){inst##_Start();}                                                                            \
+        static uint32_t write(uint32_t slave, uint8_t *data, uint32_t cnt){return inst##_I2CMasterWriteBuf(slave,data,cnt,inst##_I2C_MODE_COMPLETE_XFER);} \
+        static uint32_t read(uint32_t slave, uint8_t *data, uint32_t cnt){return inst##_I2CMasterReadBuf(slave,data,cnt,inst##_I2C_MODE_COMPLETE_XFER);}   \
+        static uint32_t status(void){return inst##_I2CMasterStatus();}                                                          \
+        static uint32_t send_start(uint32_t slave){return inst##_I2CMasterSendStart(slave,inst##_I2C_WRITE_XFER_MODE);}         \
+        static uint32_t write_byte(uint8_t data){return inst##_I2CMasterWriteByte(data);}                                       \
+        static uint32_t send_stop(void){return inst##_I2CMasterSendStop();}                                                     \
+        static constexpr uint32_t wr_cmplt=inst##_I2C_MSTAT_WR_CMPLT;                                                           \
+        static constexpr uint32_t rd_cmplt=inst##_I2C_MSTAT_RD_CMPLT;                                                           \
+        static constexpr uint32_t xfer_inp=inst##_I2C_MSTAT_XFER_INP;                                                           \
+        static constexpr uint32_t no_error=inst##_I2C_MSTR_NO_ERROR;                                                            \
+    }
+
+namespace fram {
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+#if __cplusplus>=202002L && __has_include(<span>)
+template<class T> using span=std::span<T>;
+#else
+/**
+Minimal std::span for C++17, dynamic extent only
+*/
+template<class T>
+class span {
+public:
+    constexpr span() noexcept : data_(nullptr), size_(0) {}
+    constexpr span(T *data, std::size_t size) noexcept : data_(data), size_(size) {}
+    template<std::size_t N>
+    constexpr span(T (&array)[N]) noexcept : data_(array), size_(N) {}
+    template<class C, class=std::enable_if_t<std::is_convertible_v<decltype(std::declval<C&>().data()),T*>>>
+    constexpr span(C &container) noexcept : data_(container.data()), size_(container.size()) {}
+    template<class U, class=std::enable_if_t<std::is_convertible_v<U(*)[],T(*)[]>>>
+    constexpr span(const span<U> &other) noexcept : data_(other.data()), size_(other.size()) {}
+
+    constexpr T*          data() const noexcept {return data_;}
+    constexpr std::size_t size() const noexcept {return size_;}
+    constexpr bool        empty() const noexcept {return size_==0;}
+    constexpr T&          operator[](std::size_t i) const noexcept {return data_[i];}
+    constexpr T*          begin() const noexcept {return data_;}
+    constexpr T*          end() const noexcept {return data_+size_;}
+    constexpr span        subspan(std::size_t offset, std::size_t count) const noexcept {return span(data_+offset,count);}
+
+private:
+    T           *data_;
+    std::size_t size_;
+};
+#endif
+
+/**
+Cypress FM24V10, 128 KB, 2 address bytes, address bit 16 in bit 0 of the slave address
+*/
+template<uint8_t SlaveAdr=FRAM_SLAVE_ADR>
+struct FM24V10 {
+    static constexpr uint8_t  slave_adr=SlaveAdr;       //I2C Slave address of the chip
+    static constexpr uint32_t adr_max=0x1ffff;          //the highest address of the chip
+    static constexpr uint8_t  adr_bytes=2;              //number of address bytes send in front of the data, the address bits above them go into the low bits of the slave address
+};
+
+/**
+Cypress FM24V05, 64 KB, 2 address bytes
+*/
+template<uint8_t SlaveAdr=FRAM_SLAVE_ADR>
+struct FM24V05 {
+    static constexpr uint8_t  slave_adr=SlaveAdr;
+    static constexpr uint32_t adr_max=0xffff;
+    static constexpr uint8_t  adr_bytes=2;
+};
+
+/**
+Cypress FM24CL16B, 2 KB, 1 address byte, address bits 8 to 10 in bits 0 to 2 of the slave address
+*/
+template<uint8_t SlaveAdr=FRAM_SLAVE_ADR>
+struct FM24CL16B {
+    static constexpr uint8_t  slave_adr=SlaveAdr;
+    static constexpr uint32_t adr_max=0x7ff;
+    static constexpr uint8_t  adr_bytes=1;
+};
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+A FRAM chip
+
+The page select bits in the slave address only load the upper bits of the address latch when a transfer starts.
+The latch of the chip is one counter over all address bits, so a transfer runs on across a page select boundary like it does at any other address.
+Ranges are therefore not split there, the same as in the C driver, every read and write is one transfer.
+
+@tparam Device the chip, e.g. FM24V10<0x50>
+@tparam Bus the bus policy of the I2C instance, see FRAM_CPP_BUS
+@tparam TxSize number of data bytes of the transfer buffer, longer writes are sent byte by byte from the buffer of the caller
+*/
+template<class Device, class Bus, std::size_t TxSize=64>
+class Fram {
+public:
+    using device=Device;
+    using bus=Bus;
+
+    static constexpr uint32_t adr_max=Device::adr_max;
+    static constexpr uint32_t invalid_adr=FRAM_INVALID_ADR;
+    static constexpr std::size_t tx_size=TxSize;
+
+    /**
+    Start the I2C instance
+    */
+    void start(){Bus::start(); current_adr_=invalid_adr; pending_=0;}
+
+    /**
+    Checks if a transfer started with FRAM_DONT_WAIT is still running
+
+    @return true while the transfer is running
+    */
+    bool busy(){
+
+        if(pending_!=0&&0u!=(Bus::status()&pending_))
+            pending_=0;
+
+        return pending_!=0;
+    }
+
+    /**
+    Waits for a transfer started with FRAM_DONT_WAIT, returns right away if none is running
+    */
+    void complete(){
+
+        if(pending_!=0)
+            this->wait(pending_);
+
+        pending_=0;
+    }
+
+    /**
+    Gets the address the internal latch is pointing to, see "FRAM_get_adr"
+    */
+    uint32_t adr() const {return current_adr_;}
+
+    /**
+    Set the address the FRAM is pointing to, see "FRAM_set_adr"
+
+    @param wait FRAM_DONT_WAIT returns once the transfer is started, it is done when the status of the bus shows Bus::wr_cmplt
+    @return FRAM_PARAMTER_ERROR, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t set_adr(uint32_t adr, FRAM_wait_t wait=FRAM_WAIT){
+
+        uint8_t slave;
+        uint32_t i2c_result;
+
+        if(adr>adr_max)
+            return FRAM_PARAMTER_ERROR;
+
+        //the address buffer may still be sent by the previous call
+        complete();
+
+        prep_adr(adr,adr_buf_.data(),slave);
+        i2c_result=Bus::write(slave,adr_buf_.data(),Device::adr_bytes);
+        if(i2c_result!=Bus::no_error)
+            return i2c_result;
+
+        current_adr_=adr;
+        if(wait==FRAM_WAIT)
+            this->wait(Bus::wr_cmplt);
+        else
+            pending_=Bus::wr_cmplt;
+
+        return FRAM_NO_ERROR;
+    }
+
+    /**
+    Reads data from the address the latch points to, see "FRAM_read_current_adr"
+
+    @param wait FRAM_DONT_WAIT returns once the transfer is started, it is done when the status of the bus shows Bus::rd_cmplt
+    @return FRAM_PARAMTER_ERROR if the latch is unknown or data is empty, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t read_current(span<uint8_t> data, FRAM_wait_t wait=FRAM_WAIT){
+
+        if(current_adr_>adr_max||data.empty())
+            return FRAM_PARAMTER_ERROR;
+
+        return read_latch(data.data(),data.size(),wait);
+    }
+
+    /**
+    Writes data in a single transfer
+
+    @param wait FRAM_DONT_WAIT returns once the transfer is started, it is done when the status of the bus shows Bus::wr_cmplt
+    @return FRAM_PARAMTER_ERROR if data is empty, longer than TxSize or exceeds the chip, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t write_chunk(uint32_t adr, span<const uint8_t> data, FRAM_wait_t wait=FRAM_WAIT){
+
+        if(data.empty()||data.size()>TxSize||adr>adr_max||data.size()-1>adr_max-adr)
+            return FRAM_PARAMTER_ERROR;
+
+        return write_part(adr,data.data(),data.size(),wait);
+    }
+
+    /**
+    Reads data from a given address, see "FRAM_read_from_adr"
+
+    Setting the address is skipped if the latch already points to it.
+
+    @return FRAM_PARAMTER_ERROR if data is empty or the range exceeds the chip, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t read(uint32_t adr, span<uint8_t> data){
+
+        if(data.empty()||adr>adr_max||data.size()-1>adr_max-adr)
+            return FRAM_PARAMTER_ERROR;
+
+        return read_part(adr,data.data(),data.size());
+    }
+
+    /**
+    Reads data from a constant address
+
+    The range is checked by the compiler.
+    */
+    template<uint32_t Adr, std::size_t N>
+    uint32_t read(std::array<uint8_t,N> &data){return read<Adr,N>(data.data());}
+
+    /**
+    Reads N bytes from a constant address
+    */
+    template<uint32_t Adr, std::size_t N>
+    uint32_t read(uint8_t *data){
+
+        static_assert(N>0&&Adr<=adr_max&&N-1<=adr_max-Adr,"range exceeds the chip");
+
+        return read_part(Adr,data,N);
+    }
+
+    /**
+    Writes data to a given address, see "FRAM_write_to_adr"
+
+    @return FRAM_PARAMTER_ERROR if data is empty or the range exceeds the chip, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t write(uint32_t adr, span<const uint8_t> data){
+
+        if(data.empty()||adr>adr_max||data.size()-1>adr_max-adr)
+            return FRAM_PARAMTER_ERROR;
+
+        if(data.size()<=TxSize)
+            return write_part(adr,data.data(),data.size());
+
+        return write_stream(adr,data.data(),data.size());
+    }
+
+    /**
+    Writes data to a constant address
+
+    The range is checked by the compiler, it is sent byte by byte if it exceeds TxSize.
+    */
+    template<uint32_t Adr, std::size_t N>
+    uint32_t write(const std::array<uint8_t,N> &data){return write<Adr,N>(data.data());}
+
+    /**
+    Writes N bytes to a constant address
+    */
+    template<uint32_t Adr, std::size_t N>
+    uint32_t write(const uint8_t *data){
+
+        static_assert(N>0&&Adr<=adr_max&&N-1<=adr_max-Adr,"range exceeds the chip");
+
+        if constexpr(N<=TxSize)
+            return write_part(Adr,data,N);
+        else
+            return write_stream(Adr,data,N);
+    }
+
+private:
+    /**
+    Puts the address bytes MSB first into out and the address bits above them into the slave address
+    */
+    static constexpr void prep_adr(uint32_t adr, uint8_t *out, uint8_t &slave){
+
+        for(uint8_t i=0;i<Device::adr_bytes;i++)
+            out[i]=static_cast<uint8_t>(adr>>(8*(Device::adr_bytes-1-i)));
+
+        slave=static_cast<uint8_t>(Device::slave_adr|(adr>>(8*Device::adr_bytes)));
+    }
+
+    static void wait(uint32_t flag){
+
+        while(0u==(Bus::status()&flag))   {/* busy wait */ }
+    }
+
+    uint32_t read_part(uint32_t adr, uint8_t *data, std::size_t count){
+
+        uint32_t i2c_result;
+
+        if(current_adr_!=adr){
+            i2c_result=set_adr(adr);
+            if(i2c_result!=FRAM_NO_ERROR)
+                return i2c_result;
+        }
+
+        return read_latch(data,count,FRAM_WAIT);
+    }
+
+    uint32_t read_latch(uint8_t *data, std::size_t count, FRAM_wait_t wait){
+
+        uint32_t i2c_result;
+
+        complete();
+
+        //the address bits in the slave address have to match the latch
+        i2c_result=Bus::read(Device::slave_adr|(current_adr_>>(8*Device::adr_bytes)),data,count);
+        if(i2c_result!=Bus::no_error)
+            return i2c_result;
+
+        current_adr_=(current_adr_+count)%(adr_max+1);
+        if(wait==FRAM_WAIT)
+            this->wait(Bus::rd_cmplt);
+        else
+            pending_=Bus::rd_cmplt;
+
+        return FRAM_NO_ERROR;
+    }
+
+    //sends the address and then the data of the caller in one transfer, each call returns once its byte is on the wire
+    uint32_t write_stream(uint32_t adr, const uint8_t *data, std::size_t count){
+
+        uint8_t head[Device::adr_bytes];
+        uint8_t slave;
+        uint32_t i2c_result;
+
+        //the bus may still run a transfer started with FRAM_DONT_WAIT
+        complete();
+
+        prep_adr(adr,head,slave);
+        i2c_result=Bus::send_start(slave);
+        if(i2c_result!=Bus::no_error)
+            return i2c_result;
+
+        for(std::size_t i=0;i<Device::adr_bytes+count&&i2c_result==Bus::no_error;i++)
+            i2c_result=Bus::write_byte(i<Device::adr_bytes?head[i]:data[i-Device::adr_bytes]);
+        Bus::send_stop();
+
+        //the latch stopped somewhere in the range
+        if(i2c_result!=Bus::no_error){
+            current_adr_=invalid_adr;
+            return i2c_result;
+        }
+
+        current_adr_=(adr+count)%(adr_max+1);
+
+        return FRAM_NO_ERROR;
+    }
+
+    uint32_t write_part(uint32_t adr, const uint8_t *data, std::size_t count, FRAM_wait_t wait=FRAM_WAIT){
+
+        uint8_t slave;
+        uint32_t i2c_result;
+
+        //the transfer buffer may still be sent by the previous call
+        complete();
+
+        prep_adr(adr,tx_.data(),slave);
+        for(std::size_t i=0;i<count;i++)
+            tx_[Device::adr_bytes+i]=data[i];
+
+        i2c_result=Bus::write(slave,tx_.data(),Device::adr_bytes+count);
+        if(i2c_result!=Bus::no_error)
+            return i2c_result;
+
+        current_adr_=(adr+count)%(adr_max+1);
+        if(wait==FRAM_WAIT)
+            this->wait(Bus::wr_cmplt);
+        else
+            pending_=Bus::wr_cmplt;
+
+        return FRAM_NO_ERROR;
+    }
+
+    uint32_t current_adr_=invalid_adr;                      //address the internal latch is pointing to
+    uint32_t pending_=0;                                    //status flag the transfer started with FRAM_DONT_WAIT completes with, 0 if none is running
+    std::array<uint8_t,Device::adr_bytes> adr_buf_{};       //address bytes of "set_adr"
+    std::array<uint8_t,Device::adr_bytes+TxSize> tx_{};     //transfer buffer of writes
+};
+
+} /* namespace fram */
+
+#endif /* (FRAM_HPP) */
+
+/* [] END OF FILE */
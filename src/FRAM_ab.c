@@ -0,0 +1,170 @@
+/**
+ * @file FRAM_ab.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_ab.h"
+#include "FRAM_chk.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_AB_CRC_OFFSET      6u                      //offset of the CRC in the trailer, it covers the bytes in front of it
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_ab_slot(const FRAM_ab_t * const ab, uint8_t slot);
+static uint32_t FRAM_ab_trailer(FRAM_ab_t * const ab, uint8_t slot, uint32_t * const seq, uint16_t * const length, uint8_t * const valid);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_ab_init(FRAM_ab_t * const ab, FRAM_t * const fram, uint32_t base, uint16_t capacity){
+
+    //check if parameters are valid
+    if(capacity==0||base>fram->adr_max||FRAM_AB_SIZE((uint32_t)capacity)-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    ab->fram=fram;
+    ab->base=base;
+    ab->capacity=capacity;
+    ab->length=0;
+    ab->seq=0;
+    ab->active=FRAM_AB_NONE;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ab_format(FRAM_ab_t * const ab){
+
+    uint8_t trailer[FRAM_AB_TRAILER];
+    uint32_t result;
+    uint8_t slot;
+
+    //a cleared trailer fails its CRC
+    memset(trailer,0,sizeof(trailer));
+
+    for(slot=0;slot<2;slot++){
+        result=FRAM_write_to_adr(ab->fram,FRAM_ab_slot(ab,slot)+ab->capacity,trailer,FRAM_AB_TRAILER);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    ab->length=0;
+    ab->seq=0;
+    ab->active=FRAM_AB_NONE;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ab_mount(FRAM_ab_t * const ab){
+
+    uint32_t result;
+    uint32_t seq[2];
+    uint16_t length[2];
+    uint8_t valid[2];
+    uint8_t slot;
+
+    for(slot=0;slot<2;slot++){
+        result=FRAM_ab_trailer(ab,slot,&seq[slot],&length[slot],&valid[slot]);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    ab->active=FRAM_AB_NONE;
+    ab->length=0;
+    ab->seq=0;
+
+    if(!valid[0]&&!valid[1])
+        return FRAM_AB_EMPTY;
+
+    //the sequence numbers are compared by their distance, so they may wrap around
+    if(!valid[1]||(valid[0]&&(int32_t)(seq[0]-seq[1])>0))
+        slot=0;
+    else
+        slot=1;
+
+    ab->active=slot;
+    ab->length=length[slot];
+    ab->seq=seq[slot];
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ab_read(FRAM_ab_t * const ab, uint8_t * const buffer, uint16_t size, uint16_t * const count){
+
+    //check if parameters are valid
+    if(buffer==NULL||count==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    if(ab->active==FRAM_AB_NONE)
+        return FRAM_AB_EMPTY;
+
+    *count=ab->length;
+    if(ab->length>size)
+        return FRAM_PARAMTER_ERROR;
+
+    return FRAM_read_from_adr(ab->fram,FRAM_ab_slot(ab,ab->active)+ab->capacity-ab->length,buffer,ab->length);
+}
+
+uint32_t FRAM_ab_write(FRAM_ab_t * const ab, const uint8_t * const buffer, uint16_t count){
+
+    FRAM_part_t parts[2];
+    uint8_t trailer[FRAM_AB_TRAILER];
+    uint32_t result;
+    uint32_t seq=ab->seq+1;
+    uint8_t slot=ab->active==0?1:0;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||count>ab->capacity)
+        return FRAM_PARAMTER_ERROR;
+
+    FRAM_store32(trailer,seq);
+    FRAM_store16(trailer+4,count);
+    FRAM_store16(trailer+FRAM_AB_CRC_OFFSET,FRAM_chk_crc(FRAM_CHK_CRC_INIT,trailer,FRAM_AB_CRC_OFFSET));
+
+    //the data ends at the trailer, so both go in one transfer and the trailer comes last
+    parts[0].buffer=buffer;
+    parts[0].count=count;
+    parts[1].buffer=trailer;
+    parts[1].count=FRAM_AB_TRAILER;
+
+    result=FRAM_write_parts_to_adr(ab->fram,FRAM_ab_slot(ab,slot)+ab->capacity-count,parts,2);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    ab->active=slot;
+    ab->length=count;
+    ab->seq=seq;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_ab_slot(const FRAM_ab_t * const ab, uint8_t slot){return ab->base+slot*((uint32_t)ab->capacity+FRAM_AB_TRAILER);}
+
+static uint32_t FRAM_ab_trailer(FRAM_ab_t * const ab, uint8_t slot, uint32_t * const seq, uint16_t * const length, uint8_t * const valid){
+
+    uint8_t trailer[FRAM_AB_TRAILER];
+    uint32_t result;
+
+    result=FRAM_read_from_adr(ab->fram,FRAM_ab_slot(ab,slot)+ab->capacity,trailer,FRAM_AB_TRAILER);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    *seq=FRAM_load32(trailer);
+    *length=FRAM_load16(trailer+4);
+
+    //an interrupted write leaves a trailer failing its CRC
+    *valid=*length>0&&*length<=ab->capacity&&FRAM_chk_crc(FRAM_CHK_CRC_INIT,trailer,FRAM_AB_CRC_OFFSET)==FRAM_load16(trailer+FRAM_AB_CRC_OFFSET);
+
+    return FRAM_NO_ERROR;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,146 @@
+/**
+ * @file FRAM_ab.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Record with two copies (A/B) in a region of a FRAM chip, e.g. a configuration block that must never be half-written.
+ * The region holds two slots. A slot ends with a trailer of sequence number, length and a CRC over both, the data is placed right in front of the trailer.
+ * A write goes to the slot not in use with a single transfer of data and trailer, so the trailer is written last.
+ * A write interrupted by a reset leaves a trailer failing its CRC or an older sequence number, and the other copy stays in use.
+ *
+ * The slot in use is kept in SRAM, so a read costs a single read of the data. "FRAM_ab_mount" reads the two trailers only.
+ *
+ * A record is used by one task at a time, the functions do not lock the record itself.
+ */
+
+#if !defined(FRAM_AB_H)
+#define FRAM_AB_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_AB_TRAILER         8u                      //bytes of the trailer of a slot: sequence number (4), length (2), CRC (2)
+#define FRAM_AB_SIZE(capacity)  (2u*((capacity)+FRAM_AB_TRAILER))  //size of the region of a record holding up to capacity bytes
+#define FRAM_AB_NONE            0xffu                   //slot in use if there is no valid copy
+
+#define FRAM_AB_EMPTY           0x100000u               //indicates that neither slot holds a valid copy
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+A record with two copies
+
+Initialise it with "FRAM_ab_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the record
+    uint32_t    base;                                   //address of the region
+    uint16_t    capacity;                               //highest length of the data
+    uint16_t    length;                                 //length of the data in use
+    uint32_t    seq;                                    //sequence number of the copy in use
+    uint8_t     active;                                 //slot in use, 0 or 1, FRAM_AB_NONE if there is no valid copy
+} FRAM_ab_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a record
+
+Does not access the chip. Call "FRAM_ab_mount" to find the copy in use, or "FRAM_ab_format" to start without a copy.
+
+@param ab the record to be initialised
+@param fram the chip holding the record
+@param base address of the region, the region is FRAM_AB_SIZE(capacity) bytes long
+@param capacity highest length of the data
+@return FRAM_PARAMTER_ERROR if the capacity is 0 or the region does not fit into the chip
+        FRAM_NO_ERROR if the record was initialised
+*/
+uint32_t    FRAM_ab_init(FRAM_ab_t * const ab, FRAM_t * const fram, uint32_t base, uint16_t capacity);
+
+/**
+Remove both copies
+
+Clears the two trailers.
+
+@param ab the record
+@return FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_ab_format(FRAM_ab_t * const ab);
+
+/**
+Find the copy in use after a reset
+
+Costs two reads of a trailer. The valid copy with the higher sequence number is used.
+
+@param ab the record
+@return FRAM_AB_EMPTY if neither slot holds a valid copy, the next write goes to the first slot
+        FRAM_NO_ERROR if a copy was found
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_ab_mount(FRAM_ab_t * const ab);
+
+/**
+Read the data
+
+Costs one read.
+
+@param ab the record
+@param buffer pointer to the memory the data is stored to
+@param size size of the buffer
+@param count the length of the data is stored here, also if the buffer is too small
+@return FRAM_PARAMTER_ERROR if either a pointer is NULL or the data does not fit into the buffer
+        FRAM_AB_EMPTY if there is no valid copy
+        FRAM_NO_ERROR if the data was read
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_ab_read(FRAM_ab_t * const ab, uint8_t * const buffer, uint16_t size, uint16_t * const count);
+
+/**
+Write new data
+
+Costs one write of data and trailer to the slot not in use, which is then used.
+
+@param ab the record
+@param buffer pointer to the data
+@param count length of the data, 1 to the capacity
+@return FRAM_PARAMTER_ERROR if the buffer points to NULL or the count is invalid
+        FRAM_NO_ERROR if the data was written
+        any other value is the output of "FRAM_write_parts_to_adr", the previous copy stays in use
+*/
+uint32_t    FRAM_ab_write(FRAM_ab_t * const ab, const uint8_t * const buffer, uint16_t count);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_AB_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,549 @@
+/**
+ * @file FRAM_btree.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_btree.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_BTREE_MAGIC        0x31544246u             //"FBT1"
+#define FRAM_BTREE_HEADER       20u                     //magic (4), nodes (4), top (4), root (4), height (4)
+#define FRAM_BTREE_TOP_OFFSET   8u                      //offset of top in the header, root and height follow
+#define FRAM_BTREE_NODE_HEADER  8u                      //count (2), reserved (2), link (4)
+#define FRAM_BTREE_ENTRY_SIZE   8u                      //key (4), value or child (4)
+#define FRAM_BTREE_LINK_OFFSET  4u                      //offset of the link in a node, the next leaf of a leaf or the first child of an inner node
+
+#if FRAM_BTREE_ENTRIES<3 || FRAM_BTREE_NODE_SIZE<FRAM_BTREE_HEADER
+    #error "FRAM_BTREE_NODE_SIZE has to hold the header and at least three keys"
+#endif
+
+#define FRAM_BTREE_ENTRY(node,i) ((node)+FRAM_BTREE_NODE_HEADER+(i)*FRAM_BTREE_ENTRY_SIZE)
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Nodes passed by a descent from the root to a leaf, level 0 is the leaf
+*/
+typedef struct {
+    uint32_t    node[FRAM_BTREE_HEIGHT_MAX];            //number of the node
+    uint16_t    pos[FRAM_BTREE_HEIGHT_MAX];             //index of the child taken, unused for the leaf
+    uint16_t    count[FRAM_BTREE_HEIGHT_MAX];           //number of keys of the node
+    uint8_t     rightmost[FRAM_BTREE_HEIGHT_MAX];       //the node is the last one of its level
+} FRAM_btree_path_t;
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_btree_descend(FRAM_btree_t * const tree, uint32_t key, uint8_t * const leaf, FRAM_btree_path_t * const path);
+static uint32_t FRAM_btree_inner(FRAM_btree_t * const tree, uint32_t node, const uint8_t ** const data);
+static uint32_t FRAM_btree_read(FRAM_btree_t * const tree, uint32_t node, uint8_t * const data);
+static uint32_t FRAM_btree_write(FRAM_btree_t * const tree, uint32_t node, uint8_t * const data, uint32_t from, uint32_t count);
+static uint32_t FRAM_btree_write_header(FRAM_btree_t * const tree);
+static void     FRAM_btree_split(uint8_t * const left, uint8_t * const right, uint8_t leaf, uint32_t pos, const uint8_t * const entry, uint32_t keep, uint32_t * const separator);
+static uint32_t FRAM_btree_upper(const uint8_t * const node, uint32_t key);
+static uint32_t FRAM_btree_lower(const uint8_t * const node, uint32_t key);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_btree_init(FRAM_btree_t * const tree, FRAM_t * const fram, uint32_t base, uint32_t size){
+
+    uint32_t i;
+
+    //check if parameters are valid
+    if(size<3*FRAM_BTREE_NODE_SIZE||size%FRAM_BTREE_NODE_SIZE!=0||base>fram->adr_max||size-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    tree->fram=fram;
+    tree->base=base;
+    tree->nodes=size/FRAM_BTREE_NODE_SIZE;
+    tree->top=2;
+    tree->root=1;
+    tree->height=1;
+    tree->clock=0;
+
+    memset(tree->root_data,0,FRAM_BTREE_NODE_SIZE);
+
+    for(i=0;i<FRAM_BTREE_CACHE;i++)
+        tree->cache[i].node=0;
+
+    tree->stats.finds=0;
+    tree->stats.inserts=0;
+    tree->stats.splits=0;
+    tree->stats.node_reads=0;
+    tree->stats.cache_hits=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_btree_format(FRAM_btree_t * const tree){
+
+    uint32_t result;
+    uint32_t i;
+
+    //an empty leaf as root in node 1
+    memset(tree->root_data,0,FRAM_BTREE_NODE_SIZE);
+
+    result=FRAM_write_to_adr(tree->fram,tree->base+FRAM_BTREE_NODE_SIZE,tree->root_data,FRAM_BTREE_NODE_HEADER);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    tree->top=2;
+    tree->root=1;
+    tree->height=1;
+
+    for(i=0;i<FRAM_BTREE_CACHE;i++)
+        tree->cache[i].node=0;
+
+    //the header is written last, an interrupted format leaves no valid tree
+    return FRAM_btree_write_header(tree);
+}
+
+uint32_t FRAM_btree_mount(FRAM_btree_t * const tree){
+
+    uint8_t header[FRAM_BTREE_HEADER];
+    uint32_t result;
+    uint32_t top;
+    uint32_t root;
+    uint32_t height;
+    uint32_t i;
+
+    result=FRAM_read_from_adr(tree->fram,tree->base,header,FRAM_BTREE_HEADER);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    top=FRAM_load32(header+FRAM_BTREE_TOP_OFFSET);
+    root=FRAM_load32(header+FRAM_BTREE_TOP_OFFSET+4);
+    height=FRAM_load32(header+FRAM_BTREE_TOP_OFFSET+8);
+
+    if(FRAM_load32(header)!=FRAM_BTREE_MAGIC||FRAM_load32(header+4)!=tree->nodes
+       ||top<2||top>tree->nodes||root==0||root>=top||height==0||height>FRAM_BTREE_HEIGHT_MAX)
+        return FRAM_BTREE_NO_TREE;
+
+    result=FRAM_btree_read(tree,root,tree->root_data);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(FRAM_load16(tree->root_data)>FRAM_BTREE_ENTRIES)
+        return FRAM_BTREE_NO_TREE;
+
+    tree->top=top;
+    tree->root=root;
+    tree->height=height;
+
+    for(i=0;i<FRAM_BTREE_CACHE;i++)
+        tree->cache[i].node=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_btree_find(FRAM_btree_t * const tree, uint32_t key, uint32_t * const value){
+
+    uint8_t leaf[FRAM_BTREE_NODE_SIZE];
+    uint32_t result;
+    uint32_t i;
+
+    //check if parameters are valid
+    if(value==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    tree->stats.finds++;
+
+    result=FRAM_btree_descend(tree,key,leaf,NULL);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    i=FRAM_btree_lower(leaf,key);
+    if(i==FRAM_load16(leaf)||FRAM_load32(FRAM_BTREE_ENTRY(leaf,i))!=key)
+        return FRAM_BTREE_NOT_FOUND;
+
+    *value=FRAM_load32(FRAM_BTREE_ENTRY(leaf,i)+4);
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_btree_insert(FRAM_btree_t * const tree, uint32_t key, uint32_t value){
+
+    FRAM_btree_path_t path;
+    uint8_t node[FRAM_BTREE_NODE_SIZE];
+    uint8_t sibling[FRAM_BTREE_NODE_SIZE];
+    uint8_t entry[FRAM_BTREE_ENTRY_SIZE];
+    const uint8_t *inner;
+    uint32_t result;
+    uint32_t level;
+    uint32_t pos;
+    uint32_t count;
+    uint32_t keep;
+    uint32_t split;
+    uint32_t separator;
+    uint32_t top=tree->top;
+
+    tree->stats.inserts++;
+
+    result=FRAM_btree_descend(tree,key,node,&path);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    //an existing key only gets its value replaced
+    pos=FRAM_btree_lower(node,key);
+    if(pos<path.count[0]&&FRAM_load32(FRAM_BTREE_ENTRY(node,pos))==key){
+        FRAM_store32(FRAM_BTREE_ENTRY(node,pos)+4,value);
+        return FRAM_btree_write(tree,path.node[0],node,FRAM_BTREE_NODE_HEADER+pos*FRAM_BTREE_ENTRY_SIZE+4,4);
+    }
+
+    //every full node on the path is split, a full root also needs a new root
+    for(split=0;split<tree->height&&path.count[split]==FRAM_BTREE_ENTRIES;split++);
+
+    if(split==tree->height&&tree->height==FRAM_BTREE_HEIGHT_MAX)
+        return FRAM_MEMORY_ERROR;
+
+    if(split+(split==tree->height)>tree->nodes-tree->top)
+        return FRAM_MEMORY_ERROR;
+
+    FRAM_store32(entry,key);
+    FRAM_store32(entry+4,value);
+
+    for(level=0;;level++){
+
+        count=FRAM_load16(node);
+
+        //the entries from pos on are written before the count, an entry appended behind the last one only shows when both are written
+        if(count<FRAM_BTREE_ENTRIES){
+
+            memmove(FRAM_BTREE_ENTRY(node,pos+1),FRAM_BTREE_ENTRY(node,pos),(count-pos)*FRAM_BTREE_ENTRY_SIZE);
+            memcpy(FRAM_BTREE_ENTRY(node,pos),entry,FRAM_BTREE_ENTRY_SIZE);
+            FRAM_store16(node,count+1);
+
+            result=FRAM_btree_write(tree,path.node[level],node,FRAM_BTREE_NODE_HEADER+pos*FRAM_BTREE_ENTRY_SIZE,(count+1-pos)*FRAM_BTREE_ENTRY_SIZE);
+            if(result==FRAM_NO_ERROR)
+                result=FRAM_btree_write(tree,path.node[level],node,0,2);
+            break;
+        }
+
+        //a key behind the last one of the rightmost node starts a new node, so ascending keys fill the nodes completely
+        keep=path.rightmost[level]&&pos==count?count:(count+1)/2;
+
+        FRAM_btree_split(node,sibling,level==0,pos,entry,keep,&separator);
+        tree->stats.splits++;
+
+        if(level==0)
+            FRAM_store32(node+FRAM_BTREE_LINK_OFFSET,tree->top);
+
+        //the new node is written before the node and the parent point to it
+        result=FRAM_btree_write(tree,tree->top,sibling,0,FRAM_BTREE_NODE_HEADER+FRAM_load16(sibling)*FRAM_BTREE_ENTRY_SIZE);
+        if(result!=FRAM_NO_ERROR)
+            break;
+
+        result=FRAM_btree_write(tree,path.node[level],node,0,FRAM_BTREE_NODE_HEADER+keep*FRAM_BTREE_ENTRY_SIZE);
+        if(result!=FRAM_NO_ERROR)
+            break;
+
+        FRAM_store32(entry,separator);
+        FRAM_store32(entry+4,tree->top);
+        tree->top++;
+
+        //the root was split, the new root gets the old root and the new node as children
+        if(level+1==tree->height){
+
+            memset(node,0,FRAM_BTREE_NODE_SIZE);
+            FRAM_store16(node,1);
+            FRAM_store32(node+FRAM_BTREE_LINK_OFFSET,tree->root);
+            memcpy(FRAM_BTREE_ENTRY(node,0),entry,FRAM_BTREE_ENTRY_SIZE);
+
+            result=FRAM_btree_write(tree,tree->top,node,0,FRAM_BTREE_NODE_HEADER+FRAM_BTREE_ENTRY_SIZE);
+            if(result!=FRAM_NO_ERROR)
+                break;
+
+            tree->root=tree->top;
+            tree->height++;
+            tree->top++;
+            memcpy(tree->root_data,node,FRAM_BTREE_NODE_SIZE);
+            break;
+        }
+
+        //continue with the parent, the separator goes behind the child taken by the descent
+        if(level+2==tree->height)
+            memcpy(node,tree->root_data,FRAM_BTREE_NODE_SIZE);
+        else{
+            result=FRAM_btree_inner(tree,path.node[level+1],&inner);
+            if(result!=FRAM_NO_ERROR)
+                break;
+            memcpy(node,inner,FRAM_BTREE_NODE_SIZE);
+        }
+
+        pos=path.pos[level+1];
+    }
+
+    if(tree->top!=top&&result==FRAM_NO_ERROR)
+        result=FRAM_btree_write_header(tree);
+
+    return result;
+}
+
+uint32_t FRAM_btree_seek(FRAM_btree_t * const tree, FRAM_btree_cursor_t * const cursor, uint32_t first, uint32_t last){
+
+    uint32_t result;
+
+    //check if parameters are valid
+    if(first>last)
+        return FRAM_PARAMTER_ERROR;
+
+    result=FRAM_btree_descend(tree,first,cursor->leaf,NULL);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    cursor->last=last;
+    cursor->index=FRAM_btree_lower(cursor->leaf,first);
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_btree_next(FRAM_btree_t * const tree, FRAM_btree_cursor_t * const cursor, uint32_t * const key, uint32_t * const value){
+
+    uint32_t result;
+    uint32_t next;
+    uint32_t found;
+
+    //check if parameters are valid
+    if(key==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    //the following leaf is usually the following node, its read hits the address latch
+    while(cursor->index>=FRAM_load16(cursor->leaf)){
+
+        next=FRAM_load32(cursor->leaf+FRAM_BTREE_LINK_OFFSET);
+        if(next==0)
+            return FRAM_BTREE_NOT_FOUND;
+
+        result=FRAM_btree_read(tree,next,cursor->leaf);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        cursor->index=0;
+    }
+
+    found=FRAM_load32(FRAM_BTREE_ENTRY(cursor->leaf,cursor->index));
+    if(found>cursor->last)
+        return FRAM_BTREE_NOT_FOUND;
+
+    *key=found;
+    if(value!=NULL)
+        *value=FRAM_load32(FRAM_BTREE_ENTRY(cursor->leaf,cursor->index)+4);
+
+    cursor->index++;
+
+    return FRAM_NO_ERROR;
+}
+
+const FRAM_btree_stats_t* FRAM_btree_get_stats(const FRAM_btree_t * const tree){return &tree->stats;}
+
+static uint32_t FRAM_btree_descend(FRAM_btree_t * const tree, uint32_t key, uint8_t * const leaf, FRAM_btree_path_t * const path){
+
+    const uint8_t *node=tree->root_data;
+    uint32_t result;
+    uint32_t number=tree->root;
+    uint32_t level;
+    uint32_t count;
+    uint32_t child;
+    uint32_t i;
+    uint8_t rightmost=1;
+
+    //the root is in SRAM, inner nodes are taken from the cache, only the leaf is always read
+    for(level=tree->height-1;level>0;level--){
+
+        count=FRAM_load16(node);
+        i=FRAM_btree_upper(node,key);
+        child=FRAM_load32(i==0?node+FRAM_BTREE_LINK_OFFSET:FRAM_BTREE_ENTRY(node,i-1)+4);
+
+        if(path!=NULL){
+            path->node[level]=number;
+            path->pos[level]=i;
+            path->count[level]=count;
+            path->rightmost[level]=rightmost;
+        }
+
+        rightmost=rightmost&&i==count;
+        number=child;
+
+        if(level>1){
+            result=FRAM_btree_inner(tree,child,&node);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+        }
+    }
+
+    if(tree->height==1)
+        memcpy(leaf,tree->root_data,FRAM_BTREE_NODE_SIZE);
+    else{
+        result=FRAM_btree_read(tree,number,leaf);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    if(path!=NULL){
+        path->node[0]=number;
+        path->count[0]=FRAM_load16(leaf);
+        path->rightmost[0]=rightmost;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_btree_inner(FRAM_btree_t * const tree, uint32_t node, const uint8_t ** const data){
+
+    FRAM_btree_cache_t *entry=&tree->cache[0];
+    uint32_t result;
+    uint32_t i;
+
+    tree->clock++;
+
+    for(i=0;i<FRAM_BTREE_CACHE;i++){
+
+        if(tree->cache[i].node==node){
+            tree->cache[i].used=tree->clock;
+            tree->stats.cache_hits++;
+            *data=tree->cache[i].data;
+            return FRAM_NO_ERROR;
+        }
+
+        //an unused entry or the least recently used one is replaced
+        if(entry->node!=0&&(tree->cache[i].node==0||tree->cache[i].used<entry->used))
+            entry=&tree->cache[i];
+    }
+
+    entry->node=0;
+
+    result=FRAM_btree_read(tree,node,entry->data);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    entry->node=node;
+    entry->used=tree->clock;
+    *data=entry->data;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_btree_read(FRAM_btree_t * const tree, uint32_t node, uint8_t * const data){
+
+    tree->stats.node_reads++;
+
+    return FRAM_read_from_adr(tree->fram,tree->base+node*FRAM_BTREE_NODE_SIZE,data,FRAM_BTREE_NODE_SIZE);
+}
+
+static uint32_t FRAM_btree_write(FRAM_btree_t * const tree, uint32_t node, uint8_t * const data, uint32_t from, uint32_t count){
+
+    uint32_t result;
+    uint32_t i;
+
+    result=FRAM_write_to_adr(tree->fram,tree->base+node*FRAM_BTREE_NODE_SIZE+from,data+from,count);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    //data holds the whole node, the copies in SRAM are replaced by it
+    if(node==tree->root)
+        memcpy(tree->root_data,data,FRAM_BTREE_NODE_SIZE);
+
+    for(i=0;i<FRAM_BTREE_CACHE;i++)
+        if(tree->cache[i].node==node)
+            memcpy(tree->cache[i].data,data,FRAM_BTREE_NODE_SIZE);
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_btree_write_header(FRAM_btree_t * const tree){
+
+    uint8_t header[FRAM_BTREE_HEADER];
+
+    FRAM_store32(header,FRAM_BTREE_MAGIC);
+    FRAM_store32(header+4,tree->nodes);
+    FRAM_store32(header+FRAM_BTREE_TOP_OFFSET,tree->top);
+    FRAM_store32(header+FRAM_BTREE_TOP_OFFSET+4,tree->root);
+    FRAM_store32(header+FRAM_BTREE_TOP_OFFSET+8,tree->height);
+
+    return FRAM_write_to_adr(tree->fram,tree->base,header,FRAM_BTREE_HEADER);
+}
+
+static void FRAM_btree_split(uint8_t * const left, uint8_t * const right, uint8_t leaf, uint32_t pos, const uint8_t * const entry, uint32_t keep, uint32_t * const separator){
+
+    uint32_t count=FRAM_load16(left);
+    uint32_t first;
+    uint32_t j;
+    const uint8_t *from;
+
+    //the full node together with the new entry at pos is a sequence of count+1 entries:
+    //the left node keeps the first keep of them, entry keep is the separator, of an inner node it moves up and its child becomes the link of the right node
+    first=leaf?keep:keep+1;
+
+    memset(right,0,FRAM_BTREE_NODE_SIZE);
+
+    for(j=first;j<=count;j++){
+        from=j<pos?FRAM_BTREE_ENTRY(left,j):j==pos?entry:FRAM_BTREE_ENTRY(left,j-1);
+        memcpy(FRAM_BTREE_ENTRY(right,j-first),from,FRAM_BTREE_ENTRY_SIZE);
+    }
+
+    FRAM_store16(right,count+1-first);
+
+    from=keep<pos?FRAM_BTREE_ENTRY(left,keep):keep==pos?entry:FRAM_BTREE_ENTRY(left,keep-1);
+    *separator=FRAM_load32(from);
+
+    if(leaf)
+        memcpy(right+FRAM_BTREE_LINK_OFFSET,left+FRAM_BTREE_LINK_OFFSET,4);
+    else
+        memcpy(right+FRAM_BTREE_LINK_OFFSET,from+4,4);
+
+    //the entries of the left node only change if the new entry stays in it
+    if(pos<keep){
+        memmove(FRAM_BTREE_ENTRY(left,pos+1),FRAM_BTREE_ENTRY(left,pos),(keep-1-pos)*FRAM_BTREE_ENTRY_SIZE);
+        memcpy(FRAM_BTREE_ENTRY(left,pos),entry,FRAM_BTREE_ENTRY_SIZE);
+    }
+
+    FRAM_store16(left,keep);
+}
+
+static uint32_t FRAM_btree_upper(const uint8_t * const node, uint32_t key){
+
+    //number of keys lower than or equal to key
+    uint32_t low=0;
+    uint32_t high=FRAM_load16(node);
+    uint32_t mid;
+
+    while(low<high){
+        mid=(low+high)/2;
+        if(FRAM_load32(FRAM_BTREE_ENTRY(node,mid))<=key)
+            low=mid+1;
+        else
+            high=mid;
+    }
+
+    return low;
+}
+
+static uint32_t FRAM_btree_lower(const uint8_t * const node, uint32_t key){
+
+    //number of keys lower than key
+    uint32_t low=0;
+    uint32_t high=FRAM_load16(node);
+    uint32_t mid;
+
+    while(low<high){
+        mid=(low+high)/2;
+        if(FRAM_load32(FRAM_BTREE_ENTRY(node,mid))<key)
+            low=mid+1;
+        else
+            high=mid;
+    }
+
+    return low;
+}
+
+/* [] END OF FILE */
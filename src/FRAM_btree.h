@@ -0,0 +1,223 @@
+/**
+ * @file FRAM_btree.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * B+tree in a region of a FRAM chip, mapping 32 bit keys (e.g. time stamps) to 32 bit values.
+ * The region is divided into nodes of FRAM_BTREE_NODE_SIZE bytes, the first one holds the header. A node is always read with one transfer.
+ * Inner nodes hold keys and children, leaves hold keys and values and are linked in key order, so a range scan reads one leaf after the other.
+ * Leaves are allocated in ascending order while keys are inserted in ascending order, then the next leaf follows the current one and its read hits
+ * the address latch.
+ *
+ * The root is kept in SRAM and up to FRAM_BTREE_CACHE further inner nodes are cached, so a lookup in a tree of up to three levels,
+ * which holds a full 128 KB chip, costs at most two reads: an inner node missing the cache and the leaf.
+ * A full node that gets a key behind its last one while it is the rightmost node of its level is not split in halves,
+ * so ascending inserts fill the nodes completely.
+ *
+ * Keys can not be removed. An insert behind the last key of a node writes the entry before the number of keys, so a reset during it
+ * either adds the key or not, which covers ascending keys between splits. The tree is not protected against other resets:
+ * an insert in front of keys shifts them with one transfer and a reset during it can lose one of them, a reset while a value is replaced
+ * can leave a mix of both values, and a reset while a node is split can lose the new key or leave a leaf only reached by scans.
+ * A tree is used by one task at a time, the functions do not lock the tree itself.
+ */
+
+#if !defined(FRAM_BTREE_H)
+#define FRAM_BTREE_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_BTREE_NODE_SIZE    256u                    //size of a node, the region of a tree is a multiple of it
+#define FRAM_BTREE_ENTRIES      ((FRAM_BTREE_NODE_SIZE-8u)/8u)  //highest number of keys of a node, a node has an 8 byte header and 8 bytes per key
+#define FRAM_BTREE_CACHE        4u                      //number of inner nodes cached in SRAM besides the root
+#define FRAM_BTREE_HEIGHT_MAX   8u                      //highest number of levels
+
+#define FRAM_BTREE_NOT_FOUND    0x20000u                //indicates that the key is not in the tree or, for a cursor, that there is no further key
+#define FRAM_BTREE_NO_TREE      0x40000u                //indicates that the region does not hold a tree of this size
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a tree
+*/
+typedef struct {
+    uint32_t    finds;                                  //number of lookups
+    uint32_t    inserts;                                //number of inserts
+    uint32_t    splits;                                 //number of nodes split by inserts
+    uint32_t    node_reads;                             //number of nodes read from the chip
+    uint32_t    cache_hits;                             //number of inner nodes found in the cache
+} FRAM_btree_stats_t;
+
+/**
+Inner node cached in SRAM
+*/
+typedef struct {
+    uint32_t    node;                                   //number of the node, 0 if the entry is unused
+    uint32_t    used;                                   //time of the last use, the least recently used entry is replaced
+    uint8_t     data[FRAM_BTREE_NODE_SIZE];
+} FRAM_btree_cache_t;
+
+/**
+A B+tree
+
+Initialise it with "FRAM_btree_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the tree
+    uint32_t    base;                                   //address of the region
+    uint32_t    nodes;                                  //number of nodes of the region, including the header
+    uint32_t    top;                                    //next node to be allocated
+    uint32_t    root;                                   //number of the root node
+    uint32_t    height;                                 //number of levels, 1 if the root is a leaf
+    uint32_t    clock;                                  //time of the cache
+    uint8_t     root_data[FRAM_BTREE_NODE_SIZE];
+    FRAM_btree_cache_t cache[FRAM_BTREE_CACHE];
+    FRAM_btree_stats_t stats;
+} FRAM_btree_t;
+
+/**
+Position of a range scan, see "FRAM_btree_seek"
+*/
+typedef struct {
+    uint32_t    last;                                   //highest key of the range
+    uint16_t    index;                                  //next entry of the leaf
+    uint8_t     leaf[FRAM_BTREE_NODE_SIZE];             //copy of the current leaf
+} FRAM_btree_cursor_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a tree
+
+Does not access the chip. Call "FRAM_btree_format" to start an empty tree or "FRAM_btree_mount" to use the tree found in the region.
+
+@param tree the tree to be initialised
+@param fram the chip holding the tree
+@param base address of the region
+@param size size of the region, a multiple of FRAM_BTREE_NODE_SIZE and at least three nodes
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip or the size is invalid
+        FRAM_NO_ERROR if the tree was initialised
+*/
+uint32_t    FRAM_btree_init(FRAM_btree_t * const tree, FRAM_t * const fram, uint32_t base, uint32_t size);
+
+/**
+Start an empty tree
+
+Writes an empty root and the header.
+
+@param tree the tree
+@return FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_btree_format(FRAM_btree_t * const tree);
+
+/**
+Use the tree found in the region
+
+Reads the header and the root.
+
+@param tree the tree
+@return FRAM_BTREE_NO_TREE if the header is missing or was written for another region size
+        FRAM_NO_ERROR if the tree can be used
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_btree_mount(FRAM_btree_t * const tree);
+
+/**
+Look up a key
+
+@param tree the tree
+@param key the key
+@param value the value of the key is stored here
+@return FRAM_PARAMTER_ERROR if the value points to NULL
+        FRAM_BTREE_NOT_FOUND if the key is not in the tree
+        FRAM_NO_ERROR if the key was found
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_btree_find(FRAM_btree_t * const tree, uint32_t key, uint32_t * const value);
+
+/**
+Insert a key or replace its value
+
+Costs two short writes of the leaf unless nodes are split: the entries from the new key on, then the number of keys.
+
+@param tree the tree
+@param key the key
+@param value the value
+@return FRAM_MEMORY_ERROR if the region has no room for the nodes a split needs or the tree would exceed FRAM_BTREE_HEIGHT_MAX levels,
+        nothing was written
+        FRAM_NO_ERROR if the key was inserted
+        any other value is the output of "FRAM_read_from_adr" or "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_btree_insert(FRAM_btree_t * const tree, uint32_t key, uint32_t value);
+
+/**
+Start a range scan
+
+The cursor holds a copy of the current leaf, inserts during a scan are not seen by it.
+
+@param tree the tree
+@param cursor the cursor
+@param first the lowest key of the range
+@param last the highest key of the range
+@return FRAM_PARAMTER_ERROR if the range is empty
+        FRAM_NO_ERROR if the cursor was positioned, "FRAM_btree_next" gives the first key
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_btree_seek(FRAM_btree_t * const tree, FRAM_btree_cursor_t * const cursor, uint32_t first, uint32_t last);
+
+/**
+Get the next key of a range scan
+
+@param tree the tree
+@param cursor the cursor, see "FRAM_btree_seek"
+@param key the key is stored here
+@param value the value is stored here, may be NULL
+@return FRAM_BTREE_NOT_FOUND if there is no further key in the range
+        FRAM_NO_ERROR if a key was found
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_btree_next(FRAM_btree_t * const tree, FRAM_btree_cursor_t * const cursor, uint32_t * const key, uint32_t * const value);
+
+/**
+Get the statistics of a tree
+
+@param tree the tree
+@return the statistics collected since "FRAM_btree_init"
+*/
+const FRAM_btree_stats_t* FRAM_btree_get_stats(const FRAM_btree_t * const tree);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_BTREE_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,254 @@
+/**
+ * @file FRAM_chk.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_chk.h"
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_chk_load(FRAM_chk_t * const chk, uint32_t block);
+static uint32_t FRAM_chk_store(FRAM_chk_t * const chk, uint32_t block, const uint8_t * const data);
+
+#if defined(FRAM_CHK_CRC_HW)
+uint16_t FRAM_CHK_CRC_HW(uint16_t crc, const uint8_t * const data, uint32_t count);
+#else
+//CRC of the upper byte of the register for polynomial 0x1021, one lookup replaces eight shifts
+static const uint16_t FRAM_chk_table[256]={
+    0x0000u,0x1021u,0x2042u,0x3063u,0x4084u,0x50a5u,0x60c6u,0x70e7u,
+    0x8108u,0x9129u,0xa14au,0xb16bu,0xc18cu,0xd1adu,0xe1ceu,0xf1efu,
+    0x1231u,0x0210u,0x3273u,0x2252u,0x52b5u,0x4294u,0x72f7u,0x62d6u,
+    0x9339u,0x8318u,0xb37bu,0xa35au,0xd3bdu,0xc39cu,0xf3ffu,0xe3deu,
+    0x2462u,0x3443u,0x0420u,0x1401u,0x64e6u,0x74c7u,0x44a4u,0x5485u,
+    0xa56au,0xb54bu,0x8528u,0x9509u,0xe5eeu,0xf5cfu,0xc5acu,0xd58du,
+    0x3653u,0x2672u,0x1611u,0x0630u,0x76d7u,0x66f6u,0x5695u,0x46b4u,
+    0xb75bu,0xa77au,0x9719u,0x8738u,0xf7dfu,0xe7feu,0xd79du,0xc7bcu,
+    0x48c4u,0x58e5u,0x6886u,0x78a7u,0x0840u,0x1861u,0x2802u,0x3823u,
+    0xc9ccu,0xd9edu,0xe98eu,0xf9afu,0x8948u,0x9969u,0xa90au,0xb92bu,
+    0x5af5u,0x4ad4u,0x7ab7u,0x6a96u,0x1a71u,0x0a50u,0x3a33u,0x2a12u,
+    0xdbfdu,0xcbdcu,0xfbbfu,0xeb9eu,0x9b79u,0x8b58u,0xbb3bu,0xab1au,
+    0x6ca6u,0x7c87u,0x4ce4u,0x5cc5u,0x2c22u,0x3c03u,0x0c60u,0x1c41u,
+    0xedaeu,0xfd8fu,0xcdecu,0xddcdu,0xad2au,0xbd0bu,0x8d68u,0x9d49u,
+    0x7e97u,0x6eb6u,0x5ed5u,0x4ef4u,0x3e13u,0x2e32u,0x1e51u,0x0e70u,
+    0xff9fu,0xefbeu,0xdfddu,0xcffcu,0xbf1bu,0xaf3au,0x9f59u,0x8f78u,
+    0x9188u,0x81a9u,0xb1cau,0xa1ebu,0xd10cu,0xc12du,0xf14eu,0xe16fu,
+    0x1080u,0x00a1u,0x30c2u,0x20e3u,0x5004u,0x4025u,0x7046u,0x6067u,
+    0x83b9u,0x9398u,0xa3fbu,0xb3dau,0xc33du,0xd31cu,0xe37fu,0xf35eu,
+    0x02b1u,0x1290u,0x22f3u,0x32d2u,0x4235u,0x5214u,0x6277u,0x7256u,
+    0xb5eau,0xa5cbu,0x95a8u,0x8589u,0xf56eu,0xe54fu,0xd52cu,0xc50du,
+    0x34e2u,0x24c3u,0x14a0u,0x0481u,0x7466u,0x6447u,0x5424u,0x4405u,
+    0xa7dbu,0xb7fau,0x8799u,0x97b8u,0xe75fu,0xf77eu,0xc71du,0xd73cu,
+    0x26d3u,0x36f2u,0x0691u,0x16b0u,0x6657u,0x7676u,0x4615u,0x5634u,
+    0xd94cu,0xc96du,0xf90eu,0xe92fu,0x99c8u,0x89e9u,0xb98au,0xa9abu,
+    0x5844u,0x4865u,0x7806u,0x6827u,0x18c0u,0x08e1u,0x3882u,0x28a3u,
+    0xcb7du,0xdb5cu,0xeb3fu,0xfb1eu,0x8bf9u,0x9bd8u,0xabbbu,0xbb9au,
+    0x4a75u,0x5a54u,0x6a37u,0x7a16u,0x0af1u,0x1ad0u,0x2ab3u,0x3a92u,
+    0xfd2eu,0xed0fu,0xdd6cu,0xcd4du,0xbdaau,0xad8bu,0x9de8u,0x8dc9u,
+    0x7c26u,0x6c07u,0x5c64u,0x4c45u,0x3ca2u,0x2c83u,0x1ce0u,0x0cc1u,
+    0xef1fu,0xff3eu,0xcf5du,0xdf7cu,0xaf9bu,0xbfbau,0x8fd9u,0x9ff8u,
+    0x6e17u,0x7e36u,0x4e55u,0x5e74u,0x2e93u,0x3eb2u,0x0ed1u,0x1ef0u
+};
+#endif
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint16_t FRAM_chk_crc(uint16_t crc, const uint8_t * const data, uint32_t count){
+
+#if defined(FRAM_CHK_CRC_HW)
+    return FRAM_CHK_CRC_HW(crc,data,count);
+#else
+    uint32_t i;
+
+    for(i=0;i<count;i++)
+        crc=(uint16_t)(crc<<8)^FRAM_chk_table[(crc>>8)^data[i]];
+
+    return crc;
+#endif
+}
+
+uint32_t FRAM_chk_init(FRAM_chk_t * const chk, FRAM_t * const fram, uint32_t base, uint32_t size){
+
+    //check if parameters are valid
+    if(size<FRAM_CHK_SLOT_SIZE||base>fram->adr_max||size-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    chk->fram=fram;
+    chk->base=base;
+    chk->blocks=size/FRAM_CHK_SLOT_SIZE;
+    chk->bad=FRAM_INVALID_ADR;
+
+    chk->stats.checked=0;
+    chk->stats.written=0;
+    chk->stats.merged=0;
+    chk->stats.mismatches=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_chk_format(FRAM_chk_t * const chk){
+
+    uint32_t result;
+    uint32_t i;
+
+    memset(chk->slot,0,FRAM_CHK_BLOCK_SIZE);
+    FRAM_store16(&chk->slot[FRAM_CHK_BLOCK_SIZE],FRAM_chk_crc(FRAM_CHK_CRC_INIT,chk->slot,FRAM_CHK_BLOCK_SIZE));
+
+    for(i=0;i<chk->blocks;i++){
+        result=FRAM_write_to_adr(chk->fram,chk->base+i*FRAM_CHK_SLOT_SIZE,chk->slot,FRAM_CHK_SLOT_SIZE);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_chk_read_from_adr(FRAM_chk_t * const chk, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t result;
+    uint32_t done=0;
+    uint32_t offset;
+    uint32_t chunk;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>=FRAM_chk_get_size(chk)||count>FRAM_chk_get_size(chk)-adr)
+        return FRAM_PARAMTER_ERROR;
+
+    while(done<count){
+
+        offset=(adr+done)%FRAM_CHK_BLOCK_SIZE;
+        chunk=FRAM_CHK_BLOCK_SIZE-offset;
+        if(chunk>count-done)
+            chunk=count-done;
+
+        //the CRC covers the whole block, so the whole block is read
+        result=FRAM_chk_load(chk,(adr+done)/FRAM_CHK_BLOCK_SIZE);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        memcpy(&buffer[done],&chk->slot[offset],chunk);
+        done+=chunk;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_chk_write_to_adr(FRAM_chk_t * const chk, uint32_t adr, const uint8_t * const buffer, uint32_t count){
+
+    uint32_t result;
+    uint32_t done=0;
+    uint32_t offset;
+    uint32_t chunk;
+    uint32_t block;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>=FRAM_chk_get_size(chk)||count>FRAM_chk_get_size(chk)-adr)
+        return FRAM_PARAMTER_ERROR;
+
+    while(done<count){
+
+        block=(adr+done)/FRAM_CHK_BLOCK_SIZE;
+        offset=(adr+done)%FRAM_CHK_BLOCK_SIZE;
+        chunk=FRAM_CHK_BLOCK_SIZE-offset;
+        if(chunk>count-done)
+            chunk=count-done;
+
+        if(chunk==FRAM_CHK_BLOCK_SIZE)
+            result=FRAM_chk_store(chk,block,&buffer[done]);
+        else{
+
+            //the rest of the block is kept, but only if it is intact
+            result=FRAM_chk_load(chk,block);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+
+            memcpy(&chk->slot[offset],&buffer[done],chunk);
+            result=FRAM_chk_store(chk,block,chk->slot);
+            chk->stats.merged++;
+        }
+
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        done+=chunk;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_chk_scrub(FRAM_chk_t * const chk, uint32_t block, uint32_t count){
+
+    uint32_t result;
+    uint32_t i;
+
+    //check if parameters are valid
+    if(count==0||block>=chk->blocks||count>chk->blocks-block)
+        return FRAM_PARAMTER_ERROR;
+
+    for(i=0;i<count;i++){
+        result=FRAM_chk_load(chk,block+i);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_chk_get_size(const FRAM_chk_t * const chk){return chk->blocks*FRAM_CHK_BLOCK_SIZE;}
+
+uint32_t FRAM_chk_get_bad(const FRAM_chk_t * const chk){return chk->bad;}
+
+const FRAM_chk_stats_t* FRAM_chk_get_stats(const FRAM_chk_t * const chk){return &chk->stats;}
+
+static uint32_t FRAM_chk_load(FRAM_chk_t * const chk, uint32_t block){
+
+    uint32_t result;
+    uint16_t crc;
+
+    result=FRAM_read_from_adr(chk->fram,chk->base+block*FRAM_CHK_SLOT_SIZE,chk->slot,FRAM_CHK_SLOT_SIZE);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    chk->stats.checked++;
+
+    crc=FRAM_chk_crc(FRAM_CHK_CRC_INIT,chk->slot,FRAM_CHK_BLOCK_SIZE);
+    if(FRAM_load16(&chk->slot[FRAM_CHK_BLOCK_SIZE])!=crc){
+        chk->bad=block;
+        chk->stats.mismatches++;
+        return FRAM_CHK_MISMATCH;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_chk_store(FRAM_chk_t * const chk, uint32_t block, const uint8_t * const data){
+
+    FRAM_part_t parts[2];
+    uint8_t crc[FRAM_CHK_CRC_SIZE];
+    uint32_t result;
+
+    FRAM_store16(crc,FRAM_chk_crc(FRAM_CHK_CRC_INIT,data,FRAM_CHK_BLOCK_SIZE));
+
+    //data and CRC go out with one transfer, without copying the data
+    parts[0].buffer=data;
+    parts[0].count=FRAM_CHK_BLOCK_SIZE;
+    parts[1].buffer=crc;
+    parts[1].count=FRAM_CHK_CRC_SIZE;
+
+    result=FRAM_write_parts_to_adr(chk->fram,chk->base+block*FRAM_CHK_SLOT_SIZE,parts,2);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    chk->stats.written++;
+
+    return FRAM_NO_ERROR;
+}
+
+/* [] END OF FILE */
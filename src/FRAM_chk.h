@@ -0,0 +1,202 @@
+/**
+ * @file FRAM_chk.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Checked region of a FRAM chip, every block of FRAM_CHK_BLOCK_SIZE bytes is followed by a CRC over it.
+ * The region is addressed like a chip of FRAM_CHK_BLOCK_SIZE bytes per block. A read fetches the whole blocks it touches and checks their CRCs,
+ * a write of a whole block sends the data and its CRC with one transfer. Blocks written in part are read, checked and merged first.
+ * The blocks follow each other without gaps, so the read of the next block hits the address latch.
+ *
+ * The CRC is CRC-16/CCITT-FALSE computed with a table of 256 entries in flash instead of bit by bit, the other modules use "FRAM_chk_crc" for their CRCs as well.
+ * If FRAM_CHK_CRC_HW is defined, it names a function of the application with the signature of "FRAM_chk_crc" used instead,
+ * e.g. one feeding a CRC block of the device.
+ * A reset during a write can leave a block failing its CRC, like a reset during "FRAM_write_to_adr" leaves it half written.
+ *
+ * A region is used by one task at a time, the functions do not lock the region itself.
+ */
+
+#if !defined(FRAM_CHK_H)
+#define FRAM_CHK_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_CHK_BLOCK_SIZE     64u                     //bytes of a block covered by one CRC
+#define FRAM_CHK_CRC_SIZE       2u                      //bytes of the CRC behind a block
+#define FRAM_CHK_SLOT_SIZE      (FRAM_CHK_BLOCK_SIZE+FRAM_CHK_CRC_SIZE)  //bytes a block takes on the chip
+#define FRAM_CHK_CRC_INIT       0xffffu                 //initial value of "FRAM_chk_crc"
+
+#define FRAM_CHK_MISMATCH       0x1000000u              //indicates a block failing its CRC
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a region
+*/
+typedef struct {
+    uint32_t    checked;                                //number of blocks read and checked
+    uint32_t    written;                                //number of blocks written
+    uint32_t    merged;                                 //number of blocks written in part, which were read first
+    uint32_t    mismatches;                             //number of blocks failing their CRC
+} FRAM_chk_stats_t;
+
+/**
+A checked region
+
+Initialise it with "FRAM_chk_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the region
+    uint32_t    base;                                   //address of the region
+    uint32_t    blocks;                                 //number of blocks of the region
+    uint32_t    bad;                                    //number of the last block failing its CRC, FRAM_INVALID_ADR if there was none
+    uint8_t     slot[FRAM_CHK_SLOT_SIZE];               //block and CRC of a read or a merge
+    FRAM_chk_stats_t stats;
+} FRAM_chk_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Compute a CRC
+
+CRC-16/CCITT-FALSE, start with FRAM_CHK_CRC_INIT. Data can be passed in pieces by passing the result of the previous piece as crc.
+
+@param crc CRC of the previous data
+@param data pointer to the data
+@param count number of bytes
+@return the CRC over the previous data and the data
+*/
+uint16_t    FRAM_chk_crc(uint16_t crc, const uint8_t * const data, uint32_t count);
+
+/**
+Initialise a region
+
+Does not access the chip. Call "FRAM_chk_format" once before the first use.
+
+@param chk the region to be initialised
+@param fram the chip holding the region
+@param base address of the region
+@param size size of the region, every FRAM_CHK_SLOT_SIZE bytes hold FRAM_CHK_BLOCK_SIZE bytes of data
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip or holds no block
+        FRAM_NO_ERROR if the region was initialised
+*/
+uint32_t    FRAM_chk_init(FRAM_chk_t * const chk, FRAM_t * const fram, uint32_t base, uint32_t size);
+
+/**
+Fill a region with zeros
+
+Costs one write of a block and its CRC per block.
+
+@param chk the region
+@return FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_chk_format(FRAM_chk_t * const chk);
+
+/**
+Read data
+
+Costs one read of block and CRC per block touched, all but the first read hit the address latch.
+
+@param chk the region
+@param adr address in the region, 0 is the first byte of the first block
+@param buffer pointer to the memory the data is stored to
+@param count number of bytes to read
+@return FRAM_PARAMTER_ERROR if the buffer points to NULL, the count is 0 or the data exceeds the region
+        FRAM_CHK_MISMATCH if a block fails its CRC, "FRAM_chk_get_bad" returns its number. The data before it was read.
+        FRAM_NO_ERROR if the data was read
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_chk_read_from_adr(FRAM_chk_t * const chk, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Write data
+
+Costs one write of block and CRC per block, blocks written in part are read first.
+A block written in part failing its CRC is not written, so its damage is not covered by a new CRC. Write the whole block to replace it.
+
+@param chk the region
+@param adr address in the region, 0 is the first byte of the first block
+@param buffer pointer to the data
+@param count number of bytes to write
+@return FRAM_PARAMTER_ERROR if the buffer points to NULL, the count is 0 or the data exceeds the region
+        FRAM_CHK_MISMATCH if a block written in part fails its CRC, "FRAM_chk_get_bad" returns its number. The data before it was written.
+        FRAM_NO_ERROR if the data was written
+        any other value is the output of "FRAM_read_from_adr" or "FRAM_write_parts_to_adr"
+*/
+uint32_t    FRAM_chk_write_to_adr(FRAM_chk_t * const chk, uint32_t adr, const uint8_t * const buffer, uint32_t count);
+
+/**
+Check blocks in idle time
+
+Reads the blocks and checks their CRCs, e.g. to find damaged blocks before the application needs them.
+
+@param chk the region
+@param block number of the first block
+@param count number of blocks
+@return FRAM_PARAMTER_ERROR if the count is 0 or the blocks exceed the region
+        FRAM_CHK_MISMATCH if a block fails its CRC, "FRAM_chk_get_bad" returns its number. The blocks after it were not checked.
+        FRAM_NO_ERROR if all blocks passed
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_chk_scrub(FRAM_chk_t * const chk, uint32_t block, uint32_t count);
+
+/**
+Get the size of a region
+
+@param chk the region
+@return number of bytes of data the region holds
+*/
+uint32_t    FRAM_chk_get_size(const FRAM_chk_t * const chk);
+
+/**
+Get the last block failing its CRC
+
+@param chk the region
+@return number of the block, the block at address n*FRAM_CHK_BLOCK_SIZE of the region, FRAM_INVALID_ADR if no block failed since "FRAM_chk_init"
+*/
+uint32_t    FRAM_chk_get_bad(const FRAM_chk_t * const chk);
+
+/**
+Get the statistics of a region
+
+@param chk the region
+@return the statistics collected since "FRAM_chk_init"
+*/
+const FRAM_chk_stats_t* FRAM_chk_get_stats(const FRAM_chk_t * const chk);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_CHK_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,223 @@
+/**
+ * @file FRAM_ckpt.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_ckpt.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_CKPT_MAGIC         0x314b4346u             //"FCK1"
+#define FRAM_CKPT_RANGE_MAX     (0xffffu/FRAM_CKPT_CHUNK_SIZE)  //highest number of chunks of one range, a range of the journal is at most 65535 bytes long
+#define FRAM_CKPT_FNV_BASIS     2166136261u             //FNV-1a, 32 bit
+#define FRAM_CKPT_FNV_PRIME     16777619u
+
+#if (FRAM_CKPT_CHUNKS&7u)!=0
+    #error "FRAM_CKPT_CHUNKS has to be a multiple of 8"
+#endif
+
+#define FRAM_CKPT_IS_DIRTY(ckpt,chunk)  ((ckpt)->dirty[(chunk)>>3]&(1u<<((chunk)&7u)))
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_ckpt_write(FRAM_ckpt_t * const ckpt, uint32_t adr, const uint8_t * const buffer, uint32_t count);
+static uint32_t FRAM_ckpt_hash(const uint8_t * const data, uint32_t count);
+static uint32_t FRAM_ckpt_chunk_size(const FRAM_ckpt_t * const ckpt, uint32_t chunk);
+static void     FRAM_ckpt_clear(FRAM_ckpt_t * const ckpt, uint32_t first, uint32_t count);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_ckpt_init(FRAM_ckpt_t * const ckpt, FRAM_t * const fram, FRAM_txn_t * const txn, uint32_t base, uint8_t * const image, uint32_t size){
+
+    //check if parameters are valid
+    if(image==NULL||size==0||size>FRAM_CKPT_CHUNKS*FRAM_CKPT_CHUNK_SIZE||base>fram->adr_max||FRAM_CKPT_SIZE(size)-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    ckpt->fram=fram;
+    ckpt->txn=txn;
+    ckpt->base=base;
+    ckpt->image=image;
+    ckpt->size=size;
+    ckpt->chunks=(size+FRAM_CKPT_CHUNK_SIZE-1)/FRAM_CKPT_CHUNK_SIZE;
+    ckpt->valid=0;
+
+    //nothing is known about the region yet, the first save writes every chunk
+    memset(ckpt->hash,0,sizeof(ckpt->hash));
+    memset(ckpt->dirty,0xff,sizeof(ckpt->dirty));
+
+    ckpt->stats.saves=0;
+    ckpt->stats.chunks=0;
+    ckpt->stats.ranges=0;
+    ckpt->stats.bytes=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ckpt_restore(FRAM_ckpt_t * const ckpt){
+
+    uint8_t header[FRAM_CKPT_HEADER];
+    uint32_t result;
+    uint32_t i;
+
+    //a save interrupted by a reset is finished first
+    if(ckpt->txn!=NULL){
+        result=FRAM_txn_recover(ckpt->txn);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    result=FRAM_read_from_adr(ckpt->fram,ckpt->base,header,FRAM_CKPT_HEADER);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(FRAM_load32(header)!=FRAM_CKPT_MAGIC||FRAM_load32(header+4)!=ckpt->size)
+        return FRAM_CKPT_EMPTY;
+
+    //the image follows the header, so the read hits the address latch
+    result=FRAM_read_from_adr(ckpt->fram,ckpt->base+FRAM_CKPT_HEADER,ckpt->image,ckpt->size);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    for(i=0;i<ckpt->chunks;i++)
+        ckpt->hash[i]=FRAM_ckpt_hash(&ckpt->image[i*FRAM_CKPT_CHUNK_SIZE],FRAM_ckpt_chunk_size(ckpt,i));
+
+    memset(ckpt->dirty,0,sizeof(ckpt->dirty));
+    ckpt->valid=1;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ckpt_save(FRAM_ckpt_t * const ckpt){
+
+    uint8_t header[FRAM_CKPT_HEADER];
+    uint32_t result=FRAM_NO_ERROR;
+    uint32_t hash;
+    uint32_t first;
+    uint32_t count;
+    uint32_t bytes;
+    uint32_t i;
+
+    //the hashes are updated right away, the dirty bits keep the chunks until they were written
+    for(i=0;i<ckpt->chunks;i++){
+        hash=FRAM_ckpt_hash(&ckpt->image[i*FRAM_CKPT_CHUNK_SIZE],FRAM_ckpt_chunk_size(ckpt,i));
+        if(hash!=ckpt->hash[i]){
+            ckpt->hash[i]=hash;
+            ckpt->dirty[i>>3]|=1u<<(i&7u);
+        }
+    }
+
+    if(ckpt->txn!=NULL){
+        result=FRAM_txn_begin(ckpt->txn);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    for(i=0;i<ckpt->chunks&&result==FRAM_NO_ERROR;i+=count){
+
+        if(!FRAM_CKPT_IS_DIRTY(ckpt,i)){
+            count=1;
+            continue;
+        }
+
+        //neighbouring chunks go out with one write
+        first=i;
+        bytes=0;
+        for(count=0;first+count<ckpt->chunks&&count<FRAM_CKPT_RANGE_MAX&&FRAM_CKPT_IS_DIRTY(ckpt,first+count);count++)
+            bytes+=FRAM_ckpt_chunk_size(ckpt,first+count);
+
+        result=FRAM_ckpt_write(ckpt,ckpt->base+FRAM_CKPT_HEADER+first*FRAM_CKPT_CHUNK_SIZE,&ckpt->image[first*FRAM_CKPT_CHUNK_SIZE],bytes);
+        if(result!=FRAM_NO_ERROR)
+            break;
+
+        //the chunks written directly are saved, the ones of the journal only with the commit
+        if(ckpt->txn==NULL)
+            FRAM_ckpt_clear(ckpt,first,count);
+
+        ckpt->stats.chunks+=count;
+        ckpt->stats.ranges++;
+        ckpt->stats.bytes+=bytes;
+    }
+
+    //the header follows the image, so a region gets valid only with a complete image
+    if(result==FRAM_NO_ERROR&&!ckpt->valid){
+        FRAM_store32(header,FRAM_CKPT_MAGIC);
+        FRAM_store32(header+4,ckpt->size);
+        result=FRAM_ckpt_write(ckpt,ckpt->base,header,FRAM_CKPT_HEADER);
+    }
+
+    if(ckpt->txn!=NULL){
+        if(result!=FRAM_NO_ERROR){
+            FRAM_txn_abort(ckpt->txn);
+            return result;
+        }
+
+        result=FRAM_txn_commit(ckpt->txn,FRAM_WAIT);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        FRAM_ckpt_clear(ckpt,0,ckpt->chunks);
+    }
+
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    ckpt->valid=1;
+    ckpt->stats.saves++;
+
+    return FRAM_NO_ERROR;
+}
+
+const FRAM_ckpt_stats_t* FRAM_ckpt_get_stats(const FRAM_ckpt_t * const ckpt){return &ckpt->stats;}
+
+static uint32_t FRAM_ckpt_write(FRAM_ckpt_t * const ckpt, uint32_t adr, const uint8_t * const buffer, uint32_t count){
+
+    FRAM_part_t part;
+
+    if(ckpt->txn!=NULL)
+        return FRAM_txn_write(ckpt->txn,adr,buffer,count);
+
+    //a single part, so the image does not have to be writable
+    part.buffer=buffer;
+    part.count=count;
+
+    return FRAM_write_parts_to_adr(ckpt->fram,adr,&part,1);
+}
+
+static uint32_t FRAM_ckpt_hash(const uint8_t * const data, uint32_t count){
+
+    uint32_t hash=FRAM_CKPT_FNV_BASIS;
+    uint32_t i;
+
+    for(i=0;i<count;i++)
+        hash=(hash^data[i])*FRAM_CKPT_FNV_PRIME;
+
+    return hash;
+}
+
+static uint32_t FRAM_ckpt_chunk_size(const FRAM_ckpt_t * const ckpt, uint32_t chunk){
+
+    //the last chunk may be shorter
+    if(chunk==ckpt->chunks-1)
+        return ckpt->size-chunk*FRAM_CKPT_CHUNK_SIZE;
+
+    return FRAM_CKPT_CHUNK_SIZE;
+}
+
+static void FRAM_ckpt_clear(FRAM_ckpt_t * const ckpt, uint32_t first, uint32_t count){
+
+    uint32_t i;
+
+    for(i=first;i<first+count;i++)
+        ckpt->dirty[i>>3]&=~(1u<<(i&7u));
+}
+
+/* [] END OF FILE */
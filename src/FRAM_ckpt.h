@@ -0,0 +1,147 @@
+/**
+ * @file FRAM_ckpt.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Incremental checkpoint of a block of SRAM (the image) into a region of a FRAM chip, e.g. the state of the application saved on a brown-out.
+ * The region holds a header and a copy of the image. The image is split into chunks of FRAM_CKPT_CHUNK_SIZE bytes,
+ * the checkpoint keeps a 32 bit hash of every chunk as it was saved last. A save hashes the image and writes only the chunks that changed,
+ * neighbouring chunks with one write. So the time on the bus grows with the changed chunks, not with the size of the image.
+ * "FRAM_ckpt_restore" reads the header and the whole image with one sequential read, which hits the address latch.
+ *
+ * Without journal, a reset during a save leaves a mix of old and new chunks in the region. With a journal (see FRAM_txn.h), a save is a transaction,
+ * so the region holds either the previous or the new checkpoint. That costs about three times the time on the bus, the chunks are written
+ * to the journal, read back and written to the region. The journal needs room for the whole image, which the first save writes, a few more bytes for the header of every range and its marker.
+ *
+ * The image must not change during a save. A checkpoint is used by one task at a time, the functions do not lock the checkpoint itself.
+ */
+
+#if !defined(FRAM_CKPT_H)
+#define FRAM_CKPT_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+#include "FRAM_txn.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_CKPT_CHUNK_SIZE    64u                     //bytes of a chunk covered by one hash
+#define FRAM_CKPT_CHUNKS        128u                    //highest number of chunks of an image, a multiple of 8
+#define FRAM_CKPT_HEADER        8u                      //bytes of the header in front of the image: magic (4), size of the image (4)
+#define FRAM_CKPT_SIZE(size)    (FRAM_CKPT_HEADER+(size))  //size of the region of an image of size bytes
+
+#define FRAM_CKPT_EMPTY         0x2000000u              //indicates that the region holds no checkpoint of the image
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a checkpoint
+*/
+typedef struct {
+    uint32_t    saves;                                  //number of saves
+    uint32_t    chunks;                                 //number of chunks written
+    uint32_t    ranges;                                 //number of writes of neighbouring chunks
+    uint32_t    bytes;                                  //number of bytes of the image written
+} FRAM_ckpt_stats_t;
+
+/**
+A checkpoint
+
+Initialise it with "FRAM_ckpt_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the region
+    FRAM_txn_t  *txn;                                   //journal of the saves, NULL to write the chunks directly
+    uint32_t    base;                                   //address of the region
+    uint8_t     *image;                                 //SRAM saved to the region
+    uint32_t    size;                                   //size of the image
+    uint32_t    chunks;                                 //number of chunks of the image
+    uint8_t     valid;                                  //1 if the region holds a header of the image
+    uint32_t    hash[FRAM_CKPT_CHUNKS];                 //hash of every chunk as it was saved last
+    uint8_t     dirty[FRAM_CKPT_CHUNKS/8u];             //bit per chunk to be written by the next save
+    FRAM_ckpt_stats_t stats;
+} FRAM_ckpt_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a checkpoint
+
+Does not access the chip. Call "FRAM_ckpt_restore" after a reset, until then every chunk counts as changed.
+
+@param ckpt the checkpoint to be initialised
+@param fram the chip holding the region
+@param txn the journal saves are written through, on the same chip and initialised. NULL writes the chunks directly.
+@param base address of the region, the region is FRAM_CKPT_SIZE(size) bytes long
+@param image pointer to the SRAM to be saved
+@param size size of the image, up to FRAM_CKPT_CHUNKS*FRAM_CKPT_CHUNK_SIZE bytes
+@return FRAM_PARAMTER_ERROR if the image points to NULL, the size is invalid or the region does not fit into the chip
+        FRAM_NO_ERROR if the checkpoint was initialised
+*/
+uint32_t    FRAM_ckpt_init(FRAM_ckpt_t * const ckpt, FRAM_t * const fram, FRAM_txn_t * const txn, uint32_t base, uint8_t * const image, uint32_t size);
+
+/**
+Restore the image after a reset
+
+Finishes the journal with "FRAM_txn_recover" if there is one, then reads header and image with one sequential read.
+The hashes are taken from the restored image, so the next save writes only what changed after the restore.
+
+@param ckpt the checkpoint
+@return FRAM_CKPT_EMPTY if the region holds no checkpoint of an image of this size, the image is not changed and the next save writes all of it
+        FRAM_NO_ERROR if the image was restored
+        any other value is the output of "FRAM_txn_recover" or "FRAM_read_from_adr", the content of the image is undefined
+*/
+uint32_t    FRAM_ckpt_restore(FRAM_ckpt_t * const ckpt);
+
+/**
+Save the image
+
+Writes the chunks changed since the last save, neighbouring chunks with one write. The first save into an empty region writes the whole image and the header.
+
+@param ckpt the checkpoint
+@return FRAM_MEMORY_ERROR if the changed chunks do not fit into the journal, nothing was saved
+        FRAM_NO_ERROR if the image was saved
+        any other value is the output of "FRAM_write_to_adr" or the functions of the journal. The chunks not saved are written by the next save.
+*/
+uint32_t    FRAM_ckpt_save(FRAM_ckpt_t * const ckpt);
+
+/**
+Get the statistics of a checkpoint
+
+@param ckpt the checkpoint
+@return the statistics collected since "FRAM_ckpt_init"
+*/
+const FRAM_ckpt_stats_t* FRAM_ckpt_get_stats(const FRAM_ckpt_t * const ckpt);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_CKPT_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,653 @@
+/**
+ * @file FRAM_containers.hpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Containers with their elements stored in FRAM for the C++ front-end.
+ * fram::array<T,N> has a fixed size, fram::vector<T> persists its size in front of the elements and fram::ring<T> keeps the last elements pushed.
+ * Sizes and positions are cached in SRAM, so only element accesses go to the chip.
+ * The vector and the ring keep their size and position in two header copies with a magic number, the capacity, a sequence number and a CRC,
+ * written alternately. open() takes the newer valid copy, so a header torn by a reset falls back to the previous state
+ * and a chip that never held the container, or held one of a different kind or capacity, is not taken for one. Needs FRAM_chk.c for the CRC.
+ * Reads go through a window of a few elements that is filled by one sequential read. Accessing the elements in ascending order therefore
+ * costs one transfer per window and the refills hit the address latch of the chip.
+ * Writes go straight to the chip and update the window.
+ * fram::range<T> is a view of elements at a given FRAM address without any stored metadata.
+ * All containers provide begin() and end(), see FRAM_iterator.hpp.
+ */
+
+#if !defined(FRAM_CONTAINERS_HPP)
+#define FRAM_CONTAINERS_HPP
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "FRAM.hpp"
+#include "FRAM_chk.h"
+#include "FRAM_iterator.hpp"
+
+namespace fram {
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+namespace detail {
+
+/**
+Read window over elements of type T stored at adr
+
+@tparam Dev the chip, a fram::Fram
+@tparam Window number of elements read at once
+*/
+template<class T, class Dev, std::size_t Window>
+class window {
+    static_assert(std::is_trivially_copyable_v<T>,"elements are copied byte by byte");
+    static_assert(Window>0,"empty window");
+
+public:
+    window(Dev &dev, uint32_t adr) : dev_(dev), adr_(adr) {}
+
+    /**
+    Gets element i, refills the window if i is not in it
+
+    The window is refilled from i on, or up to i if i lies before the window, so a backward pass also reads a whole window at once.
+
+    @param limit number of elements stored at adr, the window does not read beyond it
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t get(std::size_t i, std::size_t limit, T &value){
+
+        if(i<first_||i>=first_+valid_){
+            std::size_t first=i;
+            std::size_t count;
+            uint32_t result;
+
+            //a window before the current one ends at i
+            if(i<first_)
+                first=i+1>=Window?i+1-Window:0;
+
+            count=limit-first<Window?limit-first:Window;
+            result=dev_.read(adr_+first*sizeof(T),span<uint8_t>(buf_,count*sizeof(T)));
+
+            if(result!=FRAM_NO_ERROR){
+                valid_=0;
+                return fail(result);
+            }
+
+            first_=first;
+            valid_=count;
+        }
+
+        std::memcpy(&value,buf_+(i-first_)*sizeof(T),sizeof(T));
+
+        return FRAM_NO_ERROR;
+    }
+
+    /**
+    Writes element i and updates the window
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t put(std::size_t i, const T &value){
+
+        uint32_t result=dev_.write(adr_+i*sizeof(T),span<const uint8_t>(reinterpret_cast<const uint8_t*>(&value),sizeof(T)));
+
+        if(i>=first_&&i<first_+valid_){
+            if(result==FRAM_NO_ERROR)
+                std::memcpy(buf_+(i-first_)*sizeof(T),&value,sizeof(T));
+            else
+                valid_=0;
+        }
+
+        return fail(result);
+    }
+
+    void invalidate(){valid_=0;}
+
+    /**
+    Gets the first error since the last call and clears it
+
+    @return FRAM_NO_ERROR or the first error of "get" and "put"
+    */
+    uint32_t status(){
+
+        uint32_t error=error_;
+
+        error_=FRAM_NO_ERROR;
+
+        return error;
+    }
+
+    Dev& dev() const {return dev_;}
+    uint32_t adr() const {return adr_;}
+
+private:
+    uint32_t fail(uint32_t result){
+
+        if(error_==FRAM_NO_ERROR)
+            error_=result;
+
+        return result;
+    }
+
+    Dev         &dev_;
+    uint32_t    adr_;                                   //FRAM address of element 0
+    uint32_t    error_=FRAM_NO_ERROR;                   //first error since the last "status"
+    std::size_t first_=0;                               //index of the first element in the window
+    std::size_t valid_=0;                               //number of elements in the window
+    alignas(T) uint8_t buf_[Window*sizeof(T)];
+};
+
+//true if bytes bytes starting at adr fit into the chip
+template<class Dev>
+constexpr bool fits(uint32_t adr, uint64_t bytes){return bytes>0&&adr<=Dev::adr_max&&bytes-1<=Dev::adr_max-adr;}
+
+/**
+Two copies of the header of a container, holding two values
+
+Every store writes the older copy with the next sequence number, so the newer copy stays intact if the store is interrupted.
+
+@tparam Dev the chip, a fram::Fram
+@tparam Magic identifies the kind of container
+*/
+template<class Dev, uint32_t Magic>
+class header {
+    struct record_t {
+        uint32_t magic;
+        uint32_t seq;                                   //incremented by every store, the higher one is the newer copy
+        uint32_t capacity;                              //capacity of the container that stored it
+        uint32_t value[2];
+        uint16_t crc;                                   //CRC of the members above
+        uint16_t reserved;
+    };
+
+public:
+    static constexpr uint32_t bytes=2*sizeof(record_t);    //FRAM bytes of both copies
+
+    header(Dev &dev, uint32_t adr, uint32_t capacity) : dev_(dev), adr_(adr), capacity_(capacity) {}
+
+    /**
+    Reads both copies and takes the newer valid one
+
+    @param valid set to false if no copy is valid, the values are 0 then
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t load(uint32_t (&value)[2], bool &valid){
+
+        record_t record[2];
+        uint32_t result;
+        bool ok[2];
+
+        result=dev_.read(adr_,span<uint8_t>(reinterpret_cast<uint8_t*>(record),sizeof(record)));
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        for(uint8_t i=0;i<2;i++)
+            ok[i]=record[i].magic==Magic&&record[i].capacity==capacity_&&record[i].crc==crc(record[i]);
+
+        valid=ok[0]||ok[1];
+        if(!valid){
+            seq_=0;
+            value[0]=value[1]=0;
+            return FRAM_NO_ERROR;
+        }
+
+        //the copy written last wins, the sequence number may wrap around
+        current_=ok[0]&&ok[1]?static_cast<int32_t>(record[1].seq-record[0].seq)>0:ok[1];
+        seq_=record[current_].seq;
+        value[0]=record[current_].value[0];
+        value[1]=record[current_].value[1];
+
+        return FRAM_NO_ERROR;
+    }
+
+    /**
+    Writes the values into the older copy
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t store(uint32_t value0, uint32_t value1){
+
+        record_t record{Magic,seq_+1,capacity_,{value0,value1},0,0};
+        uint32_t result;
+
+        record.crc=crc(record);
+        result=dev_.write(adr_+(current_^1)*sizeof(record_t),span<const uint8_t>(reinterpret_cast<const uint8_t*>(&record),sizeof(record)));
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        current_^=1;
+        seq_=record.seq;
+
+        return FRAM_NO_ERROR;
+    }
+
+private:
+    static uint16_t crc(const record_t &record){return FRAM_chk_crc(FRAM_CHK_CRC_INIT,reinterpret_cast<const uint8_t*>(&record),offsetof(record_t,crc));}
+
+    Dev         &dev_;
+    uint32_t    adr_;                                   //FRAM address of the first copy
+    uint32_t    capacity_;
+    uint32_t    seq_=0;                                 //sequence number of the newer copy
+    uint8_t     current_=1;                             //index of the newer copy, the next store writes the other one
+};
+
+} /* namespace detail */
+
+/**
+View of count elements at a FRAM address
+
+@tparam T type of the elements, has to be trivially copyable
+@tparam Dev the chip, a fram::Fram
+@tparam Window number of elements read at once
+*/
+template<class T, class Dev, std::size_t Window=8>
+class range {
+public:
+    using value_type=T;
+
+    /**
+    @param adr FRAM address of the first element
+    @param count number of elements
+    */
+    range(Dev &dev, uint32_t adr, std::size_t count) : win_(dev,adr), count_(count) {}
+
+    /**
+    Checks the range fits into the chip
+
+    @return FRAM_PARAMTER_ERROR or FRAM_NO_ERROR
+    */
+    uint32_t open(){return count_==0||detail::fits<Dev>(win_.adr(),uint64_t(count_)*sizeof(T))?FRAM_NO_ERROR:FRAM_PARAMTER_ERROR;}
+
+    std::size_t size() const {return count_;}
+
+    iterator<range> begin(){return iterator<range>(this,0);}
+    iterator<range> end(){return iterator<range>(this,count_);}
+
+    /**
+    Reads element i
+
+    @return FRAM_PARAMTER_ERROR if i is out of range, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t get(std::size_t i, T &value){return i<count_?win_.get(i,count_,value):FRAM_PARAMTER_ERROR;}
+
+    /**
+    Writes element i
+
+    @return FRAM_PARAMTER_ERROR if i is out of range, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t set(std::size_t i, const T &value){return i<count_?win_.put(i,value):FRAM_PARAMTER_ERROR;}
+
+    /**
+    Gets the first transfer error of the element accesses since the last call, errors of iterators end up here
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t status(){return win_.status();}
+
+private:
+    detail::window<T,Dev,Window> win_;
+    std::size_t count_;
+};
+
+/**
+Fixed number of elements in FRAM
+
+@tparam T type of the elements, has to be trivially copyable
+@tparam N number of elements
+@tparam Dev the chip, a fram::Fram
+@tparam Window number of elements read at once
+*/
+template<class T, std::size_t N, class Dev, std::size_t Window=8>
+class array {
+public:
+    using value_type=T;
+
+    static constexpr uint32_t bytes=N*sizeof(T);        //FRAM bytes used by the array
+
+    /**
+    @param adr FRAM address of the first element
+    */
+    array(Dev &dev, uint32_t adr) : win_(dev,adr) {}
+
+    /**
+    Checks the array fits into the chip
+
+    @return FRAM_PARAMTER_ERROR or FRAM_NO_ERROR
+    */
+    uint32_t open(){return detail::fits<Dev>(win_.adr(),bytes)?FRAM_NO_ERROR:FRAM_PARAMTER_ERROR;}
+
+    static constexpr std::size_t size(){return N;}
+
+    iterator<array> begin(){return iterator<array>(this,0);}
+    iterator<array> end(){return iterator<array>(this,N);}
+
+    /**
+    Reads element i
+
+    @return FRAM_PARAMTER_ERROR if i is out of range, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t get(std::size_t i, T &value){return i<N?win_.get(i,N,value):FRAM_PARAMTER_ERROR;}
+
+    /**
+    Writes element i
+
+    @return FRAM_PARAMTER_ERROR if i is out of range, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t set(std::size_t i, const T &value){return i<N?win_.put(i,value):FRAM_PARAMTER_ERROR;}
+
+    /**
+    Writes value to all elements
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t fill(const T &value){
+
+        uint32_t result=FRAM_NO_ERROR;
+
+        for(std::size_t i=0;i<N&&result==FRAM_NO_ERROR;i++)
+            result=win_.put(i,value);
+
+        return result;
+    }
+
+    /**
+    Gets the first transfer error of the element accesses since the last call, errors of iterators end up here
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t status(){return win_.status();}
+
+private:
+    detail::window<T,Dev,Window> win_;
+};
+
+/**
+Elements in FRAM with the number of elements stored in front of them
+
+The element is written before the size, so an interrupted push_back leaves the previous size.
+The size is stored in a header with two copies, see FRAM_containers.hpp.
+
+@tparam T type of the elements, has to be trivially copyable
+@tparam Dev the chip, a fram::Fram
+@tparam Window number of elements read at once
+*/
+template<class T, class Dev, std::size_t Window=8>
+class vector {
+public:
+    using value_type=T;
+
+    /**
+    FRAM bytes used by a vector of capacity elements
+    */
+    static constexpr uint64_t bytes(uint32_t capacity){return header_t::bytes+uint64_t(capacity)*sizeof(T);}
+
+    /**
+    @param adr FRAM address of the header, the elements follow it
+    @param capacity maximum number of elements
+    */
+    vector(Dev &dev, uint32_t adr, uint32_t capacity) : win_(dev,adr+header_t::bytes), header_(dev,adr,capacity), adr_(adr), capacity_(capacity) {}
+
+    /**
+    Checks the vector fits into the chip and reads its size into SRAM
+
+    Without a valid header, e.g. on a new chip or after the capacity was changed, the vector is taken as uninitialised and cleared.
+
+    @return FRAM_PARAMTER_ERROR, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t open(){
+
+        uint32_t value[2];
+        uint32_t result;
+        bool valid;
+
+        if(!detail::fits<Dev>(adr_,bytes(capacity_)))
+            return FRAM_PARAMTER_ERROR;
+
+        win_.invalidate();
+        result=header_.load(value,valid);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        size_=value[0];
+
+        return !valid||size_>capacity_?clear():FRAM_NO_ERROR;
+    }
+
+    std::size_t size() const {return size_;}
+    std::size_t capacity() const {return capacity_;}
+    bool empty() const {return size_==0;}
+
+    iterator<vector> begin(){return iterator<vector>(this,0);}
+    iterator<vector> end(){return iterator<vector>(this,size_);}
+
+    /**
+    Reads element i
+
+    @return FRAM_PARAMTER_ERROR if i is out of range, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t get(std::size_t i, T &value){return i<size_?win_.get(i,size_,value):FRAM_PARAMTER_ERROR;}
+
+    /**
+    Writes element i
+
+    @return FRAM_PARAMTER_ERROR if i is out of range, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t set(std::size_t i, const T &value){return i<size_?win_.put(i,value):FRAM_PARAMTER_ERROR;}
+
+    /**
+    Appends an element
+
+    @return FRAM_MEMORY_ERROR if the vector is full, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t push_back(const T &value){
+
+        uint32_t result;
+
+        if(size_>=capacity_)
+            return FRAM_MEMORY_ERROR;
+
+        result=win_.put(size_,value);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        return store_size(size_+1);
+    }
+
+    /**
+    Removes the last element
+
+    @return FRAM_PARAMTER_ERROR if the vector is empty, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t pop_back(){return size_>0?store_size(size_-1):FRAM_PARAMTER_ERROR;}
+
+    /**
+    Removes all elements
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t clear(){return store_size(0);}
+
+    /**
+    Gets the first transfer error of the element accesses since the last call, errors of iterators end up here
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t status(){return win_.status();}
+
+private:
+    using header_t=detail::header<Dev,0x31455646>;      //"FVE1"
+
+    uint32_t store_size(uint32_t size){
+
+        uint32_t result=header_.store(size,0);
+
+        if(result==FRAM_NO_ERROR)
+            size_=size;
+
+        return result;
+    }
+
+    detail::window<T,Dev,Window> win_;
+    header_t header_;
+    uint32_t adr_;                                      //FRAM address of the header
+    uint32_t capacity_;
+    uint32_t size_=0;                                   //SRAM copy of the size
+};
+
+/**
+The last capacity elements pushed, stored in FRAM
+
+Index 0 is the oldest element. The position of the oldest element and the number of elements are stored in front of the elements
+and written after the element, so an interrupted push leaves the previous state unless the ring was full.
+They are stored in a header with two copies, see FRAM_containers.hpp.
+
+@tparam T type of the elements, has to be trivially copyable
+@tparam Dev the chip, a fram::Fram
+@tparam Window number of elements read at once
+*/
+template<class T, class Dev, std::size_t Window=8>
+class ring {
+    struct state_t {
+        uint32_t head;                                  //position of the oldest element
+        uint32_t count;                                 //number of elements
+    };
+
+    using header_t=detail::header<Dev,0x31475246>;      //"FRG1"
+
+public:
+    using value_type=T;
+
+    /**
+    FRAM bytes used by a ring of capacity elements
+    */
+    static constexpr uint64_t bytes(uint32_t capacity){return header_t::bytes+uint64_t(capacity)*sizeof(T);}
+
+    /**
+    @param adr FRAM address of the header, the elements follow it
+    @param capacity number of elements kept
+    */
+    ring(Dev &dev, uint32_t adr, uint32_t capacity) : win_(dev,adr+header_t::bytes), header_(dev,adr,capacity), adr_(adr), capacity_(capacity) {}
+
+    /**
+    Checks the ring fits into the chip and reads its header into SRAM
+
+    Without a valid header, e.g. on a new chip or after the capacity was changed, the ring is taken as uninitialised and cleared.
+
+    @return FRAM_PARAMTER_ERROR, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t open(){
+
+        uint32_t value[2];
+        uint32_t result;
+        bool valid;
+
+        if(capacity_==0||!detail::fits<Dev>(adr_,bytes(capacity_)))
+            return FRAM_PARAMTER_ERROR;
+
+        win_.invalidate();
+        result=header_.load(value,valid);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        state_=state_t{value[0],value[1]};
+
+        return !valid||state_.head>=capacity_||state_.count>capacity_?clear():FRAM_NO_ERROR;
+    }
+
+    std::size_t size() const {return state_.count;}
+    std::size_t capacity() const {return capacity_;}
+    bool empty() const {return state_.count==0;}
+    bool full() const {return state_.count==capacity_;}
+
+    iterator<ring> begin(){return iterator<ring>(this,0);}
+    iterator<ring> end(){return iterator<ring>(this,state_.count);}
+
+    /**
+    Reads element i, 0 is the oldest element
+
+    @return FRAM_PARAMTER_ERROR if i is out of range, FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t get(std::size_t i, T &value){return i<state_.count?win_.get(slot(i),capacity_,value):FRAM_PARAMTER_ERROR;}
+
+    /**
+    Appends an element, the oldest element is dropped if the ring is full
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t push(const T &value){
+
+        state_t next=state_;
+        uint32_t result;
+
+        if(next.count<capacity_)
+            next.count++;
+        else
+            next.head=(next.head+1)%capacity_;
+
+        result=win_.put(slot(state_.count<capacity_?state_.count:0),value);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        return store_state(next);
+    }
+
+    /**
+    Removes all elements
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t clear(){return store_state(state_t{0,0});}
+
+    /**
+    Gets the first transfer error of the element accesses since the last call, errors of iterators end up here
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    uint32_t status(){return win_.status();}
+
+private:
+    //position of element i
+    std::size_t slot(std::size_t i) const {return (state_.head+i)%capacity_;}
+
+    uint32_t store_state(const state_t &state){
+
+        uint32_t result=header_.store(state.head,state.count);
+
+        if(result==FRAM_NO_ERROR)
+            state_=state;
+
+        return result;
+    }
+
+    detail::window<T,Dev,Window> win_;
+    header_t header_;
+    uint32_t adr_;                                      //FRAM address of the header
+    uint32_t capacity_;
+    state_t state_{0,0};                                //SRAM copy of the header
+};
+
+} /* namespace fram */
+
+#endif /* (FRAM_CONTAINERS_HPP) */
+
+/* [] END OF FILE */
@@ -0,0 +1,411 @@
+/**
+ * @file FRAM_coro.hpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * C++20 coroutine front-end of fram::Fram.
+ * A fram::task is a coroutine returning a status code. fram::async<Fram> provides read and write operations a task can co_await.
+ * A fram::executor runs any number of tasks on one thread: suspended operations are polled in the order they were issued,
+ * one operation per bus owns the bus until it is done, and a task is resumed as soon as its operation completes.
+ * The next operation of a bus is started before the tasks of the finished ones are resumed, so the bus keeps working while they run.
+ * Operations are polled through the status of the bus, so no interrupt handler is needed.
+ *
+ * Example:
+ *   fram::task logger(fram::async<MyFram> &f){
+ *       std::array<uint8_t,16> buf;
+ *       uint32_t result=co_await f.read(0x100,buf);
+ *       ...
+ *       co_return result;
+ *   }
+ *   fram::executor exec;
+ *   fram::async<MyFram> f(dev,exec);
+ *   exec.spawn(logger(f));
+ *   exec.run();
+ *
+ * The synchronous functions of fram::Fram must not be used on a bus while operations of an executor are pending on it.
+ */
+
+#if !defined(FRAM_CORO_HPP)
+#define FRAM_CORO_HPP
+
+#if __cplusplus<202002L || !__has_include(<coroutine>)
+#error "FRAM_coro.hpp needs C++20 coroutines"
+#endif
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include "FRAM.hpp"
+
+namespace fram {
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+class executor;
+
+/**
+Coroutine returning a status code, co_return FRAM_NO_ERROR or an error
+
+A task starts when it is passed to "executor::spawn" or awaited by another task.
+*/
+class task {
+public:
+    struct promise_type;
+    using handle_t=std::coroutine_handle<promise_type>;
+
+    struct final_awaiter {
+        bool await_ready() noexcept {return false;}
+        std::coroutine_handle<> await_suspend(handle_t h) noexcept;
+        void await_resume() noexcept {}
+    };
+
+    struct promise_type {
+        uint32_t                result=FRAM_NO_ERROR;
+        std::coroutine_handle<> continuation;           //task awaiting this one
+        executor                *owner=nullptr;         //executor of a spawned task, it frees the frame when done
+
+        task get_return_object(){return task(handle_t::from_promise(*this));}
+        std::suspend_always initial_suspend() noexcept {return {};}
+        final_awaiter final_suspend() noexcept {return {};}
+        void return_value(uint32_t value){result=value;}
+        void unhandled_exception(){std::terminate();}
+    };
+
+    task(task &&other) noexcept : h_(std::exchange(other.h_,nullptr)) {}
+    task(const task&)=delete;
+    task& operator=(const task&)=delete;
+    ~task(){if(h_) h_.destroy();}
+
+    /**
+    Runs the task until it is done, the status code is the result of co_await
+    */
+    auto operator co_await() && noexcept {
+
+        struct awaiter {
+            handle_t h;
+
+            bool await_ready() noexcept {return h.done();}
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {h.promise().continuation=caller; return h;}
+            uint32_t await_resume() noexcept {return h.promise().result;}
+        };
+
+        return awaiter{h_};
+    }
+
+private:
+    friend class executor;
+
+    explicit task(handle_t h) : h_(h) {}
+
+    handle_t release(){return std::exchange(h_,nullptr);}
+
+    handle_t h_;
+};
+
+/**
+Runs tasks and polls the FRAM operations they are waiting for
+*/
+class executor {
+public:
+    /**
+    A suspended operation, linked into the executor while its task waits
+    */
+    struct waiter {
+        waiter                  *next=nullptr;
+        std::coroutine_handle<> handle;                 //task to resume
+
+        /**
+        Advances the operation
+
+        @return true if it is done
+        */
+        virtual bool poll()=0;
+
+    protected:
+        ~waiter()=default;
+    };
+
+    executor()=default;
+    executor(const executor&)=delete;
+    executor& operator=(const executor&)=delete;
+
+    /**
+    Starts a task, it runs up to its first pending operation
+    */
+    void spawn(task &&t){
+
+        task::handle_t h=t.release();
+
+        if(!h)
+            return;
+
+        h.promise().owner=this;
+        running_++;
+        h.resume();
+    }
+
+    /**
+    Appends a waiter, operations are polled in the order they were issued
+    */
+    void enqueue(waiter *w){
+
+        w->next=nullptr;
+        if(tail_)
+            tail_->next=w;
+        else
+            head_=w;
+        tail_=w;
+    }
+
+    /**
+    Polls every waiter once and resumes the tasks of the finished ones
+
+    All waiters are polled before the tasks are resumed, so the next operations already run on the buses while the tasks work.
+
+    @return true if an operation finished
+    */
+    bool poll(){
+
+        waiter *prev=nullptr;
+        waiter *w=head_;
+        waiter *done=nullptr;
+        waiter *done_tail=nullptr;
+
+        while(w){
+            waiter *next=w->next;
+
+            if(w->poll()){
+                //move it to the finished ones, the next waiter of its bus can start right away
+                if(prev)
+                    prev->next=next;
+                else
+                    head_=next;
+                if(tail_==w)
+                    tail_=prev;
+
+                w->next=nullptr;
+                if(done_tail)
+                    done_tail->next=w;
+                else
+                    done=w;
+                done_tail=w;
+            }
+            else
+                prev=w;
+
+            w=next;
+        }
+
+        //the task may issue new operations or free the waiter
+        for(w=done;w;){
+            waiter *next=w->next;
+
+            w->handle.resume();
+            w=next;
+        }
+
+        return done!=nullptr;
+    }
+
+    /**
+    Runs until all spawned tasks are done
+
+    @param idle called after a pass without progress, e.g. to yield to other RTOS tasks, may be NULL
+    */
+    void run(void (*idle)(void)=nullptr){
+
+        while(running_>0)
+            if(!poll()&&idle)
+                idle();
+    }
+
+    /**
+    Gets the number of spawned tasks not done yet
+    */
+    std::size_t running() const {return running_;}
+
+private:
+    friend struct task::final_awaiter;
+
+    waiter      *head_=nullptr;
+    waiter      *tail_=nullptr;
+    std::size_t running_=0;
+};
+
+inline std::coroutine_handle<> task::final_awaiter::await_suspend(handle_t h) noexcept {
+
+    promise_type &p=h.promise();
+
+    if(p.owner){
+        //spawned task, nobody awaits the result
+        p.owner->running_--;
+        h.destroy();
+        return std::noop_coroutine();
+    }
+
+    return p.continuation?p.continuation:std::noop_coroutine();
+}
+
+namespace detail {
+
+//operation currently owning the bus "Bus", one per I2C instance
+template<class Bus>
+struct bus_owner {
+    inline static const void *owner=nullptr;
+};
+
+} /* namespace detail */
+
+/**
+Awaitable read and write operations on a fram::Fram
+
+@tparam F the chip, a fram::Fram
+*/
+template<class F>
+class async {
+    using Bus=typename F::bus;
+
+    /**
+    Read or write, writes are split into transfers that fit into the transfer buffer
+    */
+    class op final : public executor::waiter {
+    public:
+        op(async &a, uint32_t adr, uint8_t *rx, const uint8_t *tx, std::size_t count)
+            : a_(a), adr_(adr), rx_(rx), tx_(tx), count_(count) {}
+
+        bool await_ready(){
+
+            //range errors are reported right away
+            if(count_==0||adr_>F::adr_max||count_-1>F::adr_max-adr_){
+                result_=FRAM_PARAMTER_ERROR;
+                return true;
+            }
+
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h){
+
+            handle=h;
+            a_.exec_.enqueue(this);
+        }
+
+        uint32_t await_resume() const {return result_;}
+
+        bool poll() override {
+
+            if(flag_!=0){
+                if(0u==(Bus::status()&flag_))
+                    return false;
+                flag_=0;
+            }
+            else{
+                if(detail::bus_owner<Bus>::owner!=nullptr&&detail::bus_owner<Bus>::owner!=this)
+                    return false;
+                detail::bus_owner<Bus>::owner=this;
+            }
+
+            if(done_==count_)
+                return finish(FRAM_NO_ERROR);
+
+            return start_next();
+        }
+
+    private:
+        //starts the next transfer, returns true if the operation failed
+        bool start_next(){
+
+            uint32_t adr=adr_+static_cast<uint32_t>(done_);
+            std::size_t part=count_-done_;
+            uint32_t result;
+
+            if(rx_){
+                if(a_.dev_.adr()!=adr){
+                    result=a_.dev_.set_adr(adr,FRAM_DONT_WAIT);
+                    flag_=Bus::wr_cmplt;
+                    return result!=FRAM_NO_ERROR?finish(result):false;
+                }
+                result=a_.dev_.read_current(span<uint8_t>(rx_+done_,part),FRAM_DONT_WAIT);
+                flag_=Bus::rd_cmplt;
+            }
+            else{
+                if(part>F::tx_size)
+                    part=F::tx_size;
+                result=a_.dev_.write_chunk(adr,span<const uint8_t>(tx_+done_,part),FRAM_DONT_WAIT);
+                flag_=Bus::wr_cmplt;
+            }
+
+            if(result!=FRAM_NO_ERROR)
+                return finish(result);
+
+            done_+=part;
+
+            return false;
+        }
+
+        bool finish(uint32_t result){
+
+            result_=result;
+            detail::bus_owner<Bus>::owner=nullptr;
+
+            return true;
+        }
+
+        async           &a_;
+        uint32_t        adr_;
+        uint8_t         *rx_;                           //destination of a read, NULL for writes
+        const uint8_t   *tx_;                           //source of a write
+        std::size_t     count_;
+        std::size_t     done_=0;                        //bytes transferred or in flight
+        uint32_t        flag_=0;                        //status flag of the running transfer, 0 if none is running
+        uint32_t        result_=FRAM_NO_ERROR;
+    };
+
+public:
+    async(F &dev, executor &exec) : dev_(dev), exec_(exec) {}
+
+    /**
+    Reads data from a given address, data has to stay valid until the operation is done
+
+    @return awaitable giving FRAM_PARAMTER_ERROR, FRAM_NO_ERROR or the output of the I2C module
+    */
+    op read(uint32_t adr, span<uint8_t> data){return op(*this,adr,data.data(),nullptr,data.size());}
+
+    /**
+    Writes data to a given address, data has to stay valid until the operation is done
+
+    @return awaitable giving FRAM_PARAMTER_ERROR, FRAM_NO_ERROR or the output of the I2C module
+    */
+    op write(uint32_t adr, span<const uint8_t> data){return op(*this,adr,nullptr,data.data(),data.size());}
+
+private:
+    F           &dev_;
+    executor    &exec_;
+};
+
+} /* namespace fram */
+
+#endif /* (FRAM_CORO_HPP) */
+
+/* [] END OF FILE */
@@ -0,0 +1,538 @@
+/**
+ * @file FRAM_fs.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_fs.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_FS_RECORD_OFFSET   (FRAM_FS_NAME_MAX+1u)   //offset of the A/B record in an entry
+#define FRAM_FS_BLOCK_MAX       (FRAM_HEAP_UNITS*FRAM_HEAP_UNIT)  //largest block of the heap
+
+#define FRAM_FS_READ            0u                      //direction of "FRAM_fs_transfer"
+#define FRAM_FS_WRITE           1u
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_fs_find(const FRAM_fs_t * const fs, const char * const name, uint8_t * const entry);
+static uint32_t FRAM_fs_load(FRAM_fs_t * const fs, FRAM_fs_entry_t * const entry);
+static uint32_t FRAM_fs_grow(FRAM_fs_t * const fs, FRAM_fs_entry_t * const entry, uint32_t end);
+static void     FRAM_fs_shrink(FRAM_fs_t * const fs, FRAM_fs_entry_t * const entry, uint8_t extents);
+static uint32_t FRAM_fs_release(FRAM_fs_t * const fs, FRAM_fs_entry_t * const entry, uint8_t remove);
+static uint32_t FRAM_fs_reclaim(FRAM_fs_t * const fs);
+static uint32_t FRAM_fs_transfer(FRAM_fs_t * const fs, const FRAM_fs_entry_t * const entry, uint32_t pos, uint8_t * const buffer, uint32_t count, uint8_t direction);
+static uint32_t FRAM_fs_write_record(FRAM_fs_entry_t * const entry);
+static uint32_t FRAM_fs_capacity(const FRAM_fs_entry_t * const entry, uint8_t * const extents);
+static uint8_t  FRAM_fs_length(const char * const name);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_fs_init(FRAM_fs_t * const fs, FRAM_t * const fram, uint32_t base, uint32_t size){
+
+    uint32_t result;
+    uint8_t i;
+
+    //check if parameters are valid
+    if(size<=FRAM_FS_DIR_SIZE||base>fram->adr_max||size-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    //the heap takes the rest of the region
+    result=FRAM_heap_init(&fs->heap,fram,base+FRAM_FS_DIR_SIZE,size-FRAM_FS_DIR_SIZE);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    fs->base=base;
+    memset(fs->dir,0,sizeof(fs->dir));
+
+    for(i=0;i<FRAM_FS_FILES;i++)
+        FRAM_ab_init(&fs->dir[i].record,fram,base+(uint32_t)i*FRAM_FS_ENTRY_SIZE+FRAM_FS_RECORD_OFFSET,FRAM_FS_RECORD_SIZE);
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_fs_format(FRAM_fs_t * const fs){
+
+    FRAM_part_t parts[FRAM_FS_FILES];
+    uint8_t entry[FRAM_FS_ENTRY_SIZE];
+    uint32_t result;
+    uint8_t i;
+
+    //every entry is cleared by the same buffer, so the directory is written with one transfer, a cleared trailer fails its CRC
+    memset(entry,0,sizeof(entry));
+    for(i=0;i<FRAM_FS_FILES;i++){
+        parts[i].buffer=entry;
+        parts[i].count=FRAM_FS_ENTRY_SIZE;
+    }
+
+    result=FRAM_write_parts_to_adr(fs->heap.fram,fs->base,parts,FRAM_FS_FILES);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    for(i=0;i<FRAM_FS_FILES;i++){
+        memset(fs->dir[i].name,0,sizeof(fs->dir[i].name));
+        FRAM_fs_load(fs,&fs->dir[i]);
+        FRAM_ab_init(&fs->dir[i].record,fs->heap.fram,fs->dir[i].record.base,FRAM_FS_RECORD_SIZE);
+    }
+
+    return FRAM_heap_format(&fs->heap);
+}
+
+uint32_t FRAM_fs_mount(FRAM_fs_t * const fs){
+
+    FRAM_fs_entry_t *entry;
+    uint32_t result;
+    uint8_t i;
+
+    result=FRAM_heap_mount(&fs->heap);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    for(i=0;i<FRAM_FS_FILES;i++){
+
+        entry=&fs->dir[i];
+
+        result=FRAM_read_from_adr(fs->heap.fram,fs->base+(uint32_t)i*FRAM_FS_ENTRY_SIZE,(uint8_t*)entry->name,FRAM_FS_NAME_MAX+1);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        //an entry without a terminated name is unused
+        if(memchr(entry->name,0,FRAM_FS_NAME_MAX+1)==NULL)
+            entry->name[0]=0;
+
+        //the record of an unused entry is mounted as well, so the next write of it goes to the right slot
+        result=FRAM_ab_mount(&entry->record);
+        if(result!=FRAM_NO_ERROR&&result!=FRAM_AB_EMPTY)
+            return result;
+
+        result=FRAM_fs_load(fs,entry);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    return FRAM_fs_reclaim(fs);
+}
+
+uint32_t FRAM_fs_open(FRAM_fs_t * const fs, FRAM_fs_file_t * const file, const char * const name, uint8_t flags){
+
+    FRAM_fs_entry_t *entry;
+    uint32_t result;
+    uint8_t index;
+    uint8_t length;
+
+    //check if parameters are valid
+    if(file==NULL||name==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    length=FRAM_fs_length(name);
+    if(length==0||length>FRAM_FS_NAME_MAX)
+        return FRAM_PARAMTER_ERROR;
+
+    result=FRAM_fs_find(fs,name,&index);
+    if(result==FRAM_NO_ERROR&&(flags&FRAM_FS_TRUNCATE)){
+
+        result=FRAM_fs_release(fs,&fs->dir[index],0);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+    else if(result==FRAM_FS_NOT_FOUND){
+
+        if(!(flags&FRAM_FS_CREATE))
+            return FRAM_FS_NOT_FOUND;
+
+        for(index=0;index<FRAM_FS_FILES&&fs->dir[index].name[0]!=0;index++);
+        if(index==FRAM_FS_FILES)
+            return FRAM_MEMORY_ERROR;
+
+        //the record of an unused entry may still hold the extents of a removed file, it is emptied before the name is written
+        entry=&fs->dir[index];
+        result=FRAM_fs_write_record(entry);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        //the first character makes the entry used, so it is written last and a reset never leaves a mix of two names
+        memset(entry->name,0,sizeof(entry->name));
+        memcpy(entry->name,name,length);
+
+        result=FRAM_write_to_adr(fs->heap.fram,fs->base+(uint32_t)index*FRAM_FS_ENTRY_SIZE+1u,(uint8_t*)entry->name+1,FRAM_FS_NAME_MAX);
+        if(result==FRAM_NO_ERROR)
+            result=FRAM_write_to_adr(fs->heap.fram,fs->base+(uint32_t)index*FRAM_FS_ENTRY_SIZE,(uint8_t*)entry->name,1);
+
+        if(result!=FRAM_NO_ERROR){
+            entry->name[0]=0;
+            return result;
+        }
+    }
+
+    file->fs=fs;
+    file->entry=index;
+    file->pos=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_fs_read(FRAM_fs_file_t * const file, uint8_t * const buffer, uint32_t size, uint32_t * const count){
+
+    const FRAM_fs_entry_t *entry;
+    uint32_t result;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    entry=&file->fs->dir[file->entry];
+
+    //the file may have been cut by another handle
+    if(file->pos>=entry->size)
+        size=0;
+    else if(size>entry->size-file->pos)
+        size=entry->size-file->pos;
+
+    *count=0;
+    if(size==0)
+        return FRAM_NO_ERROR;
+
+    result=FRAM_fs_transfer(file->fs,entry,file->pos,buffer,size,FRAM_FS_READ);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    file->pos+=size;
+    *count=size;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_fs_write(FRAM_fs_file_t * const file, uint8_t * const buffer, uint32_t count){
+
+    FRAM_fs_entry_t *entry;
+    uint32_t result;
+    uint32_t size;
+    uint8_t extents;
+
+    entry=&file->fs->dir[file->entry];
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||count>0xffffffffu-file->pos||file->pos>entry->size)
+        return FRAM_PARAMTER_ERROR;
+
+    FRAM_fs_capacity(entry,&extents);
+
+    result=FRAM_fs_grow(file->fs,entry,file->pos+count);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    result=FRAM_fs_transfer(file->fs,entry,file->pos,buffer,count,FRAM_FS_WRITE);
+
+    //the record follows the data, so a reset before keeps the previous size
+    size=entry->size;
+    if(result==FRAM_NO_ERROR&&file->pos+count>size){
+        entry->size=file->pos+count;
+        result=FRAM_fs_write_record(entry);
+        if(result!=FRAM_NO_ERROR)
+            entry->size=size;
+    }
+
+    if(result!=FRAM_NO_ERROR){
+        FRAM_fs_shrink(file->fs,entry,extents);
+        return result;
+    }
+
+    file->pos+=count;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_fs_seek(FRAM_fs_file_t * const file, uint32_t pos){
+
+    //check if parameters are valid
+    if(pos>file->fs->dir[file->entry].size)
+        return FRAM_PARAMTER_ERROR;
+
+    file->pos=pos;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_fs_get_size(const FRAM_fs_file_t * const file){return file->fs->dir[file->entry].size;}
+
+uint32_t FRAM_fs_remove(FRAM_fs_t * const fs, const char * const name){
+
+    uint32_t result;
+    uint8_t index;
+    uint8_t length;
+
+    //check if parameters are valid
+    if(name==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    length=FRAM_fs_length(name);
+    if(length==0||length>FRAM_FS_NAME_MAX)
+        return FRAM_PARAMTER_ERROR;
+
+    result=FRAM_fs_find(fs,name,&index);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    return FRAM_fs_release(fs,&fs->dir[index],1);
+}
+
+static uint32_t FRAM_fs_find(const FRAM_fs_t * const fs, const char * const name, uint8_t * const entry){
+
+    uint8_t i;
+
+    for(i=0;i<FRAM_FS_FILES;i++){
+        if(fs->dir[i].name[0]!=0&&strncmp(fs->dir[i].name,name,FRAM_FS_NAME_MAX+1)==0){
+            *entry=i;
+            return FRAM_NO_ERROR;
+        }
+    }
+
+    return FRAM_FS_NOT_FOUND;
+}
+
+static uint32_t FRAM_fs_load(FRAM_fs_t * const fs, FRAM_fs_entry_t * const entry){
+
+    uint8_t data[FRAM_FS_RECORD_SIZE];
+    uint32_t result;
+    uint32_t capacity=0;
+    uint16_t count;
+    uint8_t k;
+
+    entry->size=0;
+    memset(entry->extent,0,sizeof(entry->extent));
+    memset(entry->length,0,sizeof(entry->length));
+
+    if(entry->name[0]==0)
+        return FRAM_NO_ERROR;
+
+    //an empty record is a file of size 0
+    result=FRAM_ab_read(&entry->record,data,sizeof(data),&count);
+    if(result==FRAM_AB_EMPTY)
+        return FRAM_NO_ERROR;
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    //keep the extents up to the first one which is no block of the heap
+    for(k=0;k<FRAM_FS_EXTENTS;k++){
+        entry->extent[k]=FRAM_load32(&data[4u+4u*k]);
+        if(entry->extent[k]==0)
+            break;
+
+        entry->length[k]=FRAM_heap_get_size(&fs->heap,entry->extent[k]);
+        if(entry->length[k]==0){
+            entry->extent[k]=0;
+            break;
+        }
+
+        capacity+=entry->length[k];
+    }
+
+    for(;k<FRAM_FS_EXTENTS;k++)
+        entry->extent[k]=0;
+
+    entry->size=FRAM_load32(data);
+    if(entry->size>capacity)
+        entry->size=capacity;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_fs_grow(FRAM_fs_t * const fs, FRAM_fs_entry_t * const entry, uint32_t end){
+
+    uint32_t result;
+    uint32_t capacity;
+    uint32_t want;
+    uint8_t extents;
+    uint8_t first;
+
+    capacity=FRAM_fs_capacity(entry,&extents);
+    first=extents;
+
+    while(capacity<end){
+
+        if(extents==FRAM_FS_EXTENTS){
+            FRAM_fs_shrink(fs,entry,first);
+            return FRAM_MEMORY_ERROR;
+        }
+
+        //at least as large as the extents so far, so the number of extents grows with the logarithm of the size
+        want=end-capacity;
+        if(want<capacity)
+            want=capacity;
+        if(want>FRAM_FS_BLOCK_MAX)
+            want=FRAM_FS_BLOCK_MAX;
+
+        //take smaller blocks if the heap has no block that large
+        do{
+            result=FRAM_heap_alloc(&fs->heap,want,&entry->extent[extents]);
+            want/=2;
+        }while(result==FRAM_MEMORY_ERROR&&want>=FRAM_HEAP_UNIT);
+
+        if(result!=FRAM_NO_ERROR){
+            entry->extent[extents]=0;
+            FRAM_fs_shrink(fs,entry,first);
+            return result;
+        }
+
+        entry->length[extents]=FRAM_heap_get_size(&fs->heap,entry->extent[extents]);
+        capacity+=entry->length[extents];
+        extents++;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static void FRAM_fs_shrink(FRAM_fs_t * const fs, FRAM_fs_entry_t * const entry, uint8_t extents){
+
+    //the extents from this one on are not in the record on the chip, so they are just given back
+    for(;extents<FRAM_FS_EXTENTS&&entry->extent[extents]!=0;extents++){
+        FRAM_heap_free(&fs->heap,entry->extent[extents]);
+        entry->extent[extents]=0;
+        entry->length[extents]=0;
+    }
+}
+
+static uint32_t FRAM_fs_release(FRAM_fs_t * const fs, FRAM_fs_entry_t * const entry, uint8_t remove){
+
+    FRAM_fs_entry_t old=*entry;
+    uint32_t result;
+    uint8_t i;
+
+    entry->size=0;
+    memset(entry->extent,0,sizeof(entry->extent));
+    memset(entry->length,0,sizeof(entry->length));
+
+    //a removed file loses its whole name first, the record is emptied when the entry is used again.
+    //A file cut to size 0 gets an empty record first. A reset before the extents are freed leaves them to "FRAM_fs_mount".
+    if(remove){
+        memset(entry->name,0,sizeof(entry->name));
+        result=FRAM_write_to_adr(fs->heap.fram,entry->record.base-FRAM_FS_RECORD_OFFSET,(uint8_t*)entry->name,FRAM_FS_NAME_MAX+1);
+    }
+    else
+        result=FRAM_fs_write_record(entry);
+
+    if(result!=FRAM_NO_ERROR){
+        *entry=old;
+        return result;
+    }
+
+    for(i=0;i<FRAM_FS_EXTENTS&&old.extent[i]!=0;i++)
+        FRAM_heap_free(&fs->heap,old.extent[i]);
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_fs_reclaim(FRAM_fs_t * const fs){
+
+    uint32_t result;
+    uint32_t adr;
+    uint32_t length;
+    uint8_t used;
+    uint8_t i;
+    uint8_t k;
+
+    //free the blocks left without file, e.g. by a reset while a file grew
+    for(adr=fs->heap.data;adr<fs->heap.data+(uint32_t)fs->heap.units*FRAM_HEAP_UNIT;adr+=length){
+
+        length=FRAM_heap_get_size(&fs->heap,adr);
+        if(length==0){
+            length=FRAM_HEAP_UNIT;
+            continue;
+        }
+
+        used=0;
+        for(i=0;i<FRAM_FS_FILES&&!used;i++)
+            for(k=0;k<FRAM_FS_EXTENTS&&fs->dir[i].extent[k]!=0;k++)
+                if(fs->dir[i].extent[k]==adr)
+                    used=1;
+
+        if(!used){
+            result=FRAM_heap_free(&fs->heap,adr);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+        }
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_fs_transfer(FRAM_fs_t * const fs, const FRAM_fs_entry_t * const entry, uint32_t pos, uint8_t * const buffer, uint32_t count, uint8_t direction){
+
+    uint32_t result;
+    uint32_t done=0;
+    uint32_t chunk;
+    uint8_t i=0;
+
+    //find the extent holding the position
+    while(pos>=entry->length[i]){
+        pos-=entry->length[i];
+        i++;
+    }
+
+    //one transfer per extent
+    while(done<count){
+
+        chunk=entry->length[i]-pos;
+        if(chunk>count-done)
+            chunk=count-done;
+
+        if(direction==FRAM_FS_WRITE)
+            result=FRAM_write_to_adr(fs->heap.fram,entry->extent[i]+pos,&buffer[done],chunk);
+        else
+            result=FRAM_read_from_adr(fs->heap.fram,entry->extent[i]+pos,&buffer[done],chunk);
+
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        done+=chunk;
+        pos=0;
+        i++;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_fs_write_record(FRAM_fs_entry_t * const entry){
+
+    uint8_t data[FRAM_FS_RECORD_SIZE];
+    uint8_t k;
+
+    FRAM_store32(data,entry->size);
+    for(k=0;k<FRAM_FS_EXTENTS;k++)
+        FRAM_store32(&data[4u+4u*k],entry->extent[k]);
+
+    return FRAM_ab_write(&entry->record,data,FRAM_FS_RECORD_SIZE);
+}
+
+static uint32_t FRAM_fs_capacity(const FRAM_fs_entry_t * const entry, uint8_t * const extents){
+
+    uint32_t capacity=0;
+    uint8_t k;
+
+    for(k=0;k<FRAM_FS_EXTENTS&&entry->extent[k]!=0;k++)
+        capacity+=entry->length[k];
+
+    *extents=k;
+
+    return capacity;
+}
+
+static uint8_t FRAM_fs_length(const char * const name){
+
+    uint8_t length;
+
+    for(length=0;name[length]!=0&&length<=FRAM_FS_NAME_MAX;length++);
+
+    return length;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,228 @@
+/**
+ * @file FRAM_fs.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Minimal file system in a region of a FRAM chip, e.g. for calibration data, logs and crash dumps growing independently.
+ * FRAM is byte addressable and needs no erase, so files are written in place without blocks or wear levelling.
+ *
+ * The region starts with a directory of FRAM_FS_FILES entries. An entry holds the name and an A/B record (see FRAM_ab.h)
+ * of size and up to FRAM_FS_EXTENTS extents, so a reset never leaves size and extents of a file half updated.
+ * The extents are blocks of a heap (see FRAM_heap.h) placed behind the directory. A file growing beyond its extents gets a new one,
+ * at least as large as the extents it already has, so few extents cover a file.
+ * The directory is cached in SRAM, so reads and writes cost one transfer per extent touched. A write growing a file costs one more write
+ * of the record of its entry, after the data.
+ *
+ * A reset during a write growing a file keeps the previous size. Blocks of the heap left without file by a reset are freed by "FRAM_fs_mount".
+ * A file created or removed during a reset either exists or not: a new name is written with its first character last,
+ * a removed file loses its whole name before its extents are given back.
+ *
+ * A file system is used by one task at a time, the functions do not lock the file system itself.
+ */
+
+#if !defined(FRAM_FS_H)
+#define FRAM_FS_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+#include "FRAM_heap.h"
+#include "FRAM_ab.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_FS_FILES           8u                      //number of entries of the directory
+#define FRAM_FS_NAME_MAX        15u                     //highest length of a name without the terminating 0
+#define FRAM_FS_EXTENTS         6u                      //highest number of extents of a file
+#define FRAM_FS_RECORD_SIZE     (4u+4u*FRAM_FS_EXTENTS) //bytes of the record of an entry: size (4), address of each extent (4)
+#define FRAM_FS_ENTRY_SIZE      (FRAM_FS_NAME_MAX+1u+FRAM_AB_SIZE(FRAM_FS_RECORD_SIZE))  //bytes of an entry: name, A/B record
+#define FRAM_FS_DIR_SIZE        (FRAM_FS_FILES*FRAM_FS_ENTRY_SIZE)  //bytes of the directory at the start of the region
+
+#define FRAM_FS_CREATE          0x01u                   //flag of "FRAM_fs_open": create the file if it does not exist
+#define FRAM_FS_TRUNCATE        0x02u                   //flag of "FRAM_fs_open": cut the file to size 0
+
+#define FRAM_FS_NOT_FOUND       0x200000u               //indicates that there is no file of this name
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Entry of the directory
+*/
+typedef struct {
+    char        name[FRAM_FS_NAME_MAX+1];               //name of the file, empty if the entry is unused
+    uint32_t    size;                                   //size of the file
+    uint32_t    extent[FRAM_FS_EXTENTS];                //address of each extent, 0 if unused
+    uint32_t    length[FRAM_FS_EXTENTS];                //bytes of each extent, only kept in SRAM
+    FRAM_ab_t   record;                                 //record holding size and extents
+} FRAM_fs_entry_t;
+
+/**
+A file system
+
+Initialise it with "FRAM_fs_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_heap_t heap;                                   //heap holding the extents
+    uint32_t    base;                                   //address of the region, the directory starts here
+    FRAM_fs_entry_t dir[FRAM_FS_FILES];                 //cached directory
+} FRAM_fs_t;
+
+/**
+An open file
+
+The members are private to the driver.
+*/
+typedef struct {
+    FRAM_fs_t   *fs;                                    //file system holding the file
+    uint32_t    pos;                                    //position of the next read or write
+    uint8_t     entry;                                  //index of the entry of the file
+} FRAM_fs_file_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a file system
+
+Does not access the chip. Call "FRAM_fs_format" to start an empty file system or "FRAM_fs_mount" to use the file system found in the region.
+
+@param fs the file system to be initialised
+@param fram the chip holding the file system
+@param base address of the region
+@param size size of the region, FRAM_FS_DIR_SIZE bytes are taken by the directory, the rest by the heap
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip or is too small
+        FRAM_NO_ERROR if the file system was initialised
+*/
+uint32_t    FRAM_fs_init(FRAM_fs_t * const fs, FRAM_t * const fram, uint32_t base, uint32_t size);
+
+/**
+Start an empty file system
+
+Costs one write of the directory and one write of the map of the heap.
+
+@param fs the file system
+@return FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_fs_format(FRAM_fs_t * const fs);
+
+/**
+Use the file system found in the region
+
+Mounts the heap and reads name and record of every entry. Blocks of the heap not used by a file are freed.
+
+@param fs the file system
+@return FRAM_NO_ERROR if the file system can be used
+        any other value is the output of "FRAM_heap_mount", "FRAM_ab_mount", "FRAM_read_from_adr" or "FRAM_heap_free"
+*/
+uint32_t    FRAM_fs_mount(FRAM_fs_t * const fs);
+
+/**
+Open a file
+
+The position is set to the start of the file. Creating a file costs one write of the empty record and two writes of the name.
+
+@param fs the file system
+@param file the handle of the file is stored here
+@param name the name, a string of up to FRAM_FS_NAME_MAX characters
+@param flags FRAM_FS_CREATE and FRAM_FS_TRUNCATE or 0
+@return FRAM_PARAMTER_ERROR if either a pointer is NULL or the name is invalid
+        FRAM_FS_NOT_FOUND if there is no file of this name and FRAM_FS_CREATE is not set
+        FRAM_MEMORY_ERROR if the file is to be created and the directory is full
+        FRAM_NO_ERROR if the file was opened
+        any other value is the output of "FRAM_write_to_adr" or "FRAM_ab_write"
+*/
+uint32_t    FRAM_fs_open(FRAM_fs_t * const fs, FRAM_fs_file_t * const file, const char * const name, uint8_t flags);
+
+/**
+Read from a file
+
+Reads from the position up to the end of the file and moves the position. Costs one read per extent touched.
+
+@param file the file
+@param buffer pointer to the memory the data is stored to
+@param size bytes to read
+@param count the number of bytes read is stored here, less than size at the end of the file
+@return FRAM_PARAMTER_ERROR if a pointer is NULL
+        FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_fs_read(FRAM_fs_file_t * const file, uint8_t * const buffer, uint32_t size, uint32_t * const count);
+
+/**
+Write to a file
+
+Writes at the position and moves it. Costs one write per extent touched, plus one write of the entry if the file grows.
+
+@param file the file
+@param buffer pointer to the data
+@param count bytes to write
+@return FRAM_PARAMTER_ERROR if the buffer points to NULL, the count is 0 or the file was cut behind the position
+        FRAM_MEMORY_ERROR if the file cannot grow by enough extents, nothing was written
+        FRAM_NO_ERROR if the data was written
+        any other value is the output of "FRAM_write_to_adr", "FRAM_ab_write" or "FRAM_heap_alloc"
+*/
+uint32_t    FRAM_fs_write(FRAM_fs_file_t * const file, uint8_t * const buffer, uint32_t count);
+
+/**
+Set the position of a file
+
+@param file the file
+@param pos the new position, at most the size of the file
+@return FRAM_PARAMTER_ERROR if the position is behind the end of the file
+        FRAM_NO_ERROR if the position was set
+*/
+uint32_t    FRAM_fs_seek(FRAM_fs_file_t * const file, uint32_t pos);
+
+/**
+Get the size of a file
+
+@param file the file
+@return the size of the file
+*/
+uint32_t    FRAM_fs_get_size(const FRAM_fs_file_t * const file);
+
+/**
+Remove a file
+
+Clears the name first, then frees the extents. The record is emptied when the entry is used again. Handles of the file must not be used anymore.
+
+@param fs the file system
+@param name the name of the file
+@return FRAM_PARAMTER_ERROR if the name is invalid
+        FRAM_FS_NOT_FOUND if there is no file of this name
+        FRAM_NO_ERROR if the file was removed
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_fs_remove(FRAM_fs_t * const fs, const char * const name);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_FS_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,365 @@
+/**
+ * @file FRAM_heap.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_heap.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_HEAP_FREE          0u                      //map entry of a free unit
+#define FRAM_HEAP_HEAD          1u                      //map entry of the first unit of a block
+#define FRAM_HEAP_TAIL          2u                      //map entry of a further unit of a block
+#define FRAM_HEAP_NIL           0xffffu                 //end of a free list
+#define FRAM_HEAP_NO_ORDER      0xffu                   //order of a unit not starting a free block
+
+#if (1u<<(FRAM_HEAP_CLASSES-1u))!=FRAM_HEAP_UNITS
+    #error "FRAM_HEAP_UNITS has to be a power of two and FRAM_HEAP_CLASSES log2(FRAM_HEAP_UNITS)+1"
+#endif
+
+#define FRAM_HEAP_MAP_SIZE(heap) (((uint32_t)(heap)->units+3u)/4u)
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint8_t  FRAM_heap_get(const FRAM_heap_t * const heap, uint32_t unit);
+static void     FRAM_heap_set(FRAM_heap_t * const heap, uint32_t unit, uint32_t count, uint8_t entry);
+static uint32_t FRAM_heap_block(const FRAM_heap_t * const heap, uint32_t adr, uint32_t * const unit, uint8_t * const order);
+static uint32_t FRAM_heap_write_map(FRAM_heap_t * const heap, uint32_t unit, uint32_t count, uint8_t head_last);
+static void     FRAM_heap_build(FRAM_heap_t * const heap);
+static void     FRAM_heap_push(FRAM_heap_t * const heap, uint32_t unit, uint8_t order);
+static void     FRAM_heap_unlink(FRAM_heap_t * const heap, uint32_t unit);
+static void     FRAM_heap_release(FRAM_heap_t * const heap, uint32_t unit, uint8_t order);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_heap_init(FRAM_heap_t * const heap, FRAM_t * const fram, uint32_t base, uint32_t size){
+
+    uint32_t units;
+
+    //check if parameters are valid
+    if(size==0||base>fram->adr_max||size-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    //place as many units as fit behind their map
+    units=size/FRAM_HEAP_UNIT;
+    if(units>FRAM_HEAP_UNITS)
+        units=FRAM_HEAP_UNITS;
+    while(units>0&&(units+3)/4+units*FRAM_HEAP_UNIT>size)
+        units--;
+
+    if(units==0)
+        return FRAM_PARAMTER_ERROR;
+
+    heap->fram=fram;
+    heap->base=base;
+    heap->units=units;
+    heap->data=base+FRAM_HEAP_MAP_SIZE(heap);
+
+    //no free block until the heap is formatted or mounted
+    memset(heap->map,0,sizeof(heap->map));
+    memset(heap->head,0xff,sizeof(heap->head));
+    memset(heap->order,FRAM_HEAP_NO_ORDER,sizeof(heap->order));
+    heap->free=0;
+    heap->used=0;
+
+    heap->stats.allocs=0;
+    heap->stats.frees=0;
+    heap->stats.fails=0;
+    heap->stats.repaired=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_heap_format(FRAM_heap_t * const heap){
+
+    uint32_t result;
+
+    memset(heap->map,0,sizeof(heap->map));
+
+    result=FRAM_write_to_adr(heap->fram,heap->base,heap->map,FRAM_HEAP_MAP_SIZE(heap));
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    FRAM_heap_build(heap);
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_heap_mount(FRAM_heap_t * const heap){
+
+    uint32_t result;
+    uint32_t unit;
+    uint32_t count;
+    uint8_t repaired=0;
+
+    //the whole map in one stream
+    result=FRAM_read_from_adr(heap->fram,heap->base,heap->map,FRAM_HEAP_MAP_SIZE(heap));
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    unit=0;
+    while(unit<heap->units){
+
+        if(FRAM_heap_get(heap,unit)==FRAM_HEAP_FREE){
+            unit++;
+            continue;
+        }
+
+        count=1;
+        while(unit+count<heap->units&&FRAM_heap_get(heap,unit+count)==FRAM_HEAP_TAIL)
+            count++;
+
+        //a block is a power of two units aligned to its size, anything else was left by an interrupted operation
+        if(FRAM_heap_get(heap,unit)!=FRAM_HEAP_HEAD||(count&(count-1))!=0||unit%count!=0){
+            FRAM_heap_set(heap,unit,count,FRAM_HEAP_FREE);
+            heap->stats.repaired++;
+            repaired=1;
+        }
+
+        unit+=count;
+    }
+
+    //clear the entries behind the last unit as well
+    for(unit=heap->units;unit<FRAM_HEAP_MAP_SIZE(heap)*4;unit++)
+        FRAM_heap_set(heap,unit,1,FRAM_HEAP_FREE);
+
+    FRAM_heap_build(heap);
+
+    if(repaired)
+        return FRAM_write_to_adr(heap->fram,heap->base,heap->map,FRAM_HEAP_MAP_SIZE(heap));
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_heap_alloc(FRAM_heap_t * const heap, uint32_t size, uint32_t * const adr){
+
+    uint32_t result;
+    uint32_t unit;
+    uint8_t order;
+    uint8_t from;
+
+    //check if parameters are valid
+    if(size==0||adr==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    if(size>(uint32_t)heap->units*FRAM_HEAP_UNIT){
+        heap->stats.fails++;
+        return FRAM_MEMORY_ERROR;
+    }
+
+    //smallest class holding the size
+    size=(size+FRAM_HEAP_UNIT-1)/FRAM_HEAP_UNIT;
+    for(order=0;(1u<<order)<size;order++);
+
+    //smallest class with a free block
+    for(from=order;from<FRAM_HEAP_CLASSES&&!(heap->used&(1u<<from));from++);
+    if(from==FRAM_HEAP_CLASSES){
+        heap->stats.fails++;
+        return FRAM_MEMORY_ERROR;
+    }
+
+    //the block is taken from the start of the free block, the map is written before the free lists are changed.
+    //The byte holding the head goes last, a reset before it leaves tails without a head, which the mount frees.
+    unit=heap->head[from];
+    FRAM_heap_set(heap,unit,1,FRAM_HEAP_HEAD);
+    FRAM_heap_set(heap,unit+1,(1u<<order)-1,FRAM_HEAP_TAIL);
+
+    result=FRAM_heap_write_map(heap,unit,1u<<order,1);
+    if(result!=FRAM_NO_ERROR){
+        FRAM_heap_set(heap,unit,1u<<order,FRAM_HEAP_FREE);
+        return result;
+    }
+
+    //split the free block, the upper halves stay free
+    FRAM_heap_unlink(heap,unit);
+    while(from>order){
+        from--;
+        FRAM_heap_push(heap,unit+(1u<<from),from);
+    }
+
+    heap->free-=1u<<order;
+    heap->stats.allocs++;
+
+    *adr=heap->data+unit*FRAM_HEAP_UNIT;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_heap_free(FRAM_heap_t * const heap, uint32_t adr){
+
+    uint32_t result;
+    uint32_t unit;
+    uint8_t order;
+
+    //check if parameters are valid
+    if(FRAM_heap_block(heap,adr,&unit,&order)!=FRAM_NO_ERROR)
+        return FRAM_PARAMTER_ERROR;
+
+    //the byte holding the head goes first, a reset after it leaves tails without a head, which the mount frees
+    FRAM_heap_set(heap,unit,1u<<order,FRAM_HEAP_FREE);
+
+    result=FRAM_heap_write_map(heap,unit,1u<<order,0);
+    if(result!=FRAM_NO_ERROR){
+        FRAM_heap_set(heap,unit,1,FRAM_HEAP_HEAD);
+        FRAM_heap_set(heap,unit+1,(1u<<order)-1,FRAM_HEAP_TAIL);
+        return result;
+    }
+
+    FRAM_heap_release(heap,unit,order);
+
+    heap->free+=1u<<order;
+    heap->stats.frees++;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_heap_get_size(const FRAM_heap_t * const heap, uint32_t adr){
+
+    uint32_t unit;
+    uint8_t order;
+
+    if(FRAM_heap_block(heap,adr,&unit,&order)!=FRAM_NO_ERROR)
+        return 0;
+
+    return (1u<<order)*FRAM_HEAP_UNIT;
+}
+
+uint32_t FRAM_heap_get_free(const FRAM_heap_t * const heap){return (uint32_t)heap->free*FRAM_HEAP_UNIT;}
+
+const FRAM_heap_stats_t* FRAM_heap_get_stats(const FRAM_heap_t * const heap){return &heap->stats;}
+
+static uint8_t FRAM_heap_get(const FRAM_heap_t * const heap, uint32_t unit){return (heap->map[unit/4]>>((unit%4)*2))&3u;}
+
+static void FRAM_heap_set(FRAM_heap_t * const heap, uint32_t unit, uint32_t count, uint8_t entry){
+
+    for(;count>0;count--,unit++)
+        heap->map[unit/4]=(heap->map[unit/4]&~(3u<<((unit%4)*2)))|entry<<((unit%4)*2);
+}
+
+static uint32_t FRAM_heap_block(const FRAM_heap_t * const heap, uint32_t adr, uint32_t * const unit, uint8_t * const order){
+
+    uint32_t count;
+
+    if(adr<heap->data||(adr-heap->data)%FRAM_HEAP_UNIT!=0||(adr-heap->data)/FRAM_HEAP_UNIT>=heap->units)
+        return FRAM_PARAMTER_ERROR;
+
+    *unit=(adr-heap->data)/FRAM_HEAP_UNIT;
+    if(FRAM_heap_get(heap,*unit)!=FRAM_HEAP_HEAD)
+        return FRAM_PARAMTER_ERROR;
+
+    count=1;
+    while(*unit+count<heap->units&&FRAM_heap_get(heap,*unit+count)==FRAM_HEAP_TAIL)
+        count++;
+
+    for(*order=0;(1u<<*order)<count;(*order)++);
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_heap_write_map(FRAM_heap_t * const heap, uint32_t unit, uint32_t count, uint8_t head_last){
+
+    uint32_t first=unit/4;
+    uint32_t last=(unit+count-1)/4;
+    uint32_t result;
+
+    //a block of more than 4 units starts a byte of the map, the bytes behind it are written on their own before it
+    if(head_last&&last>first){
+        result=FRAM_write_to_adr(heap->fram,heap->base+first+1,&heap->map[first+1],last-first);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+        last=first;
+    }
+
+    return FRAM_write_to_adr(heap->fram,heap->base+first,&heap->map[first],last-first+1);
+}
+
+static void FRAM_heap_build(FRAM_heap_t * const heap){
+
+    uint32_t unit;
+    uint32_t end;
+    uint8_t order;
+
+    memset(heap->head,0xff,sizeof(heap->head));
+    memset(heap->order,FRAM_HEAP_NO_ORDER,sizeof(heap->order));
+    heap->used=0;
+    heap->free=0;
+
+    unit=0;
+    while(unit<heap->units){
+
+        if(FRAM_heap_get(heap,unit)!=FRAM_HEAP_FREE){
+            unit++;
+            continue;
+        }
+
+        for(end=unit;end<heap->units&&FRAM_heap_get(heap,end)==FRAM_HEAP_FREE;end++);
+        heap->free+=end-unit;
+
+        //split the free run into the largest aligned blocks, they have no free buddy of their size
+        while(unit<end){
+            for(order=0;order+1u<FRAM_HEAP_CLASSES&&unit%(2u<<order)==0&&unit+(2u<<order)<=end;order++);
+            FRAM_heap_push(heap,unit,order);
+            unit+=1u<<order;
+        }
+    }
+}
+
+static void FRAM_heap_push(FRAM_heap_t * const heap, uint32_t unit, uint8_t order){
+
+    heap->order[unit]=order;
+    heap->prev[unit]=FRAM_HEAP_NIL;
+    heap->next[unit]=heap->head[order];
+
+    if(heap->head[order]!=FRAM_HEAP_NIL)
+        heap->prev[heap->head[order]]=unit;
+
+    heap->head[order]=unit;
+    heap->used|=1u<<order;
+}
+
+static void FRAM_heap_unlink(FRAM_heap_t * const heap, uint32_t unit){
+
+    uint8_t order=heap->order[unit];
+
+    if(heap->prev[unit]!=FRAM_HEAP_NIL)
+        heap->next[heap->prev[unit]]=heap->next[unit];
+    else
+        heap->head[order]=heap->next[unit];
+
+    if(heap->next[unit]!=FRAM_HEAP_NIL)
+        heap->prev[heap->next[unit]]=heap->prev[unit];
+
+    if(heap->head[order]==FRAM_HEAP_NIL)
+        heap->used&=~(1u<<order);
+
+    heap->order[unit]=FRAM_HEAP_NO_ORDER;
+}
+
+static void FRAM_heap_release(FRAM_heap_t * const heap, uint32_t unit, uint8_t order){
+
+    uint32_t buddy;
+
+    //merge with the buddy as long as it is free and of the same size
+    while(order+1u<FRAM_HEAP_CLASSES){
+        buddy=unit^(1u<<order);
+        if(buddy>=heap->units||heap->order[buddy]!=order)
+            break;
+
+        FRAM_heap_unlink(heap,buddy);
+        unit&=~(1u<<order);
+        order++;
+    }
+
+    FRAM_heap_push(heap,unit,order);
+}
+
+/* [] END OF FILE */
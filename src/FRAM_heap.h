@@ -0,0 +1,185 @@
+/**
+ * @file FRAM_heap.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Persistent allocator for the blocks of a region of a FRAM chip.
+ * The region starts with a map holding two bits per unit of FRAM_HEAP_UNIT bytes: free, first unit of a block or further unit of a block.
+ * The units behind the map are handed out as blocks of a power of two units, aligned to their size (buddy system).
+ *
+ * The map is mirrored in SRAM together with one free list per size class, so "FRAM_heap_alloc" and "FRAM_heap_free" only touch the chip
+ * with writes of the bytes of the map covering the block. "FRAM_heap_mount" reads the map with one read and rebuilds the free lists.
+ * The byte of the map holding the first unit of a block is written last by "FRAM_heap_alloc" and first by "FRAM_heap_free", so a write cut by a reset
+ * leaves further units without a first unit, which "FRAM_heap_mount" frees. A reset during "FRAM_heap_alloc" therefore leaves the whole block free
+ * or allocated without its address being returned, a reset during "FRAM_heap_free" leaves the whole block allocated or free, never a part of it.
+ *
+ * A heap is used by one task at a time, the functions do not lock the heap itself.
+ */
+
+#if !defined(FRAM_HEAP_H)
+#define FRAM_HEAP_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_HEAP_UNIT          64u                     //bytes of a unit, the smallest block
+#define FRAM_HEAP_UNITS         256u                    //highest number of units of a heap, a power of two
+#define FRAM_HEAP_CLASSES       9u                      //number of size classes, log2(FRAM_HEAP_UNITS)+1
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a heap
+*/
+typedef struct {
+    uint32_t    allocs;                                 //number of allocated blocks
+    uint32_t    frees;                                  //number of freed blocks
+    uint32_t    fails;                                  //number of allocations without a free block large enough
+    uint32_t    repaired;                               //number of blocks of an interrupted operation freed by "FRAM_heap_mount"
+} FRAM_heap_stats_t;
+
+/**
+A persistent heap
+
+Initialise it with "FRAM_heap_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the heap
+    uint32_t    base;                                   //address of the region, the map starts here
+    uint32_t    data;                                   //address of the first unit
+    uint16_t    units;                                  //number of units
+    uint16_t    free;                                   //number of free units
+    uint16_t    used;                                   //bit n is set if the free list of class n is not empty
+    uint16_t    head[FRAM_HEAP_CLASSES];                //first free block of each class
+    uint16_t    next[FRAM_HEAP_UNITS];                  //next free block of the same class, by the first unit
+    uint16_t    prev[FRAM_HEAP_UNITS];                  //previous free block of the same class, by the first unit
+    uint8_t     order[FRAM_HEAP_UNITS];                 //class of a free block, by its first unit
+    uint8_t     map[FRAM_HEAP_UNITS/4];                 //mirror of the map
+    FRAM_heap_stats_t stats;
+} FRAM_heap_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a heap
+
+Does not access the chip. Call "FRAM_heap_format" to start an empty heap or "FRAM_heap_mount" to use the heap found in the region.
+
+@param heap the heap to be initialised
+@param fram the chip holding the heap
+@param base address of the region
+@param size size of the region, the map and up to FRAM_HEAP_UNITS units are placed in it
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip or holds no unit
+        FRAM_NO_ERROR if the heap was initialised
+*/
+uint32_t    FRAM_heap_init(FRAM_heap_t * const heap, FRAM_t * const fram, uint32_t base, uint32_t size);
+
+/**
+Start an empty heap
+
+Costs one write of the map.
+
+@param heap the heap
+@return FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_heap_format(FRAM_heap_t * const heap);
+
+/**
+Use the heap found in the region
+
+Reads the map with one read and rebuilds the free lists. Blocks left by an interrupted operation are freed and the map is written back.
+
+@param heap the heap
+@return FRAM_NO_ERROR if the heap can be used
+        any other value is the output of "FRAM_read_from_adr" or "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_heap_mount(FRAM_heap_t * const heap);
+
+/**
+Allocate a block
+
+The size is rounded up to a power of two units. Costs one write of the map, two for a block of more than 4 units.
+
+@param heap the heap
+@param size bytes needed
+@param adr the address of the block is stored here
+@return FRAM_PARAMTER_ERROR if the size is 0 or the pointer is NULL
+        FRAM_MEMORY_ERROR if there is no free block large enough
+        FRAM_NO_ERROR if the block was allocated
+        any other value is the output of "FRAM_write_to_adr", nothing was allocated
+*/
+uint32_t    FRAM_heap_alloc(FRAM_heap_t * const heap, uint32_t size, uint32_t * const adr);
+
+/**
+Free a block
+
+Costs one write of the map. The block is merged with its free neighbours of the same size.
+
+@param heap the heap
+@param adr address of the block as returned by "FRAM_heap_alloc"
+@return FRAM_PARAMTER_ERROR if the address is not the address of an allocated block
+        FRAM_NO_ERROR if the block was freed
+        any other value is the output of "FRAM_write_to_adr", the block stays allocated
+*/
+uint32_t    FRAM_heap_free(FRAM_heap_t * const heap, uint32_t adr);
+
+/**
+Get the size of a block
+
+@param heap the heap
+@param adr address of the block as returned by "FRAM_heap_alloc"
+@return the number of bytes of the block, 0 if the address is not the address of an allocated block
+*/
+uint32_t    FRAM_heap_get_size(const FRAM_heap_t * const heap, uint32_t adr);
+
+/**
+Get the number of free bytes
+
+@param heap the heap
+@return the bytes of all free blocks, the largest block that can be allocated may be smaller
+*/
+uint32_t    FRAM_heap_get_free(const FRAM_heap_t * const heap);
+
+/**
+Get the statistics of a heap
+
+@param heap the heap
+@return the statistics collected since "FRAM_heap_init"
+*/
+const FRAM_heap_stats_t* FRAM_heap_get_stats(const FRAM_heap_t * const heap);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_HEAP_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,103 @@
+/**
+ * @file FRAM_iterator.hpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Iterator over the elements of a FRAM container, so standard algorithms like std::find or std::accumulate run on FRAM.
+ * The iterator only holds the container and an index. Dereferencing reads the element through the read window of the container,
+ * so all copies of an iterator share one buffer and a sequential pass costs one transfer per window.
+ * Elements are returned by value, writing through the iterator is not supported.
+ * Transfer errors can not be returned by operator*, they are collected by the container, see "status" of the containers.
+ */
+
+#if !defined(FRAM_ITERATOR_HPP)
+#define FRAM_ITERATOR_HPP
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <cstddef>
+#include <iterator>
+
+namespace fram {
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Random access iterator over a FRAM container
+
+@tparam Container container with "value_type" and "uint32_t get(std::size_t, value_type&)"
+*/
+template<class Container>
+class iterator {
+public:
+    using iterator_category=std::random_access_iterator_tag;
+    using value_type=typename Container::value_type;
+    using difference_type=std::ptrdiff_t;
+    using pointer=void;
+    using reference=value_type;                         //elements are copies of FRAM content
+
+    iterator()=default;
+    iterator(Container *container, difference_type i) : c_(container), i_(i) {}
+
+    value_type operator*() const {
+
+        value_type value{};
+
+        c_->get(static_cast<std::size_t>(i_),value);
+
+        return value;
+    }
+
+    value_type operator[](difference_type n) const {return *(*this+n);}
+
+    iterator& operator++(){i_++; return *this;}
+    iterator& operator--(){i_--; return *this;}
+    iterator operator++(int){iterator old=*this; i_++; return old;}
+    iterator operator--(int){iterator old=*this; i_--; return old;}
+    iterator& operator+=(difference_type n){i_+=n; return *this;}
+    iterator& operator-=(difference_type n){i_-=n; return *this;}
+
+    friend iterator operator+(iterator it, difference_type n){return it+=n;}
+    friend iterator operator+(difference_type n, iterator it){return it+=n;}
+    friend iterator operator-(iterator it, difference_type n){return it-=n;}
+    friend difference_type operator-(const iterator &a, const iterator &b){return a.i_-b.i_;}
+
+    friend bool operator==(const iterator &a, const iterator &b){return a.i_==b.i_;}
+    friend bool operator!=(const iterator &a, const iterator &b){return a.i_!=b.i_;}
+    friend bool operator<(const iterator &a, const iterator &b){return a.i_<b.i_;}
+    friend bool operator>(const iterator &a, const iterator &b){return a.i_>b.i_;}
+    friend bool operator<=(const iterator &a, const iterator &b){return a.i_<=b.i_;}
+    friend bool operator>=(const iterator &a, const iterator &b){return a.i_>=b.i_;}
+
+    /**
+    Index of the element the iterator points to
+    */
+    std::size_t index() const {return static_cast<std::size_t>(i_);}
+
+private:
+    Container       *c_=nullptr;
+    difference_type i_=0;
+};
+
+} /* namespace fram */
+
+#endif /* (FRAM_ITERATOR_HPP) */
+
+/* [] END OF FILE */
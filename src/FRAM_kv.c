@@ -0,0 +1,558 @@
+/**
+ * @file FRAM_kv.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_kv.h"
+#include "FRAM_chk.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_KV_MAGIC           0x32564b46u             //"FKV2"
+#define FRAM_KV_HEADER          32u                     //magic (4), slots (4), size (4), reserved (4), two copies of top
+#define FRAM_KV_TOP_OFFSET      16u                     //offset of the first copy of top in the header
+#define FRAM_KV_TOP_SIZE        8u                      //copy of top: top (4), CRC (2), reserved (2)
+#define FRAM_KV_SLOT_SIZE       8u                      //record (4), tag (2), reserved (2)
+#define FRAM_KV_RECORD_HEADER   8u                      //key length (1), reserved (1), value length (2), capacity (2), CRC (2)
+#define FRAM_KV_CRC_OFFSET      6u                      //offset of the CRC in the record, the CRC covers the bytes in front of it, the key and the value
+#define FRAM_KV_INLINE          32u                     //value bytes read together with the key
+#define FRAM_KV_TOMBSTONE       0xffffffffu             //record of a deleted slot, probing continues behind it
+#define FRAM_KV_CLEAR           64u                     //bytes written per transfer by "FRAM_kv_format"
+
+#if (FRAM_KV_CACHE&(FRAM_KV_CACHE-1u))!=0
+    #error "FRAM_KV_CACHE has to be a power of two"
+#endif
+
+#if FRAM_KV_KEY_MAX>255
+    #error "FRAM_KV_KEY_MAX has to fit into the key length of a record"
+#endif
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Result of a lookup
+*/
+typedef struct {
+    uint32_t    slot;                                   //slot of the key, or the slot a new key goes to, FRAM_INVALID_ADR if the index is full
+    uint32_t    record;                                 //offset of the record
+    uint16_t    count;                                  //length of the value
+    uint16_t    capacity;                               //capacity of the record
+    uint16_t    crc;                                    //CRC of the record
+    uint8_t     data[FRAM_KV_RECORD_HEADER+FRAM_KV_KEY_MAX+FRAM_KV_INLINE];  //record as read, the value starts behind the key
+} FRAM_kv_find_t;
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_kv_hash(const char * const key, uint8_t * const length);
+static uint32_t FRAM_kv_find(FRAM_kv_t * const kv, const char * const key, uint8_t length, uint32_t hash, uint16_t want, FRAM_kv_find_t * const found);
+static uint32_t FRAM_kv_match(FRAM_kv_t * const kv, uint32_t record, const char * const key, uint8_t length, uint16_t want, FRAM_kv_find_t * const found);
+static uint32_t FRAM_kv_write_value(FRAM_kv_t * const kv, const char * const key, const uint8_t * const buffer, uint16_t count, uint16_t capacity, uint8_t reserve);
+static uint32_t FRAM_kv_write_slot(FRAM_kv_t * const kv, uint32_t slot, uint32_t record, uint32_t hash);
+static uint32_t FRAM_kv_write_top(FRAM_kv_t * const kv, uint32_t top);
+static uint32_t FRAM_kv_copy(FRAM_kv_t * const kv, uint32_t from, uint32_t to, uint16_t count, uint16_t * const crc);
+static void     FRAM_kv_pack_top(uint8_t * const out, uint32_t top);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_kv_init(FRAM_kv_t * const kv, FRAM_t * const fram, uint32_t base, uint32_t size, uint32_t slots){
+
+    uint32_t i;
+
+    //check if parameters are valid
+    if(size==0||base>fram->adr_max||size-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    if(slots<FRAM_KV_PROBE||(slots&(slots-1))!=0||slots>(size-FRAM_KV_HEADER)/FRAM_KV_SLOT_SIZE)
+        return FRAM_PARAMTER_ERROR;
+
+    kv->fram=fram;
+    kv->base=base;
+    kv->size=size;
+    kv->slots=slots;
+    kv->top=FRAM_KV_HEADER+slots*FRAM_KV_SLOT_SIZE;
+    kv->copy=0;
+
+    for(i=0;i<FRAM_KV_CACHE;i++)
+        kv->cache[i].record=0;
+
+    kv->stats.gets=0;
+    kv->stats.cache_hits=0;
+    kv->stats.probes=0;
+    kv->stats.puts=0;
+    kv->stats.moved=0;
+    kv->stats.wasted=0;
+    kv->stats.corrupt=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_kv_format(FRAM_kv_t * const kv){
+
+    uint8_t data[FRAM_KV_CLEAR];
+    uint32_t end=FRAM_KV_HEADER+kv->slots*FRAM_KV_SLOT_SIZE;
+    uint32_t result;
+    uint32_t pos;
+    uint32_t i;
+
+    //an empty slot points to record 0
+    memset(data,0,sizeof(data));
+
+    for(pos=FRAM_KV_HEADER;pos<end;pos+=FRAM_KV_CLEAR){
+        result=FRAM_write_to_adr(kv->fram,kv->base+pos,data,end-pos<FRAM_KV_CLEAR?end-pos:FRAM_KV_CLEAR);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    //the header is written last, an interrupted format leaves no valid store
+    FRAM_store32(data,FRAM_KV_MAGIC);
+    FRAM_store32(data+4,kv->slots);
+    FRAM_store32(data+8,kv->size);
+    FRAM_store32(data+12,0);
+    FRAM_kv_pack_top(data+FRAM_KV_TOP_OFFSET,end);
+    FRAM_kv_pack_top(data+FRAM_KV_TOP_OFFSET+FRAM_KV_TOP_SIZE,end);
+
+    result=FRAM_write_to_adr(kv->fram,kv->base,data,FRAM_KV_HEADER);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    kv->top=end;
+    kv->copy=0;
+
+    for(i=0;i<FRAM_KV_CACHE;i++)
+        kv->cache[i].record=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_kv_mount(FRAM_kv_t * const kv){
+
+    uint8_t header[FRAM_KV_HEADER];
+    uint8_t check[FRAM_KV_TOP_SIZE];
+    uint32_t result;
+    uint32_t top=0;
+    uint32_t copy=0;
+    uint32_t i;
+
+    result=FRAM_read_from_adr(kv->fram,kv->base,header,FRAM_KV_HEADER);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(FRAM_load32(header)!=FRAM_KV_MAGIC||FRAM_load32(header+4)!=kv->slots||FRAM_load32(header+8)!=kv->size)
+        return FRAM_KV_NO_STORE;
+
+    //top only grows, the higher valid copy is the newer one, a copy torn by a reset fails its CRC
+    for(i=0;i<2;i++){
+        FRAM_kv_pack_top(check,FRAM_load32(header+FRAM_KV_TOP_OFFSET+i*FRAM_KV_TOP_SIZE));
+        if(memcmp(check,header+FRAM_KV_TOP_OFFSET+i*FRAM_KV_TOP_SIZE,FRAM_KV_TOP_SIZE)==0&&FRAM_load32(check)>=top){
+            top=FRAM_load32(check);
+            copy=i^1u;
+        }
+    }
+
+    if(top<FRAM_KV_HEADER+kv->slots*FRAM_KV_SLOT_SIZE||top>kv->size)
+        return FRAM_KV_NO_STORE;
+
+    kv->top=top;
+    kv->copy=copy;
+
+    for(i=0;i<FRAM_KV_CACHE;i++)
+        kv->cache[i].record=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_kv_get(FRAM_kv_t * const kv, const char * const key, uint8_t * const buffer, uint16_t size, uint16_t * const count){
+
+    FRAM_kv_find_t found;
+    uint32_t result;
+    uint32_t hash;
+    uint32_t value;
+    uint16_t inline_count;
+    uint16_t crc;
+    uint8_t length;
+
+    //check if parameters are valid
+    if(key==NULL||buffer==NULL||count==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    hash=FRAM_kv_hash(key,&length);
+    if(length==0||length>FRAM_KV_KEY_MAX)
+        return FRAM_PARAMTER_ERROR;
+
+    kv->stats.gets++;
+
+    //short values come with the key
+    result=FRAM_kv_find(kv,key,length,hash,size<FRAM_KV_INLINE?size:FRAM_KV_INLINE,&found);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    *count=found.count;
+    if(found.count>size)
+        return FRAM_PARAMTER_ERROR;
+
+    value=FRAM_KV_RECORD_HEADER+length;
+    inline_count=found.count<FRAM_KV_INLINE?found.count:FRAM_KV_INLINE;
+    memcpy(buffer,found.data+value,inline_count);
+
+    //the rest follows the part already read, so the read hits the address latch
+    if(found.count>inline_count){
+        result=FRAM_read_from_adr(kv->fram,kv->base+found.record+value+inline_count,buffer+inline_count,found.count-inline_count);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    //a record rewritten in place and torn by a reset fails its CRC
+    crc=FRAM_chk_crc(FRAM_CHK_CRC_INIT,found.data,FRAM_KV_CRC_OFFSET);
+    crc=FRAM_chk_crc(crc,(const uint8_t*)key,length);
+    crc=FRAM_chk_crc(crc,buffer,found.count);
+    if(crc!=found.crc){
+        kv->stats.corrupt++;
+        return FRAM_KV_CORRUPT;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_kv_put(FRAM_kv_t * const kv, const char * const key, const uint8_t * const buffer, uint16_t count){
+
+    //check if parameters are valid
+    if(buffer==NULL&&count!=0)
+        return FRAM_PARAMTER_ERROR;
+
+    return FRAM_kv_write_value(kv,key,buffer,count,count,0);
+}
+
+uint32_t FRAM_kv_reserve(FRAM_kv_t * const kv, const char * const key, uint16_t capacity){return FRAM_kv_write_value(kv,key,NULL,0,capacity,1);}
+
+uint32_t FRAM_kv_delete(FRAM_kv_t * const kv, const char * const key){
+
+    FRAM_kv_find_t found;
+    uint8_t tombstone[4];
+    uint32_t result;
+    uint32_t hash;
+    uint8_t length;
+
+    //check if parameters are valid
+    if(key==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    hash=FRAM_kv_hash(key,&length);
+    if(length==0||length>FRAM_KV_KEY_MAX)
+        return FRAM_PARAMTER_ERROR;
+
+    result=FRAM_kv_find(kv,key,length,hash,0,&found);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    //probing has to continue behind the slot, so it is not emptied
+    FRAM_store32(tombstone,FRAM_KV_TOMBSTONE);
+    result=FRAM_write_to_adr(kv->fram,kv->base+FRAM_KV_HEADER+found.slot*FRAM_KV_SLOT_SIZE,tombstone,sizeof(tombstone));
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    kv->cache[hash&(FRAM_KV_CACHE-1u)].record=0;
+    kv->stats.wasted+=FRAM_KV_RECORD_HEADER+length+found.capacity;
+
+    return FRAM_NO_ERROR;
+}
+
+const FRAM_kv_stats_t* FRAM_kv_get_stats(const FRAM_kv_t * const kv){return &kv->stats;}
+
+static uint32_t FRAM_kv_hash(const char * const key, uint8_t * const length){
+
+    //FNV-1a
+    uint32_t hash=2166136261u;
+    uint32_t i;
+
+    for(i=0;key[i]!=0&&i<=FRAM_KV_KEY_MAX;i++){
+        hash^=(uint8_t)key[i];
+        hash*=16777619u;
+    }
+
+    *length=i;
+
+    return hash;
+}
+
+static uint32_t FRAM_kv_find(FRAM_kv_t * const kv, const char * const key, uint8_t length, uint32_t hash, uint16_t want, FRAM_kv_find_t * const found){
+
+    FRAM_kv_cache_t * const cached=&kv->cache[hash&(FRAM_KV_CACHE-1u)];
+    uint8_t slots[FRAM_KV_PROBE*FRAM_KV_SLOT_SIZE];
+    uint32_t result;
+    uint32_t slot=hash&(kv->slots-1u);
+    uint32_t done;
+    uint32_t part;
+    uint32_t record;
+    uint32_t i;
+
+    //a cached key is found with a single read of its record
+    if(cached->record!=0&&cached->hash==hash){
+
+        result=FRAM_kv_match(kv,cached->record,key,length,want,found);
+        if(result!=FRAM_KV_NOT_FOUND){
+            if(result==FRAM_NO_ERROR){
+                found->slot=cached->slot;
+                kv->stats.cache_hits++;
+            }
+            return result;
+        }
+    }
+
+    found->slot=FRAM_INVALID_ADR;
+
+    //read a few slots at a time, a part ends at the end of the index
+    for(done=0;done<kv->slots;done+=part){
+
+        part=kv->slots-slot<FRAM_KV_PROBE?kv->slots-slot:FRAM_KV_PROBE;
+
+        result=FRAM_read_from_adr(kv->fram,kv->base+FRAM_KV_HEADER+slot*FRAM_KV_SLOT_SIZE,slots,part*FRAM_KV_SLOT_SIZE);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        kv->stats.probes++;
+
+        for(i=0;i<part;i++,slot=(slot+1)&(kv->slots-1u)){
+
+            record=FRAM_load32(slots+i*FRAM_KV_SLOT_SIZE);
+
+            //an empty slot ends the probe sequence, a new key takes the first free slot
+            if(record==0){
+                if(found->slot==FRAM_INVALID_ADR)
+                    found->slot=slot;
+                return FRAM_KV_NOT_FOUND;
+            }
+
+            if(record==FRAM_KV_TOMBSTONE){
+                if(found->slot==FRAM_INVALID_ADR)
+                    found->slot=slot;
+                continue;
+            }
+
+            //a slot torn by a reset may point anywhere, it matches no key
+            if(FRAM_load16(slots+i*FRAM_KV_SLOT_SIZE+4)!=(uint16_t)(hash>>16)
+               ||record<FRAM_KV_HEADER+kv->slots*FRAM_KV_SLOT_SIZE||record>=kv->size)
+                continue;
+
+            result=FRAM_kv_match(kv,record,key,length,want,found);
+            if(result==FRAM_NO_ERROR){
+                found->slot=slot;
+                cached->hash=hash;
+                cached->record=record;
+                cached->slot=slot;
+            }
+            if(result!=FRAM_KV_NOT_FOUND)
+                return result;
+        }
+    }
+
+    return FRAM_KV_NOT_FOUND;
+}
+
+static uint32_t FRAM_kv_match(FRAM_kv_t * const kv, uint32_t record, const char * const key, uint8_t length, uint16_t want, FRAM_kv_find_t * const found){
+
+    uint32_t result;
+    uint32_t count=FRAM_KV_RECORD_HEADER+length+want;
+
+    //the read may go past a short record, but not past the region
+    if(count>kv->size-record)
+        count=kv->size-record;
+
+    result=FRAM_read_from_adr(kv->fram,kv->base+record,found->data,count);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(found->data[0]!=length||memcmp(found->data+FRAM_KV_RECORD_HEADER,key,length)!=0)
+        return FRAM_KV_NOT_FOUND;
+
+    found->record=record;
+    found->count=FRAM_load16(found->data+2);
+    found->capacity=FRAM_load16(found->data+4);
+    found->crc=FRAM_load16(found->data+FRAM_KV_CRC_OFFSET);
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_kv_write_value(FRAM_kv_t * const kv, const char * const key, const uint8_t * const buffer, uint16_t count, uint16_t capacity, uint8_t reserve){
+
+    FRAM_kv_find_t found;
+    FRAM_part_t parts[3];
+    uint8_t header[FRAM_KV_RECORD_HEADER];
+    uint32_t result;
+    uint32_t hash;
+    uint32_t record;
+    uint32_t end;
+    uint16_t crc;
+    uint8_t length;
+    uint8_t exists;
+    uint8_t copy=0;
+
+    //check if parameters are valid
+    if(key==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    hash=FRAM_kv_hash(key,&length);
+    if(length==0||length>FRAM_KV_KEY_MAX)
+        return FRAM_PARAMTER_ERROR;
+
+    kv->stats.puts++;
+
+    result=FRAM_kv_find(kv,key,length,hash,0,&found);
+    if(result!=FRAM_NO_ERROR&&result!=FRAM_KV_NOT_FOUND)
+        return result;
+
+    exists=result==FRAM_NO_ERROR;
+
+    //a reserved key keeps its value, a bigger capacity moves the value to a new record
+    if(exists&&reserve){
+        if(found.capacity>=capacity)
+            return FRAM_NO_ERROR;
+        count=found.count;
+        copy=1;
+    }
+
+    header[0]=length;
+    header[1]=0;
+    FRAM_store16(header+2,count);
+
+    parts[0].buffer=header;
+    parts[0].count=FRAM_KV_RECORD_HEADER;
+    parts[1].buffer=(const uint8_t*)key;
+    parts[1].count=length;
+    parts[2].buffer=buffer;
+    parts[2].count=count;
+
+    //the value fits into its record, header, key and value are rewritten in one transfer
+    if(exists&&!copy&&count<=found.capacity){
+        FRAM_store16(header+4,found.capacity);
+        crc=FRAM_chk_crc(FRAM_CHK_CRC_INIT,header,FRAM_KV_CRC_OFFSET);
+        crc=FRAM_chk_crc(crc,(const uint8_t*)key,length);
+        FRAM_store16(header+FRAM_KV_CRC_OFFSET,FRAM_chk_crc(crc,buffer,count));
+        return FRAM_write_parts_to_adr(kv->fram,kv->base+found.record,parts,3);
+    }
+
+    if(found.slot==FRAM_INVALID_ADR)
+        return FRAM_MEMORY_ERROR;
+
+    //a new record goes to the top of the region
+    if(FRAM_KV_RECORD_HEADER+length+capacity>kv->size-kv->top)
+        return FRAM_MEMORY_ERROR;
+
+    record=kv->top;
+    end=record+FRAM_KV_RECORD_HEADER+length+capacity;
+    FRAM_store16(header+4,capacity);
+    crc=FRAM_chk_crc(FRAM_CHK_CRC_INIT,header,FRAM_KV_CRC_OFFSET);
+    crc=FRAM_chk_crc(crc,(const uint8_t*)key,length);
+
+    //the record is complete before the top and the slot point to it
+    if(copy){
+        result=FRAM_kv_copy(kv,found.record+FRAM_KV_RECORD_HEADER+length,record+FRAM_KV_RECORD_HEADER+length,count,&crc);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+        FRAM_store16(header+FRAM_KV_CRC_OFFSET,crc);
+        result=FRAM_write_parts_to_adr(kv->fram,kv->base+record,parts,2);
+    }
+    else{
+        FRAM_store16(header+FRAM_KV_CRC_OFFSET,FRAM_chk_crc(crc,buffer,count));
+        result=FRAM_write_parts_to_adr(kv->fram,kv->base+record,parts,count>0?3:2);
+    }
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    result=FRAM_kv_write_top(kv,end);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    result=FRAM_kv_write_slot(kv,found.slot,record,hash);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(exists){
+        kv->stats.moved++;
+        kv->stats.wasted+=FRAM_KV_RECORD_HEADER+length+found.capacity;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_kv_write_slot(FRAM_kv_t * const kv, uint32_t slot, uint32_t record, uint32_t hash){
+
+    FRAM_kv_cache_t * const cached=&kv->cache[hash&(FRAM_KV_CACHE-1u)];
+    uint8_t data[FRAM_KV_SLOT_SIZE];
+    uint32_t result;
+
+    FRAM_store32(data,record);
+    FRAM_store16(data+4,(uint16_t)(hash>>16));
+    FRAM_store16(data+6,0);
+
+    result=FRAM_write_to_adr(kv->fram,kv->base+FRAM_KV_HEADER+slot*FRAM_KV_SLOT_SIZE,data,FRAM_KV_SLOT_SIZE);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    cached->hash=hash;
+    cached->record=record;
+    cached->slot=slot;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_kv_write_top(FRAM_kv_t * const kv, uint32_t top){
+
+    uint8_t data[FRAM_KV_TOP_SIZE];
+    uint32_t result;
+
+    //the copies are written in turn, the other one keeps the previous top if a reset tears the write
+    FRAM_kv_pack_top(data,top);
+
+    result=FRAM_write_to_adr(kv->fram,kv->base+FRAM_KV_TOP_OFFSET+kv->copy*FRAM_KV_TOP_SIZE,data,FRAM_KV_TOP_SIZE);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    kv->top=top;
+    kv->copy^=1u;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_kv_copy(FRAM_kv_t * const kv, uint32_t from, uint32_t to, uint16_t count, uint16_t * const crc){
+
+    uint8_t scratch[FRAM_KV_INLINE];
+    uint32_t result;
+    uint32_t done;
+    uint32_t part;
+
+    for(done=0;done<count;done+=part){
+
+        part=count-done<FRAM_KV_INLINE?count-done:FRAM_KV_INLINE;
+
+        result=FRAM_read_from_adr(kv->fram,kv->base+from+done,scratch,part);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        result=FRAM_write_to_adr(kv->fram,kv->base+to+done,scratch,part);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        *crc=FRAM_chk_crc(*crc,scratch,part);
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static void FRAM_kv_pack_top(uint8_t * const out, uint32_t top){
+
+    FRAM_store32(out,top);
+    FRAM_store16(out+4,FRAM_chk_crc(FRAM_CHK_CRC_INIT,out,4));
+    FRAM_store16(out+6,0);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,218 @@
+/**
+ * @file FRAM_kv.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Key-value store in a region of a FRAM chip.
+ * The region holds a header, a hash index and the records. The index is a table of slots with open addressing (linear probing),
+ * every slot holds the position of a record and a part of the hash of its key. A record holds its key and value next to each other.
+ * A small cache in SRAM maps hashes of recently used keys to their records, so a get of a cached key is a single read of key and value.
+ * Otherwise the slots are read a few at a time until the key is found.
+ *
+ * Values can be reserved with a fixed capacity or grow: a value that does not fit into its record any more is moved to a new record.
+ *
+ * Every record holds a CRC over its key and value. A value fitting into its record is rewritten in place with one transfer,
+ * a reset during this transfer leaves the record failing its CRC and "FRAM_kv_get" returns FRAM_KV_CORRUPT instead of a mix of both values.
+ * A new or moved record is written completely before the top of the region and the slot are updated, so a reset keeps the previous value.
+ * The top is kept in two copies with a CRC, a torn copy falls back to the other one. A reset tearing the record position of the slot
+ * while a value is moved loses the key, its get returns FRAM_KV_NOT_FOUND then.
+ *
+ * Space of moved and deleted records is not reclaimed, there is no compaction: the records only grow towards the end of the region,
+ * until a put returns FRAM_MEMORY_ERROR. "wasted" of the statistics counts the bytes lost this way since "FRAM_kv_init".
+ * Reserve values that change in size, or start a new store with "FRAM_kv_format" and put the keys again to get the space back.
+ *
+ * A store is used by one task at a time, the functions do not lock the store itself.
+ */
+
+#if !defined(FRAM_KV_H)
+#define FRAM_KV_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_KV_KEY_MAX         31u                     //highest length of a key without the terminating 0
+#define FRAM_KV_CACHE           32u                     //number of entries of the SRAM cache, has to be a power of two
+#define FRAM_KV_PROBE           4u                      //number of slots read at once while probing
+
+#define FRAM_KV_NOT_FOUND       0x8000u                 //indicates that the key is not in the store
+#define FRAM_KV_NO_STORE        0x10000u                //indicates that the region does not hold a store of this geometry
+#define FRAM_KV_CORRUPT         0x8000000u              //indicates a record failing its CRC
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a store
+*/
+typedef struct {
+    uint32_t    gets;                                   //number of gets
+    uint32_t    cache_hits;                             //number of gets and puts served by the cache
+    uint32_t    probes;                                 //number of slot reads of gets and puts missing the cache
+    uint32_t    puts;                                   //number of puts
+    uint32_t    moved;                                  //number of values moved to a bigger record
+    uint32_t    wasted;                                 //number of bytes of moved and deleted records
+    uint32_t    corrupt;                                //number of records failing their CRC
+} FRAM_kv_stats_t;
+
+/**
+Entry of the SRAM cache
+*/
+typedef struct {
+    uint32_t    hash;                                   //hash of the key
+    uint32_t    record;                                 //offset of the record from base, 0 if the entry is unused
+    uint32_t    slot;                                   //slot pointing to the record
+} FRAM_kv_cache_t;
+
+/**
+A key-value store
+
+Initialise it with "FRAM_kv_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the store
+    uint32_t    base;                                   //address of the region
+    uint32_t    size;                                   //size of the region
+    uint32_t    slots;                                  //number of slots of the index
+    uint32_t    top;                                    //offset of the next record from base
+    uint8_t     copy;                                   //copy of the top written next
+    FRAM_kv_cache_t cache[FRAM_KV_CACHE];
+    FRAM_kv_stats_t stats;
+} FRAM_kv_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a store
+
+Does not access the chip. Call "FRAM_kv_format" to start an empty store or "FRAM_kv_mount" to use the store found in the region.
+
+@param kv the store to be initialised
+@param fram the chip holding the store
+@param base address of the region
+@param size size of the region
+@param slots number of slots of the index, a power of two and more than the number of keys, e.g. 1024 for 500 keys
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip, the number of slots is invalid or the index does not fit into the region
+        FRAM_NO_ERROR if the store was initialised
+*/
+uint32_t    FRAM_kv_init(FRAM_kv_t * const kv, FRAM_t * const fram, uint32_t base, uint32_t size, uint32_t slots);
+
+/**
+Start an empty store
+
+Clears the index and writes the header.
+
+@param kv the store
+@return FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_kv_format(FRAM_kv_t * const kv);
+
+/**
+Use the store found in the region
+
+@param kv the store
+@return FRAM_KV_NO_STORE if the header is missing or was written for another number of slots or region size
+        FRAM_NO_ERROR if the store can be used
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_kv_mount(FRAM_kv_t * const kv);
+
+/**
+Read a value
+
+@param kv the store
+@param key the key, a string of up to FRAM_KV_KEY_MAX characters
+@param buffer pointer to the memory the value is stored to
+@param size size of the buffer
+@param count the length of the value is stored here, also if the buffer is too small
+@return FRAM_PARAMTER_ERROR if either a pointer is NULL, the key is invalid or the value does not fit into the buffer
+        FRAM_KV_NOT_FOUND if the key is not in the store
+        FRAM_KV_CORRUPT if the record fails its CRC, e.g. after a reset during a put rewriting it, the buffer holds what was read
+        FRAM_NO_ERROR if the value was read
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_kv_get(FRAM_kv_t * const kv, const char * const key, uint8_t * const buffer, uint16_t size, uint16_t * const count);
+
+/**
+Write a value
+
+A new key gets a record of exactly the length of the value unless it was reserved with "FRAM_kv_reserve".
+A value longer than the capacity of its record is moved to a new record.
+
+@param kv the store
+@param key the key, a string of up to FRAM_KV_KEY_MAX characters
+@param buffer pointer to the value
+@param count length of the value, may be 0
+@return FRAM_PARAMTER_ERROR if either a pointer is NULL or the key is invalid
+        FRAM_MEMORY_ERROR if the index or the region is full
+        FRAM_NO_ERROR if the value was written
+        any other value is the output of "FRAM_read_from_adr" or "FRAM_write_parts_to_adr"
+*/
+uint32_t    FRAM_kv_put(FRAM_kv_t * const kv, const char * const key, const uint8_t * const buffer, uint16_t count);
+
+/**
+Reserve a record for a value of fixed size
+
+Creates the key with an empty value and a record of the given capacity. Does nothing if the key exists with at least this capacity,
+an existing key with a smaller capacity is moved to a new record of this capacity and keeps its value.
+
+@param kv the store
+@param key the key, a string of up to FRAM_KV_KEY_MAX characters
+@param capacity the capacity of the record
+@return see "FRAM_kv_put", the output of "FRAM_write_to_adr" if the value could not be moved
+*/
+uint32_t    FRAM_kv_reserve(FRAM_kv_t * const kv, const char * const key, uint16_t capacity);
+
+/**
+Remove a key
+
+@param kv the store
+@param key the key
+@return FRAM_PARAMTER_ERROR if the key is invalid
+        FRAM_KV_NOT_FOUND if the key is not in the store
+        FRAM_NO_ERROR if the key was removed
+        any other value is the output of "FRAM_read_from_adr" or "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_kv_delete(FRAM_kv_t * const kv, const char * const key);
+
+/**
+Get the statistics of a store
+
+@param kv the store
+@return the statistics collected since "FRAM_kv_init"
+*/
+const FRAM_kv_stats_t* FRAM_kv_get_stats(const FRAM_kv_t * const kv);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_KV_H) */
+
+/* [] END OF FILE */
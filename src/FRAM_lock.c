@@ -0,0 +1,223 @@
+/**
+ * @file FRAM_lock.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdlib.h>
+#include "FRAM_lock.h"
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_lock_now(const FRAM_lock_t * const lock);
+static uint8_t  FRAM_lock_higher_waiting(const FRAM_lock_t * const lock, FRAM_prio_t prio);
+static uint8_t  FRAM_lock_take(FRAM_lock_t * const lock, FRAM_prio_t prio, uint32_t ticket, uint8_t parked);
+static void     FRAM_lock_free(FRAM_lock_t * const lock, uint8_t park);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+void FRAM_lock_init(FRAM_lock_t * const lock, const FRAM_lock_hooks_t * const hooks){
+
+    uint8_t i;
+
+    lock->hooks=hooks;
+    lock->held=0;
+    lock->sleepers=0;
+    lock->prio=FRAM_PRIO_NORMAL;
+    lock->taken_at=0;
+    lock->held_for=0;
+
+    for(i=0;i<FRAM_PRIO_COUNT;i++){
+        lock->next[i]=0;
+        lock->serving[i]=0;
+        lock->parked[i]=0;
+    }
+
+    FRAM_lock_clear_stats(lock);
+}
+
+void FRAM_lock_acquire(FRAM_lock_t * const lock, FRAM_prio_t prio){
+
+    uint32_t state;
+    uint32_t ticket;
+    uint32_t start;
+    uint32_t wait;
+    uint8_t contended;
+
+    if(lock==NULL)
+        return;
+
+    start=FRAM_lock_now(lock);
+
+    //draw a ticket, the tickets of a class are served in the order they were drawn
+    state=lock->hooks->enter();
+    ticket=lock->next[prio]++;
+    lock->hooks->exit(state);
+
+    contended=FRAM_lock_take(lock,prio,ticket,0);
+
+    //only the holder touches the statistics
+    lock->prio=prio;
+    lock->taken_at=FRAM_lock_now(lock);
+    lock->held_for=0;
+    wait=lock->taken_at-start;
+
+    lock->stats.contended+=contended;
+    lock->stats.acquisitions[prio]++;
+    lock->stats.wait_total[prio]+=wait;
+    if(wait>lock->stats.wait_max[prio])
+        lock->stats.wait_max[prio]=wait;
+}
+
+uint8_t FRAM_lock_yield(FRAM_lock_t * const lock){
+
+    FRAM_prio_t prio;
+    uint32_t held_for;
+
+    if(lock==NULL||!FRAM_lock_higher_waiting(lock,lock->prio))
+        return 0;
+
+    prio=lock->prio;
+    held_for=lock->held_for+FRAM_lock_now(lock)-lock->taken_at;
+    lock->stats.yields++;
+
+    //park at the head of our class instead of drawing a new ticket, the higher classes are served meanwhile
+    FRAM_lock_free(lock,1);
+    FRAM_lock_take(lock,prio,0,1);
+
+    //the higher classes overwrote the holder's members
+    lock->prio=prio;
+    lock->held_for=held_for;
+    lock->taken_at=FRAM_lock_now(lock);
+
+    return 1;
+}
+
+void FRAM_lock_release(FRAM_lock_t * const lock){
+
+    uint32_t hold;
+
+    if(lock==NULL)
+        return;
+
+    hold=lock->held_for+FRAM_lock_now(lock)-lock->taken_at;
+    lock->stats.hold_total+=hold;
+    if(hold>lock->stats.hold_max)
+        lock->stats.hold_max=hold;
+
+    FRAM_lock_free(lock,0);
+}
+
+const FRAM_lock_stats_t* FRAM_lock_get_stats(const FRAM_lock_t * const lock){return &lock->stats;}
+
+void FRAM_lock_clear_stats(FRAM_lock_t * const lock){
+
+    uint8_t i;
+
+    for(i=0;i<FRAM_PRIO_COUNT;i++){
+        lock->stats.acquisitions[i]=0;
+        lock->stats.wait_max[i]=0;
+        lock->stats.wait_total[i]=0;
+    }
+
+    lock->stats.contended=0;
+    lock->stats.yields=0;
+    lock->stats.hold_max=0;
+    lock->stats.hold_total=0;
+}
+
+static uint32_t FRAM_lock_now(const FRAM_lock_t * const lock){return lock->hooks->now!=NULL?lock->hooks->now():0;}
+
+static uint8_t FRAM_lock_higher_waiting(const FRAM_lock_t * const lock, FRAM_prio_t prio){
+
+    uint8_t i;
+
+    //a class has waiting tasks while not all of its tickets were served or its holder yielded
+    for(i=0;i<prio;i++)
+        if(lock->next[i]!=lock->serving[i]||lock->parked[i])
+            return 1;
+
+    return 0;
+}
+
+static uint8_t FRAM_lock_take(FRAM_lock_t * const lock, FRAM_prio_t prio, uint32_t ticket, uint8_t parked){
+
+    uint32_t state;
+    uint8_t contended=0;
+    uint8_t sleep;
+
+    for(;;){
+        state=lock->hooks->enter();
+
+        //take the lock if it is free, no higher class is waiting and it is our turn within the class, a parked holder comes first
+        if(!lock->held&&!FRAM_lock_higher_waiting(lock,prio)&&(parked||(!lock->parked[prio]&&lock->serving[prio]==ticket))){
+            lock->held=1;
+
+            if(parked)
+                lock->parked[prio]=0;
+            else
+                lock->serving[prio]++;
+
+            lock->hooks->exit(state);
+            return contended;
+        }
+
+        //register inside the critical section, so the next free finds us. Without a free slot we poll.
+        sleep=lock->hooks->self!=NULL&&lock->sleepers<FRAM_LOCK_SLEEPERS;
+        if(sleep){
+            lock->sleeping[lock->sleepers].task=lock->hooks->self();
+            lock->sleeping[lock->sleepers].prio=prio;
+            lock->sleeping[lock->sleepers].ticket=ticket;
+            lock->sleeping[lock->sleepers].parked=parked;
+            lock->sleepers++;
+        }
+
+        lock->hooks->exit(state);
+
+        contended=1;
+        if(sleep)
+            lock->hooks->sleep();
+        else
+            lock->hooks->wait();
+    }
+}
+
+static void FRAM_lock_free(FRAM_lock_t * const lock, uint8_t park){
+
+    uint32_t state;
+    void *task=NULL;
+    uint8_t prio;
+    uint8_t i;
+
+    state=lock->hooks->enter();
+
+    if(park)
+        lock->parked[lock->prio]=1;
+    lock->held=0;
+
+    //only the task taking the lock next is woken: the parked holder or the next ticket of the highest waiting class.
+    //If it is not blocked, it is running and takes the lock itself.
+    for(prio=0;prio<FRAM_PRIO_COUNT;prio++)
+        if(lock->next[prio]!=lock->serving[prio]||lock->parked[prio])
+            break;
+
+    for(i=0;i<lock->sleepers&&prio<FRAM_PRIO_COUNT;i++){
+        if(lock->sleeping[i].prio==prio&&(lock->parked[prio]?lock->sleeping[i].parked:!lock->sleeping[i].parked&&lock->sleeping[i].ticket==lock->serving[prio])){
+            task=lock->sleeping[i].task;
+            lock->sleeping[i]=lock->sleeping[--lock->sleepers];
+            break;
+        }
+    }
+
+    lock->hooks->exit(state);
+
+    if(task!=NULL)
+        lock->hooks->wake(task);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,183 @@
+/**
+ * @file FRAM_lock.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Lock serialising the tasks using an I2C bus of the FRAM driver.
+ * The lock is a ticket lock with priority classes: within a class, tasks get the bus in the order they asked for it.
+ * A waiting task of a higher class is always served before the waiting tasks of lower classes.
+ * Long transfers of lower classes are split into chunks by the driver and hand the bus to waiting higher classes between the chunks,
+ * which bounds the wait of the urgent class to about one chunk. The yielding task keeps its place at the head of its own class,
+ * so it gets the bus back before the tasks of its class that asked for it later.
+ * It needs a critical section from the operating system and a way to wait, both are passed in as hooks.
+ * Waiting tasks either block until the lock wakes them ("self", "sleep" and "wake" hooks), or poll the lock and let other tasks run in between ("wait" hook).
+ * A blocked task is only woken when the lock is freed and it is the one to take it next.
+ * With FreeRTOS, e.g. taskENTER_CRITICAL/taskEXIT_CRITICAL (or CyEnterCriticalSection/CyExitCriticalSection),
+ * xTaskGetCurrentTaskHandle, ulTaskNotifyTake(pdTRUE,portMAX_DELAY) and xTaskNotifyGive, or taskYIELD to poll.
+ * On a host, pthread_mutex_lock/pthread_mutex_unlock of a global mutex, a semaphore per thread with sem_wait/sem_post (or sched_yield) do the same.
+ */
+
+#if !defined(FRAM_LOCK_H)
+#define FRAM_LOCK_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#if !defined(FRAM_LOCK_SLEEPERS)
+#define FRAM_LOCK_SLEEPERS      8u                      //number of tasks that can block on a lock at the same time, further tasks poll
+#endif
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Priority classes, FRAM_PRIO_URGENT is served first
+*/
+typedef enum {FRAM_PRIO_URGENT, FRAM_PRIO_NORMAL, FRAM_PRIO_BULK, FRAM_PRIO_COUNT} FRAM_prio_t;
+
+/**
+Operating system hooks of a lock
+*/
+typedef struct {
+    uint32_t    (*enter)(void);                         //enters a critical section and returns the state to be restored by exit
+    void        (*exit)(uint32_t state);                //leaves the critical section
+    void        (*wait)(void);                          //lets other tasks run while polling the lock
+    uint32_t    (*now)(void);                           //time base of the statistics, e.g. the tick count. NULL if no times shall be collected.
+    void*       (*self)(void);                          //returns the calling task. NULL to always poll with "wait".
+    void        (*sleep)(void);                         //blocks the calling task until "wake" is called for it, a wake before the sleep must not be lost
+    void        (*wake)(void *task);                    //wakes a task blocked in "sleep"
+} FRAM_lock_hooks_t;
+
+/**
+Statistics of a lock
+
+The times are in units of the "now" hook.
+*/
+typedef struct {
+    uint32_t    acquisitions[FRAM_PRIO_COUNT];          //number of times the lock was taken, per class. Taking it back after a yield is not counted.
+    uint32_t    wait_max[FRAM_PRIO_COUNT];              //longest time a task waited for the lock, per class
+    uint32_t    wait_total[FRAM_PRIO_COUNT];            //sum of the times tasks waited for the lock, per class
+    uint32_t    contended;                              //number of times a task had to wait for the lock
+    uint32_t    yields;                                 //number of times a chunked transfer handed the lock to a higher class
+    uint32_t    hold_max;                               //longest time the lock was held, without the time it was handed over by yields
+    uint32_t    hold_total;                             //sum of the times the lock was held, without the time it was handed over by yields
+} FRAM_lock_stats_t;
+
+/**
+A lock
+
+Initialise it with "FRAM_lock_init", the members are private to the driver.
+*/
+typedef struct {
+    const FRAM_lock_hooks_t *hooks;
+    volatile uint32_t next[FRAM_PRIO_COUNT];            //next ticket to be handed out, per class
+    volatile uint32_t serving[FRAM_PRIO_COUNT];         //next ticket allowed to take the lock, per class
+    volatile uint8_t  parked[FRAM_PRIO_COUNT];          //set while the holder of a class yielded the lock, it is served first within its class
+    volatile uint8_t  held;                             //set while a task holds the lock
+    struct {
+        void        *task;                              //the blocked task, from the "self" hook
+        FRAM_prio_t prio;                               //its class
+        uint32_t    ticket;                             //its ticket
+        uint8_t     parked;                             //set if it yielded the lock
+    } sleeping[FRAM_LOCK_SLEEPERS];                     //tasks blocked in the "sleep" hook
+    uint8_t     sleepers;                               //number of entries in sleeping
+    FRAM_prio_t prio;                                   //class of the current holder
+    uint32_t    taken_at;                               //time the lock was taken by its current holder, or taken back after a yield
+    uint32_t    held_for;                               //time the current holder held the lock before its last yield
+    FRAM_lock_stats_t stats;
+} FRAM_lock_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a lock
+
+@param lock the lock to be initialised
+@param hooks the operating system hooks
+@return void
+*/
+void        FRAM_lock_init(FRAM_lock_t * const lock, const FRAM_lock_hooks_t * const hooks);
+
+/**
+Take a lock
+
+Waits until all tasks of the same class that asked for the lock earlier and all waiting tasks of higher classes have released it.
+Does nothing if lock is NULL. The lock is not recursive.
+
+@param lock the lock
+@param prio the class of the calling task
+@return void
+*/
+void        FRAM_lock_acquire(FRAM_lock_t * const lock, FRAM_prio_t prio);
+
+/**
+Let waiting higher classes take a lock
+
+Called by the holder between two chunks of a long transfer. If a task of a higher class than the holder's is waiting,
+the lock is handed to it and taken back once no higher class is waiting anymore, otherwise the function returns right away.
+The holder keeps its place: it is served before all tasks of its own class. Handing over the lock does not count as a new
+acquisition and its time is neither counted as waiting nor as holding. Does nothing if lock is NULL.
+
+@param lock the lock, held by the calling task
+@return 1 if the lock was handed over in between, i.e. the state of the bus may have changed, 0 otherwise
+*/
+uint8_t     FRAM_lock_yield(FRAM_lock_t * const lock);
+
+/**
+Release a lock
+
+Hands the lock to the waiting task of the highest class that asked for it first. Does nothing if lock is NULL.
+
+@param lock the lock
+@return void
+*/
+void        FRAM_lock_release(FRAM_lock_t * const lock);
+
+/**
+Get the statistics of a lock
+
+@param lock the lock
+@return the statistics collected since "FRAM_lock_init" or the last "FRAM_lock_clear_stats"
+*/
+const FRAM_lock_stats_t* FRAM_lock_get_stats(const FRAM_lock_t * const lock);
+
+/**
+Clear the statistics of a lock
+
+@param lock the lock
+@return void
+*/
+void        FRAM_lock_clear_stats(FRAM_lock_t * const lock);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_LOCK_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,512 @@
+/**
+ * @file FRAM_log.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_log.h"
+#include "FRAM_chk.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_LOG_CRC_OFFSET     6u                      //offset of the CRC in the header, the CRC covers the header bytes in front of it
+#define FRAM_LOG_SCRATCH        32u                     //bytes of the stack buffer the payload is checked with
+#define FRAM_LOG_CLEAR          64u                     //bytes written per transfer by "FRAM_log_format"
+
+#if FRAM_LOG_SECTOR_SIZE<=FRAM_LOG_HEADER_SIZE || FRAM_LOG_RECORD_MAX>0xffffu
+    #error "FRAM_LOG_SECTOR_SIZE has to hold a header and the payload length has to fit into 16 bit"
+#endif
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static void     FRAM_log_pack(uint8_t * const header, uint32_t seq, const uint8_t * const buffer, uint16_t count);
+static uint32_t FRAM_log_header(FRAM_log_t * const log, uint32_t pos, uint32_t * const seq, uint16_t * const count, uint16_t * const crc);
+static uint32_t FRAM_log_check(FRAM_log_t * const log, uint32_t pos, uint32_t * const seq, uint16_t * const count);
+static uint32_t FRAM_log_scan(FRAM_log_t * const log);
+static uint32_t FRAM_log_follow(FRAM_log_t * const log, uint32_t pos, uint32_t seq);
+static uint32_t FRAM_log_next_sector(const FRAM_log_t * const log, uint32_t pos);
+static uint32_t FRAM_log_place(const FRAM_log_t * const log, uint32_t need);
+static void     FRAM_log_advance(FRAM_log_t * const log, uint32_t pos, uint32_t end, uint32_t records);
+static uint32_t FRAM_log_seq_add(uint32_t seq, uint32_t n);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_log_init(FRAM_log_t * const log, FRAM_t * const fram, uint32_t base, uint32_t size){
+
+    //check if parameters are valid
+    if(size<2*FRAM_LOG_SECTOR_SIZE||size%FRAM_LOG_SECTOR_SIZE!=0||base>fram->adr_max||size-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    log->fram=fram;
+    log->base=base;
+    log->sectors=size/FRAM_LOG_SECTOR_SIZE;
+    log->head=0;
+    log->seq=1;
+    log->first=0;
+    log->empty=1;
+
+    log->stats.appended=0;
+    log->stats.writes=0;
+    log->stats.dropped=0;
+    log->stats.corrupt=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_log_format(FRAM_log_t * const log){
+
+    uint8_t zero[FRAM_LOG_CLEAR];
+    uint32_t size=log->sectors*FRAM_LOG_SECTOR_SIZE;
+    uint32_t result;
+    uint32_t pos;
+
+    //records of an older log may be left anywhere in a sector and could continue the new sequence, so the whole region is cleared
+    memset(zero,0,sizeof(zero));
+
+    for(pos=0;pos<size;pos+=FRAM_LOG_CLEAR){
+        result=FRAM_write_to_adr(log->fram,log->base+pos,zero,size-pos<FRAM_LOG_CLEAR?size-pos:FRAM_LOG_CLEAR);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    log->head=0;
+    log->seq=1;
+    log->first=0;
+    log->empty=1;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_log_recover(FRAM_log_t * const log){
+
+    uint32_t result;
+    uint32_t lo=0;
+    uint32_t hi=log->sectors-1;
+    uint32_t mid;
+    uint32_t i;
+    uint32_t first_seq;
+    uint32_t best_seq;
+    uint32_t seq;
+    uint16_t count;
+
+    //sector 0 is the reference of the search, without it the log is scanned
+    result=FRAM_log_check(log,0,&first_seq,&count);
+    if(result==FRAM_LOG_CORRUPT||result==FRAM_LOG_END)
+        return FRAM_log_scan(log);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    best_seq=first_seq;
+
+    //sectors written after sector 0 in this lap start with higher sequence numbers, all following sectors are older or empty.
+    //Search the last sector of this lap, a corrupted sector is replaced by the next readable one.
+    while(lo<hi){
+
+        mid=lo+(hi-lo+1)/2;
+
+        for(i=mid;i<=hi;i++){
+            result=FRAM_log_check(log,i*FRAM_LOG_SECTOR_SIZE,&seq,&count);
+            if(result!=FRAM_LOG_CORRUPT)
+                break;
+            log->stats.corrupt++;
+        }
+
+        if(i<=hi&&result!=FRAM_NO_ERROR&&result!=FRAM_LOG_END)
+            return result;
+
+        if(i<=hi&&result==FRAM_NO_ERROR&&FRAM_LOG_BEFORE(best_seq,seq)){
+            lo=i;
+            best_seq=seq;
+        }
+        else
+            hi=mid-1;
+    }
+
+    result=FRAM_log_follow(log,lo*FRAM_LOG_SECTOR_SIZE,best_seq);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    //the oldest records are in the next readable sector, unless it was never written
+    log->first=0;
+
+    for(i=1;i<log->sectors;i++){
+
+        result=FRAM_log_check(log,(lo+i)%log->sectors*FRAM_LOG_SECTOR_SIZE,&seq,&count);
+
+        if(result==FRAM_NO_ERROR){
+            if(FRAM_LOG_BEFORE(seq,first_seq))
+                log->first=(lo+i)%log->sectors;
+            break;
+        }
+        if(result==FRAM_LOG_END)
+            break;
+        if(result!=FRAM_LOG_CORRUPT)
+            return result;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_log_append(FRAM_log_t * const log, const uint8_t * const buffer, uint16_t count){
+
+    FRAM_part_t record;
+
+    record.buffer=buffer;
+    record.count=count;
+
+    return FRAM_log_append_batch(log,&record,1);
+}
+
+uint32_t FRAM_log_append_batch(FRAM_log_t * const log, const FRAM_part_t * const records, uint8_t count){
+
+    uint8_t header[FRAM_LOG_BATCH_MAX][FRAM_LOG_HEADER_SIZE];
+    FRAM_part_t parts[2*FRAM_LOG_BATCH_MAX];
+    uint32_t result;
+    uint32_t pos;
+    uint32_t end;
+    uint8_t done;
+    uint8_t n;
+
+    //check if parameters are valid, nothing is written if one record is invalid
+    if(records==NULL||count==0)
+        return FRAM_PARAMTER_ERROR;
+
+    for(done=0;done<count;done++)
+        if(records[done].buffer==NULL||records[done].count==0||records[done].count>FRAM_LOG_RECORD_MAX)
+            return FRAM_PARAMTER_ERROR;
+
+    //records going to the same sector share one transfer, so a transfer enters at most one new sector
+    for(done=0;done<count;done+=n){
+
+        pos=FRAM_log_place(log,FRAM_LOG_HEADER_SIZE+records[done].count);
+        end=pos;
+
+        for(n=0;done+n<count&&n<FRAM_LOG_BATCH_MAX;n++){
+
+            const FRAM_part_t * const record=&records[done+n];
+
+            //the sector is full or the record does not fit into its rest
+            if(n>0&&(end%FRAM_LOG_SECTOR_SIZE==0||end%FRAM_LOG_SECTOR_SIZE+FRAM_LOG_HEADER_SIZE+record->count>FRAM_LOG_SECTOR_SIZE))
+                break;
+
+            FRAM_log_pack(header[n],FRAM_log_seq_add(log->seq,n),record->buffer,(uint16_t)record->count);
+            parts[2*n].buffer=header[n];
+            parts[2*n].count=FRAM_LOG_HEADER_SIZE;
+            parts[2*n+1]=*record;
+
+            end+=FRAM_LOG_HEADER_SIZE+record->count;
+        }
+
+        result=FRAM_write_parts_to_adr(log->fram,log->base+pos,parts,2*n);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        FRAM_log_advance(log,pos,end,n);
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_log_get_seq(const FRAM_log_t * const log){return log->seq;}
+
+uint32_t FRAM_log_first(FRAM_log_t * const log, FRAM_log_cursor_t * const cursor){
+
+    uint32_t result;
+    uint32_t sector=log->first;
+    uint32_t seq;
+    uint32_t i;
+    uint16_t length;
+
+    if(log->empty)
+        return FRAM_LOG_END;
+
+    //the oldest sector starts with a record unless it was corrupted, then the next valid sector is taken
+    for(i=0;i<log->sectors;i++,sector=(sector+1)%log->sectors){
+
+        result=FRAM_log_check(log,sector*FRAM_LOG_SECTOR_SIZE,&seq,&length);
+
+        if(result==FRAM_NO_ERROR&&FRAM_LOG_BEFORE(seq,log->seq)){
+            cursor->pos=sector*FRAM_LOG_SECTOR_SIZE;
+            cursor->seq=seq;
+            return FRAM_NO_ERROR;
+        }
+
+        if(result!=FRAM_NO_ERROR&&result!=FRAM_LOG_CORRUPT&&result!=FRAM_LOG_END)
+            return result;
+    }
+
+    return FRAM_LOG_END;
+}
+
+uint32_t FRAM_log_read(FRAM_log_t * const log, FRAM_log_cursor_t * const cursor, uint8_t * const buffer, uint16_t size, uint16_t * const count, uint32_t * const seq){
+
+    uint32_t result;
+    uint32_t pos=cursor->pos;
+    uint32_t found;
+    uint32_t i;
+    uint16_t length;
+    uint16_t crc;
+    uint8_t header[FRAM_LOG_HEADER_SIZE];
+
+    //check if parameters are valid
+    if(buffer==NULL||count==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    if(!FRAM_LOG_BEFORE(cursor->seq,log->seq))
+        return FRAM_LOG_END;
+
+    result=FRAM_log_header(log,pos,&found,&length,&crc);
+    if(result!=FRAM_NO_ERROR&&result!=FRAM_LOG_END)
+        return result;
+
+    //the record did not fit into the rest of the sector or its header is lost, continue at the next sector starting with a newer record
+    if(result==FRAM_LOG_END||found!=cursor->seq){
+
+        for(i=0;i<log->sectors;i++){
+
+            pos=FRAM_log_next_sector(log,pos);
+
+            result=FRAM_log_check(log,pos,&found,&length);
+            if(result==FRAM_NO_ERROR&&!FRAM_LOG_BEFORE(found,cursor->seq)&&FRAM_LOG_BEFORE(found,log->seq))
+                break;
+            if(result!=FRAM_NO_ERROR&&result!=FRAM_LOG_CORRUPT&&result!=FRAM_LOG_END)
+                return result;
+        }
+
+        if(i==log->sectors)
+            return FRAM_LOG_END;
+
+        result=FRAM_log_header(log,pos,&found,&length,&crc);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        cursor->pos=pos;
+        cursor->seq=found;
+    }
+
+    if(length>size)
+        return FRAM_PARAMTER_ERROR;
+
+    //the payload follows the header, so the read hits the address latch
+    result=FRAM_read_from_adr(log->fram,log->base+pos+FRAM_LOG_HEADER_SIZE,buffer,length);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    *count=length;
+    if(seq!=NULL)
+        *seq=found;
+
+    cursor->pos=(pos+FRAM_LOG_HEADER_SIZE+length)%(log->sectors*FRAM_LOG_SECTOR_SIZE);
+    cursor->seq=FRAM_log_seq_add(found,1);
+
+    FRAM_log_pack(header,found,buffer,length);
+    if(FRAM_load16(header+FRAM_LOG_CRC_OFFSET)!=crc){
+        log->stats.corrupt++;
+        return FRAM_LOG_CORRUPT;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+const FRAM_log_stats_t* FRAM_log_get_stats(const FRAM_log_t * const log){return &log->stats;}
+
+static void FRAM_log_pack(uint8_t * const header, uint32_t seq, const uint8_t * const buffer, uint16_t count){
+
+    uint16_t crc;
+
+    FRAM_store32(header,seq);
+    FRAM_store16(header+4,count);
+
+    crc=FRAM_chk_crc(FRAM_CHK_CRC_INIT,header,FRAM_LOG_CRC_OFFSET);
+    crc=FRAM_chk_crc(crc,buffer,count);
+
+    FRAM_store16(header+FRAM_LOG_CRC_OFFSET,crc);
+}
+
+static uint32_t FRAM_log_header(FRAM_log_t * const log, uint32_t pos, uint32_t * const seq, uint16_t * const count, uint16_t * const crc){
+
+    uint8_t header[FRAM_LOG_HEADER_SIZE];
+    uint32_t result;
+
+    //no record starts in the last bytes of a sector
+    if(pos%FRAM_LOG_SECTOR_SIZE>FRAM_LOG_SECTOR_SIZE-FRAM_LOG_HEADER_SIZE-1)
+        return FRAM_LOG_END;
+
+    result=FRAM_read_from_adr(log->fram,log->base+pos,header,FRAM_LOG_HEADER_SIZE);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    *seq=FRAM_load32(header);
+    *count=FRAM_load16(header+4);
+    *crc=FRAM_load16(header+FRAM_LOG_CRC_OFFSET);
+
+    //a cleared header or a length exceeding the sector is no record
+    if(*seq==0||*count==0||pos%FRAM_LOG_SECTOR_SIZE+FRAM_LOG_HEADER_SIZE+*count>FRAM_LOG_SECTOR_SIZE)
+        return FRAM_LOG_END;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_log_check(FRAM_log_t * const log, uint32_t pos, uint32_t * const seq, uint16_t * const count){
+
+    uint8_t scratch[FRAM_LOG_SCRATCH];
+    uint32_t result;
+    uint32_t done;
+    uint32_t part;
+    uint16_t crc;
+    uint16_t check;
+
+    result=FRAM_log_header(log,pos,seq,count,&crc);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    FRAM_store32(scratch,*seq);
+    FRAM_store16(scratch+4,*count);
+    check=FRAM_chk_crc(FRAM_CHK_CRC_INIT,scratch,FRAM_LOG_CRC_OFFSET);
+
+    //the payload follows the header, every part hits the address latch
+    for(done=0;done<*count;done+=part){
+
+        part=*count-done<FRAM_LOG_SCRATCH?*count-done:FRAM_LOG_SCRATCH;
+
+        result=FRAM_read_from_adr(log->fram,log->base+pos+FRAM_LOG_HEADER_SIZE+done,scratch,part);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        check=FRAM_chk_crc(check,scratch,part);
+    }
+
+    return check==crc?FRAM_NO_ERROR:FRAM_LOG_CORRUPT;
+}
+
+static uint32_t FRAM_log_scan(FRAM_log_t * const log){
+
+    uint32_t result;
+    uint32_t sector;
+    uint32_t best=log->sectors;
+    uint32_t best_seq=0;
+    uint32_t oldest=0;
+    uint32_t oldest_seq=0;
+    uint32_t seq;
+    uint16_t count;
+
+    //the sector with the highest sequence number at its start holds the newest records, the one with the lowest the oldest
+    for(sector=0;sector<log->sectors;sector++){
+
+        result=FRAM_log_check(log,sector*FRAM_LOG_SECTOR_SIZE,&seq,&count);
+
+        if(result==FRAM_NO_ERROR){
+            if(best==log->sectors||FRAM_LOG_BEFORE(best_seq,seq)){
+                best=sector;
+                best_seq=seq;
+            }
+            if(oldest_seq==0||FRAM_LOG_BEFORE(seq,oldest_seq)){
+                oldest=sector;
+                oldest_seq=seq;
+            }
+        }
+        else if(result!=FRAM_LOG_CORRUPT&&result!=FRAM_LOG_END)
+            return result;
+    }
+
+    if(best==log->sectors){
+        log->head=0;
+        log->seq=1;
+        log->first=0;
+        log->empty=1;
+        return FRAM_NO_ERROR;
+    }
+
+    result=FRAM_log_follow(log,best*FRAM_LOG_SECTOR_SIZE,best_seq);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    log->first=oldest;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_log_follow(FRAM_log_t * const log, uint32_t pos, uint32_t seq){
+
+    uint8_t zero[FRAM_LOG_HEADER_SIZE];
+    uint32_t const start=pos;
+    uint32_t result;
+    uint32_t found;
+    uint16_t count;
+
+    memset(zero,0,sizeof(zero));
+
+    //follow the records of the sector starting with seq up to the first one missing, later sectors can not continue it
+    do{
+        result=FRAM_log_check(log,pos,&found,&count);
+
+        if(result==FRAM_LOG_CORRUPT){
+            //the last record may be torn by a reset. Its header is cleared, otherwise it stays in front of the records
+            //going to the next sector if the next append does not fit here, and readers would take it for the next record
+            log->stats.corrupt++;
+            result=FRAM_write_to_adr(log->fram,log->base+pos,zero,FRAM_LOG_HEADER_SIZE);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+            break;
+        }
+        if(result==FRAM_LOG_END||(result==FRAM_NO_ERROR&&found!=seq))
+            break;
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        pos+=FRAM_LOG_HEADER_SIZE+count;
+        seq=FRAM_log_seq_add(seq,1);
+    }while(pos%FRAM_LOG_SECTOR_SIZE!=0&&pos-start<FRAM_LOG_SECTOR_SIZE);
+
+    log->head=pos%(log->sectors*FRAM_LOG_SECTOR_SIZE);
+    log->seq=seq;
+    log->empty=0;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_log_next_sector(const FRAM_log_t * const log, uint32_t pos){return (pos/FRAM_LOG_SECTOR_SIZE+1)%log->sectors*FRAM_LOG_SECTOR_SIZE;}
+
+static uint32_t FRAM_log_place(const FRAM_log_t * const log, uint32_t need){
+
+    //a record never crosses a sector boundary
+    if(log->head%FRAM_LOG_SECTOR_SIZE+need>FRAM_LOG_SECTOR_SIZE)
+        return FRAM_log_next_sector(log,log->head);
+
+    return log->head;
+}
+
+static void FRAM_log_advance(FRAM_log_t * const log, uint32_t pos, uint32_t end, uint32_t records){
+
+    //entering the sector of the oldest records drops them
+    if(pos%FRAM_LOG_SECTOR_SIZE==0&&pos/FRAM_LOG_SECTOR_SIZE==log->first&&!log->empty){
+        log->first=(log->first+1)%log->sectors;
+        log->stats.dropped++;
+    }
+
+    log->head=end%(log->sectors*FRAM_LOG_SECTOR_SIZE);
+    log->seq=FRAM_log_seq_add(log->seq,records);
+    log->empty=0;
+    log->stats.appended+=records;
+    log->stats.writes++;
+}
+
+static uint32_t FRAM_log_seq_add(uint32_t seq, uint32_t n){
+
+    //0 marks a cleared header, the sequence numbers skip it when they wrap around
+    seq+=n;
+    if(seq<n)
+        seq++;
+
+    return seq;
+}
+
+/* [] END OF FILE */
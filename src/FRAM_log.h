@@ -0,0 +1,217 @@
+/**
+ * @file FRAM_log.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Append-only ring log in a region of a FRAM chip.
+ * Every record starts with a header holding a sequence number, the payload length and a CRC over both and the payload.
+ * The position of the next record is not stored in the FRAM, "FRAM_log_recover" finds it after a reset by following the sequence numbers.
+ * Appending a record is therefore a single write of header and payload.
+ *
+ * The region is divided into sectors of FRAM_LOG_SECTOR_SIZE bytes and a record never crosses a sector boundary,
+ * so every sector in use starts with a record header. If a record does not fit into the rest of a sector, it goes to the start of the next one.
+ * When the log wraps around, the sector the next record goes to is dropped as a whole.
+ *
+ * A log is used by one task at a time, the functions do not lock the log itself.
+ */
+
+#if !defined(FRAM_LOG_H)
+#define FRAM_LOG_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_LOG_SECTOR_SIZE    256u                    //size of a sector, the region of a log is a multiple of it
+#define FRAM_LOG_HEADER_SIZE    8u                      //bytes of the record header: sequence number (4), length (2), CRC (2)
+#define FRAM_LOG_RECORD_MAX     (FRAM_LOG_SECTOR_SIZE-FRAM_LOG_HEADER_SIZE)  //highest payload length of a record
+#define FRAM_LOG_BATCH_MAX      8u                      //highest number of records "FRAM_log_append_batch" writes in one transfer
+#define FRAM_LOG_BEFORE(a,b)    ((int32_t)((a)-(b))<0)  //1 if sequence number a is older than b, compared by their distance so they may wrap around
+
+#define FRAM_LOG_END            0x2000u                 //indicates that there is no further record
+#define FRAM_LOG_CORRUPT        0x4000u                 //indicates a record with a CRC mismatch
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a log
+*/
+typedef struct {
+    uint32_t    appended;                               //number of records appended
+    uint32_t    writes;                                 //number of write transfers of the appends
+    uint32_t    dropped;                                //number of sectors dropped by wrapping around
+    uint32_t    corrupt;                                //number of records with a CRC mismatch found by reads and the recovery
+} FRAM_log_stats_t;
+
+/**
+A ring log
+
+Initialise it with "FRAM_log_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the log
+    uint32_t    base;                                   //address of the first sector
+    uint32_t    sectors;                                //number of sectors
+    uint32_t    head;                                   //offset of the next record from base
+    uint32_t    seq;                                    //sequence number of the next record
+    uint32_t    first;                                  //sector holding the oldest record
+    uint8_t     empty;                                  //1 if the log holds no record
+    FRAM_log_stats_t stats;
+} FRAM_log_t;
+
+/**
+Read position in a log, see "FRAM_log_first"
+*/
+typedef struct {
+    uint32_t    pos;                                    //offset of the next record from base
+    uint32_t    seq;                                    //sequence number of the next record
+} FRAM_log_cursor_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a log
+
+Does not access the chip. Call "FRAM_log_format" to start an empty log or "FRAM_log_recover" to continue the log found in the region.
+
+@param log the log to be initialised
+@param fram the chip holding the log
+@param base address of the region
+@param size size of the region, a multiple of FRAM_LOG_SECTOR_SIZE and at least two sectors
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip or the size is invalid
+        FRAM_NO_ERROR if the log was initialised
+*/
+uint32_t    FRAM_log_init(FRAM_log_t * const log, FRAM_t * const fram, uint32_t base, uint32_t size);
+
+/**
+Start an empty log
+
+Clears the whole region, so nothing left in it is taken for a record.
+
+@param log the log
+@return FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_log_format(FRAM_log_t * const log);
+
+/**
+Find the next record position after a reset
+
+The sequence numbers at the sector starts rise up to the newest sector and drop after it, so the newest sector is found by a binary search
+over the sector starts. A corrupted sector start is stepped over by reading the following sectors. If the first sector of the region can not be read,
+the first record of every sector is read instead. From the newest sector on, the records are followed up to the first one missing.
+A record interrupted by a reset fails its CRC, its header is cleared so it is not taken for a record if the next append goes to the next sector.
+
+@param log the log
+@return FRAM_NO_ERROR if the operation succeeded, the log is empty if no record was found
+        any other value is the output of "FRAM_read_from_adr" or "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_log_recover(FRAM_log_t * const log);
+
+/**
+Append a record
+
+Costs one write of header and payload.
+
+@param log the log
+@param buffer pointer to the payload
+@param count length of the payload, 1 to FRAM_LOG_RECORD_MAX
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL or the count is invalid
+        FRAM_NO_ERROR if the record was appended
+        any other value is the output of "FRAM_write_parts_to_adr"
+*/
+uint32_t    FRAM_log_append(FRAM_log_t * const log, const uint8_t * const buffer, uint16_t count);
+
+/**
+Append several records
+
+Records going to the same sector are written in one transfer of up to FRAM_LOG_BATCH_MAX records.
+
+@param log the log
+@param records the payloads, see "FRAM_log_append" for the valid lengths
+@param count number of records
+@return FRAM_PARAMTER_ERROR if a record is invalid, no record was appended
+        FRAM_NO_ERROR if the records were appended
+        any other value is the output of "FRAM_write_parts_to_adr", the records before the failed transfer were appended
+*/
+uint32_t    FRAM_log_append_batch(FRAM_log_t * const log, const FRAM_part_t * const records, uint8_t count);
+
+/**
+Get the sequence number the next record gets
+
+@param log the log
+@return the sequence number, records are numbered from 1 on. After 0xffffffff the numbering goes on with 1, 0 is never used.
+*/
+uint32_t    FRAM_log_get_seq(const FRAM_log_t * const log);
+
+/**
+Position a cursor at the oldest record
+
+@param log the log
+@param cursor the cursor
+@return FRAM_LOG_END if the log is empty
+        FRAM_NO_ERROR if the cursor points to a record
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_log_first(FRAM_log_t * const log, FRAM_log_cursor_t * const cursor);
+
+/**
+Read the record at a cursor and move the cursor to the next record
+
+Records lost to a corrupted header are skipped, the sequence number shows the gap.
+
+@param log the log
+@param cursor the cursor, see "FRAM_log_first"
+@param buffer pointer to the memory the payload is stored to
+@param size size of the buffer
+@param count the payload length is stored here
+@param seq the sequence number of the record is stored here, may be NULL
+@return FRAM_LOG_END if there is no further record
+        FRAM_PARAMTER_ERROR if the payload does not fit into the buffer, the cursor is not moved
+        FRAM_LOG_CORRUPT if the payload does not match its CRC, the cursor is moved anyway
+        FRAM_NO_ERROR if the record was read
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_log_read(FRAM_log_t * const log, FRAM_log_cursor_t * const cursor, uint8_t * const buffer, uint16_t size, uint16_t * const count, uint32_t * const seq);
+
+/**
+Get the statistics of a log
+
+@param log the log
+@return the statistics collected since "FRAM_log_init"
+*/
+const FRAM_log_stats_t* FRAM_log_get_stats(const FRAM_log_t * const log);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_LOG_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,548 @@
+/**
+ * @file FRAM_lskv.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_lskv.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_LSKV_DELETED       0x80u                   //flag of the key length marking a record that removes its key
+#define FRAM_LSKV_RESERVE       2u                      //sectors a put leaves free, one for the records the compactor appends and one for deletes
+#define FRAM_LSKV_HEAD          (FRAM_LOG_HEADER_SIZE+1u+FRAM_LSKV_KEY_MAX)  //log header, key length and key of a record
+
+#if (FRAM_LSKV_SLOTS&(FRAM_LSKV_SLOTS-1u))!=0
+    #error "FRAM_LSKV_SLOTS has to be a power of two"
+#endif
+
+#if FRAM_LSKV_KEY_MAX>=FRAM_LSKV_DELETED || FRAM_LSKV_KEY_MAX+1u>FRAM_LOG_RECORD_MAX
+    #error "FRAM_LSKV_KEY_MAX has to fit into the key length of a record"
+#endif
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint8_t  FRAM_lskv_length(const char * const key);
+static uint32_t FRAM_lskv_hash(const uint8_t * const key, uint8_t length);
+static uint32_t FRAM_lskv_lookup(FRAM_lskv_t * const kv, const uint8_t * const key, uint8_t length, uint32_t hash, uint32_t * const slot, uint8_t * const head);
+static uint32_t FRAM_lskv_slot_of(const FRAM_lskv_t * const kv, uint32_t hash, uint32_t record);
+static void     FRAM_lskv_remove(FRAM_lskv_t * const kv, uint32_t slot);
+static uint8_t  FRAM_lskv_fits(const FRAM_lskv_t * const kv, uint32_t need, uint32_t reserve);
+static uint32_t FRAM_lskv_make_room(FRAM_lskv_t * const kv, uint32_t need, uint32_t reserve);
+static uint32_t FRAM_lskv_step(FRAM_lskv_t * const kv);
+static uint32_t FRAM_lskv_append(FRAM_lskv_t * const kv, const uint8_t * const data, uint16_t count, uint32_t * const record);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_lskv_init(FRAM_lskv_t * const kv, FRAM_t * const fram, uint32_t base, uint32_t size){
+
+    uint32_t result;
+    uint32_t i;
+
+    //check if parameters are valid
+    if(size<(FRAM_LSKV_LOW+2u)*FRAM_LOG_SECTOR_SIZE)
+        return FRAM_PARAMTER_ERROR;
+
+    result=FRAM_log_init(&kv->log,fram,base,size);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    kv->compact.pos=0;
+    kv->compact.seq=1;
+    kv->keys=0;
+
+    for(i=0;i<FRAM_LSKV_SLOTS;i++)
+        kv->index[i].record=FRAM_INVALID_ADR;
+
+    kv->stats.gets=0;
+    kv->stats.puts=0;
+    kv->stats.scanned=0;
+    kv->stats.copied=0;
+    kv->stats.stalls=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_lskv_format(FRAM_lskv_t * const kv){
+
+    uint32_t result;
+    uint32_t i;
+
+    result=FRAM_log_format(&kv->log);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    kv->compact.pos=kv->log.head;
+    kv->compact.seq=kv->log.seq;
+    kv->keys=0;
+
+    for(i=0;i<FRAM_LSKV_SLOTS;i++)
+        kv->index[i].record=FRAM_INVALID_ADR;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_lskv_mount(FRAM_lskv_t * const kv){
+
+    FRAM_log_cursor_t cursor;
+    uint8_t data[FRAM_LOG_RECORD_MAX];
+    uint8_t head[FRAM_LSKV_HEAD];
+    uint32_t size=kv->log.sectors*FRAM_LOG_SECTOR_SIZE;
+    uint32_t result;
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t i;
+    uint16_t count;
+    uint8_t length;
+
+    kv->keys=0;
+
+    for(i=0;i<FRAM_LSKV_SLOTS;i++)
+        kv->index[i].record=FRAM_INVALID_ADR;
+
+    result=FRAM_log_recover(&kv->log);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    kv->compact.pos=kv->log.head;
+    kv->compact.seq=kv->log.seq;
+
+    result=FRAM_log_first(&kv->log,&cursor);
+    if(result==FRAM_LOG_END)
+        return FRAM_NO_ERROR;
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    //nothing is known to be compacted, the compactor starts at the oldest record
+    kv->compact=cursor;
+
+    //the records are read from the oldest on, so the index ends up pointing to the newest record of every key
+    for(;;){
+
+        result=FRAM_log_read(&kv->log,&cursor,data,sizeof(data),&count,NULL);
+        if(result==FRAM_LOG_END)
+            return FRAM_NO_ERROR;
+        if(result==FRAM_LOG_CORRUPT)
+            continue;
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        length=data[0]&~FRAM_LSKV_DELETED;
+        if(length==0||length>FRAM_LSKV_KEY_MAX||1u+length>count)
+            continue;
+
+        hash=FRAM_lskv_hash(data+1,length);
+
+        result=FRAM_lskv_lookup(kv,data+1,length,hash,&slot,head);
+        if(result!=FRAM_NO_ERROR&&result!=FRAM_LSKV_NOT_FOUND)
+            return result;
+
+        if(data[0]&FRAM_LSKV_DELETED){
+            if(result==FRAM_NO_ERROR){
+                FRAM_lskv_remove(kv,slot);
+                kv->keys--;
+            }
+            continue;
+        }
+
+        if(result==FRAM_LSKV_NOT_FOUND){
+            if(kv->keys+1u>=FRAM_LSKV_SLOTS)
+                return FRAM_MEMORY_ERROR;
+            kv->keys++;
+        }
+
+        kv->index[slot].hash=hash;
+        kv->index[slot].record=(cursor.pos+size-FRAM_LOG_HEADER_SIZE-count)%size;
+    }
+}
+
+uint32_t FRAM_lskv_get(FRAM_lskv_t * const kv, const char * const key, uint8_t * const buffer, uint16_t size, uint16_t * const count){
+
+    uint8_t head[FRAM_LSKV_HEAD];
+    uint32_t result;
+    uint32_t slot;
+    uint16_t length;
+    uint8_t key_length;
+
+    //check if parameters are valid
+    if(key==NULL||buffer==NULL||count==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    key_length=FRAM_lskv_length(key);
+    if(key_length==0||key_length>FRAM_LSKV_KEY_MAX)
+        return FRAM_PARAMTER_ERROR;
+
+    kv->stats.gets++;
+
+    result=FRAM_lskv_lookup(kv,(const uint8_t*)key,key_length,FRAM_lskv_hash((const uint8_t*)key,key_length),&slot,head);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    length=FRAM_load16(head+4)-1u-key_length;
+
+    *count=length;
+    if(length>size)
+        return FRAM_PARAMTER_ERROR;
+
+    if(length==0)
+        return FRAM_NO_ERROR;
+
+    //the value follows the key, so the read hits the address latch
+    return FRAM_read_from_adr(kv->log.fram,kv->log.base+kv->index[slot].record+FRAM_LOG_HEADER_SIZE+1u+key_length,buffer,length);
+}
+
+uint32_t FRAM_lskv_put(FRAM_lskv_t * const kv, const char * const key, const uint8_t * const buffer, uint16_t count){
+
+    uint8_t data[FRAM_LOG_RECORD_MAX];
+    uint8_t head[FRAM_LSKV_HEAD];
+    uint32_t result;
+    uint32_t hash;
+    uint32_t slot;
+    uint32_t record;
+    uint8_t length;
+    uint8_t exists;
+
+    //check if parameters are valid
+    if(key==NULL||(buffer==NULL&&count!=0))
+        return FRAM_PARAMTER_ERROR;
+
+    length=FRAM_lskv_length(key);
+    if(length==0||length>FRAM_LSKV_KEY_MAX||count>FRAM_LOG_RECORD_MAX-1u-length)
+        return FRAM_PARAMTER_ERROR;
+
+    kv->stats.puts++;
+
+    hash=FRAM_lskv_hash((const uint8_t*)key,length);
+
+    //the compactor only changes the records of the slots, the slot found stays valid
+    result=FRAM_lskv_lookup(kv,(const uint8_t*)key,length,hash,&slot,head);
+    if(result!=FRAM_NO_ERROR&&result!=FRAM_LSKV_NOT_FOUND)
+        return result;
+
+    exists=result==FRAM_NO_ERROR;
+    if(!exists&&kv->keys+1u>=FRAM_LSKV_SLOTS)
+        return FRAM_MEMORY_ERROR;
+
+    result=FRAM_lskv_make_room(kv,FRAM_LOG_HEADER_SIZE+1u+length+count,FRAM_LSKV_RESERVE);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    data[0]=length;
+    memcpy(data+1,key,length);
+    if(count>0)
+        memcpy(data+1+length,buffer,count);
+
+    result=FRAM_lskv_append(kv,data,1u+length+count,&record);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    kv->index[slot].hash=hash;
+    kv->index[slot].record=record;
+
+    if(!exists)
+        kv->keys++;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_lskv_delete(FRAM_lskv_t * const kv, const char * const key){
+
+    uint8_t data[1u+FRAM_LSKV_KEY_MAX];
+    uint8_t head[FRAM_LSKV_HEAD];
+    uint32_t result;
+    uint32_t slot;
+    uint32_t record;
+    uint8_t length;
+
+    //check if parameters are valid
+    if(key==NULL)
+        return FRAM_PARAMTER_ERROR;
+
+    length=FRAM_lskv_length(key);
+    if(length==0||length>FRAM_LSKV_KEY_MAX)
+        return FRAM_PARAMTER_ERROR;
+
+    kv->stats.puts++;
+
+    result=FRAM_lskv_lookup(kv,(const uint8_t*)key,length,FRAM_lskv_hash((const uint8_t*)key,length),&slot,head);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    //a delete may take the sector kept for deletes, so a full store can still be emptied
+    result=FRAM_lskv_make_room(kv,FRAM_LOG_HEADER_SIZE+1u+length,FRAM_LSKV_RESERVE-1u);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    data[0]=length|FRAM_LSKV_DELETED;
+    memcpy(data+1,key,length);
+
+    result=FRAM_lskv_append(kv,data,1u+length,&record);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    FRAM_lskv_remove(kv,slot);
+    kv->keys--;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_lskv_compact(FRAM_lskv_t * const kv, uint32_t records){
+
+    uint32_t result;
+
+    for(;records>0;records--){
+        result=FRAM_lskv_step(kv);
+        if(result==FRAM_LOG_END)
+            break;
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_lskv_get_free(const FRAM_lskv_t * const kv){
+
+    uint32_t sectors=kv->log.sectors;
+    uint32_t head=kv->log.head/FRAM_LOG_SECTOR_SIZE;
+    uint32_t compact=kv->compact.pos/FRAM_LOG_SECTOR_SIZE;
+
+    //the compactor passed all records, every sector but the one of the head is free
+    if(!FRAM_LOG_BEFORE(kv->compact.seq,kv->log.seq))
+        return sectors-1u;
+
+    return (compact+sectors-head-1u)%sectors;
+}
+
+const FRAM_lskv_stats_t* FRAM_lskv_get_stats(const FRAM_lskv_t * const kv){return &kv->stats;}
+
+static uint8_t FRAM_lskv_length(const char * const key){
+
+    uint8_t length;
+
+    for(length=0;key[length]!=0&&length<=FRAM_LSKV_KEY_MAX;length++);
+
+    return length;
+}
+
+static uint32_t FRAM_lskv_hash(const uint8_t * const key, uint8_t length){
+
+    //FNV-1a
+    uint32_t hash=2166136261u;
+    uint8_t i;
+
+    for(i=0;i<length;i++){
+        hash^=key[i];
+        hash*=16777619u;
+    }
+
+    return hash;
+}
+
+static uint32_t FRAM_lskv_lookup(FRAM_lskv_t * const kv, const uint8_t * const key, uint8_t length, uint32_t hash, uint32_t * const slot, uint8_t * const head){
+
+    uint32_t result;
+    uint32_t i=hash&(FRAM_LSKV_SLOTS-1u);
+
+    //the index always keeps an empty slot, which ends the probing
+    for(;kv->index[i].record!=FRAM_INVALID_ADR;i=(i+1u)&(FRAM_LSKV_SLOTS-1u)){
+
+        if(kv->index[i].hash!=hash)
+            continue;
+
+        //only a matching hash costs a read of the record's key
+        result=FRAM_read_from_adr(kv->log.fram,kv->log.base+kv->index[i].record,head,FRAM_LOG_HEADER_SIZE+1u+length);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        if(head[FRAM_LOG_HEADER_SIZE]==length&&memcmp(head+FRAM_LOG_HEADER_SIZE+1,key,length)==0){
+            *slot=i;
+            return FRAM_NO_ERROR;
+        }
+    }
+
+    *slot=i;
+
+    return FRAM_LSKV_NOT_FOUND;
+}
+
+static uint32_t FRAM_lskv_slot_of(const FRAM_lskv_t * const kv, uint32_t hash, uint32_t record){
+
+    uint32_t i=hash&(FRAM_LSKV_SLOTS-1u);
+
+    for(;kv->index[i].record!=FRAM_INVALID_ADR;i=(i+1u)&(FRAM_LSKV_SLOTS-1u))
+        if(kv->index[i].record==record)
+            return i;
+
+    return FRAM_INVALID_ADR;
+}
+
+static void FRAM_lskv_remove(FRAM_lskv_t * const kv, uint32_t slot){
+
+    uint32_t i=slot;
+    uint32_t home;
+
+    //the following slots of the probe sequence are moved back, so no probing ends too early
+    for(;;){
+
+        i=(i+1u)&(FRAM_LSKV_SLOTS-1u);
+        if(kv->index[i].record==FRAM_INVALID_ADR)
+            break;
+
+        home=kv->index[i].hash&(FRAM_LSKV_SLOTS-1u);
+
+        //the entry stays if its home slot lies cyclically between the emptied slot and its slot
+        if(((i-home)&(FRAM_LSKV_SLOTS-1u))<((i-slot)&(FRAM_LSKV_SLOTS-1u)))
+            continue;
+
+        kv->index[slot]=kv->index[i];
+        slot=i;
+    }
+
+    kv->index[slot].record=FRAM_INVALID_ADR;
+}
+
+static uint8_t FRAM_lskv_fits(const FRAM_lskv_t * const kv, uint32_t need, uint32_t reserve){
+
+    uint32_t sectors=kv->log.sectors;
+    uint32_t pos=kv->log.head;
+    uint32_t target;
+    uint32_t compact;
+
+    if(!FRAM_LOG_BEFORE(kv->compact.seq,kv->log.seq))
+        return 1;
+
+    //see "FRAM_log_place", a record never crosses a sector boundary
+    if(pos%FRAM_LOG_SECTOR_SIZE+need>FRAM_LOG_SECTOR_SIZE)
+        pos=(pos/FRAM_LOG_SECTOR_SIZE+1u)%sectors*FRAM_LOG_SECTOR_SIZE;
+
+    target=pos/FRAM_LOG_SECTOR_SIZE;
+    compact=kv->compact.pos/FRAM_LOG_SECTOR_SIZE;
+
+    //entering the sector of the compactor would drop records it has not passed, in any other case it is behind the head in the same sector
+    if(target==compact)
+        return pos%FRAM_LOG_SECTOR_SIZE!=0?1:0;
+
+    //the sectors between the record and the compactor are the reserve
+    return (compact+sectors-target-1u)%sectors>=reserve;
+}
+
+static uint32_t FRAM_lskv_make_room(FRAM_lskv_t * const kv, uint32_t need, uint32_t reserve){
+
+    uint32_t result;
+    uint32_t seq=kv->log.seq;
+    uint32_t i;
+    uint8_t stalled=0;
+
+    //a few records per put keep the compactor ahead of the head
+    if(FRAM_lskv_get_free(kv)<FRAM_LSKV_LOW){
+        for(i=0;i<FRAM_LSKV_STEP;i++){
+            result=FRAM_lskv_step(kv);
+            if(result==FRAM_LOG_END)
+                break;
+            if(result!=FRAM_NO_ERROR)
+                return result;
+        }
+    }
+
+    //the log is full of records the compactor has not passed, the put waits until they are passed once
+    while(!FRAM_lskv_fits(kv,need,reserve)){
+
+        if(!FRAM_LOG_BEFORE(kv->compact.seq,seq))
+            return FRAM_LSKV_FULL;
+
+        result=FRAM_lskv_step(kv);
+        if(result!=FRAM_NO_ERROR&&result!=FRAM_LOG_END)
+            return result;
+
+        stalled=1;
+    }
+
+    kv->stats.stalls+=stalled;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_lskv_step(FRAM_lskv_t * const kv){
+
+    FRAM_log_cursor_t cursor=kv->compact;
+    uint8_t data[FRAM_LOG_RECORD_MAX];
+    uint32_t size=kv->log.sectors*FRAM_LOG_SECTOR_SIZE;
+    uint32_t result;
+    uint32_t record;
+    uint32_t slot;
+    uint16_t count;
+    uint8_t length;
+
+    if(!FRAM_LOG_BEFORE(kv->compact.seq,kv->log.seq))
+        return FRAM_LOG_END;
+
+    result=FRAM_log_read(&kv->log,&kv->compact,data,sizeof(data),&count,NULL);
+    if(result==FRAM_LOG_END){
+        kv->compact.pos=kv->log.head;
+        kv->compact.seq=kv->log.seq;
+        return FRAM_LOG_END;
+    }
+
+    //a corrupted record is dropped
+    if(result==FRAM_LOG_CORRUPT){
+        kv->stats.scanned++;
+        return FRAM_NO_ERROR;
+    }
+
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    kv->stats.scanned++;
+
+    //only the newest record of a key is live, records removing a key are never
+    length=data[0];
+    if(length==0||length>FRAM_LSKV_KEY_MAX||1u+length>count)
+        return FRAM_NO_ERROR;
+
+    record=(kv->compact.pos+size-FRAM_LOG_HEADER_SIZE-count)%size;
+
+    slot=FRAM_lskv_slot_of(kv,FRAM_lskv_hash(data+1,length),record);
+    if(slot==FRAM_INVALID_ADR)
+        return FRAM_NO_ERROR;
+
+    //the reserve of the puts takes the live records of the sector being compacted, if it does not the record stays where it is
+    if(!FRAM_lskv_fits(kv,FRAM_LOG_HEADER_SIZE+count,0)){
+        kv->compact=cursor;
+        return FRAM_LSKV_FULL;
+    }
+
+    result=FRAM_lskv_append(kv,data,count,&record);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    kv->index[slot].record=record;
+    kv->stats.copied++;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_lskv_append(FRAM_lskv_t * const kv, const uint8_t * const data, uint16_t count, uint32_t * const record){
+
+    uint32_t size=kv->log.sectors*FRAM_LOG_SECTOR_SIZE;
+    uint32_t result;
+
+    result=FRAM_log_append(&kv->log,data,count);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    //the record ends at the head
+    *record=(kv->log.head+size-FRAM_LOG_HEADER_SIZE-count)%size;
+
+    return FRAM_NO_ERROR;
+}
+
+/* [] END OF FILE */
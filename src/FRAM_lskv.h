@@ -0,0 +1,217 @@
+/**
+ * @file FRAM_lskv.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Log-structured key-value store on top of a ring log (see FRAM_log.h).
+ * Every put appends a record of key and value to the log with a single write, values are never updated in place.
+ * A delete appends a record marking the key as removed. The index mapping the keys to their newest records is kept in SRAM only,
+ * "FRAM_lskv_mount" rebuilds it by reading the log.
+ *
+ * The compactor walks the log from the oldest record on and appends the records still referenced by the index again,
+ * so the log can drop the sectors behind it when it wraps around. Once fewer than FRAM_LSKV_LOW sectors are free,
+ * every put compacts FRAM_LSKV_STEP records first. More records are compacted only if the put would otherwise enter a sector
+ * the compactor has not passed yet. "FRAM_lskv_compact" compacts in idle time. "FRAM_lskv_mount" does not know how far the compactor got,
+ * it starts at the oldest record again and the puts following a mount compact more records until it has caught up.
+ * A put returns FRAM_LSKV_FULL if the live records leave no room for its record, deleting keys makes room again.
+ * Puts keep two sectors free: one takes the records the compactor appends, the other one is left to deletes, so a full store can still be emptied.
+ * The store works best if the live records take up less than half of the region.
+ *
+ * A store is used by one task at a time, the functions do not lock the store itself.
+ */
+
+#if !defined(FRAM_LSKV_H)
+#define FRAM_LSKV_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+#include "FRAM_log.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_LSKV_KEY_MAX       31u                     //highest length of a key without the terminating 0
+#define FRAM_LSKV_VALUE_MAX     (FRAM_LOG_RECORD_MAX-1u-FRAM_LSKV_KEY_MAX)  //highest length of a value that fits with any key, shorter keys leave room for longer values
+#define FRAM_LSKV_SLOTS         128u                    //number of slots of the SRAM index, a power of two and more than the number of keys
+#define FRAM_LSKV_LOW           4u                      //puts compact records if fewer sectors are free
+#define FRAM_LSKV_STEP          2u                      //number of records compacted by a put if fewer than FRAM_LSKV_LOW sectors are free
+
+#define FRAM_LSKV_NOT_FOUND     0x80000u                //indicates that the key is not in the store
+#define FRAM_LSKV_FULL          0x4000000u              //indicates that the live records leave no room in the log
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a store
+*/
+typedef struct {
+    uint32_t    gets;                                   //number of gets
+    uint32_t    puts;                                   //number of puts and deletes
+    uint32_t    scanned;                                //number of records passed by the compactor
+    uint32_t    copied;                                 //number of records appended again by the compactor
+    uint32_t    stalls;                                 //number of puts compacting more than FRAM_LSKV_STEP records
+} FRAM_lskv_stats_t;
+
+/**
+Slot of the SRAM index
+*/
+typedef struct {
+    uint32_t    hash;                                   //hash of the key
+    uint32_t    record;                                 //offset of the newest record of the key in the log, FRAM_INVALID_ADR if the slot is empty
+} FRAM_lskv_slot_t;
+
+/**
+A log-structured key-value store
+
+Initialise it with "FRAM_lskv_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_log_t  log;                                    //log holding the records
+    FRAM_log_cursor_t compact;                          //next record of the compactor
+    uint32_t    keys;                                   //number of keys in the index
+    FRAM_lskv_slot_t index[FRAM_LSKV_SLOTS];
+    FRAM_lskv_stats_t stats;
+} FRAM_lskv_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a store
+
+Does not access the chip. Call "FRAM_lskv_format" to start an empty store or "FRAM_lskv_mount" to use the store found in the region.
+
+@param kv the store to be initialised
+@param fram the chip holding the store
+@param base address of the region
+@param size size of the region, a multiple of FRAM_LOG_SECTOR_SIZE and at least FRAM_LSKV_LOW+2 sectors
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip or the size is invalid
+        FRAM_NO_ERROR if the store was initialised
+*/
+uint32_t    FRAM_lskv_init(FRAM_lskv_t * const kv, FRAM_t * const fram, uint32_t base, uint32_t size);
+
+/**
+Start an empty store
+
+@param kv the store
+@return see "FRAM_log_format"
+*/
+uint32_t    FRAM_lskv_format(FRAM_lskv_t * const kv);
+
+/**
+Use the store found in the region
+
+Recovers the log and reads all of its records to rebuild the index.
+
+@param kv the store
+@return FRAM_MEMORY_ERROR if the log holds more keys than the index can take
+        FRAM_NO_ERROR if the store can be used
+        any other value is the output of "FRAM_log_recover" or "FRAM_log_read"
+*/
+uint32_t    FRAM_lskv_mount(FRAM_lskv_t * const kv);
+
+/**
+Read a value
+
+Costs one read of the record header and the key and one read of the value, which hits the address latch.
+
+@param kv the store
+@param key the key, a string of up to FRAM_LSKV_KEY_MAX characters
+@param buffer pointer to the memory the value is stored to
+@param size size of the buffer
+@param count the length of the value is stored here, also if the buffer is too small
+@return FRAM_PARAMTER_ERROR if either a pointer is NULL, the key is invalid or the value does not fit into the buffer
+        FRAM_LSKV_NOT_FOUND if the key is not in the store
+        FRAM_NO_ERROR if the value was read
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_lskv_get(FRAM_lskv_t * const kv, const char * const key, uint8_t * const buffer, uint16_t size, uint16_t * const count);
+
+/**
+Write a value
+
+Appends a record of key and value with one write, after compacting records if the log runs short of free sectors.
+
+@param kv the store
+@param key the key, a string of up to FRAM_LSKV_KEY_MAX characters
+@param buffer pointer to the value
+@param count length of the value, at most FRAM_LOG_RECORD_MAX-1 minus the length of the key
+@return FRAM_PARAMTER_ERROR if either a pointer is NULL, the key is invalid or the value is too long
+        FRAM_MEMORY_ERROR if the index is full, nothing was written
+        FRAM_LSKV_FULL if the live records leave no room for the record, nothing was written by the put itself. Delete keys to make room
+        FRAM_NO_ERROR if the value was written
+        any other value is the output of "FRAM_read_from_adr", "FRAM_log_read" or "FRAM_log_append"
+*/
+uint32_t    FRAM_lskv_put(FRAM_lskv_t * const kv, const char * const key, const uint8_t * const buffer, uint16_t count);
+
+/**
+Remove a key
+
+Appends a record marking the key as removed, see "FRAM_lskv_put".
+
+@param kv the store
+@param key the key
+@return FRAM_PARAMTER_ERROR if the key is invalid
+        FRAM_LSKV_NOT_FOUND if the key is not in the store
+        FRAM_NO_ERROR if the key was removed
+        any other value see "FRAM_lskv_put"
+*/
+uint32_t    FRAM_lskv_delete(FRAM_lskv_t * const kv, const char * const key);
+
+/**
+Compact records in idle time
+
+@param kv the store
+@param records highest number of records to compact
+@return FRAM_LSKV_FULL if the log has no room for the next live record, it stays where it is
+        FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_log_read" or "FRAM_log_append"
+*/
+uint32_t    FRAM_lskv_compact(FRAM_lskv_t * const kv, uint32_t records);
+
+/**
+Get the number of free sectors
+
+@param kv the store
+@return the number of sectors between the newest record and the oldest record not passed by the compactor
+*/
+uint32_t    FRAM_lskv_get_free(const FRAM_lskv_t * const kv);
+
+/**
+Get the statistics of a store
+
+@param kv the store
+@return the statistics collected since "FRAM_lskv_init"
+*/
+const FRAM_lskv_stats_t* FRAM_lskv_get_stats(const FRAM_lskv_t * const kv);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_LSKV_H) */
+
+/* [] END OF FILE */
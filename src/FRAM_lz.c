@@ -0,0 +1,329 @@
+/**
+ * @file FRAM_lz.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_lz.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_LZ_STORED          0x8000u                 //flag of the record header, the block is stored as it is
+#define FRAM_LZ_MATCH_MIN       3u                      //shortest match, a match takes two bytes: distance-1, length-FRAM_LZ_MATCH_MIN
+#define FRAM_LZ_MATCH_MAX       (FRAM_LZ_MATCH_MIN+255u)
+#define FRAM_LZ_HASH_SIZE       64u                     //entries of the table of positions of the compressor, a power of two
+
+#if FRAM_LZ_BLOCK_SIZE>256u
+    #error "FRAM_LZ_BLOCK_SIZE has to be at most 256, so a distance fits into one byte"
+#endif
+
+#define FRAM_LZ_HASH(data)      ((((uint32_t)(data)[0]<<8^(uint32_t)(data)[1]<<4^(data)[2])*0x9e5u>>8)&(FRAM_LZ_HASH_SIZE-1u))
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_lz_load(FRAM_lz_t * const lz, uint32_t block, uint8_t * const data);
+static uint32_t FRAM_lz_store(FRAM_lz_t * const lz, uint32_t block, const uint8_t * const data);
+static uint16_t FRAM_lz_compress(const uint8_t * const in, uint8_t * const out);
+static uint32_t FRAM_lz_decompress(const uint8_t * const in, uint16_t length, uint8_t * const out);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_lz_init(FRAM_lz_t * const lz, FRAM_t * const fram, uint32_t base, uint32_t size){
+
+    //check if parameters are valid
+    if(size<FRAM_LZ_SLOT_SIZE||base>fram->adr_max||size-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    lz->fram=fram;
+    lz->base=base;
+    lz->blocks=size/FRAM_LZ_SLOT_SIZE;
+
+    lz->stats.blocks=0;
+    lz->stats.stored=0;
+    lz->stats.merged=0;
+    lz->stats.bytes=0;
+    lz->stats.packed=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_lz_format(FRAM_lz_t * const lz){
+
+    uint32_t result;
+    uint32_t i;
+
+    //an empty record is a block of zeros
+    memset(lz->record,0,FRAM_LZ_HEADER_SIZE);
+
+    for(i=0;i<lz->blocks;i++){
+        result=FRAM_write_to_adr(lz->fram,lz->base+i*FRAM_LZ_SLOT_SIZE,lz->record,FRAM_LZ_HEADER_SIZE);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_lz_read_from_adr(FRAM_lz_t * const lz, uint32_t adr, uint8_t * const buffer, uint32_t count){
+
+    uint32_t result;
+    uint32_t done=0;
+    uint32_t offset;
+    uint32_t chunk;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>=FRAM_lz_get_size(lz)||count>FRAM_lz_get_size(lz)-adr)
+        return FRAM_PARAMTER_ERROR;
+
+    while(done<count){
+
+        offset=(adr+done)%FRAM_LZ_BLOCK_SIZE;
+        chunk=FRAM_LZ_BLOCK_SIZE-offset;
+        if(chunk>count-done)
+            chunk=count-done;
+
+        //whole blocks are decompressed straight into the buffer
+        if(chunk==FRAM_LZ_BLOCK_SIZE)
+            result=FRAM_lz_load(lz,(adr+done)/FRAM_LZ_BLOCK_SIZE,&buffer[done]);
+        else{
+            result=FRAM_lz_load(lz,(adr+done)/FRAM_LZ_BLOCK_SIZE,lz->block);
+            memcpy(&buffer[done],&lz->block[offset],chunk);
+        }
+
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        done+=chunk;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_lz_write_to_adr(FRAM_lz_t * const lz, uint32_t adr, const uint8_t * const buffer, uint32_t count){
+
+    uint32_t result;
+    uint32_t done=0;
+    uint32_t offset;
+    uint32_t chunk;
+    uint32_t block;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||adr>=FRAM_lz_get_size(lz)||count>FRAM_lz_get_size(lz)-adr)
+        return FRAM_PARAMTER_ERROR;
+
+    while(done<count){
+
+        block=(adr+done)/FRAM_LZ_BLOCK_SIZE;
+        offset=(adr+done)%FRAM_LZ_BLOCK_SIZE;
+        chunk=FRAM_LZ_BLOCK_SIZE-offset;
+        if(chunk>count-done)
+            chunk=count-done;
+
+        if(chunk==FRAM_LZ_BLOCK_SIZE)
+            result=FRAM_lz_store(lz,block,&buffer[done]);
+        else{
+
+            //the rest of the block is kept
+            result=FRAM_lz_load(lz,block,lz->block);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+
+            memcpy(&lz->block[offset],&buffer[done],chunk);
+            result=FRAM_lz_store(lz,block,lz->block);
+            lz->stats.merged++;
+        }
+
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        lz->stats.bytes+=chunk;
+        done+=chunk;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_lz_get_size(const FRAM_lz_t * const lz){return lz->blocks*FRAM_LZ_BLOCK_SIZE;}
+
+const FRAM_lz_stats_t* FRAM_lz_get_stats(const FRAM_lz_t * const lz){return &lz->stats;}
+
+static uint32_t FRAM_lz_load(FRAM_lz_t * const lz, uint32_t block, uint8_t * const data){
+
+    uint8_t header[FRAM_LZ_HEADER_SIZE];
+    uint32_t result;
+    uint32_t adr=lz->base+block*FRAM_LZ_SLOT_SIZE;
+    uint16_t length;
+
+    result=FRAM_read_from_adr(lz->fram,adr,header,FRAM_LZ_HEADER_SIZE);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    length=FRAM_load16(header);
+
+    //the data follows the header, so the read hits the address latch
+    if(length==(FRAM_LZ_STORED|FRAM_LZ_BLOCK_SIZE))
+        return FRAM_read_from_adr(lz->fram,adr+FRAM_LZ_HEADER_SIZE,data,FRAM_LZ_BLOCK_SIZE);
+
+    if(length==0){
+        memset(data,0,FRAM_LZ_BLOCK_SIZE);
+        return FRAM_NO_ERROR;
+    }
+
+    if(length>=FRAM_LZ_BLOCK_SIZE)
+        return FRAM_LZ_CORRUPT;
+
+    result=FRAM_read_from_adr(lz->fram,adr+FRAM_LZ_HEADER_SIZE,&lz->record[FRAM_LZ_HEADER_SIZE],length);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    return FRAM_lz_decompress(&lz->record[FRAM_LZ_HEADER_SIZE],length,data);
+}
+
+static uint32_t FRAM_lz_store(FRAM_lz_t * const lz, uint32_t block, const uint8_t * const data){
+
+    uint32_t result;
+    uint32_t i;
+    uint16_t length;
+
+    for(i=0;i<FRAM_LZ_BLOCK_SIZE&&data[i]==0;i++);
+
+    //a block of zeros is an empty record, a block not getting smaller is stored as it is
+    if(i==FRAM_LZ_BLOCK_SIZE)
+        length=0;
+    else{
+        length=FRAM_lz_compress(data,&lz->record[FRAM_LZ_HEADER_SIZE]);
+        if(length>=FRAM_LZ_BLOCK_SIZE){
+            memcpy(&lz->record[FRAM_LZ_HEADER_SIZE],data,FRAM_LZ_BLOCK_SIZE);
+            length=FRAM_LZ_BLOCK_SIZE;
+            lz->stats.stored++;
+        }
+    }
+
+    FRAM_store16(lz->record,length==FRAM_LZ_BLOCK_SIZE?FRAM_LZ_STORED|FRAM_LZ_BLOCK_SIZE:length);
+
+    result=FRAM_write_to_adr(lz->fram,lz->base+block*FRAM_LZ_SLOT_SIZE,lz->record,FRAM_LZ_HEADER_SIZE+length);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    lz->stats.blocks++;
+    lz->stats.packed+=FRAM_LZ_HEADER_SIZE+length;
+
+    return FRAM_NO_ERROR;
+}
+
+static uint16_t FRAM_lz_compress(const uint8_t * const in, uint8_t * const out){
+
+    uint16_t table[FRAM_LZ_HASH_SIZE];
+    uint16_t pos=0;
+    uint16_t length=0;
+    uint16_t flags=0;
+    uint16_t candidate;
+    uint16_t match;
+    uint16_t max;
+    uint8_t bit=0;
+
+    memset(table,0,sizeof(table));
+
+    //groups of a flag byte and eight items, a set bit marks a match, a cleared one a literal
+    while(pos<FRAM_LZ_BLOCK_SIZE){
+
+        //give up as soon as the output is not smaller than the block
+        if(length+3u>=FRAM_LZ_BLOCK_SIZE)
+            return FRAM_LZ_BLOCK_SIZE;
+
+        if(bit==0){
+            flags=length++;
+            out[flags]=0;
+        }
+
+        match=0;
+        if(pos+FRAM_LZ_MATCH_MIN<=FRAM_LZ_BLOCK_SIZE){
+
+            //the table holds the last position of each hash plus one, 0 if there was none
+            candidate=table[FRAM_LZ_HASH(&in[pos])];
+            table[FRAM_LZ_HASH(&in[pos])]=pos+1;
+
+            if(candidate!=0){
+                candidate--;
+                max=FRAM_LZ_BLOCK_SIZE-pos;
+                if(max>FRAM_LZ_MATCH_MAX)
+                    max=FRAM_LZ_MATCH_MAX;
+                while(match<max&&in[candidate+match]==in[pos+match])
+                    match++;
+            }
+        }
+
+        if(match>=FRAM_LZ_MATCH_MIN){
+            out[flags]|=1u<<bit;
+            out[length++]=pos-candidate-1;
+            out[length++]=match-FRAM_LZ_MATCH_MIN;
+
+            //the positions inside the match are entered as well, so later matches find them
+            for(pos++,match--;match>0;pos++,match--)
+                if(pos+FRAM_LZ_MATCH_MIN<=FRAM_LZ_BLOCK_SIZE)
+                    table[FRAM_LZ_HASH(&in[pos])]=pos+1;
+        }
+        else
+            out[length++]=in[pos++];
+
+        bit=(bit+1)&7u;
+    }
+
+    return length;
+}
+
+static uint32_t FRAM_lz_decompress(const uint8_t * const in, uint16_t length, uint8_t * const out){
+
+    uint16_t pos=0;
+    uint16_t i=0;
+    uint16_t distance;
+    uint16_t match;
+    uint8_t flags;
+    uint8_t bit;
+
+    while(pos<FRAM_LZ_BLOCK_SIZE){
+
+        if(i>=length)
+            return FRAM_LZ_CORRUPT;
+        flags=in[i++];
+
+        for(bit=0;bit<8&&pos<FRAM_LZ_BLOCK_SIZE;bit++){
+
+            if(flags&(1u<<bit)){
+
+                if(i+2u>length)
+                    return FRAM_LZ_CORRUPT;
+
+                distance=in[i]+1u;
+                match=in[i+1]+FRAM_LZ_MATCH_MIN;
+                i+=2;
+
+                if(distance>pos||match>FRAM_LZ_BLOCK_SIZE-pos)
+                    return FRAM_LZ_CORRUPT;
+
+                //byte by byte, so a match may overlap the data it copies
+                for(;match>0;match--,pos++)
+                    out[pos]=out[pos-distance];
+            }
+            else{
+
+                if(i>=length)
+                    return FRAM_LZ_CORRUPT;
+
+                out[pos++]=in[i++];
+            }
+        }
+    }
+
+    return i==length?FRAM_NO_ERROR:FRAM_LZ_CORRUPT;
+}
+
+/* [] END OF FILE */
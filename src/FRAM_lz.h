@@ -0,0 +1,166 @@
+/**
+ * @file FRAM_lz.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Compressed region of a FRAM chip for bulk data like snapshots, where the time on the bus matters more than the time of the CPU.
+ * The region is addressed like a chip of FRAM_LZ_BLOCK_SIZE bytes per block. Every block has a slot of its own holding a record
+ * of its compressed length and the compressed data (LZSS with a window of one block), so only the compressed bytes go over the bus.
+ * A block that does not get smaller is stored as it is, a block of zeros as an empty record.
+ *
+ * At 400 kHz a byte takes 22.5 us on the bus, about 1000 cycles of a CPU at 48 MHz. Compressing a block costs far less than that per byte,
+ * so the throughput grows with the compression ratio. Incompressible data gets a little slower, it still costs the attempt to compress it.
+ * Blocks written in part are read, merged and compressed again.
+ * A reset during a write can leave a block undecodable, like a reset during "FRAM_write_to_adr" leaves it half written.
+ *
+ * A region is used by one task at a time, the functions do not lock the region itself.
+ */
+
+#if !defined(FRAM_LZ_H)
+#define FRAM_LZ_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_LZ_BLOCK_SIZE      256u                    //bytes of a block as seen by the application, at most 256
+#define FRAM_LZ_HEADER_SIZE     2u                      //bytes of the record header: length of the compressed data and a flag for a stored block
+#define FRAM_LZ_SLOT_SIZE       (FRAM_LZ_HEADER_SIZE+FRAM_LZ_BLOCK_SIZE)  //bytes a block takes on the chip
+
+#define FRAM_LZ_CORRUPT         0x800000u               //indicates a block that cannot be decompressed
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a region
+*/
+typedef struct {
+    uint32_t    blocks;                                 //number of written blocks
+    uint32_t    stored;                                 //number of blocks written as they are
+    uint32_t    merged;                                 //number of blocks written in part, which were read first
+    uint32_t    bytes;                                  //number of bytes written by the application
+    uint32_t    packed;                                 //number of bytes written to the chip, with the record headers
+} FRAM_lz_stats_t;
+
+/**
+A compressed region
+
+Initialise it with "FRAM_lz_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the region
+    uint32_t    base;                                   //address of the region
+    uint32_t    blocks;                                 //number of blocks of the region
+    uint8_t     block[FRAM_LZ_BLOCK_SIZE];              //block merged from a partial write
+    uint8_t     record[FRAM_LZ_SLOT_SIZE];              //compressed record
+    FRAM_lz_stats_t stats;
+} FRAM_lz_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a region
+
+Does not access the chip. Call "FRAM_lz_format" once before the first use.
+
+@param lz the region to be initialised
+@param fram the chip holding the region
+@param base address of the region
+@param size size of the region, every FRAM_LZ_SLOT_SIZE bytes hold FRAM_LZ_BLOCK_SIZE bytes of data
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip or holds no block
+        FRAM_NO_ERROR if the region was initialised
+*/
+uint32_t    FRAM_lz_init(FRAM_lz_t * const lz, FRAM_t * const fram, uint32_t base, uint32_t size);
+
+/**
+Fill a region with zeros
+
+Costs one write of an empty record per block.
+
+@param lz the region
+@return FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_lz_format(FRAM_lz_t * const lz);
+
+/**
+Read data
+
+Costs one read of the record header and one read of the compressed data per block, the second read hits the address latch.
+
+@param lz the region
+@param adr address in the region, 0 is the first byte of the first block
+@param buffer pointer to the memory the data is stored to
+@param count number of bytes to read
+@return FRAM_PARAMTER_ERROR if the buffer points to NULL, the count is 0 or the data exceeds the region
+        FRAM_LZ_CORRUPT if a block cannot be decompressed
+        FRAM_NO_ERROR if the data was read
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_lz_read_from_adr(FRAM_lz_t * const lz, uint32_t adr, uint8_t * const buffer, uint32_t count);
+
+/**
+Write data
+
+Costs one write of the record per block, blocks written in part are read first.
+
+@param lz the region
+@param adr address in the region, 0 is the first byte of the first block
+@param buffer pointer to the data
+@param count number of bytes to write
+@return FRAM_PARAMTER_ERROR if the buffer points to NULL, the count is 0 or the data exceeds the region
+        FRAM_LZ_CORRUPT if a block written in part cannot be decompressed
+        FRAM_NO_ERROR if the data was written
+        any other value is the output of "FRAM_read_from_adr" or "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_lz_write_to_adr(FRAM_lz_t * const lz, uint32_t adr, const uint8_t * const buffer, uint32_t count);
+
+/**
+Get the number of bytes of a region
+
+@param lz the region
+@return the number of bytes the application can store
+*/
+uint32_t    FRAM_lz_get_size(const FRAM_lz_t * const lz);
+
+/**
+Get the statistics of a region
+
+@param lz the region
+@return the statistics collected since "FRAM_lz_init"
+*/
+const FRAM_lz_stats_t* FRAM_lz_get_stats(const FRAM_lz_t * const lz);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_LZ_H) */
+
+/* [] END OF FILE */
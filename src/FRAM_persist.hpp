@@ -0,0 +1,254 @@
+/**
+ * @file FRAM_persist.hpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Typed persistent variables for the C++ front-end.
+ * A fram::layout lists the persistent variables of an application. Every variable gets its FRAM offset at compile time:
+ * either pinned to a given offset or placed right after the previous variable. Overlapping variables and variables exceeding the chip are compile errors.
+ * Single members of a struct can be read and written on their own, so changing one field does not rewrite the whole struct.
+ *
+ * Example:
+ *   struct Calib {float gain; float offset;};
+ *   struct CalibTag; struct BootsTag;
+ *   using Vars=fram::layout<MyFram,0x100,fram::var<CalibTag,Calib>,fram::var<BootsTag,uint32_t,0x1000>>;
+ *   Vars::set_field<CalibTag,FRAM_FIELD(Calib,gain)>(dev,1.5f);
+ *
+ * Placed variables move if a variable in front of them is added or resized, so new variables belong at the end of the list or get pinned.
+ */
+
+#if !defined(FRAM_PERSIST_HPP)
+#define FRAM_PERSIST_HPP
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include "FRAM.hpp"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+//describes the member "member" of the struct "type" for the field functions of fram::layout
+#define FRAM_FIELD(type,member)     fram::field<type,decltype(type::member),offsetof(type,member)>
+
+namespace fram {
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+constexpr uint32_t auto_offset=0xffffffff;              //offset of a variable placed right after the previous one
+
+/**
+A persistent variable
+
+@tparam Tag type naming the variable, only used to look it up
+@tparam T type of the variable, has to be trivially copyable
+@tparam Offset FRAM offset of the variable, auto_offset to place it right after the previous variable
+*/
+template<class Tag, class T, uint32_t Offset=auto_offset>
+struct var {
+    static_assert(std::is_trivially_copyable_v<T>,"persistent variables are copied byte by byte");
+
+    using tag=Tag;
+    using type=T;
+    static constexpr uint32_t requested=Offset;
+    static constexpr uint32_t size=sizeof(T);
+};
+
+/**
+A member of a struct, see FRAM_FIELD
+*/
+template<class Owner, class T, std::size_t Offset>
+struct field {
+    static_assert(std::is_standard_layout_v<Owner>,"offsetof needs a standard layout type");
+
+    using owner=Owner;
+    using type=T;
+    static constexpr uint32_t offset=Offset;
+    static constexpr uint32_t size=sizeof(T);
+};
+
+namespace detail {
+
+//offsets of the variables, auto_offset entries follow the previous variable
+template<std::size_t N>
+constexpr std::array<uint32_t,N> place(uint32_t base, const std::array<uint32_t,N> &requested, const std::array<uint32_t,N> &sizes){
+
+    std::array<uint32_t,N> offsets{};
+
+    for(std::size_t i=0;i<N;i++){
+        offsets[i]=requested[i]==auto_offset?base:requested[i];
+        base=offsets[i]+sizes[i];
+    }
+
+    return offsets;
+}
+
+//true if no two variables share a byte
+template<std::size_t N>
+constexpr bool disjoint(const std::array<uint32_t,N> &offsets, const std::array<uint32_t,N> &sizes){
+
+    for(std::size_t i=0;i<N;i++)
+        for(std::size_t j=i+1;j<N;j++)
+            if(offsets[i]<offsets[j]+sizes[j]&&offsets[j]<offsets[i]+sizes[i])
+                return false;
+
+    return true;
+}
+
+//true if all variables end at or below adr_max
+template<std::size_t N>
+constexpr bool fits(const std::array<uint32_t,N> &offsets, const std::array<uint32_t,N> &sizes, uint32_t adr_max){
+
+    for(std::size_t i=0;i<N;i++)
+        if(offsets[i]>adr_max||sizes[i]-1>adr_max-offsets[i])
+            return false;
+
+    return true;
+}
+
+//index of the only true entry, N if there is none or more than one
+template<std::size_t N>
+constexpr std::size_t unique(const std::array<bool,N> &match){
+
+    std::size_t found=N;
+
+    for(std::size_t i=0;i<N;i++)
+        if(match[i]){
+            if(found!=N)
+                return N;
+            found=i;
+        }
+
+    return found;
+}
+
+} /* namespace detail */
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Layout of persistent variables
+
+@tparam Dev the chip, a fram::Fram
+@tparam Base FRAM offset of the first placed variable
+@tparam Vars the variables, fram::var
+*/
+template<class Dev, uint32_t Base, class... Vars>
+class layout {
+    static constexpr std::size_t count=sizeof...(Vars);
+
+    static constexpr std::array<uint32_t,count> sizes{Vars::size...};
+
+    template<class Tag>
+    static constexpr std::size_t index=detail::unique(std::array<bool,count>{std::is_same_v<Tag,typename Vars::tag>...});
+
+    template<class Tag>
+    using entry=std::tuple_element_t<index<Tag>,std::tuple<Vars...>>;
+
+public:
+    static constexpr std::array<uint32_t,count> offsets=detail::place(Base,std::array<uint32_t,count>{Vars::requested...},sizes);
+
+    static_assert(count>0,"empty layout");
+    static_assert(detail::disjoint(offsets,sizes),"persistent variables overlap");
+    static_assert(detail::fits(offsets,sizes,Dev::adr_max),"persistent variable exceeds the chip");
+
+    /**
+    FRAM offset of a variable
+    */
+    template<class Tag>
+    static constexpr uint32_t offset_of(){
+
+        static_assert(index<Tag><count,"unknown or ambiguous tag");
+        return offsets[index<Tag>];
+    }
+
+    /**
+    Highest FRAM address used by the layout
+    */
+    static constexpr uint32_t end(){
+
+        uint32_t last=0;
+
+        for(std::size_t i=0;i<count;i++)
+            if(offsets[i]+sizes[i]-1>last)
+                last=offsets[i]+sizes[i]-1;
+
+        return last;
+    }
+
+    /**
+    Reads a whole variable
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    template<class Tag>
+    static uint32_t get(Dev &dev, typename entry<Tag>::type &value){
+
+        return dev.template read<offset_of<Tag>(),sizeof(value)>(reinterpret_cast<uint8_t*>(&value));
+    }
+
+    /**
+    Writes a whole variable
+
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    template<class Tag>
+    static uint32_t set(Dev &dev, const typename entry<Tag>::type &value){
+
+        return dev.template write<offset_of<Tag>(),sizeof(value)>(reinterpret_cast<const uint8_t*>(&value));
+    }
+
+    /**
+    Reads one member of a struct variable
+
+    @tparam Field the member, see FRAM_FIELD
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    template<class Tag, class Field>
+    static uint32_t get_field(Dev &dev, typename Field::type &value){
+
+        static_assert(std::is_same_v<typename Field::owner,typename entry<Tag>::type>,"field of another type");
+        return dev.template read<offset_of<Tag>()+Field::offset,Field::size>(reinterpret_cast<uint8_t*>(&value));
+    }
+
+    /**
+    Writes one member of a struct variable, the other members are not touched
+
+    @tparam Field the member, see FRAM_FIELD
+    @return FRAM_NO_ERROR or the output of the I2C module
+    */
+    template<class Tag, class Field>
+    static uint32_t set_field(Dev &dev, const typename Field::type &value){
+
+        static_assert(std::is_same_v<typename Field::owner,typename entry<Tag>::type>,"field of another type");
+        return dev.template write<offset_of<Tag>()+Field::offset,Field::size>(reinterpret_cast<const uint8_t*>(&value));
+    }
+};
+
+} /* namespace fram */
+
+#endif /* (FRAM_PERSIST_HPP) */
+
+/* [] END OF FILE */
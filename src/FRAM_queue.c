@@ -0,0 +1,148 @@
+/**
+ * @file FRAM_queue.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_queue.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_QUEUE_MASK     (FRAM_QUEUE_DEPTH-1u)
+
+#if (FRAM_QUEUE_DEPTH&FRAM_QUEUE_MASK)!=0
+    #error "FRAM_QUEUE_DEPTH has to be a power of two"
+#endif
+
+#if FRAM_QUEUE_SLOT_SIZE>255
+    #error "FRAM_QUEUE_SLOT_SIZE has to fit into the count of a slot"
+#endif
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static void FRAM_queue_fill(FRAM_queue_t * const queue, uint32_t slot, uint32_t adr, const uint8_t * const buffer, uint32_t count);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+void FRAM_queue_init(FRAM_queue_t * const queue, FRAM_t * const fram){
+
+    uint32_t i;
+
+    queue->fram=fram;
+    queue->head=0;
+    queue->tail=0;
+
+    for(i=0;i<FRAM_QUEUE_DEPTH;i++)
+        queue->ready[i]=0;
+
+    queue->stats.pushed=0;
+    queue->stats.overflows=0;
+    queue->stats.written=0;
+    queue->stats.errors=0;
+}
+
+uint32_t FRAM_queue_push(FRAM_queue_t * const queue, uint32_t adr, const uint8_t * const buffer, uint32_t count){
+
+    uint32_t head=queue->head;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||count>FRAM_QUEUE_SLOT_SIZE)
+        return FRAM_PARAMTER_ERROR;
+
+    //the slot is only free again once the consumer moved the tail past it
+    if(head-queue->tail>=FRAM_QUEUE_DEPTH){
+        queue->stats.overflows++;
+        return FRAM_QUEUE_FULL;
+    }
+
+    queue->head=head+1;
+    queue->stats.pushed++;
+
+    FRAM_queue_fill(queue,head&FRAM_QUEUE_MASK,adr,buffer,count);
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_queue_push_mp(FRAM_queue_t * const queue, uint32_t adr, const uint8_t * const buffer, uint32_t count){
+
+    uint32_t head;
+    uint8_t state;
+
+    //check if parameters are valid
+    if(buffer==NULL||count==0||count>FRAM_QUEUE_SLOT_SIZE)
+        return FRAM_PARAMTER_ERROR;
+
+    //claim the slot, the Cortex-M0 has no exclusive access instructions so a short critical section is used instead
+    state=CyEnterCriticalSection();
+
+    head=queue->head;
+    if(head-queue->tail>=FRAM_QUEUE_DEPTH){
+        queue->stats.overflows++;
+        CyExitCriticalSection(state);
+        return FRAM_QUEUE_FULL;
+    }
+    queue->head=head+1;
+    queue->stats.pushed++;
+
+    CyExitCriticalSection(state);
+
+    //other producers can claim the next slots while this one is copied
+    FRAM_queue_fill(queue,head&FRAM_QUEUE_MASK,adr,buffer,count);
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_queue_drain(FRAM_queue_t * const queue, uint32_t max){
+
+    uint32_t i2c_result;
+    uint32_t slot;
+
+    while(max-->0&&queue->tail!=queue->head){
+
+        slot=queue->tail&FRAM_QUEUE_MASK;
+
+        //the producer is still copying the record
+        if(!queue->ready[slot])
+            break;
+
+        i2c_result=FRAM_write_to_adr(queue->fram,queue->adr[slot],queue->data[slot],queue->count[slot]);
+        if(i2c_result!=FRAM_NO_ERROR){
+            queue->stats.errors++;
+            return i2c_result;
+        }
+
+        queue->stats.written++;
+
+        //hand the slot back to the producers
+        queue->ready[slot]=0;
+        __DMB();
+        queue->tail++;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_queue_pending(const FRAM_queue_t * const queue){return queue->head-queue->tail;}
+
+const FRAM_queue_stats_t* FRAM_queue_get_stats(const FRAM_queue_t * const queue){return &queue->stats;}
+
+static void FRAM_queue_fill(FRAM_queue_t * const queue, uint32_t slot, uint32_t adr, const uint8_t * const buffer, uint32_t count){
+
+    queue->adr[slot]=adr;
+    queue->count[slot]=count;
+    memcpy(queue->data[slot],buffer,count);
+
+    //publish the slot only after its content is visible to the consumer
+    __DMB();
+    queue->ready[slot]=1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,154 @@
+/**
+ * @file FRAM_queue.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Submission queue for FRAM writes from interrupt handlers.
+ * An interrupt handler can not wait for an I2C transfer, so it copies the data into a preallocated slot of the queue instead and returns.
+ * A worker task or the main loop later writes the queued records to the FRAM with "FRAM_queue_drain".
+ * "FRAM_queue_push" does without any lock if only one context pushes, "FRAM_queue_push_mp" allows any number of interrupt handlers and tasks to push.
+ */
+
+#if !defined(FRAM_QUEUE_H)
+#define FRAM_QUEUE_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_QUEUE_DEPTH        16u                     //number of slots of a queue, has to be a power of two
+#define FRAM_QUEUE_SLOT_SIZE    32u                     //highest number of bytes of one queued write
+
+#define FRAM_QUEUE_FULL         0x1000u                 //indicates that a record was dropped because all slots of the queue were in use
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a queue
+*/
+typedef struct {
+    uint32_t    pushed;                                 //number of records queued
+    uint32_t    overflows;                              //number of records dropped because the queue was full
+    uint32_t    written;                                //number of records written to the FRAM
+    uint32_t    errors;                                 //number of failed writes, the record is retried by the next drain
+} FRAM_queue_stats_t;
+
+/**
+A queue of FRAM writes
+
+Initialise it with "FRAM_queue_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip the records are written to
+    volatile uint32_t head;                             //next slot to be claimed by a producer
+    volatile uint32_t tail;                             //next slot to be written by the consumer
+    volatile uint8_t  ready[FRAM_QUEUE_DEPTH];          //set by the producer once the slot is filled, cleared by the consumer once it is written
+    uint32_t    adr[FRAM_QUEUE_DEPTH];                  //address of the record in the slot
+    uint8_t     count[FRAM_QUEUE_DEPTH];                //number of bytes of the record in the slot
+    uint8_t     data[FRAM_QUEUE_DEPTH][FRAM_QUEUE_SLOT_SIZE];
+    FRAM_queue_stats_t stats;
+} FRAM_queue_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a queue
+
+@param queue the queue to be initialised
+@param fram the chip the records are written to
+@return void
+*/
+void        FRAM_queue_init(FRAM_queue_t * const queue, FRAM_t * const fram);
+
+/**
+Queue a write, single producer
+
+Copies the data into the next free slot. Safe to call from an interrupt handler without any lock,
+as long as no other context pushes to the same queue at the same time.
+
+@param queue the queue
+@param adr address to be written
+@param buffer pointer to the data to be written, it can be reused as soon as the function returned
+@param count number of bytes to be written
+@return FRAM_PARAMTER_ERROR if either the buffer points to NULL, the count is 0 or bigger than FRAM_QUEUE_SLOT_SIZE
+        FRAM_QUEUE_FULL if all slots are in use, the record is dropped
+        FRAM_NO_ERROR if the record was queued
+*/
+uint32_t    FRAM_queue_push(FRAM_queue_t * const queue, uint32_t adr, const uint8_t * const buffer, uint32_t count);
+
+/**
+Queue a write, multiple producers
+
+Same as "FRAM_queue_push", but any number of interrupt handlers and tasks may push to the same queue.
+Claiming the slot takes a critical section of a few instructions, the data is copied outside of it.
+
+@param queue the queue
+@param adr address to be written
+@param buffer pointer to the data to be written, it can be reused as soon as the function returned
+@param count number of bytes to be written
+@return see "FRAM_queue_push"
+*/
+uint32_t    FRAM_queue_push_mp(FRAM_queue_t * const queue, uint32_t adr, const uint8_t * const buffer, uint32_t count);
+
+/**
+Write queued records to the FRAM
+
+Writes the queued records in the order they were claimed, using "FRAM_write_to_adr". Call it from one worker task or the main loop only.
+A record claimed by a producer that did not finish copying yet stops the drain, it is written by the next call.
+
+@param queue the queue
+@param max highest number of records to be written by this call
+@return FRAM_NO_ERROR if the records were written or the queue is empty
+        any other value is the output of "FRAM_write_to_adr". The failed record stays in the queue.
+*/
+uint32_t    FRAM_queue_drain(FRAM_queue_t * const queue, uint32_t max);
+
+/**
+Get the number of queued records
+
+@param queue the queue
+@return the number of claimed slots that were not written yet
+*/
+uint32_t    FRAM_queue_pending(const FRAM_queue_t * const queue);
+
+/**
+Get the statistics of a queue
+
+@param queue the queue
+@return the statistics collected since "FRAM_queue_init"
+*/
+const FRAM_queue_stats_t* FRAM_queue_get_stats(const FRAM_queue_t * const queue);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_QUEUE_H) */
+
+/* [] END OF FILE */
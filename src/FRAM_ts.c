@@ -0,0 +1,464 @@
+/**
+ * @file FRAM_ts.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_ts.h"
+#include "FRAM_chk.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+
+#define FRAM_TS_SEQ_OFFSET      0u                      //offsets in the block header
+#define FRAM_TS_TIME_OFFSET     4u
+#define FRAM_TS_VALUE_OFFSET    8u
+#define FRAM_TS_LAST_OFFSET     12u
+#define FRAM_TS_COUNT_OFFSET    16u
+#define FRAM_TS_LENGTH_OFFSET   18u
+#define FRAM_TS_CRC_OFFSET      20u                     //the CRC covers the header in front of it and the payload
+
+#define FRAM_TS_SAMPLE_MAX      10u                     //highest number of bytes of an encoded sample, two varints of 5 bytes
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_ts_check(FRAM_ts_t * const ts, uint32_t block, uint8_t * const data, uint8_t * const valid);
+static uint32_t FRAM_ts_block(const FRAM_ts_t * const ts, uint32_t seq);
+static uint8_t  FRAM_ts_put_varint(uint8_t * const out, uint32_t value);
+static uint32_t FRAM_ts_get_varint(const uint8_t * const in, uint16_t * const pos);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_ts_init(FRAM_ts_t * const ts, FRAM_t * const fram, uint32_t base, uint32_t size){
+
+    //check if parameters are valid
+    if(size<2*FRAM_TS_BLOCK_SIZE||size%FRAM_TS_BLOCK_SIZE!=0||base>fram->adr_max||size-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    ts->fram=fram;
+    ts->base=base;
+    ts->blocks=size/FRAM_TS_BLOCK_SIZE;
+    ts->first=0;
+    ts->used=0;
+    ts->seq=0;
+    ts->last_time=0;
+    ts->last_value=0;
+    ts->count=0;
+    ts->length=0;
+
+    ts->stats.samples=0;
+    ts->stats.blocks=0;
+    ts->stats.bytes=0;
+    ts->stats.corrupt=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ts_format(FRAM_ts_t * const ts){
+
+    uint32_t result;
+    uint32_t i;
+
+    //a cleared header holds no sample
+    memset(ts->block,0,FRAM_TS_HEADER_SIZE);
+
+    for(i=0;i<ts->blocks;i++){
+        result=FRAM_write_to_adr(ts->fram,ts->base+i*FRAM_TS_BLOCK_SIZE,ts->block,FRAM_TS_HEADER_SIZE);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    ts->first=0;
+    ts->used=0;
+    ts->seq=0;
+    ts->last_time=0;
+    ts->count=0;
+    ts->length=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ts_mount(FRAM_ts_t * const ts){
+
+    uint32_t result;
+    uint32_t lo=0;
+    uint32_t hi=ts->blocks-1;
+    uint32_t mid;
+    uint32_t first_seq;
+    uint32_t seq;
+    uint8_t valid;
+
+    ts->count=0;
+    ts->length=0;
+
+    result=FRAM_ts_check(ts,0,ts->block,&valid);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(valid){
+
+        //blocks written after block 0 in this lap follow its sequence number, all further blocks are older, empty or torn
+        first_seq=FRAM_load32(&ts->block[FRAM_TS_SEQ_OFFSET]);
+
+        while(lo<hi){
+
+            mid=lo+(hi-lo+1)/2;
+
+            result=FRAM_ts_check(ts,mid,ts->block,&valid);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+
+            if(valid&&FRAM_load32(&ts->block[FRAM_TS_SEQ_OFFSET])==first_seq+mid)
+                lo=mid;
+            else
+                hi=mid-1;
+        }
+    }
+    else{
+
+        //block 0 is empty or was torn while the ring wrapped around, then the last block is the newest one
+        lo=ts->blocks-1;
+    }
+
+    result=FRAM_ts_check(ts,lo,ts->block,&valid);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(!valid){
+        ts->first=0;
+        ts->used=0;
+        ts->seq=0;
+        ts->last_time=0;
+        return FRAM_NO_ERROR;
+    }
+
+    seq=FRAM_load32(&ts->block[FRAM_TS_SEQ_OFFSET]);
+    ts->seq=seq+1;
+    ts->last_time=FRAM_load32(&ts->block[FRAM_TS_LAST_OFFSET]);
+
+    //the oldest block is the next one of the previous lap, the one behind it if the next one was torn
+    result=FRAM_ts_check(ts,(lo+1)%ts->blocks,ts->block,&valid);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(valid&&FRAM_load32(&ts->block[FRAM_TS_SEQ_OFFSET])==seq+1-ts->blocks){
+        ts->first=(lo+1)%ts->blocks;
+        ts->used=ts->blocks;
+        return FRAM_NO_ERROR;
+    }
+
+    result=FRAM_ts_check(ts,(lo+2)%ts->blocks,ts->block,&valid);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(valid&&FRAM_load32(&ts->block[FRAM_TS_SEQ_OFFSET])==seq+2-ts->blocks){
+        ts->first=(lo+2)%ts->blocks;
+        ts->used=ts->blocks-1;
+    }
+    else{
+        ts->first=0;
+        ts->used=lo+1;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ts_append(FRAM_ts_t * const ts, uint32_t time, int32_t value){
+
+    uint8_t sample[FRAM_TS_SAMPLE_MAX];
+    uint32_t result;
+    uint32_t delta;
+    uint8_t length;
+
+    //check if parameters are valid
+    if((ts->used>0||ts->count>0)&&time<ts->last_time)
+        return FRAM_PARAMTER_ERROR;
+
+    if(ts->count>0){
+
+        //the difference of the values is zigzag encoded, so small negative differences take few bytes as well
+        delta=(uint32_t)value-(uint32_t)ts->last_value;
+        length=FRAM_ts_put_varint(sample,time-ts->last_time);
+        length+=FRAM_ts_put_varint(&sample[length],delta<<1^(uint32_t)-(int32_t)(delta>>31));
+
+        if(ts->length+length>FRAM_TS_PAYLOAD_MAX||ts->count==0xffffu){
+            result=FRAM_ts_flush(ts);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+        }
+        else{
+            memcpy(&ts->block[FRAM_TS_HEADER_SIZE+ts->length],sample,length);
+            ts->length+=length;
+        }
+    }
+
+    //the first sample of a block goes to its header
+    if(ts->count==0){
+        ts->first_time=time;
+        ts->first_value=value;
+    }
+
+    ts->count++;
+    ts->last_time=time;
+    ts->last_value=value;
+    ts->stats.samples++;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ts_flush(FRAM_ts_t * const ts){
+
+    uint32_t result;
+    uint16_t crc;
+
+    if(ts->count==0)
+        return FRAM_NO_ERROR;
+
+    //the block holding the oldest samples is dropped before it is overwritten
+    if(ts->used==ts->blocks){
+        ts->first=(ts->first+1)%ts->blocks;
+        ts->used--;
+    }
+
+    FRAM_store32(&ts->block[FRAM_TS_SEQ_OFFSET],ts->seq);
+    FRAM_store32(&ts->block[FRAM_TS_TIME_OFFSET],ts->first_time);
+    FRAM_store32(&ts->block[FRAM_TS_VALUE_OFFSET],(uint32_t)ts->first_value);
+    FRAM_store32(&ts->block[FRAM_TS_LAST_OFFSET],ts->last_time);
+    FRAM_store16(&ts->block[FRAM_TS_COUNT_OFFSET],ts->count);
+    FRAM_store16(&ts->block[FRAM_TS_LENGTH_OFFSET],ts->length);
+    FRAM_store16(&ts->block[FRAM_TS_CRC_OFFSET+2],0);
+
+    crc=FRAM_chk_crc(FRAM_CHK_CRC_INIT,ts->block,FRAM_TS_CRC_OFFSET);
+    crc=FRAM_chk_crc(crc,&ts->block[FRAM_TS_HEADER_SIZE],ts->length);
+    FRAM_store16(&ts->block[FRAM_TS_CRC_OFFSET],crc);
+
+    result=FRAM_write_to_adr(ts->fram,ts->base+(ts->first+ts->used)%ts->blocks*FRAM_TS_BLOCK_SIZE,ts->block,FRAM_TS_HEADER_SIZE+ts->length);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    ts->stats.blocks++;
+    ts->stats.bytes+=FRAM_TS_HEADER_SIZE+ts->length;
+
+    ts->used++;
+    ts->seq++;
+    ts->count=0;
+    ts->length=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ts_seek(FRAM_ts_t * const ts, FRAM_ts_cursor_t * const cursor, uint32_t time){
+
+    uint32_t result;
+    uint32_t lo=0;
+    uint32_t hi;
+    uint32_t mid;
+    uint32_t sample_time;
+    int32_t sample_value;
+
+    cursor->index=0;
+    cursor->pos=0;
+    cursor->count=0;
+    cursor->pending=0;
+
+    //samples of the same time may end the previous block, so the search looks for the last block starting before the time
+    if(ts->used==0||(ts->count>0&&ts->first_time<time))
+        cursor->seq=ts->seq;
+    else{
+
+        hi=ts->used-1;
+
+        while(lo<hi){
+
+            mid=lo+(hi-lo+1)/2;
+
+            result=FRAM_read_from_adr(ts->fram,ts->base+FRAM_ts_block(ts,ts->seq-ts->used+mid)*FRAM_TS_BLOCK_SIZE,cursor->data,FRAM_TS_HEADER_SIZE);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+
+            if(FRAM_load32(&cursor->data[FRAM_TS_TIME_OFFSET])<time)
+                lo=mid;
+            else
+                hi=mid-1;
+        }
+
+        cursor->seq=ts->seq-ts->used+lo;
+    }
+
+    //skip the older samples of the block, the first sample found is returned again by "FRAM_ts_next"
+    do{
+        result=FRAM_ts_next(ts,cursor,&sample_time,&sample_value);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }while(sample_time<time);
+
+    cursor->pending=1;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_ts_next(FRAM_ts_t * const ts, FRAM_ts_cursor_t * const cursor, uint32_t * const time, int32_t * const value){
+
+    const uint8_t *block;
+    uint32_t result;
+    uint32_t delta;
+    uint16_t count;
+    uint8_t valid;
+
+    if(cursor->pending){
+        cursor->pending=0;
+        *time=cursor->time;
+        *value=cursor->value;
+        return FRAM_NO_ERROR;
+    }
+
+    for(;;){
+
+        //the block of the cursor was dropped, continue with the oldest one
+        if((int32_t)(cursor->seq-(ts->seq-ts->used))<0){
+            cursor->seq=ts->seq-ts->used;
+            cursor->index=0;
+            cursor->pos=0;
+            cursor->count=0;
+        }
+
+        if(cursor->seq==ts->seq){
+
+            //the block in SRAM only grows, so the position stays valid
+            block=ts->block;
+            count=ts->count;
+        }
+        else{
+
+            if(cursor->count==0){
+
+                result=FRAM_ts_check(ts,FRAM_ts_block(ts,cursor->seq),cursor->data,&valid);
+                if(result!=FRAM_NO_ERROR)
+                    return result;
+
+                if(!valid||FRAM_load32(&cursor->data[FRAM_TS_SEQ_OFFSET])!=cursor->seq){
+                    ts->stats.corrupt++;
+                    cursor->seq++;
+                    cursor->index=0;
+                    cursor->pos=0;
+                    continue;
+                }
+
+                cursor->count=FRAM_load16(&cursor->data[FRAM_TS_COUNT_OFFSET]);
+            }
+
+            block=cursor->data;
+            count=cursor->count;
+        }
+
+        if(cursor->index<count)
+            break;
+
+        if(cursor->seq==ts->seq)
+            return FRAM_TS_END;
+
+        cursor->seq++;
+        cursor->index=0;
+        cursor->pos=0;
+        cursor->count=0;
+    }
+
+    if(cursor->index==0&&block==ts->block){
+        cursor->time=ts->first_time;
+        cursor->value=ts->first_value;
+    }
+    else if(cursor->index==0){
+        cursor->time=FRAM_load32(&block[FRAM_TS_TIME_OFFSET]);
+        cursor->value=(int32_t)FRAM_load32(&block[FRAM_TS_VALUE_OFFSET]);
+    }
+    else{
+        cursor->time+=FRAM_ts_get_varint(&block[FRAM_TS_HEADER_SIZE],&cursor->pos);
+        delta=FRAM_ts_get_varint(&block[FRAM_TS_HEADER_SIZE],&cursor->pos);
+        cursor->value=(int32_t)((uint32_t)cursor->value+(delta>>1^(uint32_t)-(int32_t)(delta&1)));
+    }
+
+    cursor->index++;
+
+    *time=cursor->time;
+    *value=cursor->value;
+
+    return FRAM_NO_ERROR;
+}
+
+const FRAM_ts_stats_t* FRAM_ts_get_stats(const FRAM_ts_t * const ts){return &ts->stats;}
+
+static uint32_t FRAM_ts_check(FRAM_ts_t * const ts, uint32_t block, uint8_t * const data, uint8_t * const valid){
+
+    uint32_t result;
+    uint16_t count;
+    uint16_t length;
+    uint16_t crc;
+
+    *valid=0;
+
+    result=FRAM_read_from_adr(ts->fram,ts->base+block*FRAM_TS_BLOCK_SIZE,data,FRAM_TS_HEADER_SIZE);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    count=FRAM_load16(&data[FRAM_TS_COUNT_OFFSET]);
+    length=FRAM_load16(&data[FRAM_TS_LENGTH_OFFSET]);
+
+    //a cleared header holds no sample
+    if(count==0||length>FRAM_TS_PAYLOAD_MAX)
+        return FRAM_NO_ERROR;
+
+    //the payload follows the header, so the read hits the address latch
+    if(length>0){
+        result=FRAM_read_from_adr(ts->fram,ts->base+block*FRAM_TS_BLOCK_SIZE+FRAM_TS_HEADER_SIZE,&data[FRAM_TS_HEADER_SIZE],length);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    crc=FRAM_chk_crc(FRAM_CHK_CRC_INIT,data,FRAM_TS_CRC_OFFSET);
+    crc=FRAM_chk_crc(crc,&data[FRAM_TS_HEADER_SIZE],length);
+
+    *valid=crc==FRAM_load16(&data[FRAM_TS_CRC_OFFSET]);
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_ts_block(const FRAM_ts_t * const ts, uint32_t seq){return (ts->first+(seq-(ts->seq-ts->used)))%ts->blocks;}
+
+static uint8_t FRAM_ts_put_varint(uint8_t * const out, uint32_t value){
+
+    uint8_t length=0;
+
+    //7 bits per byte, the lowest bits first, the top bit marks a following byte
+    while(value>=0x80u){
+        out[length++]=(uint8_t)(value|0x80u);
+        value>>=7;
+    }
+    out[length++]=(uint8_t)value;
+
+    return length;
+}
+
+static uint32_t FRAM_ts_get_varint(const uint8_t * const in, uint16_t * const pos){
+
+    uint32_t value=0;
+    uint8_t shift=0;
+    uint8_t data;
+
+    do{
+        data=in[(*pos)++];
+        value|=(uint32_t)(data&0x7fu)<<shift;
+        shift+=7;
+    }while((data&0x80u)&&shift<35);
+
+    return value;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,212 @@
+/**
+ * @file FRAM_ts.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Time series of 32 bit samples in a ring of blocks in a region of a FRAM chip, e.g. sensor values changing by a few counts per tick.
+ * A block starts with a header holding a sequence number, time and value of its first sample, the time of its last sample,
+ * the number of samples and a CRC. Every further sample is stored as the difference to the previous one:
+ * the time difference as varint, the value difference zigzag encoded as varint. A sample taken every tick and changing by less than 64 counts takes two bytes.
+ *
+ * Samples are collected in a block in SRAM, which is written with a single transfer when it is full or "FRAM_ts_flush" is called.
+ * Samples not flushed are lost by a reset. When the ring wraps around, the oldest block is dropped.
+ * "FRAM_ts_mount" finds the newest block with a binary search over the sequence numbers, "FRAM_ts_seek" finds a time with a binary search over the block headers.
+ *
+ * A time series is used by one task at a time, the functions do not lock the time series itself.
+ */
+
+#if !defined(FRAM_TS_H)
+#define FRAM_TS_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_TS_BLOCK_SIZE      256u                    //size of a block, the region of a time series is a multiple of it
+#define FRAM_TS_HEADER_SIZE     24u                     //bytes of the block header: sequence number (4), first time (4), first value (4), last time (4), samples (2), payload length (2), CRC (2), reserved (2)
+#define FRAM_TS_PAYLOAD_MAX     (FRAM_TS_BLOCK_SIZE-FRAM_TS_HEADER_SIZE)  //bytes of the encoded samples of a block
+
+#define FRAM_TS_END             0x400000u               //indicates that there is no further sample
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a time series
+*/
+typedef struct {
+    uint32_t    samples;                                //number of appended samples
+    uint32_t    blocks;                                 //number of written blocks
+    uint32_t    bytes;                                  //number of bytes written to the chip, 8 per sample without encoding
+    uint32_t    corrupt;                                //number of blocks skipped by a cursor due to a CRC mismatch
+} FRAM_ts_stats_t;
+
+/**
+A time series
+
+Initialise it with "FRAM_ts_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the time series
+    uint32_t    base;                                   //address of the region
+    uint32_t    blocks;                                 //number of blocks of the region
+    uint32_t    first;                                  //block holding the oldest samples
+    uint32_t    used;                                   //number of written blocks
+    uint32_t    seq;                                    //sequence number of the block in SRAM
+    uint32_t    first_time;                             //time of the first sample of the block in SRAM
+    int32_t     first_value;                            //value of the first sample of the block in SRAM
+    uint32_t    last_time;                              //time of the newest sample
+    int32_t     last_value;                             //value of the newest sample
+    uint16_t    count;                                  //number of samples of the block in SRAM
+    uint16_t    length;                                 //bytes of the encoded samples of the block in SRAM
+    uint8_t     block[FRAM_TS_BLOCK_SIZE];              //block in SRAM
+    FRAM_ts_stats_t stats;
+} FRAM_ts_t;
+
+/**
+Position in a time series
+*/
+typedef struct {
+    uint32_t    seq;                                    //sequence number of the block
+    uint32_t    time;                                   //time of the last sample read
+    int32_t     value;                                  //value of the last sample read
+    uint16_t    index;                                  //number of samples of the block read
+    uint16_t    pos;                                    //offset of the next sample in the payload
+    uint16_t    count;                                  //number of samples of the loaded block, 0 if no block is loaded
+    uint8_t     pending;                                //the last sample read is returned again by "FRAM_ts_next"
+    uint8_t     data[FRAM_TS_BLOCK_SIZE];               //loaded block
+} FRAM_ts_cursor_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a time series
+
+Does not access the chip. Call "FRAM_ts_format" to start an empty time series or "FRAM_ts_mount" to use the time series found in the region.
+
+@param ts the time series to be initialised
+@param fram the chip holding the time series
+@param base address of the region
+@param size size of the region, a multiple of FRAM_TS_BLOCK_SIZE and at least two blocks
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip or the size is invalid
+        FRAM_NO_ERROR if the time series was initialised
+*/
+uint32_t    FRAM_ts_init(FRAM_ts_t * const ts, FRAM_t * const fram, uint32_t base, uint32_t size);
+
+/**
+Start an empty time series
+
+Clears the header of every block.
+
+@param ts the time series
+@return FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_ts_format(FRAM_ts_t * const ts);
+
+/**
+Use the time series found in the region
+
+Finds the newest block with a binary search, every step costs one read of a block.
+
+@param ts the time series
+@return FRAM_NO_ERROR if the time series can be used, also if it is empty
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_ts_mount(FRAM_ts_t * const ts);
+
+/**
+Append a sample
+
+Does not access the chip unless the block in SRAM is full and written.
+
+@param ts the time series
+@param time time of the sample, not lower than the time of the newest sample
+@param value value of the sample
+@return FRAM_PARAMTER_ERROR if the time is lower than the time of the newest sample
+        FRAM_NO_ERROR if the sample was appended
+        any other value see "FRAM_ts_flush", the sample was not appended
+*/
+uint32_t    FRAM_ts_append(FRAM_ts_t * const ts, uint32_t time, int32_t value);
+
+/**
+Write the block in SRAM
+
+Costs one write of header and encoded samples. The next sample starts a new block, so flushing often wastes space.
+
+@param ts the time series
+@return FRAM_NO_ERROR if the operation succeeded, also if there was no sample to write
+        any other value is the output of "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_ts_flush(FRAM_ts_t * const ts);
+
+/**
+Position a cursor at the first sample not older than a time
+
+Costs a binary search over the block headers and one read of the block found.
+
+@param ts the time series
+@param cursor the cursor
+@param time the time
+@return FRAM_TS_END if there is no such sample
+        FRAM_NO_ERROR if the cursor points to a sample
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_ts_seek(FRAM_ts_t * const ts, FRAM_ts_cursor_t * const cursor, uint32_t time);
+
+/**
+Read the sample at a cursor and move the cursor to the next sample
+
+Costs one read of a block whenever the cursor enters a block written to the chip. Blocks failing their CRC are skipped.
+Samples appended after the cursor was positioned are read as well.
+
+@param ts the time series
+@param cursor the cursor, see "FRAM_ts_seek"
+@param time the time of the sample is stored here
+@param value the value of the sample is stored here
+@return FRAM_TS_END if there is no further sample, the cursor can be used again after more samples were appended
+        FRAM_NO_ERROR if the sample was read
+        any other value is the output of "FRAM_read_from_adr"
+*/
+uint32_t    FRAM_ts_next(FRAM_ts_t * const ts, FRAM_ts_cursor_t * const cursor, uint32_t * const time, int32_t * const value);
+
+/**
+Get the statistics of a time series
+
+@param ts the time series
+@return the statistics collected since "FRAM_ts_init"
+*/
+const FRAM_ts_stats_t* FRAM_ts_get_stats(const FRAM_ts_t * const ts);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_TS_H) */
+
+/* [] END OF FILE */
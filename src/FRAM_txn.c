@@ -0,0 +1,324 @@
+/**
+ * @file FRAM_txn.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <project.h>
+#include <string.h>
+#include "FRAM_txn.h"
+#include "FRAM_chk.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_TXN_MAGIC          0x31585446u             //"FTX1"
+#define FRAM_TXN_MARKER         12u                     //magic (4), end of the journal (4), CRC of the journal (2), CRC of the marker (2)
+#define FRAM_TXN_JOURNAL_CRC    8u                      //offset of the CRC of the journal in the marker
+#define FRAM_TXN_MARKER_CRC     10u                     //offset of the CRC of the marker, it covers the bytes in front of it
+#define FRAM_TXN_RANGE_HEADER   6u                      //address (4), length (2)
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t FRAM_txn_check(FRAM_txn_t * const txn, uint32_t end, uint16_t * const crc);
+static uint32_t FRAM_txn_apply(FRAM_txn_t * const txn, uint32_t end, uint32_t * const ranges);
+static void     FRAM_txn_reset(FRAM_txn_t * const txn);
+static uint8_t  FRAM_txn_valid(const FRAM_txn_t * const txn, uint32_t adr, uint32_t count);
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+uint32_t FRAM_txn_init(FRAM_txn_t * const txn, FRAM_t * const fram, uint32_t base, uint32_t size){
+
+    //check if parameters are valid
+    if(size<FRAM_TXN_MARKER+2*(FRAM_TXN_RANGE_HEADER+FRAM_TXN_COPY)||base>fram->adr_max||size-1>fram->adr_max-base)
+        return FRAM_PARAMTER_ERROR;
+
+    txn->fram=fram;
+    txn->base=base;
+    txn->size=size;
+
+    FRAM_txn_reset(txn);
+
+    txn->stats.commits=0;
+    txn->stats.aborts=0;
+    txn->stats.flushes=0;
+    txn->stats.journaled=0;
+    txn->stats.replayed=0;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_txn_recover(FRAM_txn_t * const txn){
+
+    uint8_t marker[FRAM_TXN_MARKER];
+    uint32_t result;
+    uint32_t end;
+    uint16_t crc;
+
+    FRAM_txn_reset(txn);
+
+    result=FRAM_read_from_adr(txn->fram,txn->base,marker,FRAM_TXN_MARKER);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    if(FRAM_load32(marker)!=FRAM_TXN_MAGIC)
+        return FRAM_NO_ERROR;
+
+    end=FRAM_load32(marker+4);
+
+    //an interrupted marker write fails the CRC of the marker, the transactions were not committed
+    if(FRAM_chk_crc(FRAM_CHK_CRC_INIT,marker,FRAM_TXN_MARKER_CRC)==FRAM_load16(marker+FRAM_TXN_MARKER_CRC)&&end>=FRAM_TXN_MARKER&&end<=txn->size){
+
+        //a marker left behind by an interrupted clear does not match the journal written after it
+        result=FRAM_txn_check(txn,end,&crc);
+        if(result!=FRAM_NO_ERROR&&result!=FRAM_PARAMTER_ERROR)
+            return result;
+
+        if(result==FRAM_NO_ERROR&&crc==FRAM_load16(marker+FRAM_TXN_JOURNAL_CRC)){
+            result=FRAM_txn_apply(txn,end,&txn->stats.replayed);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+        }
+    }
+
+    //the whole marker is cleared, see "FRAM_txn_flush"
+    memset(marker,0,FRAM_TXN_MARKER);
+
+    return FRAM_write_to_adr(txn->fram,txn->base,marker,FRAM_TXN_MARKER);
+}
+
+uint32_t FRAM_txn_begin(FRAM_txn_t * const txn){
+
+    uint32_t result;
+
+    //check if parameters are valid
+    if(txn->open!=FRAM_INVALID_ADR)
+        return FRAM_PARAMTER_ERROR;
+
+    //the other half of the journal is left to the new transaction
+    if(txn->tail-FRAM_TXN_MARKER>(txn->size-FRAM_TXN_MARKER)/2){
+        result=FRAM_txn_flush(txn);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+    }
+
+    txn->open=txn->tail;
+    txn->open_crc=txn->crc;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_txn_write(FRAM_txn_t * const txn, uint32_t adr, const uint8_t * const buffer, uint32_t count){
+
+    FRAM_part_t parts[2];
+    uint8_t header[FRAM_TXN_RANGE_HEADER];
+    uint32_t result;
+
+    //check if parameters are valid
+    if(txn->open==FRAM_INVALID_ADR||buffer==NULL||count>0xffffu||!FRAM_txn_valid(txn,adr,count))
+        return FRAM_PARAMTER_ERROR;
+
+    if(FRAM_TXN_RANGE_HEADER+count>txn->size-txn->tail)
+        return FRAM_MEMORY_ERROR;
+
+    FRAM_store32(header,adr);
+    FRAM_store16(header+4,(uint16_t)count);
+
+    parts[0].buffer=header;
+    parts[0].count=FRAM_TXN_RANGE_HEADER;
+    parts[1].buffer=buffer;
+    parts[1].count=count;
+
+    result=FRAM_write_parts_to_adr(txn->fram,txn->base+txn->tail,parts,2);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    txn->crc=FRAM_chk_crc(txn->crc,header,FRAM_TXN_RANGE_HEADER);
+    txn->crc=FRAM_chk_crc(txn->crc,buffer,count);
+    txn->tail+=FRAM_TXN_RANGE_HEADER+count;
+    txn->stats.journaled+=FRAM_TXN_RANGE_HEADER+count;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_txn_commit(FRAM_txn_t * const txn, FRAM_wait_t wait){
+
+    //check if parameters are valid
+    if(txn->open==FRAM_INVALID_ADR)
+        return FRAM_PARAMTER_ERROR;
+
+    //an empty transaction has nothing to apply
+    if(txn->tail!=txn->open)
+        txn->pending++;
+
+    txn->open=FRAM_INVALID_ADR;
+    txn->stats.commits++;
+
+    if(wait==FRAM_WAIT||txn->pending>=FRAM_TXN_GROUP)
+        return FRAM_txn_flush(txn);
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_txn_abort(FRAM_txn_t * const txn){
+
+    //check if parameters are valid
+    if(txn->open==FRAM_INVALID_ADR)
+        return FRAM_PARAMTER_ERROR;
+
+    //the ranges of the transaction are left in the journal behind its end, no marker will cover them
+    txn->tail=txn->open;
+    txn->crc=txn->open_crc;
+    txn->open=FRAM_INVALID_ADR;
+    txn->stats.aborts++;
+
+    return FRAM_NO_ERROR;
+}
+
+uint32_t FRAM_txn_flush(FRAM_txn_t * const txn){
+
+    uint8_t marker[FRAM_TXN_MARKER];
+    uint32_t result;
+    uint32_t ranges=0;
+
+    //check if parameters are valid
+    if(txn->open!=FRAM_INVALID_ADR)
+        return FRAM_PARAMTER_ERROR;
+
+    if(txn->pending==0)
+        return FRAM_NO_ERROR;
+
+    //the transactions are committed by this single write
+    FRAM_store32(marker,FRAM_TXN_MAGIC);
+    FRAM_store32(marker+4,txn->tail);
+    FRAM_store16(marker+FRAM_TXN_JOURNAL_CRC,txn->crc);
+    FRAM_store16(marker+FRAM_TXN_MARKER_CRC,FRAM_chk_crc(FRAM_CHK_CRC_INIT,marker,FRAM_TXN_MARKER_CRC));
+
+    result=FRAM_write_to_adr(txn->fram,txn->base,marker,FRAM_TXN_MARKER);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    txn->stats.flushes++;
+
+    result=FRAM_txn_apply(txn,txn->tail,&ranges);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    //a reset before the marker is cleared only applies the journal once more. The whole marker is cleared, a stale end and CRC
+    //behind the magic would let the next marker torn after its magic commit the part of the next journal matching this one
+    memset(marker,0,FRAM_TXN_MARKER);
+
+    result=FRAM_write_to_adr(txn->fram,txn->base,marker,FRAM_TXN_MARKER);
+    if(result!=FRAM_NO_ERROR)
+        return result;
+
+    FRAM_txn_reset(txn);
+
+    return FRAM_NO_ERROR;
+}
+
+const FRAM_txn_stats_t* FRAM_txn_get_stats(const FRAM_txn_t * const txn){return &txn->stats;}
+
+static uint32_t FRAM_txn_check(FRAM_txn_t * const txn, uint32_t end, uint16_t * const crc){
+
+    uint8_t data[FRAM_TXN_COPY];
+    uint32_t result;
+    uint32_t pos=FRAM_TXN_MARKER;
+    uint32_t count;
+    uint32_t part;
+
+    *crc=FRAM_CHK_CRC_INIT;
+
+    //the journal is read in one pass, every read hits the address latch
+    while(pos<end){
+
+        if(end-pos<FRAM_TXN_RANGE_HEADER)
+            return FRAM_PARAMTER_ERROR;
+
+        result=FRAM_read_from_adr(txn->fram,txn->base+pos,data,FRAM_TXN_RANGE_HEADER);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        *crc=FRAM_chk_crc(*crc,data,FRAM_TXN_RANGE_HEADER);
+        count=FRAM_load16(data+4);
+
+        if(!FRAM_txn_valid(txn,FRAM_load32(data),count)||count>end-pos-FRAM_TXN_RANGE_HEADER)
+            return FRAM_PARAMTER_ERROR;
+
+        for(pos+=FRAM_TXN_RANGE_HEADER;count>0;count-=part,pos+=part){
+
+            part=count<FRAM_TXN_COPY?count:FRAM_TXN_COPY;
+
+            result=FRAM_read_from_adr(txn->fram,txn->base+pos,data,part);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+
+            *crc=FRAM_chk_crc(*crc,data,part);
+        }
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static uint32_t FRAM_txn_apply(FRAM_txn_t * const txn, uint32_t end, uint32_t * const ranges){
+
+    uint8_t data[FRAM_TXN_COPY];
+    uint32_t result;
+    uint32_t pos=FRAM_TXN_MARKER;
+    uint32_t adr;
+    uint32_t count;
+    uint32_t part;
+
+    //the ranges are applied in journal order, so later writes to the same address win
+    while(pos<end){
+
+        result=FRAM_read_from_adr(txn->fram,txn->base+pos,data,FRAM_TXN_RANGE_HEADER);
+        if(result!=FRAM_NO_ERROR)
+            return result;
+
+        adr=FRAM_load32(data);
+        count=FRAM_load16(data+4);
+
+        for(pos+=FRAM_TXN_RANGE_HEADER;count>0;count-=part,pos+=part,adr+=part){
+
+            part=count<FRAM_TXN_COPY?count:FRAM_TXN_COPY;
+
+            result=FRAM_read_from_adr(txn->fram,txn->base+pos,data,part);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+
+            result=FRAM_write_to_adr(txn->fram,adr,data,part);
+            if(result!=FRAM_NO_ERROR)
+                return result;
+        }
+
+        (*ranges)++;
+    }
+
+    return FRAM_NO_ERROR;
+}
+
+static void FRAM_txn_reset(FRAM_txn_t * const txn){
+
+    txn->tail=FRAM_TXN_MARKER;
+    txn->open=FRAM_INVALID_ADR;
+    txn->crc=FRAM_CHK_CRC_INIT;
+    txn->open_crc=FRAM_CHK_CRC_INIT;
+    txn->pending=0;
+}
+
+static uint8_t FRAM_txn_valid(const FRAM_txn_t * const txn, uint32_t adr, uint32_t count){
+
+    //the range has to be inside the chip and outside of the journal
+    if(count==0||adr>txn->fram->adr_max||count-1>txn->fram->adr_max-adr)
+        return 0;
+
+    return adr+count<=txn->base||adr>=txn->base+txn->size;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,189 @@
+/**
+ * @file FRAM_txn.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Transactions over several address ranges of a FRAM chip, backed by a redo journal in a region of the same chip.
+ * The writes of a transaction go to the journal first, every range with one write of its address, length and data.
+ * A flush writes a commit marker holding the length of the journal and a CRC over it, then copies the journaled ranges to their addresses and clears the marker.
+ * A marker interrupted by a reset fails its CRC, so the transactions are either applied completely or not at all.
+ * "FRAM_txn_recover" applies a journal with a valid marker again after a reset.
+ *
+ * Transactions committed with FRAM_DONT_WAIT stay in the journal until the group is flushed, so they share one marker write and one pass over the journal.
+ * Reads and plain writes see a transaction only after it was flushed.
+ *
+ * A journal is used by one task at a time, the functions do not lock the journal itself.
+ */
+
+#if !defined(FRAM_TXN_H)
+#define FRAM_TXN_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define FRAM_TXN_GROUP          8u                      //highest number of transactions committed with FRAM_DONT_WAIT before the group is flushed
+#define FRAM_TXN_COPY           64u                     //bytes copied per transfer from the journal to the addresses of the ranges
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a journal
+*/
+typedef struct {
+    uint32_t    commits;                                //number of committed transactions
+    uint32_t    aborts;                                 //number of aborted transactions
+    uint32_t    flushes;                                //number of marker writes
+    uint32_t    journaled;                              //number of bytes written to the journal
+    uint32_t    replayed;                               //number of ranges applied again by "FRAM_txn_recover"
+} FRAM_txn_stats_t;
+
+/**
+A redo journal
+
+Initialise it with "FRAM_txn_init", the members are private to the driver.
+*/
+typedef struct {
+    FRAM_t      *fram;                                  //chip holding the journal and the ranges
+    uint32_t    base;                                   //address of the region
+    uint32_t    size;                                   //size of the region
+    uint32_t    tail;                                   //offset of the next range from base
+    uint32_t    open;                                   //offset of the first range of the open transaction, FRAM_INVALID_ADR if no transaction is open
+    uint16_t    crc;                                    //CRC of the journal up to tail
+    uint16_t    open_crc;                               //CRC of the journal up to open
+    uint8_t     pending;                                //number of committed transactions not flushed yet
+    FRAM_txn_stats_t stats;
+} FRAM_txn_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+/**
+Initialise a journal
+
+Does not access the chip. Call "FRAM_txn_recover" after a reset before the first transaction.
+
+@param txn the journal to be initialised
+@param fram the chip holding the journal, the ranges of the transactions are on the same chip
+@param base address of the region
+@param size size of the region, a transaction can take up to half of it
+@return FRAM_PARAMTER_ERROR if the region does not fit into the chip or is too small
+        FRAM_NO_ERROR if the journal was initialised
+*/
+uint32_t    FRAM_txn_init(FRAM_txn_t * const txn, FRAM_t * const fram, uint32_t base, uint32_t size);
+
+/**
+Finish the transactions of a journal after a reset
+
+If the journal holds a valid marker, all ranges up to it are written to their addresses again. Then the marker is cleared.
+A transaction without marker is dropped.
+
+@param txn the journal
+@return FRAM_NO_ERROR if the operation succeeded, also if there was nothing to apply
+        any other value is the output of "FRAM_read_from_adr" or "FRAM_write_to_adr"
+*/
+uint32_t    FRAM_txn_recover(FRAM_txn_t * const txn);
+
+/**
+Open a transaction
+
+Flushes the committed transactions first if they take up more than half of the journal.
+
+@param txn the journal
+@return FRAM_PARAMTER_ERROR if a transaction is open
+        FRAM_NO_ERROR if the transaction was opened
+        any other value see "FRAM_txn_flush"
+*/
+uint32_t    FRAM_txn_begin(FRAM_txn_t * const txn);
+
+/**
+Write a range in the open transaction
+
+Costs one write of address, length and data to the journal. The range must not overlap the journal.
+Later ranges of the same or following transactions overwrite earlier ones.
+
+@param txn the journal
+@param adr address of the range
+@param buffer pointer to the data
+@param count length of the range, 1 to 65535
+@return FRAM_PARAMTER_ERROR if no transaction is open, the buffer points to NULL or the range is invalid
+        FRAM_MEMORY_ERROR if the journal is full, abort the transaction
+        FRAM_NO_ERROR if the range was journaled
+        any other value is the output of "FRAM_write_parts_to_adr"
+*/
+uint32_t    FRAM_txn_write(FRAM_txn_t * const txn, uint32_t adr, const uint8_t * const buffer, uint32_t count);
+
+/**
+Commit the open transaction
+
+@param txn the journal
+@param wait FRAM_WAIT flushes the journal, the transaction is applied when the function returns.
+            FRAM_DONT_WAIT leaves the transaction in the journal until FRAM_TXN_GROUP transactions are committed, "FRAM_txn_flush" is called
+            or a transaction is committed with FRAM_WAIT. A reset before drops it.
+@return FRAM_PARAMTER_ERROR if no transaction is open
+        FRAM_NO_ERROR if the transaction was committed
+        any other value see "FRAM_txn_flush"
+*/
+uint32_t    FRAM_txn_commit(FRAM_txn_t * const txn, FRAM_wait_t wait);
+
+/**
+Drop the open transaction
+
+@param txn the journal
+@return FRAM_PARAMTER_ERROR if no transaction is open
+        FRAM_NO_ERROR if the transaction was dropped
+*/
+uint32_t    FRAM_txn_abort(FRAM_txn_t * const txn);
+
+/**
+Apply the committed transactions
+
+Writes the marker, copies the journaled ranges to their addresses and clears the marker. Does nothing if no transaction is pending.
+
+@param txn the journal
+@return FRAM_PARAMTER_ERROR if a transaction is open
+        FRAM_NO_ERROR if the operation succeeded
+        any other value is the output of "FRAM_read_from_adr" or "FRAM_write_to_adr", "FRAM_txn_recover" finishes the transactions
+*/
+uint32_t    FRAM_txn_flush(FRAM_txn_t * const txn);
+
+/**
+Get the statistics of a journal
+
+@param txn the journal
+@return the statistics collected since "FRAM_txn_init"
+*/
+const FRAM_txn_stats_t* FRAM_txn_get_stats(const FRAM_txn_t * const txn);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (FRAM_TXN_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,121 @@
+/**
+ * @file bench_chk.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Host time of "FRAM_chk_crc" against the CRC computed bit by bit, like the modules did before they used it.
+ * Checked region against plain writes and reads of 32 KB: the bytes and transfers on the bus and the time at 400 kHz.
+ * The cost of a write of 8 bytes at a random address, which reads and merges up to two blocks.
+ */
+
+#include <string.h>
+#include <time.h>
+#include "FRAM_chk.h"
+#include "sim.h"
+#include "test.h"
+
+#define BYTES                   0x8000u
+#define CRC_BYTES               0x10000u
+#define CRC_REPEAT              200u
+#define PARTIAL                 1000u                   //number of writes of 8 bytes
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_chk_t chk;
+static uint8_t data[CRC_BYTES];
+static uint8_t buffer[BYTES];
+
+static double seconds(void){
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    return now.tv_sec+now.tv_nsec/1e9;
+}
+
+static uint16_t crc_bitwise(uint16_t crc, const uint8_t * const in, uint32_t count){
+
+    uint32_t i;
+    uint8_t bit;
+
+    for(i=0;i<count;i++){
+        crc^=(uint16_t)in[i]<<8;
+        for(bit=0;bit<8;bit++)
+            crc=crc&0x8000u?(uint16_t)(crc<<1)^0x1021u:(uint16_t)(crc<<1);
+    }
+
+    return crc;
+}
+
+static void report(const char * const name, uint64_t start){
+
+    const FRAM_stats_t * const stats=FRAM_get_stats(&fram);
+
+    printf("  %-11s %6u bytes written %6u read, %4u transfers, %3u address sets, %6.1f ms\n",name,stats->bytes_written,stats->bytes_read,
+           stats->reads+stats->writes+stats->set_adrs,stats->set_adrs,(sim_now()-start)/1e6);
+}
+
+int main(void){
+
+    volatile uint16_t sink;
+    uint64_t start;
+    double host;
+    double bitwise;
+    uint32_t i;
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    for(i=0;i<CRC_BYTES;i++)
+        data[i]=(uint8_t)test_rand();
+
+    host=seconds();
+    for(i=0;i<CRC_REPEAT;i++)
+        sink=crc_bitwise(FRAM_CHK_CRC_INIT,data,CRC_BYTES);
+    bitwise=(seconds()-host)*1e9/CRC_REPEAT/CRC_BYTES;
+
+    host=seconds();
+    for(i=0;i<CRC_REPEAT;i++)
+        sink=FRAM_chk_crc(FRAM_CHK_CRC_INIT,data,CRC_BYTES);
+    (void)sink;
+    printf("CRC: %.2f ns/B with the table, %.2f ns/B bit by bit\n",(seconds()-host)*1e9/CRC_REPEAT/CRC_BYTES,bitwise);
+
+    printf("%u bytes\n",BYTES);
+    CHECK_EQ(FRAM_chk_init(&chk,&fram,0x10000,BYTES/FRAM_CHK_BLOCK_SIZE*FRAM_CHK_SLOT_SIZE),FRAM_NO_ERROR);
+
+    FRAM_clear_stats(&fram);
+    start=sim_now();
+    CHECK_EQ(FRAM_write_to_adr(&fram,0,data,BYTES),FRAM_NO_ERROR);
+    report("plain write",start);
+
+    FRAM_clear_stats(&fram);
+    start=sim_now();
+    CHECK_EQ(FRAM_chk_write_to_adr(&chk,0,data,BYTES),FRAM_NO_ERROR);
+    report("chk write",start);
+
+    FRAM_clear_stats(&fram);
+    start=sim_now();
+    CHECK_EQ(FRAM_read_from_adr(&fram,0,buffer,BYTES),FRAM_NO_ERROR);
+    report("plain read",start);
+
+    FRAM_clear_stats(&fram);
+    start=sim_now();
+    CHECK_EQ(FRAM_chk_read_from_adr(&chk,0,buffer,BYTES),FRAM_NO_ERROR);
+    report("chk read",start);
+    CHECK(memcmp(buffer,data,BYTES)==0);
+
+    FRAM_clear_stats(&fram);
+    start=sim_now();
+    for(i=0;i<PARTIAL;i++)
+        CHECK_EQ(FRAM_chk_write_to_adr(&chk,test_rand()%(BYTES-8),data,8),FRAM_NO_ERROR);
+    printf("%u writes of 8 bytes at random addresses: %.1f bytes read and %.1f written per write, %.2f ms per write\n",PARTIAL,
+           (double)fram.stats.bytes_read/PARTIAL,(double)fram.stats.bytes_written/PARTIAL,(sim_now()-start)/1e6/PARTIAL);
+
+    return 0;
+}
+
+/* [] END OF FILE */
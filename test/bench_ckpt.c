@@ -0,0 +1,138 @@
+/**
+ * @file bench_ckpt.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Incremental checkpoint of an image of 8 KB against a full dump of the image: the time on the bus at 400 kHz of saves
+ * after changes of fields of 8 bytes at random addresses, with the chunks written directly and through a journal.
+ * The cost of the CPU is the host time of a save without changes, which only hashes the image. It is given in cycles of the host,
+ * estimated with a chain of dependent additions, and as the time of a PSoC 4 with a Cortex-M0 at 48 MHz taking M0_FACTOR times the cycles of the host.
+ */
+
+#include <string.h>
+#include <time.h>
+#include "FRAM_ckpt.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x100u
+#define JOURNAL                 0x8000u
+#define JOURNAL_SIZE            0x8000u
+#define IMAGE                   (FRAM_CKPT_CHUNKS*FRAM_CKPT_CHUNK_SIZE)
+#define REPEAT                  20u                     //saves per measurement
+#define HASH_REPEAT             2000u                   //host runs of the hashes
+#define M0_HZ                   48e6                    //clock of the PSoC
+#define M0_FACTOR               5.0                     //cycles of a Cortex-M0 per cycle of the host, it runs one instruction per cycle at best
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_txn_t txn;
+static FRAM_ckpt_t ckpt;
+static uint8_t image[IMAGE];
+
+static double seconds(void){
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    return now.tv_sec+now.tv_nsec/1e9;
+}
+
+//cycles of the host per second, every addition of the chain waits for the previous one
+static double host_hz(void){
+
+    const uint32_t count=200000000u;
+    uint32_t value=0;
+    uint32_t i;
+    double start;
+
+    start=seconds();
+    for(i=0;i<count;i++){
+        value+=i;
+        __asm__ volatile("" : "+r"(value));
+    }
+
+    return count/(seconds()-start);
+}
+
+//changes fields of 8 bytes at random addresses, percent of the bytes of the image in total
+static void change(uint32_t percent){
+
+    uint32_t fields=IMAGE*percent/100u/8u;
+    uint32_t adr;
+    uint32_t i;
+
+    while(fields--){
+        adr=test_rand()%(IMAGE-7u);
+        for(i=0;i<8;i++)
+            image[adr+i]++;
+    }
+}
+
+int main(void){
+
+    static const uint32_t percents[]={1,5,10,25,50};
+    const double hz=host_hz();
+    uint64_t start;
+    uint64_t total;
+    double full_ns;
+    double host;
+    uint32_t journal;
+    uint32_t written;
+    uint32_t k;
+    uint32_t i;
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+    for(i=0;i<IMAGE;i++)
+        image[i]=(uint8_t)test_rand();
+
+    start=sim_now();
+    CHECK_EQ(FRAM_write_to_adr(&fram,BASE+FRAM_CKPT_HEADER,image,IMAGE),FRAM_NO_ERROR);
+    full_ns=sim_now()-start;
+    printf("%u bytes, full dump %.1f ms on the bus\n",IMAGE,full_ns/1e6);
+
+    for(journal=0;journal<2;journal++){
+
+        if(journal){
+            CHECK_EQ(FRAM_txn_init(&txn,&fram,JOURNAL,JOURNAL_SIZE),FRAM_NO_ERROR);
+            CHECK_EQ(FRAM_txn_recover(&txn),FRAM_NO_ERROR);
+        }
+        CHECK_EQ(FRAM_ckpt_init(&ckpt,&fram,journal?&txn:NULL,BASE,image,IMAGE),FRAM_NO_ERROR);
+        CHECK_EQ(FRAM_ckpt_save(&ckpt),FRAM_NO_ERROR);
+
+        printf("%s\n",journal?"journal":"direct");
+        for(k=0;k<sizeof(percents)/sizeof(percents[0]);k++){
+
+            total=0;
+            written=0;
+            for(i=0;i<REPEAT;i++){
+                change(percents[k]);
+                FRAM_clear_stats(&fram);
+                start=sim_now();
+                CHECK_EQ(FRAM_ckpt_save(&ckpt),FRAM_NO_ERROR);
+                total+=sim_now()-start;
+                written+=fram.stats.bytes_written;
+            }
+            printf("  %2u%% of the bytes changed: %5.0f bytes written, %6.1f ms on the bus, %5.2fx the full dump\n",percents[k],
+                   (double)written/REPEAT,total/1e6/REPEAT,total/full_ns/REPEAT);
+        }
+    }
+
+    //nothing changed, so the save only hashes the image
+    CHECK_EQ(FRAM_ckpt_init(&ckpt,&fram,NULL,BASE,image,IMAGE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ckpt_save(&ckpt),FRAM_NO_ERROR);
+    host=seconds();
+    for(i=0;i<HASH_REPEAT;i++)
+        CHECK_EQ(FRAM_ckpt_save(&ckpt),FRAM_NO_ERROR);
+    host=(seconds()-host)/HASH_REPEAT;
+    printf("hashing %u bytes: %.1f us on the host, %.1f host cycles/B, PSoC %.2f ms\n",IMAGE,host*1e6,host*hz/IMAGE,host*hz*M0_FACTOR/M0_HZ*1e3);
+
+    return 0;
+}
+
+/* [] END OF FILE */
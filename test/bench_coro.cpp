@@ -0,0 +1,69 @@
+/**
+ * @file bench_coro.cpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * How many outstanding coroutine operations keep the bus saturated. Every task reads 32 bytes and writes them back,
+ * working for CPU_NS after every transfer. All tasks run on one executor and one bus, while a task works the transfers of the others run on the bus.
+ * Prints the share of bus time the bus was busy and the operations per second of bus time for 1 to 8 tasks.
+ * Two tasks already reach the maximum: one operation per bus is in flight, the rest of the idle time are short transfers
+ * (setting the address latch) ending while a task works, the next one only starts with the next pass of the executor.
+ */
+
+#include <array>
+#include "FRAM_coro.hpp"
+#include "sim.h"
+#include "test.h"
+
+FRAM_CPP_BUS(SimBus,SIM0);
+
+using Chip=fram::Fram<fram::FM24V10<FRAM_SLAVE_ADR>,SimBus,32>;
+
+#define OPS                     500u                    //read-work-write rounds per task
+#define CPU_NS                  400000u                 //time a task works after a transfer, about half the time of a transfer of 32 bytes
+
+static fram::task worker(fram::async<Chip> &f, uint32_t n){
+
+    std::array<uint8_t,32> buf{};
+    uint32_t result=FRAM_NO_ERROR;
+
+    for(uint32_t i=0;i<OPS&&result==FRAM_NO_ERROR;i++){
+        const uint32_t adr=(n*OPS+i)*64u%(SIM_CHIP_SIZE-64u);
+
+        result=co_await f.read(adr,buf);
+        sim_sleep(CPU_NS);
+        buf[0]++;
+        if(result==FRAM_NO_ERROR)
+            result=co_await f.write(adr,buf);
+        sim_sleep(CPU_NS);
+    }
+
+    co_return result;
+}
+
+int main(){
+
+    printf("tasks  bus busy  ops/s\n");
+
+    for(uint32_t tasks=1;tasks<=8;tasks++){
+        Chip chip;
+        fram::executor exec;
+        fram::async<Chip> f(chip,exec);
+
+        sim_reset();
+        chip.start();
+
+        for(uint32_t n=0;n<tasks;n++)
+            exec.spawn(worker(f,n));
+        exec.run();
+
+        CHECK_EQ(sim_get_stats(0)->refused,0);
+        printf("%5u  %6.1f %%  %5.0f\n",tasks,100.0*sim_get_stats(0)->busy_ns/sim_now(),2.0*tasks*OPS/(sim_now()/1e9));
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */
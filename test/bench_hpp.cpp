@@ -0,0 +1,87 @@
+/**
+ * @file bench_hpp.cpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * C++ front-end against the C driver on the same chip: the time on the bus at 400 kHz and the transfers of writes and reads
+ * of 16 bytes to 8 KB with "Fram::write" and "Fram::read" and with "FRAM_write_to_adr" and "FRAM_read_from_adr".
+ * Writes longer than the transfer buffer of the C++ front-end go byte by byte from the buffer of the caller in one transfer,
+ * so both take the same time. Reads start at a fresh address, so both set the address latch first.
+ */
+
+#include <array>
+#include <cstring>
+#include "FRAM.hpp"
+#include "sim.h"
+#include "test.h"
+
+FRAM_CPP_BUS(SimBus,SIM0);
+
+using Chip=fram::Fram<fram::FM24V10<FRAM_SLAVE_ADR>,SimBus,64>;
+
+#define ADR                     0xf000u                 //the longest range crosses the page select boundary
+#define BYTES_MAX               8192u
+
+static uint8_t out[BYTES_MAX];
+static uint8_t in[BYTES_MAX];
+
+int main(){
+
+    static const uint32_t sizes[]={16,64,256,1024,8192};
+    Chip chip;
+    FRAM_bus_t bus;
+    FRAM_t fram;
+    uint64_t start;
+    double cpp_write, c_write, cpp_read, c_read;
+    uint32_t cpp_transfers, c_transfers;
+
+    sim_reset();
+    chip.start();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+    for(uint32_t i=0;i<BYTES_MAX;i++)
+        out[i]=static_cast<uint8_t>(test_rand());
+
+    printf("bytes   write C++      C   transfers   read C++      C   transfers\n");
+    for(uint32_t size : sizes){
+
+        //writes
+        sim_clear_stats();
+        start=sim_now();
+        CHECK_EQ(chip.write(ADR,fram::span<const uint8_t>(out,size)),FRAM_NO_ERROR);
+        cpp_write=(sim_now()-start)/1e6;
+        cpp_transfers=sim_get_stats(0)->transfers;
+        CHECK(memcmp(sim_mem(0,FRAM_SLAVE_ADR)+ADR,out,size)==0);
+
+        sim_clear_stats();
+        start=sim_now();
+        CHECK_EQ(FRAM_write_to_adr(&fram,ADR,out,size),FRAM_NO_ERROR);
+        c_write=(sim_now()-start)/1e6;
+        c_transfers=sim_get_stats(0)->transfers;
+        printf("%5u  %7.2f %7.2f ms  %3u %3u",size,cpp_write,c_write,cpp_transfers,c_transfers);
+
+        //reads, the latches of both point behind the range
+        memset(in,0,size);
+        sim_clear_stats();
+        start=sim_now();
+        CHECK_EQ(chip.read(ADR,fram::span<uint8_t>(in,size)),FRAM_NO_ERROR);
+        cpp_read=(sim_now()-start)/1e6;
+        cpp_transfers=sim_get_stats(0)->transfers;
+        CHECK(memcmp(in,out,size)==0);
+
+        memset(in,0,size);
+        sim_clear_stats();
+        start=sim_now();
+        CHECK_EQ(FRAM_read_from_adr(&fram,ADR,in,size),FRAM_NO_ERROR);
+        c_read=(sim_now()-start)/1e6;
+        c_transfers=sim_get_stats(0)->transfers;
+        CHECK(memcmp(in,out,size)==0);
+        printf("   %7.2f %7.2f ms  %3u %3u\n",cpp_read,c_read,cpp_transfers,c_transfers);
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,87 @@
+/**
+ * @file bench_instances.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Host throughput of the driver with 1 to SIM_BUSES threads, each driving its own bus with its own chip.
+ * Measured in real time of the host, the simulated bus time is not the limit here.
+ */
+
+#include <pthread.h>
+#include <time.h>
+#include "sim.h"
+#include "test.h"
+
+#define OPS                     200000
+
+typedef struct {
+    uint8_t     n;
+    FRAM_bus_t  bus;
+    FRAM_t      fram;
+    uint8_t     buffer[64];
+} worker_t;
+
+static worker_t workers[SIM_BUSES];
+
+static void* work(void *arg){
+
+    worker_t * const w=arg;
+    uint32_t adr=0;
+    int it;
+
+    FRAM_bus_init(&w->bus,&sim_i2c[w->n]);
+    FRAM_init(&w->fram,&w->bus,FRAM_SLAVE_ADR);
+
+    for(it=0;it<OPS;it++){
+        adr=(adr+4099)%(SIM_CHIP_SIZE-64);
+        if(it&1)
+            FRAM_write_to_adr(&w->fram,adr,w->buffer,32);
+        else
+            FRAM_read_from_adr(&w->fram,adr,w->buffer,32);
+    }
+
+    return NULL;
+}
+
+static double seconds(void){
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    return now.tv_sec+now.tv_nsec/1e9;
+}
+
+int main(void){
+
+    pthread_t threads[SIM_BUSES];
+    double start;
+    double base=0;
+    double rate;
+    uint8_t count;
+    uint8_t n;
+
+    sim_reset();
+
+    for(count=1;count<=SIM_BUSES;count*=2){
+
+        start=seconds();
+        for(n=0;n<count;n++){
+            workers[n].n=n;
+            CHECK(pthread_create(&threads[n],NULL,work,&workers[n])==0);
+        }
+        for(n=0;n<count;n++)
+            pthread_join(threads[n],NULL);
+
+        rate=count*OPS/(seconds()-start);
+        if(count==1)
+            base=rate;
+        printf("%u thread(s): %8.0f transfers/s of 32 bytes, %.2fx\n",count,rate,rate/base);
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,136 @@
+/**
+ * @file bench_lock.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Contention on one saturated bus: an urgent task reading 16 bytes every 2 ms, two normal tasks with a random 64 byte read or write
+ * every 10 ms and a bulk task writing 4 KB blocks all the time share the lock for 2 s of bus time. Prints the wait per class in us of bus time,
+ * once with the tasks blocking on a semaphore each and once polling the lock, with the host CPU time of both.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+#include "sim.h"
+#include "test.h"
+
+#define RUN_NS                  2000000000ull
+#define BULK                    4096u
+
+static pthread_mutex_t critical=PTHREAD_MUTEX_INITIALIZER;
+static __thread sem_t semaphore;
+static __thread int semaphore_init;
+
+static uint32_t enter(void){pthread_mutex_lock(&critical); return 0;}
+static void     leave(uint32_t state){(void)state; pthread_mutex_unlock(&critical);}
+static void     spin(void){sched_yield();}
+static uint32_t now(void){return (uint32_t)(sim_now()/1000u);}
+static void     sleep_on(void){sem_wait(&semaphore);}
+static void     wake(void *task){sem_post(task);}
+
+static void* self(void){
+
+    if(!semaphore_init)
+        semaphore_init=sem_init(&semaphore,0,0)==0;
+
+    return &semaphore;
+}
+
+static const FRAM_lock_hooks_t blocking={enter,leave,spin,now,self,sleep_on,wake};
+static const FRAM_lock_hooks_t polling={enter,leave,spin,now,NULL,NULL,NULL};
+
+typedef struct {
+    FRAM_prio_t prio;
+    uint32_t    period;                                 //ns of bus time from one operation to the next, 0 for back to back
+    FRAM_t      fram;
+    uint32_t    ops;
+    uint8_t     buffer[BULK];
+} task_t;
+
+static FRAM_bus_t bus;
+static FRAM_lock_t lock;
+static task_t tasks[4]={
+    {.prio=FRAM_PRIO_URGENT,.period=2000000u},
+    {.prio=FRAM_PRIO_NORMAL,.period=10000000u},
+    {.prio=FRAM_PRIO_NORMAL,.period=10000000u},
+    {.prio=FRAM_PRIO_BULK,.period=0}
+};
+
+static void* work(void *arg){
+
+    task_t * const t=arg;
+    unsigned long long state=(uintptr_t)t;
+    uint64_t next=0;
+    uint32_t adr;
+
+    while(sim_now()<RUN_NS){
+        state=state*6364136223846793005ull+1442695040888963407ull;
+        adr=(state>>24)%(SIM_CHIP_SIZE-BULK);
+
+        while(sim_now()<next&&sim_now()<RUN_NS)
+            sched_yield();
+        next=sim_now()+t->period;
+
+        if(t->prio==FRAM_PRIO_URGENT)
+            FRAM_read_from_adr_prio(&t->fram,FRAM_PRIO_URGENT,adr,t->buffer,16);
+        else if(t->prio==FRAM_PRIO_NORMAL){
+            if(state>>63)
+                FRAM_write_to_adr_prio(&t->fram,FRAM_PRIO_NORMAL,adr,t->buffer,64);
+            else
+                FRAM_read_from_adr_prio(&t->fram,FRAM_PRIO_NORMAL,adr,t->buffer,64);
+        }
+        else
+            FRAM_write_to_adr_prio(&t->fram,FRAM_PRIO_BULK,adr,t->buffer,BULK);
+
+        t->ops++;
+    }
+
+    return NULL;
+}
+
+static void run(const char *name, const FRAM_lock_hooks_t *hooks){
+
+    static const char * const classes[FRAM_PRIO_COUNT]={"urgent","normal","bulk"};
+    pthread_t threads[4];
+    const FRAM_lock_stats_t *stats;
+    clock_t cpu;
+    uint32_t ops[FRAM_PRIO_COUNT]={0};
+    uint8_t i;
+
+    sim_reset();
+    sim_yield(1);
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_lock_init(&lock,hooks);
+    FRAM_bus_set_lock(&bus,&lock);
+
+    cpu=clock();
+    for(i=0;i<4;i++){
+        FRAM_init(&tasks[i].fram,&bus,FRAM_SLAVE_ADR+2*i);
+        tasks[i].ops=0;
+        CHECK(pthread_create(&threads[i],NULL,work,&tasks[i])==0);
+    }
+    for(i=0;i<4;i++){
+        pthread_join(threads[i],NULL);
+        ops[tasks[i].prio]+=tasks[i].ops;
+    }
+    cpu=clock()-cpu;
+
+    stats=FRAM_lock_get_stats(&lock);
+    printf("%s: bus busy %.1f %%, %u yields, host CPU %.2f s\n",name,100.0*sim_get_stats(0)->busy_ns/sim_now(),stats->yields,(double)cpu/CLOCKS_PER_SEC);
+    for(i=0;i<FRAM_PRIO_COUNT;i++)
+        printf("  %-6s %6u ops, wait avg %7.0f us, max %7u us\n",classes[i],ops[i],
+            stats->acquisitions[i]?(double)stats->wait_total[i]/stats->acquisitions[i]:0.0,stats->wait_max[i]);
+}
+
+int main(void){
+
+    run("blocking",&blocking);
+    run("polling",&polling);
+
+    return 0;
+}
+
+/* [] END OF FILE */
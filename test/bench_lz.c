@@ -0,0 +1,184 @@
+/**
+ * @file bench_lz.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Compressed region against plain writes and reads of 32 KB of several kinds of data: the compression ratio, the time on the bus
+ * at 400 kHz, and the cost of the CPU. The cost of the CPU is the host time of the whole call on a second bus whose transfers end
+ * at the first poll, so the host does not spend its time polling. It is given in cycles of the host, estimated with a chain of dependent additions.
+ * A PSoC 4 with a Cortex-M0 at 48 MHz is modelled to take M0_FACTOR times the cycles of the host.
+ * The throughput on the PSoC adds the modelled time of the CPU to the time on the bus. The break-even factor is how many times the cycles
+ * of the host the Cortex-M0 may take before the compressed region gets slower than plain writes.
+ */
+
+#include <string.h>
+#include <time.h>
+#include "FRAM_lz.h"
+#include "sim.h"
+#include "test.h"
+
+#define BYTES                   0x8000u
+#define REPEAT                  20u                     //host runs per measurement
+#define M0_HZ                   48e6                    //clock of the PSoC
+#define M0_FACTOR               5.0                     //cycles of a Cortex-M0 per cycle of the host, it runs one instruction per cycle at best
+
+static uint32_t fast_status(void);
+
+static const FRAM_i2c_t fast_i2c={SIM1_Start,SIM1_I2CMasterWriteBuf,SIM1_I2CMasterReadBuf,fast_status,SIM1_I2C_MODE_COMPLETE_XFER,
+                                  SIM1_I2C_MSTAT_WR_CMPLT,SIM1_I2C_MSTAT_RD_CMPLT,SIM1_I2C_MSTAT_XFER_INP,SIM1_I2C_MSTR_NO_ERROR};
+static FRAM_bus_t bus;
+static FRAM_bus_t fast_bus;
+static FRAM_t fram;
+static FRAM_t fast_fram;
+static FRAM_lz_t lz;
+static FRAM_lz_t fast_lz;
+static uint8_t data[BYTES];
+static uint8_t buffer[BYTES];
+
+//skips the rest of a running transfer
+static uint32_t fast_status(void){
+
+    const uint32_t status=SIM1_I2CMasterStatus();
+
+    if(status&SIM_I2C_MSTAT_XFER_INP)
+        sim_sleep(SIM_BYTE_NS*(BYTES+4ull));
+
+    return status;
+}
+
+static double seconds(void){
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    return now.tv_sec+now.tv_nsec/1e9;
+}
+
+//cycles of the host per second, every addition of the chain waits for the previous one
+static double host_hz(void){
+
+    const uint32_t count=200000000u;
+    uint32_t value=0;
+    uint32_t i;
+    double start;
+
+    start=seconds();
+    for(i=0;i<count;i++){
+        value+=i;
+        __asm__ volatile("" : "+r"(value));
+    }
+
+    return count/(seconds()-start);
+}
+
+static void fill(uint32_t kind){
+
+    static const char text[]="the quick brown fox jumps over the lazy dog ";
+    uint32_t i;
+
+    test_seed(kind);
+
+    for(i=0;i<BYTES;i++){
+        switch(kind){
+            case 0: data[i]=0; break;
+
+            //a counter in every fourth of 16 byte records, the rest zero
+            case 1: data[i]=i%16<4?(uint8_t)(i/16):0; break;
+
+            //records of 16 bytes: a counter, a constant, a small value and padding
+            case 2: data[i]=i%16<4?(uint8_t)((i/16*3)>>(8*(i%16))):i%16<8?0x5a:i%16<12?(uint8_t)(test_rand()%3):0; break;
+            case 3: data[i]=(uint8_t)text[test_rand()%(sizeof(text)-1)]; break;
+            default: data[i]=(uint8_t)test_rand(); break;
+        }
+    }
+}
+
+//runs a write or read of BYTES bytes, plain or compressed
+static void run(FRAM_t * const chip, FRAM_lz_t * const region, uint8_t write){
+
+    if(write&&region!=NULL)
+        CHECK_EQ(FRAM_lz_write_to_adr(region,0,data,BYTES),FRAM_NO_ERROR);
+    else if(write)
+        CHECK_EQ(FRAM_write_to_adr(chip,0,data,BYTES),FRAM_NO_ERROR);
+    else if(region!=NULL)
+        CHECK_EQ(FRAM_lz_read_from_adr(region,0,buffer,BYTES),FRAM_NO_ERROR);
+    else
+        CHECK_EQ(FRAM_read_from_adr(chip,0,buffer,BYTES),FRAM_NO_ERROR);
+
+    if(!write)
+        CHECK(memcmp(buffer,data,BYTES)==0);
+}
+
+//simulated time of a run on the bus in ns, host time of REPEAT runs on the fast bus per byte in cycles of the host
+static void measure(uint8_t write, uint8_t packed, double hz, double * const cycles, double * const bus_ns){
+
+    uint64_t start;
+    double host;
+    uint32_t i;
+
+    start=sim_now();
+    run(&fram,packed?&lz:NULL,write);
+    *bus_ns=sim_now()-start;
+
+    host=seconds();
+    for(i=0;i<REPEAT;i++)
+        run(&fast_fram,packed?&fast_lz:NULL,write);
+    *cycles=(seconds()-host)*hz/REPEAT/BYTES;
+}
+
+static void report(const char * const what, double cycles, double bus_ns, double plain_ns){
+
+    const double cpu_ns=cycles*M0_FACTOR*BYTES/M0_HZ*1e9;
+
+    printf("  %-5s %5.1f host cycles/B, %6.1f ms on the bus, PSoC %6.1f ms = %5.2fx plain",what,cycles,bus_ns/1e6,
+           (bus_ns+cpu_ns)/1e6,plain_ns/(bus_ns+cpu_ns));
+
+    //stored blocks save nothing on the bus
+    if(plain_ns>bus_ns)
+        printf(", break-even at %.0fx\n",(plain_ns-bus_ns)/(cycles*BYTES/M0_HZ*1e9));
+    else
+        printf("\n");
+}
+
+int main(void){
+
+    static const char * const names[]={"zeros","sparse counters","struct snapshot","text","random"};
+    const double hz=host_hz();
+    double plain_ns;
+    double bus_ns;
+    double cycles;
+    uint32_t kind;
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+    FRAM_bus_init(&fast_bus,&fast_i2c);
+    FRAM_init(&fast_fram,&fast_bus,FRAM_SLAVE_ADR);
+
+    printf("host at about %.2f GHz, Cortex-M0 at %.0f MHz taking %.0fx the cycles of the host\n",hz/1e9,M0_HZ/1e6,M0_FACTOR);
+
+    for(kind=0;kind<sizeof(names)/sizeof(names[0]);kind++){
+
+        fill(kind);
+        CHECK_EQ(FRAM_lz_init(&lz,&fram,0x10000,BYTES/FRAM_LZ_BLOCK_SIZE*FRAM_LZ_SLOT_SIZE),FRAM_NO_ERROR);
+        CHECK_EQ(FRAM_lz_init(&fast_lz,&fast_fram,0x10000,BYTES/FRAM_LZ_BLOCK_SIZE*FRAM_LZ_SLOT_SIZE),FRAM_NO_ERROR);
+        CHECK_EQ(FRAM_lz_write_to_adr(&lz,0,data,BYTES),FRAM_NO_ERROR);
+        printf("%s: ratio %.2f, %u of %u blocks stored as they are\n",names[kind],(double)lz.stats.bytes/lz.stats.packed,
+               lz.stats.stored,lz.stats.blocks);
+
+        measure(1,0,hz,&cycles,&plain_ns);
+        measure(1,1,hz,&cycles,&bus_ns);
+        report("write",cycles,bus_ns,plain_ns);
+
+        measure(0,0,hz,&cycles,&plain_ns);
+        measure(0,1,hz,&cycles,&bus_ns);
+        report("read",cycles,bus_ns,plain_ns);
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,79 @@
+/**
+ * @file bench_stripe.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Bulk throughput of one chip against two chips striped over one and over two buses, in simulated time at 400 kHz.
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "test.h"
+
+#define BYTES                   0x10000u
+
+static uint8_t buffer[BYTES];
+
+static double kbps(uint64_t ns){return BYTES/1.024/(ns/1e6);}
+
+int main(void){
+
+    static const uint32_t sizes[]={16,64,256,1024};
+    FRAM_bus_t bus[2];
+    FRAM_t fram[3];
+    FRAM_t * const separate[2]={&fram[0],&fram[1]};
+    FRAM_t * const shared[2]={&fram[0],&fram[2]};
+    FRAM_stripe_t stripe;
+    uint64_t start;
+    uint64_t write_ns;
+    uint64_t read_ns;
+    uint32_t i;
+
+    sim_reset();
+    FRAM_bus_init(&bus[0],&sim_i2c[0]);
+    FRAM_bus_init(&bus[1],&sim_i2c[1]);
+    FRAM_init(&fram[0],&bus[0],0x50);
+    FRAM_init(&fram[1],&bus[1],0x50);
+    FRAM_init(&fram[2],&bus[0],0x52);
+
+    for(i=0;i<BYTES;i++)
+        buffer[i]=test_rand();
+
+    start=sim_now();
+    CHECK_EQ(FRAM_write_to_adr(&fram[0],0,buffer,BYTES),FRAM_NO_ERROR);
+    write_ns=sim_now()-start;
+    start=sim_now();
+    CHECK_EQ(FRAM_read_from_adr(&fram[0],0,buffer,BYTES),FRAM_NO_ERROR);
+    read_ns=sim_now()-start;
+    printf("%-28s write %6.1f KB/s  read %6.1f KB/s\n","one chip",kbps(write_ns),kbps(read_ns));
+
+    for(i=0;i<sizeof(sizes)/sizeof(sizes[0]);i++){
+
+        stripe.count=2;
+        stripe.stripe_size=sizes[i];
+
+        stripe.devices=separate;
+        start=sim_now();
+        CHECK_EQ(FRAM_stripe_write_to_adr(&stripe,0,buffer,BYTES),FRAM_NO_ERROR);
+        write_ns=sim_now()-start;
+        start=sim_now();
+        CHECK_EQ(FRAM_stripe_read_from_adr(&stripe,0,buffer,BYTES),FRAM_NO_ERROR);
+        read_ns=sim_now()-start;
+        printf("two buses, stripe %4u B     write %6.1f KB/s  read %6.1f KB/s\n",(unsigned)sizes[i],kbps(write_ns),kbps(read_ns));
+
+        stripe.devices=shared;
+        start=sim_now();
+        CHECK_EQ(FRAM_stripe_write_to_adr(&stripe,0,buffer,BYTES),FRAM_NO_ERROR);
+        write_ns=sim_now()-start;
+        start=sim_now();
+        CHECK_EQ(FRAM_stripe_read_from_adr(&stripe,0,buffer,BYTES),FRAM_NO_ERROR);
+        read_ns=sim_now()-start;
+        printf("one bus,   stripe %4u B     write %6.1f KB/s  read %6.1f KB/s\n",(unsigned)sizes[i],kbps(write_ns),kbps(read_ns));
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,90 @@
+/**
+ * @file project.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Stand-in for the header generated by PSoC Creator, used by the host tests.
+ * It declares the I2C instances SIM0 to SIM3 of the bus model (see sim.h) and the few CPU functions the driver uses.
+ */
+
+#if !defined(PROJECT_H)
+#define PROJECT_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define SIM_DECLARE_I2C(inst)                                                                       \
+    void        inst##_Start(void);                                                                 \
+    uint32_t    inst##_I2CMasterWriteBuf(uint32_t slaveAddress, uint8_t * wrData, uint32_t cnt, uint32_t mode); \
+    uint32_t    inst##_I2CMasterReadBuf(uint32_t slaveAddress, uint8_t * rdData, uint32_t cnt, uint32_t mode);  \
+    uint32_t    inst##_I2CMasterStatus(void);                                                       \
+    uint32_t    inst##_I2CMasterSendStart(uint32_t slaveAddress, uint32_t bitRnW);                  \
+    uint32_t    inst##_I2CMasterWriteByte(uint32_t theByte);                                        \
+    uint32_t    inst##_I2CMasterSendStop(void);
+
+#define SIM_I2C_MODE_COMPLETE_XFER  0x00u
+#define SIM_I2C_MSTAT_RD_CMPLT      0x01u
+#define SIM_I2C_MSTAT_WR_CMPLT      0x02u
+#define SIM_I2C_MSTAT_XFER_INP      0x08u
+#define SIM_I2C_MSTR_NO_ERROR       0x00u
+#define SIM_I2C_MSTR_NOT_READY      0x02u
+#define SIM_I2C_MSTR_ERR_LB_NAK     0x10u
+#define SIM_I2C_WRITE_XFER_MODE     0x00u
+#define SIM_I2C_READ_XFER_MODE      0x01u
+
+#define SIM0_I2C_MODE_COMPLETE_XFER SIM_I2C_MODE_COMPLETE_XFER
+#define SIM0_I2C_MSTAT_RD_CMPLT     SIM_I2C_MSTAT_RD_CMPLT
+#define SIM0_I2C_MSTAT_WR_CMPLT     SIM_I2C_MSTAT_WR_CMPLT
+#define SIM0_I2C_MSTAT_XFER_INP     SIM_I2C_MSTAT_XFER_INP
+#define SIM0_I2C_MSTR_NO_ERROR      SIM_I2C_MSTR_NO_ERROR
+#define SIM0_I2C_WRITE_XFER_MODE    SIM_I2C_WRITE_XFER_MODE
+#define SIM1_I2C_MODE_COMPLETE_XFER SIM_I2C_MODE_COMPLETE_XFER
+#define SIM1_I2C_MSTAT_RD_CMPLT     SIM_I2C_MSTAT_RD_CMPLT
+#define SIM1_I2C_MSTAT_WR_CMPLT     SIM_I2C_MSTAT_WR_CMPLT
+#define SIM1_I2C_MSTAT_XFER_INP     SIM_I2C_MSTAT_XFER_INP
+#define SIM1_I2C_MSTR_NO_ERROR      SIM_I2C_MSTR_NO_ERROR
+#define SIM1_I2C_WRITE_XFER_MODE    SIM_I2C_WRITE_XFER_MODE
+#define SIM2_I2C_MODE_COMPLETE_XFER SIM_I2C_MODE_COMPLETE_XFER
+#define SIM2_I2C_MSTAT_RD_CMPLT     SIM_I2C_MSTAT_RD_CMPLT
+#define SIM2_I2C_MSTAT_WR_CMPLT     SIM_I2C_MSTAT_WR_CMPLT
+#define SIM2_I2C_MSTAT_XFER_INP     SIM_I2C_MSTAT_XFER_INP
+#define SIM2_I2C_MSTR_NO_ERROR      SIM_I2C_MSTR_NO_ERROR
+#define SIM2_I2C_WRITE_XFER_MODE    SIM_I2C_WRITE_XFER_MODE
+#define SIM3_I2C_MODE_COMPLETE_XFER SIM_I2C_MODE_COMPLETE_XFER
+#define SIM3_I2C_MSTAT_RD_CMPLT     SIM_I2C_MSTAT_RD_CMPLT
+#define SIM3_I2C_MSTAT_WR_CMPLT     SIM_I2C_MSTAT_WR_CMPLT
+#define SIM3_I2C_MSTAT_XFER_INP     SIM_I2C_MSTAT_XFER_INP
+#define SIM3_I2C_MSTR_NO_ERROR      SIM_I2C_MSTR_NO_ERROR
+#define SIM3_I2C_WRITE_XFER_MODE    SIM_I2C_WRITE_XFER_MODE
+
+#define __DMB()                     __sync_synchronize()
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+SIM_DECLARE_I2C(SIM0)
+SIM_DECLARE_I2C(SIM1)
+SIM_DECLARE_I2C(SIM2)
+SIM_DECLARE_I2C(SIM3)
+
+uint8_t     CyEnterCriticalSection(void);
+void        CyExitCriticalSection(uint8_t savedIntrStatus);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (PROJECT_H) */
+
+/* [] END OF FILE */
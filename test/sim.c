@@ -0,0 +1,308 @@
+/**
+ * @file sim.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ */
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "sim.h"
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define SIM_ADR_BYTES           2u                      //address bytes in front of the data of a write
+#define SIM_CHIP(slave_adr)     (((slave_adr)>>1)&(SIM_CHIPS-1u))
+
+//the I2C API has no context, so every instance gets functions of its own
+#define SIM_DEFINE_I2C(inst,n)                                                                                          \
+    void     inst##_Start(void){}                                                                                       \
+    uint32_t inst##_I2CMasterWriteBuf(uint32_t slaveAddress, uint8_t * wrData, uint32_t cnt, uint32_t mode){            \
+        (void)mode; return sim_write(n,slaveAddress,wrData,cnt);}                                                       \
+    uint32_t inst##_I2CMasterReadBuf(uint32_t slaveAddress, uint8_t * rdData, uint32_t cnt, uint32_t mode){             \
+        (void)mode; return sim_read(n,slaveAddress,rdData,cnt);}                                                        \
+    uint32_t inst##_I2CMasterStatus(void){return sim_status(n);}                                                       \
+    uint32_t inst##_I2CMasterSendStart(uint32_t slaveAddress, uint32_t bitRnW){return sim_send_start(n,slaveAddress,bitRnW);} \
+    uint32_t inst##_I2CMasterWriteByte(uint32_t theByte){return sim_write_byte(n,theByte);}                           \
+    uint32_t inst##_I2CMasterSendStop(void){return sim_send_stop(n);}
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+typedef struct {
+    uint8_t     mem[SIM_CHIPS][SIM_CHIP_SIZE];          //content of the chips
+    uint32_t    latch[SIM_CHIPS];                       //address latch of the chips
+    uint64_t    busy_until;                             //time the running transfer ends
+    uint32_t    fail;                                   //number of transfers still to be refused
+    uint32_t    manual_slave;                           //slave address of the running byte by byte write, 0 if none is running
+    uint32_t    manual_count;                           //bytes of the byte by byte write so far, the first SIM_ADR_BYTES are the address
+    uint32_t    manual_adr;                             //address the next data byte of the byte by byte write goes to
+    sim_stats_t stats;
+} sim_bus_t;
+
+/*******************************************************************************
+**                      Locals                                                **
+*******************************************************************************/
+static uint32_t sim_write(uint8_t n, uint32_t slave_adr, const uint8_t * const data, uint32_t count);
+static uint32_t sim_read(uint8_t n, uint32_t slave_adr, uint8_t * const data, uint32_t count);
+static uint32_t sim_status(uint8_t n);
+static uint32_t sim_send_start(uint8_t n, uint32_t slave_adr, uint32_t rnw);
+static uint32_t sim_write_byte(uint8_t n, uint32_t byte);
+static uint32_t sim_send_stop(uint8_t n);
+static uint8_t  sim_store(sim_bus_t * const bus, uint32_t chip, uint32_t adr, uint8_t byte);
+static uint32_t sim_start(sim_bus_t * const bus, uint32_t slave_adr, uint32_t count);
+static void     sim_critical_init(void);
+
+static sim_bus_t sim_bus[SIM_BUSES];
+static uint64_t sim_time;
+static long sim_budget=-1;
+static uint8_t sim_lost;
+static uint8_t sim_yields;
+static pthread_mutex_t sim_critical;
+static pthread_once_t sim_once=PTHREAD_ONCE_INIT;
+
+/*******************************************************************************
+**                      Definitions                                           **
+*******************************************************************************/
+SIM_DEFINE_I2C(SIM0,0)
+SIM_DEFINE_I2C(SIM1,1)
+SIM_DEFINE_I2C(SIM2,2)
+SIM_DEFINE_I2C(SIM3,3)
+
+const FRAM_i2c_t sim_i2c[SIM_BUSES]={FRAM_I2C(SIM0),FRAM_I2C(SIM1),FRAM_I2C(SIM2),FRAM_I2C(SIM3)};
+
+void sim_reset(void){
+
+    memset(sim_bus,0,sizeof(sim_bus));
+    __atomic_store_n(&sim_time,0,__ATOMIC_SEQ_CST);
+    sim_budget=-1;
+    sim_lost=0;
+    sim_yields=0;
+}
+
+uint8_t* sim_mem(uint8_t bus, uint8_t slave_adr){return sim_bus[bus].mem[SIM_CHIP(slave_adr)];}
+
+uint64_t sim_now(void){return __atomic_load_n(&sim_time,__ATOMIC_SEQ_CST);}
+
+void sim_sleep(uint64_t ns){__atomic_add_fetch(&sim_time,ns,__ATOMIC_SEQ_CST);}
+
+void sim_power_cut(long bytes){
+
+    sim_budget=bytes;
+    sim_lost=0;
+}
+
+uint8_t sim_power_lost(void){return sim_lost;}
+
+void sim_reboot(FRAM_t * const fram){FRAM_init(fram,fram->bus,fram->slave_adr);}
+
+void sim_fail(uint8_t bus, uint32_t transfers){sim_bus[bus].fail=transfers;}
+
+void sim_yield(uint8_t yield){sim_yields=yield;}
+
+const sim_stats_t* sim_get_stats(uint8_t bus){return &sim_bus[bus].stats;}
+
+void sim_clear_stats(void){
+
+    uint8_t i;
+
+    for(i=0;i<SIM_BUSES;i++)
+        memset(&sim_bus[i].stats,0,sizeof(sim_stats_t));
+}
+
+static uint32_t sim_write(uint8_t n, uint32_t slave_adr, const uint8_t * const data, uint32_t count){
+
+    sim_bus_t * const bus=&sim_bus[n];
+    uint32_t chip=SIM_CHIP(slave_adr);
+    uint32_t adr;
+    uint32_t result;
+    uint32_t i;
+
+    if(count<SIM_ADR_BYTES)
+        return SIM_I2C_MSTR_ERR_LB_NAK;
+
+    result=sim_start(bus,slave_adr,count);
+    if(result!=SIM_I2C_MSTR_NO_ERROR)
+        return result;
+
+    //the page select bit of the slave address is bit 16 of the address
+    adr=(slave_adr&1u)<<16|(uint32_t)data[0]<<8|data[1];
+
+    //the data is stored right away, a power cut drops the rest of the transfer
+    for(i=SIM_ADR_BYTES;i<count;i++){
+        if(!sim_store(bus,chip,adr,data[i]))
+            break;
+        adr=(adr+1)%SIM_CHIP_SIZE;
+    }
+
+    bus->latch[chip]=adr;
+
+    return SIM_I2C_MSTR_NO_ERROR;
+}
+
+static uint32_t sim_read(uint8_t n, uint32_t slave_adr, uint8_t * const data, uint32_t count){
+
+    sim_bus_t * const bus=&sim_bus[n];
+    uint32_t chip=SIM_CHIP(slave_adr);
+    uint32_t result;
+    uint32_t i;
+
+    if(count==0)
+        return SIM_I2C_MSTR_ERR_LB_NAK;
+
+    result=sim_start(bus,slave_adr,count);
+    if(result!=SIM_I2C_MSTR_NO_ERROR)
+        return result;
+
+    //the latch wraps around at the end of the chip
+    for(i=0;i<count;i++){
+        data[i]=bus->mem[chip][bus->latch[chip]];
+        bus->latch[chip]=(bus->latch[chip]+1)%SIM_CHIP_SIZE;
+    }
+
+    return SIM_I2C_MSTR_NO_ERROR;
+}
+
+static uint32_t sim_status(uint8_t n){
+
+    //every poll of a busy bus takes some time
+    if(sim_now()<sim_bus[n].busy_until){
+        sim_sleep(SIM_POLL_NS);
+        if(sim_yields)
+            sched_yield();
+        return SIM_I2C_MSTAT_XFER_INP;
+    }
+
+    return SIM_I2C_MSTAT_RD_CMPLT|SIM_I2C_MSTAT_WR_CMPLT;
+}
+
+//the byte by byte functions return once their byte is on the wire, so the time passes in them
+static uint32_t sim_send_start(uint8_t n, uint32_t slave_adr, uint32_t rnw){
+
+    sim_bus_t * const bus=&sim_bus[n];
+    uint32_t result;
+
+    //only writes are modelled byte by byte
+    if(rnw!=SIM_I2C_WRITE_XFER_MODE||bus->manual_slave!=0)
+        return SIM_I2C_MSTR_NOT_READY;
+
+    result=sim_start(bus,slave_adr,0);
+    if(result!=SIM_I2C_MSTR_NO_ERROR)
+        return result;
+
+    bus->manual_slave=slave_adr;
+    bus->manual_count=0;
+    bus->manual_adr=(slave_adr&1u)<<16;
+    sim_sleep(SIM_BYTE_NS);
+
+    return SIM_I2C_MSTR_NO_ERROR;
+}
+
+static uint32_t sim_write_byte(uint8_t n, uint32_t byte){
+
+    sim_bus_t * const bus=&sim_bus[n];
+    const uint32_t chip=SIM_CHIP(bus->manual_slave);
+
+    if(bus->manual_slave==0)
+        return SIM_I2C_MSTR_NOT_READY;
+
+    bus->busy_until=sim_now()+SIM_BYTE_NS;
+    bus->stats.bytes++;
+    bus->stats.busy_ns+=SIM_BYTE_NS;
+    sim_sleep(SIM_BYTE_NS);
+
+    //the address bytes come first, the page select bit of the slave address is bit 16 of the address
+    if(bus->manual_count<SIM_ADR_BYTES)
+        bus->manual_adr|=(byte&0xffu)<<(8u*(SIM_ADR_BYTES-1u-bus->manual_count));
+    else if(sim_store(bus,chip,bus->manual_adr,(uint8_t)byte))
+        bus->manual_adr=(bus->manual_adr+1)%SIM_CHIP_SIZE;
+
+    bus->manual_count++;
+
+    return SIM_I2C_MSTR_NO_ERROR;
+}
+
+static uint32_t sim_send_stop(uint8_t n){
+
+    sim_bus_t * const bus=&sim_bus[n];
+
+    if(bus->manual_slave==0)
+        return SIM_I2C_MSTR_NOT_READY;
+
+    if(bus->manual_count>=SIM_ADR_BYTES)
+        bus->latch[SIM_CHIP(bus->manual_slave)]=bus->manual_adr;
+    bus->manual_slave=0;
+
+    return SIM_I2C_MSTR_NO_ERROR;
+}
+
+//stores a written byte, returns 0 if the power was cut before it
+static uint8_t sim_store(sim_bus_t * const bus, uint32_t chip, uint32_t adr, uint8_t byte){
+
+    if(sim_budget==0){
+        sim_lost=1;
+        return 0;
+    }
+    if(sim_budget>0)
+        sim_budget--;
+
+    bus->mem[chip][adr]=byte;
+
+    return 1;
+}
+
+static uint32_t sim_start(sim_bus_t * const bus, uint32_t slave_adr, uint32_t count){
+
+    uint64_t start=sim_now();
+    uint64_t duration=(uint64_t)(count+1u)*SIM_BYTE_NS;
+
+    //like the I2C master of the PSoC, a transfer can not be started while the previous one is running
+    if(bus->busy_until>start){
+        bus->stats.refused++;
+        return SIM_I2C_MSTR_NOT_READY;
+    }
+
+    if(bus->fail>0||(slave_adr&0x78u)!=0x50u){
+        if(bus->fail>0)
+            bus->fail--;
+        bus->stats.naks++;
+        return SIM_I2C_MSTR_ERR_LB_NAK;
+    }
+
+    bus->busy_until=start+duration;
+    bus->stats.transfers++;
+    bus->stats.bytes+=count+1u;
+    bus->stats.busy_ns+=duration;
+
+    return SIM_I2C_MSTR_NO_ERROR;
+}
+
+static void sim_critical_init(void){
+
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr,PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&sim_critical,&attr);
+}
+
+uint8_t CyEnterCriticalSection(void){
+
+    //stands in for disabling the interrupts, the threads of a test act as tasks and interrupt handlers
+    pthread_once(&sim_once,sim_critical_init);
+    pthread_mutex_lock(&sim_critical);
+
+    return 0;
+}
+
+void CyExitCriticalSection(uint8_t savedIntrStatus){
+
+    (void)savedIntrStatus;
+    pthread_mutex_unlock(&sim_critical);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,146 @@
+/**
+ * @file sim.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Host model of up to SIM_BUSES I2C instances with FM24V10 chips, used by the tests and benchmarks.
+ * Every bus runs one transfer at a time and takes SIM_BYTE_NS per byte on the wire, like an I2C bus at 400 kHz.
+ * The buses run independently of each other: a transfer started on one bus does not delay the others,
+ * so transfers spread over several buses finish in parallel. Starting a transfer on a busy bus fails with SIM_I2C_MSTR_NOT_READY.
+ * The time is simulated and shared by all threads. Every call of "_I2CMasterStatus" on a busy bus lets SIM_POLL_NS pass,
+ * so the time advances while the driver waits for a bus. Writes can also be sent byte by byte with "_I2CMasterSendStart", "_I2CMasterWriteByte"
+ * and "_I2CMasterSendStop" as one transfer, these return once their byte is on the wire.
+ *
+ * The chips keep their content until "sim_reset". A power cut stops all writes after a given number of bytes,
+ * which leaves a write torn like a reset of the PSoC in the middle of a transfer.
+ */
+
+#if !defined(SIM_H)
+#define SIM_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdint.h>
+#include <project.h>
+#include "FRAM.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define SIM_BUSES               4u                      //number of I2C instances, SIM0 to SIM3
+#define SIM_CHIPS               4u                      //number of chips per bus, slave addresses 0x50, 0x52, 0x54 and 0x56
+#define SIM_CHIP_SIZE           0x20000u                //bytes of a chip
+#define SIM_BYTE_NS             22500u                  //time of a byte on the bus: 9 clocks at 400 kHz
+#define SIM_POLL_NS             1000u                   //time of one call of "_I2CMasterStatus" while the bus is busy
+
+/*******************************************************************************
+**                      Typedefs                                              **
+*******************************************************************************/
+/**
+Statistics of a bus
+*/
+typedef struct {
+    uint32_t    transfers;                              //number of started transfers
+    uint32_t    naks;                                   //number of transfers refused by "sim_fail"
+    uint32_t    refused;                                //number of transfers started while the bus was busy, answered with SIM_I2C_MSTR_NOT_READY
+    uint64_t    bytes;                                  //number of bytes on the wire, with the slave address bytes
+    uint64_t    busy_ns;                                //time the bus was busy
+} sim_stats_t;
+
+/*******************************************************************************
+**                      Declarations                                          **
+*******************************************************************************/
+extern const FRAM_i2c_t sim_i2c[SIM_BUSES];            //API of the I2C instances for "FRAM_bus_init"
+
+/**
+Clear all chips, statistics and faults, and restart the time at 0
+*/
+void        sim_reset(void);
+
+/**
+Get the memory of a chip
+
+@param bus number of the bus
+@param slave_adr slave address of the chip, the page select bit is ignored
+@return pointer to the SIM_CHIP_SIZE bytes of the chip
+*/
+uint8_t*    sim_mem(uint8_t bus, uint8_t slave_adr);
+
+/**
+Get the simulated time in ns
+*/
+uint64_t    sim_now(void);
+
+/**
+Let time pass, e.g. to model the work of the CPU
+*/
+void        sim_sleep(uint64_t ns);
+
+/**
+Cut the power after a number of written data bytes
+
+The address latch of a chip stays where the cut write stopped, while the driver still expects it behind the whole write.
+Call "sim_reboot" after the power cut, like after a reset.
+
+@param bytes number of bytes still written to the chips of all buses, -1 to never cut the power
+*/
+void        sim_power_cut(long bytes);
+
+/**
+Check if the power was cut
+
+@return 1 if a write lost bytes since the last "sim_power_cut"
+*/
+uint8_t     sim_power_lost(void);
+
+/**
+Reset the driver of a chip like after a power up
+
+The chip keeps its memory, the driver forgets the address latch of the chip and its statistics. The modules on the chip have to be mounted again.
+
+@param fram the chip, it stays on its bus and slave address
+*/
+void        sim_reboot(FRAM_t * const fram);
+
+/**
+Refuse transfers of a bus
+
+@param bus number of the bus
+@param transfers number of following transfers answered with SIM_I2C_MSTR_ERR_LB_NAK
+*/
+void        sim_fail(uint8_t bus, uint32_t transfers);
+
+/**
+Let other threads run while a thread polls a busy bus
+
+Like the scheduler of an RTOS does for tasks of the same priority. Otherwise a thread may finish long transfers
+within one time slice of the host, before the other threads had a chance to ask for the bus. Off after "sim_reset".
+
+@param yield 1 to yield the host CPU on every poll of a busy bus, 0 to poll without yielding
+*/
+void        sim_yield(uint8_t yield);
+
+/**
+Get the statistics of a bus
+*/
+const sim_stats_t* sim_get_stats(uint8_t bus);
+
+/**
+Clear the statistics of all buses
+*/
+void        sim_clear_stats(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* (SIM_H) */
+
+/* [] END OF FILE */
@@ -0,0 +1,43 @@
+/**
+ * @file test.h
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Checks of the host tests. A failed check prints its location and ends the test with exit code 1.
+ */
+
+#if !defined(TEST_H)
+#define TEST_H
+
+/*******************************************************************************
+**                      Includes                                              **
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+/*******************************************************************************
+**                      Macros                                                **
+*******************************************************************************/
+#define CHECK(cond)             do{ if(!(cond)){ printf("%s:%d: check failed: %s\n",__FILE__,__LINE__,#cond); exit(1); } }while(0)
+#define CHECK_EQ(a,b)           do{ unsigned long long _a=(unsigned long long)(a), _b=(unsigned long long)(b); \
+                                    if(_a!=_b){ printf("%s:%d: check failed: %s == %s (0x%llx != 0x%llx)\n",__FILE__,__LINE__,#a,#b,_a,_b); exit(1); } }while(0)
+
+static unsigned long long test_state=0x9e3779b97f4a7c15ull;
+
+//xorshift, so the tests run the same on every host
+static inline unsigned test_rand(void){
+
+    test_state^=test_state<<13;
+    test_state^=test_state>>7;
+    test_state^=test_state<<17;
+
+    return (unsigned)(test_state>>11);
+}
+
+static inline void test_seed(unsigned long long seed){test_state=seed*0x9e3779b97f4a7c15ull+1u;}
+
+#endif /* (TEST_H) */
+
+/* [] END OF FILE */
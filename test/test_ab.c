@@ -0,0 +1,138 @@
+/**
+ * @file test_ab.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * A/B record: 200 writes of random length, each cut by a power loss at every byte. A mount after the cut returns the previous copy,
+ * or the new one once the write is complete, and FRAM_AB_EMPTY before the first write. The sequence numbers wrap around.
+ */
+
+#include <string.h>
+#include "FRAM_ab.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x400u
+#define CAPACITY                100u
+#define WRITES                  200u
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+
+static void check_data(FRAM_ab_t * const ab, const uint8_t * const expect, uint16_t length){
+
+    uint8_t buffer[CAPACITY];
+    uint16_t count;
+
+    CHECK_EQ(FRAM_ab_read(ab,buffer,sizeof(buffer),&count),FRAM_NO_ERROR);
+    CHECK_EQ(count,length);
+    CHECK(memcmp(buffer,expect,length)==0);
+}
+
+static void test_cut(void){
+
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    uint8_t saved[FRAM_AB_SIZE(CAPACITY)];
+    uint8_t data[CAPACITY];
+    uint8_t current[CAPACITY];
+    uint16_t length=0;
+    uint16_t count;
+    uint32_t points=0;
+    uint32_t i;
+    uint16_t k;
+    FRAM_ab_t ab;
+    FRAM_ab_t cut;
+    FRAM_ab_t mounted;
+    long budget;
+    uint8_t lost;
+
+    CHECK_EQ(FRAM_ab_init(&ab,&fram,BASE,CAPACITY),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ab_format(&ab),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ab_mount(&ab),FRAM_AB_EMPTY);
+    CHECK_EQ(FRAM_ab_read(&ab,data,sizeof(data),&count),FRAM_AB_EMPTY);
+
+    for(i=0;i<WRITES;i++){
+
+        count=1+test_rand()%CAPACITY;
+        for(k=0;k<count;k++)
+            data[k]=(uint8_t)test_rand();
+
+        //every cut starts from the region as it was before the write
+        memcpy(saved,mem+BASE,sizeof(saved));
+        for(budget=0;;budget++){
+
+            cut=ab;
+            sim_power_cut(budget);
+            FRAM_ab_write(&cut,data,count);
+            lost=sim_power_lost();
+            sim_power_cut(-1);
+            points++;
+
+            sim_reboot(&fram);
+            CHECK_EQ(FRAM_ab_init(&mounted,&fram,BASE,CAPACITY),FRAM_NO_ERROR);
+            if(!lost){
+                CHECK_EQ(FRAM_ab_mount(&mounted),FRAM_NO_ERROR);
+                check_data(&mounted,data,count);
+                break;
+            }
+
+            if(length==0)
+                CHECK_EQ(FRAM_ab_mount(&mounted),FRAM_AB_EMPTY);
+            else{
+                CHECK_EQ(FRAM_ab_mount(&mounted),FRAM_NO_ERROR);
+                check_data(&mounted,current,length);
+            }
+            memcpy(mem+BASE,saved,sizeof(saved));
+        }
+
+        CHECK_EQ(FRAM_ab_write(&ab,data,count),FRAM_NO_ERROR);
+        memcpy(current,data,count);
+        length=count;
+        check_data(&ab,current,length);
+    }
+
+    CHECK_EQ(FRAM_ab_write(&ab,data,0),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_ab_write(&ab,data,CAPACITY+1),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_ab_read(&ab,data,length-1,&count),FRAM_PARAMTER_ERROR);
+
+    printf("ab: %u writes cut at %u points\n",WRITES,points);
+}
+
+static void test_wrap(void){
+
+    uint8_t data[4];
+    uint32_t i;
+    FRAM_ab_t ab;
+
+    CHECK_EQ(FRAM_ab_init(&ab,&fram,BASE,CAPACITY),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ab_format(&ab),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ab_mount(&ab),FRAM_AB_EMPTY);
+
+    //the newer copy wins while the sequence numbers pass 0xffffffff
+    ab.seq=0xfffffffcu;
+    for(i=0;i<8;i++){
+        memset(data,i,sizeof(data));
+        CHECK_EQ(FRAM_ab_write(&ab,data,sizeof(data)),FRAM_NO_ERROR);
+        CHECK_EQ(FRAM_ab_init(&ab,&fram,BASE,CAPACITY),FRAM_NO_ERROR);
+        CHECK_EQ(FRAM_ab_mount(&ab),FRAM_NO_ERROR);
+        CHECK_EQ(ab.seq,0xfffffffdu+i);
+        check_data(&ab,data,sizeof(data));
+    }
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_cut();
+    test_wrap();
+
+    printf("ab: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,102 @@
+/**
+ * @file test_array.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Linear address space over three chips on one bus: random ranges, also across the ends of the chips and the page select boundary,
+ * land on the right chip at the right address and read back unchanged. Every chip keeps its own address latch, so sequential reads
+ * alternating between two chips set the address of each chip once.
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "test.h"
+
+#define CHIPS                   3u
+#define SIZE                    (CHIPS*SIM_CHIP_SIZE)
+#define ROUNDS                  4000u
+
+static uint8_t model[SIZE];
+static uint8_t buffer[SIZE];
+
+int main(void){
+
+    FRAM_bus_t bus;
+    FRAM_t fram[CHIPS];
+    FRAM_t * const devices[CHIPS]={&fram[0],&fram[1],&fram[2]};
+    const FRAM_array_t array={devices,CHIPS};
+    uint32_t adr;
+    uint32_t count;
+    uint32_t chip;
+    uint32_t i;
+    uint32_t round;
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    for(chip=0;chip<CHIPS;chip++)
+        FRAM_init(&fram[chip],&bus,FRAM_SLAVE_ADR+2*chip);
+
+    CHECK_EQ(FRAM_array_get_adr_max(&array),SIZE-1);
+    CHECK_EQ(FRAM_array_write_to_adr(&array,SIZE-1,buffer,2),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_array_write_to_adr(&array,0,NULL,1),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_array_read_from_adr(&array,SIZE,buffer,1),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_array_read_from_adr(&array,0,buffer,0),FRAM_PARAMTER_ERROR);
+
+    //a write across the end of a chip is split into one write per chip
+    for(i=0;i<64;i++)
+        buffer[i]=(uint8_t)(i+1);
+    FRAM_clear_stats(&fram[0]);
+    FRAM_clear_stats(&fram[1]);
+    CHECK_EQ(FRAM_array_write_to_adr(&array,SIM_CHIP_SIZE-32,buffer,64),FRAM_NO_ERROR);
+    memcpy(&model[SIM_CHIP_SIZE-32],buffer,64);
+    CHECK_EQ(fram[0].stats.bytes_written,32);
+    CHECK_EQ(fram[1].stats.bytes_written,32);
+    CHECK(memcmp(sim_mem(0,FRAM_SLAVE_ADR)+SIM_CHIP_SIZE-32,buffer,32)==0);
+    CHECK(memcmp(sim_mem(0,FRAM_SLAVE_ADR+2),buffer+32,32)==0);
+
+    //random ranges against a model of the address space, some of them across a whole chip
+    for(round=0;round<ROUNDS;round++){
+
+        adr=test_rand()%SIZE;
+        count=1+test_rand()%(test_rand()%50==0?SIM_CHIP_SIZE+1000:300);
+        if(count>SIZE-adr)
+            count=SIZE-adr;
+
+        if(test_rand()%2){
+            for(i=0;i<count;i++)
+                buffer[i]=(uint8_t)test_rand();
+            CHECK_EQ(FRAM_array_write_to_adr(&array,adr,buffer,count),FRAM_NO_ERROR);
+            memcpy(&model[adr],buffer,count);
+        }
+        else{
+            CHECK_EQ(FRAM_array_read_from_adr(&array,adr,buffer,count),FRAM_NO_ERROR);
+            CHECK(memcmp(buffer,&model[adr],count)==0);
+        }
+    }
+
+    //chip n holds the addresses n*SIM_CHIP_SIZE to (n+1)*SIM_CHIP_SIZE-1
+    for(chip=0;chip<CHIPS;chip++)
+        CHECK(memcmp(sim_mem(0,FRAM_SLAVE_ADR+2*chip),&model[chip*SIM_CHIP_SIZE],SIM_CHIP_SIZE)==0);
+
+    //sequential reads alternating between the first and the last chip hit the latch of each chip
+    CHECK_EQ(FRAM_array_read_from_adr(&array,0x1000,buffer,16),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_array_read_from_adr(&array,2*SIM_CHIP_SIZE+0x1000,buffer,16),FRAM_NO_ERROR);
+    FRAM_clear_stats(&fram[0]);
+    FRAM_clear_stats(&fram[2]);
+    for(i=1;i<100;i++){
+        CHECK_EQ(FRAM_array_read_from_adr(&array,0x1000+i*16,buffer,16),FRAM_NO_ERROR);
+        CHECK(memcmp(buffer,&model[0x1000+i*16],16)==0);
+        CHECK_EQ(FRAM_array_read_from_adr(&array,2*SIM_CHIP_SIZE+0x1000+i*16,buffer,16),FRAM_NO_ERROR);
+        CHECK(memcmp(buffer,&model[2*SIM_CHIP_SIZE+0x1000+i*16],16)==0);
+    }
+    CHECK_EQ(fram[0].stats.set_adrs,0);
+    CHECK_EQ(fram[2].stats.set_adrs,0);
+    CHECK_EQ(fram[0].stats.latch_hits,99);
+
+    printf("array: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,197 @@
+/**
+ * @file test_btree.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * B+tree over a whole FM24V10: random inserts and replaced values match a model after a remount, a lookup costs at most two reads
+ * and range scans return the keys of the model in order. Ascending keys fill the leaves, so a full scan hits the address latch.
+ * An ascending insert without a split cut by a power loss at every byte either adds the key or not, the other keys stay.
+ */
+
+#include <string.h>
+#include "FRAM_btree.h"
+#include "sim.h"
+#include "test.h"
+
+#define SIZE                    0x20000u
+#define KEYS                    20000u
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_btree_t tree;
+static uint32_t model[KEYS];
+static uint8_t present[KEYS];
+
+//mounts the tree again after a reset
+static void remount(void){
+
+    sim_reboot(&fram);
+    CHECK_EQ(FRAM_btree_init(&tree,&fram,0,SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_btree_mount(&tree),FRAM_NO_ERROR);
+}
+
+static void test_random(void){
+
+    FRAM_btree_cursor_t cursor;
+    uint32_t reads_max=0;
+    uint32_t reads;
+    uint32_t result;
+    uint32_t value;
+    uint32_t key;
+    uint32_t first;
+    uint32_t last;
+    uint32_t expect;
+    uint32_t count;
+    uint32_t prev=0;
+    uint32_t i;
+    uint32_t k;
+
+    CHECK_EQ(FRAM_btree_init(&tree,&fram,0,SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_btree_mount(&tree),FRAM_BTREE_NO_TREE);
+    CHECK_EQ(FRAM_btree_format(&tree),FRAM_NO_ERROR);
+
+    //keys are multiples of 3, about every second insert replaces a value
+    for(i=0;i<2*KEYS;i++){
+        k=test_rand()%KEYS;
+        value=test_rand();
+        result=FRAM_btree_insert(&tree,k*3,value);
+        if(result==FRAM_MEMORY_ERROR)
+            break;
+        CHECK_EQ(result,FRAM_NO_ERROR);
+        model[k]=value;
+        present[k]=1;
+    }
+
+    remount();
+    CHECK(tree.height<=3);
+
+    for(k=0;k<KEYS;k++){
+        reads=fram.stats.reads;
+        result=FRAM_btree_find(&tree,k*3,&value);
+        if(fram.stats.reads-reads>reads_max)
+            reads_max=fram.stats.reads-reads;
+
+        if(present[k]){
+            CHECK_EQ(result,FRAM_NO_ERROR);
+            CHECK_EQ(value,model[k]);
+        }
+        else
+            CHECK_EQ(result,FRAM_BTREE_NOT_FOUND);
+        CHECK_EQ(FRAM_btree_find(&tree,k*3+1,&value),FRAM_BTREE_NOT_FOUND);
+    }
+    CHECK(reads_max<=2);
+
+    //range scans in key order
+    for(i=0;i<200;i++){
+        first=test_rand()%(3*KEYS);
+        last=first+test_rand()%5000;
+        for(expect=0,k=0;k<KEYS;k++)
+            expect+=present[k]&&k*3>=first&&k*3<=last;
+
+        CHECK_EQ(FRAM_btree_seek(&tree,&cursor,first,last),FRAM_NO_ERROR);
+        for(count=0;(result=FRAM_btree_next(&tree,&cursor,&key,&value))==FRAM_NO_ERROR;count++){
+            CHECK(key>=first&&key<=last&&key%3==0);
+            CHECK(count==0||key>prev);
+            CHECK(present[key/3]);
+            CHECK_EQ(value,model[key/3]);
+            prev=key;
+        }
+        CHECK_EQ(result,FRAM_BTREE_NOT_FOUND);
+        CHECK_EQ(count,expect);
+    }
+    CHECK_EQ(FRAM_btree_seek(&tree,&cursor,10,9),FRAM_PARAMTER_ERROR);
+
+    printf("btree: random keys, height %u, at most %u reads per lookup\n",tree.height,reads_max);
+}
+
+static void test_ascending(void){
+
+    FRAM_btree_cursor_t cursor;
+    uint32_t result;
+    uint32_t value;
+    uint32_t key;
+    uint32_t prev=0;
+    uint32_t count;
+    uint32_t reads;
+    uint32_t hits;
+
+    CHECK_EQ(FRAM_btree_format(&tree),FRAM_NO_ERROR);
+
+    for(count=0;(result=FRAM_btree_insert(&tree,count*10,count))==FRAM_NO_ERROR;count++);
+    CHECK_EQ(result,FRAM_MEMORY_ERROR);
+
+    //the leaves are full and follow each other, reading the next one hits the address latch. The seek reads the inner nodes below the root.
+    remount();
+    reads=fram.stats.reads;
+    hits=fram.stats.latch_hits;
+    CHECK_EQ(FRAM_btree_seek(&tree,&cursor,0,0xffffffffu),FRAM_NO_ERROR);
+    for(key=0;FRAM_btree_next(&tree,&cursor,&key,&value)==FRAM_NO_ERROR;prev++){
+        CHECK_EQ(key,prev*10);
+        CHECK_EQ(value,prev);
+    }
+    CHECK_EQ(prev,count);
+    reads=fram.stats.reads-reads;
+    hits=fram.stats.latch_hits-hits;
+    CHECK_EQ(reads,(count+FRAM_BTREE_ENTRIES-1)/FRAM_BTREE_ENTRIES+tree.height-2);
+    //only the first leaf and the leaves allocated right after an inner node miss the latch
+    CHECK(reads-hits<=tree.top-1-(count+FRAM_BTREE_ENTRIES-1)/FRAM_BTREE_ENTRIES+1);
+
+    printf("btree: %u ascending keys, a full scan takes %u reads, %u hit the address latch\n",count,reads,hits);
+}
+
+static void test_cut(void){
+
+    uint32_t result;
+    uint32_t value;
+    uint32_t key;
+    uint32_t i;
+    long budget;
+    uint8_t done;
+
+    CHECK_EQ(FRAM_btree_format(&tree),FRAM_NO_ERROR);
+
+    //an insert behind the last key of a leaf with room: the entry, then the number of keys
+    for(key=0,budget=0;key<200;key++,budget=(budget+1)%12){
+
+        if(key>0&&key%FRAM_BTREE_ENTRIES==0){
+            CHECK_EQ(FRAM_btree_insert(&tree,key,~key),FRAM_NO_ERROR);
+            continue;
+        }
+
+        sim_power_cut(budget);
+        FRAM_btree_insert(&tree,key,~key);
+        done=!sim_power_lost();
+        sim_power_cut(-1);
+
+        remount();
+        result=FRAM_btree_find(&tree,key,&value);
+        CHECK(done?result==FRAM_NO_ERROR:result==FRAM_BTREE_NOT_FOUND||result==FRAM_NO_ERROR);
+        if(result==FRAM_NO_ERROR)
+            CHECK_EQ(value,~key);
+        else
+            CHECK_EQ(FRAM_btree_insert(&tree,key,~key),FRAM_NO_ERROR);
+
+        for(i=0;i<=key;i++){
+            CHECK_EQ(FRAM_btree_find(&tree,i,&value),FRAM_NO_ERROR);
+            CHECK_EQ(value,~i);
+        }
+    }
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_random();
+    test_ascending();
+    test_cut();
+
+    printf("btree: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,210 @@
+/**
+ * @file test_chk.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Checked region: "FRAM_chk_crc" gives the check value of CRC-16/CCITT-FALSE and matches the bitwise CRC on random data, also in pieces.
+ * 20000 random partial writes and reads match a model. 2000 single bit flips in blocks or CRCs are found by a read, by a partial write,
+ * which leaves the block as it is, and by a scrub. A whole block write cut by a power loss at every byte reads back as the old block,
+ * the new block or FRAM_CHK_MISMATCH.
+ */
+
+#include <string.h>
+#include "FRAM_chk.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x100u
+#define BLOCKS                  1024u
+#define SIZE                    (BLOCKS*FRAM_CHK_BLOCK_SIZE)
+#define ROUNDS                  20000u
+#define FLIPS                   2000u
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_chk_t chk;
+static uint8_t model[SIZE];
+static uint8_t buffer[SIZE];
+
+//CRC-16/CCITT-FALSE bit by bit, like the modules computed it before
+static uint16_t crc_bitwise(uint16_t crc, const uint8_t * const data, uint32_t count){
+
+    uint32_t i;
+    uint8_t bit;
+
+    for(i=0;i<count;i++){
+        crc^=(uint16_t)data[i]<<8;
+        for(bit=0;bit<8;bit++)
+            crc=crc&0x8000u?(uint16_t)(crc<<1)^0x1021u:(uint16_t)(crc<<1);
+    }
+
+    return crc;
+}
+
+static void test_crc(void){
+
+    uint32_t count;
+    uint32_t split;
+    uint32_t i;
+    uint32_t k;
+
+    CHECK_EQ(FRAM_chk_crc(FRAM_CHK_CRC_INIT,(const uint8_t*)"123456789",9),0x29b1);
+    CHECK_EQ(FRAM_chk_crc(FRAM_CHK_CRC_INIT,buffer,0),FRAM_CHK_CRC_INIT);
+
+    for(k=0;k<1000;k++){
+        count=test_rand()%300;
+        for(i=0;i<count;i++)
+            buffer[i]=(uint8_t)test_rand();
+        split=count>0?test_rand()%count:0;
+
+        CHECK_EQ(FRAM_chk_crc(FRAM_CHK_CRC_INIT,buffer,count),crc_bitwise(FRAM_CHK_CRC_INIT,buffer,count));
+        CHECK_EQ(FRAM_chk_crc(FRAM_chk_crc(FRAM_CHK_CRC_INIT,buffer,split),&buffer[split],count-split),crc_bitwise(FRAM_CHK_CRC_INIT,buffer,count));
+    }
+}
+
+static void test_random(void){
+
+    uint32_t round;
+    uint32_t adr;
+    uint32_t count;
+    uint32_t i;
+
+    CHECK_EQ(FRAM_chk_init(&chk,&fram,BASE,BLOCKS*FRAM_CHK_SLOT_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_chk_format(&chk),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_chk_get_size(&chk),SIZE);
+    CHECK_EQ(FRAM_chk_get_bad(&chk),FRAM_INVALID_ADR);
+    memset(model,0,sizeof(model));
+
+    for(round=0;round<ROUNDS;round++){
+
+        adr=test_rand()%SIZE;
+        count=1+test_rand()%(test_rand()%4?100:3000);
+        if(count>SIZE-adr)
+            count=SIZE-adr;
+
+        if(test_rand()%2){
+            for(i=0;i<count;i++)
+                buffer[i]=(uint8_t)test_rand();
+            CHECK_EQ(FRAM_chk_write_to_adr(&chk,adr,buffer,count),FRAM_NO_ERROR);
+            memcpy(&model[adr],buffer,count);
+        }
+        else{
+            CHECK_EQ(FRAM_chk_read_from_adr(&chk,adr,buffer,count),FRAM_NO_ERROR);
+            CHECK(memcmp(buffer,&model[adr],count)==0);
+        }
+    }
+
+    CHECK_EQ(FRAM_chk_read_from_adr(&chk,0,buffer,SIZE),FRAM_NO_ERROR);
+    CHECK(memcmp(buffer,model,SIZE)==0);
+    CHECK_EQ(FRAM_chk_scrub(&chk,0,BLOCKS),FRAM_NO_ERROR);
+    CHECK_EQ(chk.stats.mismatches,0);
+
+    CHECK_EQ(FRAM_chk_write_to_adr(&chk,0,NULL,1),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_chk_write_to_adr(&chk,SIZE-1,buffer,2),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_chk_read_from_adr(&chk,0,buffer,0),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_chk_scrub(&chk,BLOCKS-1,2),FRAM_PARAMTER_ERROR);
+}
+
+static void test_flips(void){
+
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    uint8_t slot[FRAM_CHK_SLOT_SIZE];
+    uint32_t block;
+    uint32_t k;
+    uint8_t *flip;
+    uint8_t bit;
+
+    for(k=0;k<FLIPS;k++){
+
+        block=test_rand()%BLOCKS;
+        flip=&mem[BASE+block*FRAM_CHK_SLOT_SIZE+test_rand()%FRAM_CHK_SLOT_SIZE];
+        bit=1u<<(test_rand()%8);
+        *flip^=bit;
+        memcpy(slot,&mem[BASE+block*FRAM_CHK_SLOT_SIZE],sizeof(slot));
+
+        //the data in front of the bad block is read
+        CHECK_EQ(FRAM_chk_read_from_adr(&chk,block*FRAM_CHK_BLOCK_SIZE-(block>0),buffer,1+(block>0)),FRAM_CHK_MISMATCH);
+        CHECK_EQ(FRAM_chk_get_bad(&chk),block);
+        if(block>0)
+            CHECK_EQ(buffer[0],model[block*FRAM_CHK_BLOCK_SIZE-1]);
+
+        //a partial write does not cover the damage with a new CRC
+        CHECK_EQ(FRAM_chk_write_to_adr(&chk,block*FRAM_CHK_BLOCK_SIZE+1,buffer,3),FRAM_CHK_MISMATCH);
+        CHECK(memcmp(slot,&mem[BASE+block*FRAM_CHK_SLOT_SIZE],sizeof(slot))==0);
+
+        //a scrub stops at the bad block
+        CHECK_EQ(FRAM_chk_scrub(&chk,block-(block>0),1+(block>0)+(block+1<BLOCKS)),FRAM_CHK_MISMATCH);
+        CHECK_EQ(FRAM_chk_get_bad(&chk),block);
+
+        *flip^=bit;
+    }
+
+    CHECK_EQ(FRAM_chk_scrub(&chk,0,BLOCKS),FRAM_NO_ERROR);
+    printf("chk: %u single bit flips found by read, partial write and scrub\n",FLIPS);
+}
+
+static void test_cut(void){
+
+    uint8_t data[FRAM_CHK_BLOCK_SIZE];
+    uint32_t mismatches=0;
+    uint32_t result;
+    uint32_t block;
+    uint32_t i;
+    long budget;
+    uint8_t lost;
+
+    for(block=0;block<100;block++){
+
+        for(i=0;i<sizeof(data);i++)
+            data[i]=(uint8_t)test_rand();
+
+        for(budget=0;;budget++){
+
+            //every cut starts from the old block
+            CHECK_EQ(FRAM_chk_write_to_adr(&chk,block*FRAM_CHK_BLOCK_SIZE,&model[block*FRAM_CHK_BLOCK_SIZE],FRAM_CHK_BLOCK_SIZE),FRAM_NO_ERROR);
+
+            sim_power_cut(budget);
+            FRAM_chk_write_to_adr(&chk,block*FRAM_CHK_BLOCK_SIZE,data,sizeof(data));
+            lost=sim_power_lost();
+            sim_power_cut(-1);
+
+            sim_reboot(&fram);
+            result=FRAM_chk_read_from_adr(&chk,block*FRAM_CHK_BLOCK_SIZE,buffer,FRAM_CHK_BLOCK_SIZE);
+            if(!lost){
+                CHECK_EQ(result,FRAM_NO_ERROR);
+                CHECK(memcmp(buffer,data,sizeof(data))==0);
+                break;
+            }
+
+            if(result==FRAM_CHK_MISMATCH)
+                mismatches++;
+            else{
+                CHECK_EQ(result,FRAM_NO_ERROR);
+                CHECK(memcmp(buffer,&model[block*FRAM_CHK_BLOCK_SIZE],sizeof(data))==0||memcmp(buffer,data,sizeof(data))==0);
+            }
+        }
+        memcpy(&model[block*FRAM_CHK_BLOCK_SIZE],data,sizeof(data));
+    }
+
+    CHECK(mismatches>0);
+    printf("chk: 100 block writes cut at every byte, %u cuts left a block failing its CRC\n",mismatches);
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_crc();
+    test_random();
+    test_flips();
+    test_cut();
+
+    printf("chk: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,229 @@
+/**
+ * @file test_ckpt.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Incremental checkpoint: a save writes only the chunks dirtied since the last save, neighbouring chunks with one write,
+ * also the short last chunk of an image, and a restore after a reset gives the image back. A save refused by the bus is completed by the next one.
+ * 3000 saves of random changes, a third of them cut by a power loss at a random byte, with and without a journal:
+ * with the journal the restored image is the previous or the new one, without it every byte is old or new and only chunks written at the cut are mixed.
+ */
+
+#include <string.h>
+#include "FRAM_ckpt.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x100u
+#define JOURNAL                 0x8000u
+#define JOURNAL_SIZE            0x8000u
+#define IMAGE                   (FRAM_CKPT_CHUNKS*FRAM_CKPT_CHUNK_SIZE)
+#define SHORT                   1000u                   //size of an image with a short last chunk
+#define SAVES                   3000u
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_txn_t txn;
+static FRAM_ckpt_t ckpt;
+static uint8_t image[IMAGE];
+static uint8_t saved[IMAGE];
+static uint8_t next[IMAGE];
+
+//mounts the checkpoint again after a reset, the image in RAM is gone
+static uint32_t remount(FRAM_txn_t * const journal, uint32_t size){
+
+    memset(image,0,sizeof(image));
+    sim_reboot(&fram);
+    if(journal!=NULL)
+        CHECK_EQ(FRAM_txn_init(journal,&fram,JOURNAL,JOURNAL_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ckpt_init(&ckpt,&fram,journal,BASE,image,size),FRAM_NO_ERROR);
+
+    return FRAM_ckpt_restore(&ckpt);
+}
+
+//changes fields of 8 bytes at random addresses
+static void change(uint32_t size, uint32_t fields){
+
+    uint32_t adr;
+    uint32_t i;
+
+    while(fields--){
+        adr=test_rand()%(size-7u);
+        for(i=0;i<8;i++)
+            image[adr+i]++;
+    }
+}
+
+//saves the image and checks the chunks and writes it took
+static void check_save(uint32_t size, uint32_t chunks, uint32_t ranges){
+
+    const FRAM_ckpt_stats_t before=*FRAM_ckpt_get_stats(&ckpt);
+    const FRAM_ckpt_stats_t * const stats=FRAM_ckpt_get_stats(&ckpt);
+
+    CHECK_EQ(FRAM_ckpt_save(&ckpt),FRAM_NO_ERROR);
+    CHECK_EQ(stats->saves,before.saves+1);
+    CHECK_EQ(stats->chunks-before.chunks,chunks);
+    CHECK_EQ(stats->ranges-before.ranges,ranges);
+    CHECK(memcmp(sim_mem(0,FRAM_SLAVE_ADR)+BASE+FRAM_CKPT_HEADER,image,size)==0);
+}
+
+static void test_dirty(void){
+
+    uint32_t i;
+
+    //the region holds no checkpoint yet, so the first save writes all chunks with one write and then the header
+    CHECK_EQ(remount(NULL,IMAGE),FRAM_CKPT_EMPTY);
+    for(i=0;i<IMAGE;i++)
+        image[i]=(uint8_t)test_rand();
+    check_save(IMAGE,FRAM_CKPT_CHUNKS,1);
+    CHECK_EQ(FRAM_ckpt_get_stats(&ckpt)->bytes,IMAGE);
+    memcpy(saved,image,IMAGE);
+
+    //nothing changed, nothing written
+    FRAM_clear_stats(&fram);
+    check_save(IMAGE,0,0);
+    CHECK_EQ(fram.stats.bytes_written,0);
+
+    //a byte in chunk 5, the last byte of chunk 10 and the first of chunk 11, and the last chunk
+    image[5*FRAM_CKPT_CHUNK_SIZE+17]^=1;
+    image[11*FRAM_CKPT_CHUNK_SIZE-1]^=1;
+    image[11*FRAM_CKPT_CHUNK_SIZE]^=1;
+    image[IMAGE-1]^=1;
+    FRAM_clear_stats(&fram);
+    check_save(IMAGE,4,3);
+    CHECK_EQ(fram.stats.bytes_written,4*FRAM_CKPT_CHUNK_SIZE);
+    memcpy(saved,image,IMAGE);
+
+    //the restore reads the header and the image, after it only new changes are written
+    CHECK_EQ(remount(NULL,IMAGE),FRAM_NO_ERROR);
+    CHECK(memcmp(image,saved,IMAGE)==0);
+    check_save(IMAGE,0,0);
+    image[100]^=0x80;
+    check_save(IMAGE,1,1);
+
+    //a refused write keeps its chunks dirty for the next save
+    image[3000]^=1;
+    image[7000]^=1;
+    sim_fail(0,1);
+    CHECK(FRAM_ckpt_save(&ckpt)!=FRAM_NO_ERROR);
+    check_save(IMAGE,2,2);
+
+    //an image with a short last chunk
+    CHECK_EQ(remount(NULL,SHORT),FRAM_CKPT_EMPTY);
+    for(i=0;i<SHORT;i++)
+        image[i]=(uint8_t)test_rand();
+    check_save(SHORT,(SHORT+FRAM_CKPT_CHUNK_SIZE-1)/FRAM_CKPT_CHUNK_SIZE,1);
+    image[SHORT-1]^=1;
+    FRAM_clear_stats(&fram);
+    check_save(SHORT,1,1);
+    CHECK_EQ(fram.stats.bytes_written,SHORT%FRAM_CKPT_CHUNK_SIZE);
+    memcpy(saved,image,SHORT);
+    CHECK_EQ(remount(NULL,SHORT),FRAM_NO_ERROR);
+    CHECK(memcmp(image,saved,SHORT)==0);
+
+    //a checkpoint of another size is not restored
+    CHECK_EQ(remount(NULL,SHORT+1),FRAM_CKPT_EMPTY);
+
+    CHECK_EQ(FRAM_ckpt_init(&ckpt,&fram,NULL,BASE,NULL,SHORT),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_ckpt_init(&ckpt,&fram,NULL,BASE,image,0),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_ckpt_init(&ckpt,&fram,NULL,BASE,image,IMAGE+1),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_ckpt_init(&ckpt,&fram,NULL,fram.adr_max-IMAGE,image,IMAGE),FRAM_PARAMTER_ERROR);
+}
+
+//checks the image restored after a save cut by a power loss, returns the number of chunks mixing old and new bytes
+static uint32_t check_cut(uint8_t journal){
+
+    uint32_t mixed=0;
+    uint32_t chunk;
+    uint32_t i;
+
+    if(journal){
+        CHECK(memcmp(image,saved,IMAGE)==0||memcmp(image,next,IMAGE)==0);
+        return 0;
+    }
+
+    for(chunk=0;chunk<FRAM_CKPT_CHUNKS;chunk++){
+        i=chunk*FRAM_CKPT_CHUNK_SIZE;
+        if(memcmp(&image[i],&saved[i],FRAM_CKPT_CHUNK_SIZE)==0||memcmp(&image[i],&next[i],FRAM_CKPT_CHUNK_SIZE)==0)
+            continue;
+        for(;i<(chunk+1)*FRAM_CKPT_CHUNK_SIZE;i++)
+            CHECK(image[i]==saved[i]||image[i]==next[i]);
+        mixed++;
+    }
+
+    return mixed;
+}
+
+static void test_cut(uint8_t journal){
+
+    FRAM_txn_t * const redo=journal?&txn:NULL;
+    uint32_t mixed=0;
+    uint32_t cuts=0;
+    uint32_t old=0;
+    uint32_t save;
+    uint32_t result;
+    uint32_t i;
+    uint8_t lost;
+
+    memset(sim_mem(0,FRAM_SLAVE_ADR)+BASE,0xa5,FRAM_CKPT_SIZE(IMAGE));
+    memset(sim_mem(0,FRAM_SLAVE_ADR)+JOURNAL,0,JOURNAL_SIZE);
+    CHECK_EQ(remount(redo,IMAGE),FRAM_CKPT_EMPTY);
+    for(i=0;i<IMAGE;i++)
+        image[i]=(uint8_t)test_rand();
+    CHECK_EQ(FRAM_ckpt_save(&ckpt),FRAM_NO_ERROR);
+    memcpy(saved,image,IMAGE);
+
+    for(save=0;save<SAVES;save++){
+
+        change(IMAGE,test_rand()%(IMAGE/8u*20u/100u));
+        memcpy(next,image,IMAGE);
+
+        if(test_rand()%3){
+            CHECK_EQ(FRAM_ckpt_save(&ckpt),FRAM_NO_ERROR);
+            memcpy(saved,image,IMAGE);
+            continue;
+        }
+
+        sim_power_cut(test_rand()%(journal?20000u:9000u));
+        result=FRAM_ckpt_save(&ckpt);
+        lost=sim_power_lost();
+        if(!lost)
+            CHECK_EQ(result,FRAM_NO_ERROR);
+        sim_power_cut(-1);
+
+        CHECK_EQ(remount(redo,IMAGE),FRAM_NO_ERROR);
+        i=check_cut(journal);
+        CHECK(i<=1);
+        mixed+=i;
+        old+=lost&&memcmp(image,saved,IMAGE)==0;
+        memcpy(saved,image,IMAGE);
+        cuts+=lost;
+    }
+
+    //the last image is restored as it was saved
+    CHECK_EQ(remount(redo,IMAGE),FRAM_NO_ERROR);
+    CHECK(memcmp(image,saved,IMAGE)==0);
+
+    if(journal)
+        printf("ckpt: %u saves with a journal, %u cut by a power loss, %u restored the previous image and %u the new one\n",SAVES,cuts,old,cuts-old);
+    else
+        printf("ckpt: %u saves without a journal, %u cut by a power loss, %u chunks mixing old and new bytes\n",SAVES,cuts,mixed);
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_dirty();
+    test_cut(0);
+    test_cut(1);
+
+    printf("ckpt: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
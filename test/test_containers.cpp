@@ -0,0 +1,164 @@
+/**
+ * @file test_containers.cpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * FRAM containers: contents survive a reopen, a header torn by a power cut falls back to the previous state,
+ * and a corrupted header, a different capacity or another kind of container is not taken for a valid one.
+ */
+
+#include <cstring>
+#include <vector>
+#include "FRAM_containers.hpp"
+#include "sim.h"
+#include "test.h"
+
+FRAM_CPP_BUS(SimBus,SIM0);
+
+using Chip=fram::Fram<fram::FM24V10<FRAM_SLAVE_ADR>,SimBus,64>;
+using Vector=fram::vector<uint32_t,Chip,4>;
+using Ring=fram::ring<uint16_t,Chip,4>;
+
+#define VEC_ADR                 0x100u
+#define RING_ADR                0x1000u
+
+static Chip chip;
+
+//every element of the vector matches the model
+static void check_vector(const std::vector<uint32_t> &model){
+
+    Vector vec(chip,VEC_ADR,64);
+    uint32_t value;
+
+    CHECK_EQ(vec.open(),FRAM_NO_ERROR);
+    CHECK_EQ(vec.size(),model.size());
+    for(std::size_t i=0;i<model.size();i++){
+        CHECK_EQ(vec.get(i,value),FRAM_NO_ERROR);
+        CHECK_EQ(value,model[i]);
+    }
+}
+
+static void test_vector(){
+
+    std::vector<uint32_t> model;
+    Vector vec(chip,VEC_ADR,64);
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    std::size_t done;
+    long budget;
+    uint32_t i;
+
+    sim_reset();
+    std::memset(mem,0xff,0x200);
+
+    //an erased chip holds no vector
+    CHECK_EQ(vec.open(),FRAM_NO_ERROR);
+    CHECK_EQ(vec.size(),0);
+
+    for(i=0;i<40;i++){
+        CHECK_EQ(vec.push_back(i*3+1),FRAM_NO_ERROR);
+        model.push_back(i*3+1);
+    }
+    CHECK_EQ(vec.pop_back(),FRAM_NO_ERROR);
+    model.pop_back();
+    check_vector(model);
+
+    //a push cut at every byte leaves the size before or after it
+    for(budget=0;;budget++){
+        sim_power_cut(budget);
+        {
+            Vector cut(chip,VEC_ADR,64);
+            CHECK_EQ(cut.open(),FRAM_NO_ERROR);
+            cut.push_back(0xabcd0000u+budget);
+        }
+        done=!sim_power_lost();
+        sim_power_cut(-1);
+
+        Vector reopened(chip,VEC_ADR,64);
+        CHECK_EQ(reopened.open(),FRAM_NO_ERROR);
+        CHECK(reopened.size()==model.size()||reopened.size()==model.size()+1);
+        if(reopened.size()==model.size()+1)
+            model.push_back(0xabcd0000u+budget);
+        check_vector(model);
+        if(done)
+            break;
+    }
+
+    //one corrupted copy falls back to the other one, two corrupted copies read as no vector
+    mem[VEC_ADR+4]^=0x40;
+    mem[VEC_ADR+24+4]^=0x40;
+    CHECK_EQ(vec.open(),FRAM_NO_ERROR);
+    CHECK_EQ(vec.size(),0);
+
+    //a vector of another capacity at the same address is not taken for this one
+    CHECK_EQ(vec.push_back(7),FRAM_NO_ERROR);
+    CHECK_EQ(vec.push_back(8),FRAM_NO_ERROR);
+    {
+        Vector other(chip,VEC_ADR,32);
+        CHECK_EQ(other.open(),FRAM_NO_ERROR);
+        CHECK_EQ(other.size(),0);
+    }
+}
+
+static void test_ring(){
+
+    std::vector<uint16_t> model;
+    Ring ring(chip,RING_ADR,10);
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    uint16_t value;
+    std::size_t i;
+    int n;
+
+    sim_reset();
+
+    CHECK_EQ(ring.open(),FRAM_NO_ERROR);
+    CHECK(ring.empty());
+
+    for(n=0;n<25;n++){
+        CHECK_EQ(ring.push(static_cast<uint16_t>(n*7)),FRAM_NO_ERROR);
+        model.push_back(static_cast<uint16_t>(n*7));
+        if(model.size()>10)
+            model.erase(model.begin());
+    }
+
+    //the oldest element is index 0, also after a reopen
+    {
+        Ring reopened(chip,RING_ADR,10);
+        CHECK_EQ(reopened.open(),FRAM_NO_ERROR);
+        CHECK(reopened.full());
+        for(i=0;i<model.size();i++){
+            CHECK_EQ(reopened.get(i,value),FRAM_NO_ERROR);
+            CHECK_EQ(value,model[i]);
+        }
+    }
+
+    //a header torn in the middle falls back to the previous push
+    CHECK_EQ(ring.push(0x1234),FRAM_NO_ERROR);
+    mem[RING_ADR+((25+1)&1)*24+8]^=1;
+    {
+        Ring reopened(chip,RING_ADR,10);
+        CHECK_EQ(reopened.open(),FRAM_NO_ERROR);
+        CHECK_EQ(reopened.get(9,value),FRAM_NO_ERROR);
+        CHECK_EQ(value,model[9]);
+    }
+
+    //a vector is not taken for a ring
+    {
+        fram::vector<uint16_t,Chip,4> vec(chip,RING_ADR,10);
+        CHECK_EQ(vec.open(),FRAM_NO_ERROR);
+        CHECK_EQ(vec.size(),0);
+    }
+}
+
+int main(){
+
+    chip.start();
+    test_vector();
+    test_ring();
+
+    printf("containers: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
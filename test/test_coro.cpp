@@ -0,0 +1,97 @@
+/**
+ * @file test_coro.cpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Coroutine front-end: many tasks on one executor write and read back their own ranges across the page select boundary, split over the transfer buffer,
+ * without ever starting a transfer on the busy bus; tasks awaiting tasks get their results and range errors return right away.
+ */
+
+#include <array>
+#include <cstring>
+#include "FRAM_coro.hpp"
+#include "sim.h"
+#include "test.h"
+
+FRAM_CPP_BUS(SimBus,SIM0);
+
+using Chip=fram::Fram<fram::FM24V10<FRAM_SLAVE_ADR>,SimBus,32>;
+
+#define TASKS                   8u
+#define SIZE                    300u
+
+static uint8_t out[TASKS][SIZE];
+static uint8_t in[TASKS][SIZE];
+static uint32_t results[TASKS];
+
+//writes and reads back a range crossing the page select boundary, in pieces of different lengths
+static fram::task worker(fram::async<Chip> &f, uint32_t n){
+
+    const uint32_t base=0xffc0u+n*SIZE;
+    uint32_t done;
+    uint32_t part;
+    uint32_t result;
+
+    for(done=0;done<SIZE;done+=part){
+        part=1+(n*37+done)%97;
+        if(part>SIZE-done)
+            part=SIZE-done;
+        result=co_await f.write(base+done,fram::span<const uint8_t>(out[n]+done,part));
+        if(result!=FRAM_NO_ERROR)
+            co_return result;
+    }
+
+    co_return co_await f.read(base,fram::span<uint8_t>(in[n],SIZE));
+}
+
+static fram::task outer(fram::async<Chip> &f, uint32_t n){
+
+    std::array<uint8_t,4> dummy;
+
+    //a range error does not suspend
+    if(co_await f.read(Chip::adr_max,dummy)!=FRAM_PARAMTER_ERROR)
+        co_return 1;
+
+    results[n]=co_await worker(f,n);
+    co_return FRAM_NO_ERROR;
+}
+
+int main(){
+
+    Chip chip;
+    fram::executor exec;
+    fram::async<Chip> f(chip,exec);
+    uint32_t n;
+    uint32_t i;
+
+    sim_reset();
+    chip.start();
+
+    for(n=0;n<TASKS;n++){
+        for(i=0;i<SIZE;i++)
+            out[n][i]=static_cast<uint8_t>(n*31+i*7+1);
+        results[n]=0xffffffffu;
+        exec.spawn(outer(f,n));
+    }
+    CHECK_EQ(exec.running(),TASKS);
+
+    exec.run();
+    CHECK_EQ(exec.running(),0);
+
+    for(n=0;n<TASKS;n++){
+        CHECK_EQ(results[n],FRAM_NO_ERROR);
+        CHECK(std::memcmp(in[n],out[n],SIZE)==0);
+        CHECK(std::memcmp(sim_mem(0,FRAM_SLAVE_ADR)+0xffc0u+n*SIZE,out[n],SIZE)==0);
+    }
+
+    //the executor only started a transfer once the previous one was done
+    CHECK_EQ(sim_get_stats(0)->refused,0);
+    CHECK_EQ(sim_get_stats(0)->naks,0);
+
+    printf("coro: ok, %u transfers\n",sim_get_stats(0)->transfers);
+    return 0;
+}
+
+/* [] END OF FILE */
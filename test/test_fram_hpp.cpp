@@ -0,0 +1,125 @@
+/**
+ * @file test_fram_hpp.cpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * C++ front-end: a write longer than the transfer buffer is one transfer sent from the buffer of the caller. A range across the page select boundary
+ * at 0x10000 takes one transfer and lands on the same bytes as with the C driver, both read back what the other wrote there. Calls after a transfer started with FRAM_DONT_WAIT wait for it instead of overwriting its buffer or starting on a busy bus.
+ */
+
+#include <array>
+#include <cstring>
+#include "FRAM.hpp"
+#include "sim.h"
+#include "test.h"
+
+FRAM_CPP_BUS(SimBus,SIM0);
+
+using Chip=fram::Fram<fram::FM24V10<FRAM_SLAVE_ADR>,SimBus,64>;
+
+int main(){
+
+    Chip chip;
+    std::array<uint8_t,32> out;
+    std::array<uint8_t,32> in;
+    std::array<uint8_t,8> a;
+    std::array<uint8_t,8> b;
+    std::array<uint8_t,200> big;
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    FRAM_bus_t bus;
+    FRAM_t fram;
+
+    sim_reset();
+    chip.start();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    //a range over the page select boundary is one transfer, the latch of the chip counts on across it
+    for(std::size_t i=0;i<out.size();i++)
+        out[i]=static_cast<uint8_t>(i*11+3);
+    CHECK_EQ((chip.write<0xfff0,32>(out)),FRAM_NO_ERROR);
+    CHECK_EQ(sim_get_stats(0)->transfers,1);
+    CHECK(memcmp(&mem[0xfff0],out.data(),out.size())==0);
+
+    sim_clear_stats();
+    CHECK_EQ((chip.read<0xfff0,32>(in)),FRAM_NO_ERROR);
+    CHECK_EQ(sim_get_stats(0)->transfers,2);
+    CHECK(in==out);
+    CHECK_EQ(chip.adr(),0x10010);
+
+    in.fill(0);
+    CHECK_EQ(chip.read(0xfff0,in),FRAM_NO_ERROR);
+    CHECK(in==out);
+    in.fill(0);
+    CHECK_EQ(chip.set_adr(0xfff0),FRAM_NO_ERROR);
+    CHECK_EQ(chip.read_current(in),FRAM_NO_ERROR);
+    CHECK(in==out);
+
+    //the C driver does the same with the same number of transfers, and each API reads what the other wrote
+    in.fill(0);
+    sim_clear_stats();
+    CHECK_EQ(FRAM_read_from_adr(&fram,0xfff0,in.data(),in.size()),FRAM_NO_ERROR);
+    CHECK_EQ(sim_get_stats(0)->transfers,2);
+    CHECK(in==out);
+    CHECK_EQ(FRAM_get_adr(&fram),0x10010);
+
+    for(std::size_t i=0;i<out.size();i++)
+        out[i]=static_cast<uint8_t>(i*7+1);
+    sim_clear_stats();
+    CHECK_EQ(FRAM_write_to_adr(&fram,0xfff8,out.data(),out.size()),FRAM_NO_ERROR);
+    CHECK_EQ(sim_get_stats(0)->transfers,1);
+    CHECK(memcmp(&mem[0xfff8],out.data(),out.size())==0);
+    in.fill(0);
+    CHECK_EQ(chip.read(0xfff8,in),FRAM_NO_ERROR);
+    CHECK(in==out);
+
+    //a write longer than the transfer buffer goes in one transfer from the buffer of the caller
+    for(std::size_t i=0;i<big.size();i++)
+        big[i]=static_cast<uint8_t>(i*5+9);
+    sim_clear_stats();
+    CHECK_EQ(chip.write(0x2000,big),FRAM_NO_ERROR);
+    CHECK_EQ(sim_get_stats(0)->transfers,1);
+    CHECK_EQ(sim_get_stats(0)->bytes,1+2+big.size());
+    CHECK(memcmp(&mem[0x2000],big.data(),big.size())==0);
+    CHECK_EQ(chip.adr(),0x2000+big.size());
+    CHECK_EQ((chip.write<0x3000,200>(big)),FRAM_NO_ERROR);
+    CHECK(memcmp(&mem[0x3000],big.data(),big.size())==0);
+
+    //a refused one leaves the chip and the latch as they were
+    sim_fail(0,1);
+    big.fill(0);
+    CHECK(chip.write(0x2000,big)!=FRAM_NO_ERROR);
+    CHECK_EQ(mem[0x2000],9);
+    CHECK_EQ(chip.adr(),0x3000+big.size());
+
+    //a second write right after one started without waiting waits for the bus, both arrive unchanged
+    a.fill(0xaa);
+    b.fill(0xbb);
+    sim_clear_stats();
+    CHECK_EQ(chip.write_chunk(0x100,a,FRAM_DONT_WAIT),FRAM_NO_ERROR);
+    CHECK(chip.busy());
+    a.fill(0xcc);
+    CHECK_EQ(chip.write_chunk(0x200,b,FRAM_DONT_WAIT),FRAM_NO_ERROR);
+    chip.complete();
+    CHECK(!chip.busy());
+    CHECK_EQ(sim_get_stats(0)->refused,0);
+    CHECK_EQ(mem[0x100],0xaa);
+    CHECK_EQ(mem[0x107],0xaa);
+    CHECK_EQ(mem[0x200],0xbb);
+
+    //the same for the address buffer and a read following a set_adr without waiting
+    CHECK_EQ(chip.set_adr(0x100,FRAM_DONT_WAIT),FRAM_NO_ERROR);
+    CHECK_EQ(chip.set_adr(0x200,FRAM_DONT_WAIT),FRAM_NO_ERROR);
+    CHECK_EQ(chip.read_current(a,FRAM_DONT_WAIT),FRAM_NO_ERROR);
+    CHECK_EQ(chip.read(0x100,b),FRAM_NO_ERROR);
+    CHECK_EQ(sim_get_stats(0)->refused,0);
+    CHECK_EQ(a[0],0xbb);
+    CHECK_EQ(b[7],0xaa);
+
+    printf("fram_hpp: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
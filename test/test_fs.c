@@ -0,0 +1,301 @@
+/**
+ * @file test_fs.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * File system: a create cut at every byte right after a remove never brings back the removed file, and a remove cut at every byte
+ * leaves the file complete or gone. Random creates, writes at random positions, truncates and removes of 10 names in 8 entries
+ * match a model after every remount, also when cut by a power loss at a random byte: a cut write leaves the old or the new size,
+ * the bytes outside the written range are unchanged. Removing all files gives back the whole heap.
+ */
+
+#include <string.h>
+#include "FRAM_fs.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x0u
+#define SIZE                    (FRAM_FS_DIR_SIZE+FRAM_HEAP_UNITS/4u+FRAM_HEAP_UNITS*FRAM_HEAP_UNIT)
+#define NAMES                   10u
+#define FILE_MAX                4000u
+#define ROUNDS                  20000u
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_fs_t fs;
+static uint8_t exists[NAMES];
+static uint32_t size[NAMES];
+static uint8_t content[NAMES][FILE_MAX];
+static const char * const name[NAMES]={"calib","log","dump","a","b","cfg0","cfg1","trace","x","longer_name_15c"};
+
+//mounts the file system again after a reset
+static void remount(void){
+
+    sim_reboot(&fram);
+    CHECK_EQ(FRAM_fs_init(&fs,&fram,BASE,SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_fs_mount(&fs),FRAM_NO_ERROR);
+}
+
+//reads a whole file, returns 0 if it does not exist
+static uint8_t read_file(const char * const file_name, uint8_t * const buffer, uint32_t * const length){
+
+    FRAM_fs_file_t file;
+    uint32_t result;
+    uint32_t count;
+
+    result=FRAM_fs_open(&fs,&file,file_name,0);
+    if(result==FRAM_FS_NOT_FOUND)
+        return 0;
+    CHECK_EQ(result,FRAM_NO_ERROR);
+
+    *length=FRAM_fs_get_size(&file);
+    CHECK(*length<=FILE_MAX);
+    CHECK_EQ(FRAM_fs_read(&file,buffer,FILE_MAX,&count),FRAM_NO_ERROR);
+    CHECK_EQ(count,*length);
+
+    return 1;
+}
+
+static void check_files(void){
+
+    uint8_t buffer[FILE_MAX];
+    uint32_t length;
+    uint32_t n;
+
+    for(n=0;n<NAMES;n++){
+        CHECK_EQ(read_file(name[n],buffer,&length),exists[n]);
+        if(exists[n]){
+            CHECK_EQ(length,size[n]);
+            CHECK(memcmp(buffer,content[n],length)==0);
+        }
+    }
+}
+
+//the heap is free apart from the extents of the files
+static void check_heap(void){
+
+    uint32_t used=0;
+    uint32_t i;
+    uint32_t k;
+
+    for(i=0;i<FRAM_FS_FILES;i++)
+        for(k=0;k<FRAM_FS_EXTENTS&&fs.dir[i].extent[k]!=0;k++)
+            used+=FRAM_heap_get_size(&fs.heap,fs.dir[i].extent[k]);
+
+    CHECK_EQ(used+FRAM_heap_get_free(&fs.heap),fs.heap.units*FRAM_HEAP_UNIT);
+}
+
+static void test_create(void){
+
+    FRAM_fs_file_t file;
+    uint8_t data[100];
+    long budget;
+    uint8_t lost;
+
+    memset(data,0x5a,sizeof(data));
+
+    CHECK_EQ(FRAM_fs_init(&fs,&fram,BASE,SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_fs_format(&fs),FRAM_NO_ERROR);
+
+    //the new file takes the entry of the removed one
+    for(budget=0;;budget++){
+
+        CHECK_EQ(FRAM_fs_open(&fs,&file,"calib",FRAM_FS_CREATE),FRAM_NO_ERROR);
+        CHECK_EQ(FRAM_fs_write(&file,data,sizeof(data)),FRAM_NO_ERROR);
+        CHECK_EQ(FRAM_fs_remove(&fs,"calib"),FRAM_NO_ERROR);
+
+        sim_power_cut(budget);
+        FRAM_fs_open(&fs,&file,"crash",FRAM_FS_CREATE);
+        lost=sim_power_lost();
+        sim_power_cut(-1);
+
+        remount();
+        CHECK_EQ(FRAM_fs_open(&fs,&file,"calib",0),FRAM_FS_NOT_FOUND);
+        if(!lost){
+            CHECK_EQ(FRAM_fs_open(&fs,&file,"crash",0),FRAM_NO_ERROR);
+            CHECK_EQ(FRAM_fs_get_size(&file),0);
+            break;
+        }
+        if(FRAM_fs_open(&fs,&file,"crash",0)==FRAM_NO_ERROR){
+            CHECK_EQ(FRAM_fs_get_size(&file),0);
+            CHECK_EQ(FRAM_fs_remove(&fs,"crash"),FRAM_NO_ERROR);
+        }
+        check_heap();
+    }
+    CHECK_EQ(FRAM_fs_remove(&fs,"crash"),FRAM_NO_ERROR);
+
+    //a cut remove leaves the file complete or gone
+    for(budget=0;;budget++){
+
+        CHECK_EQ(FRAM_fs_open(&fs,&file,"calib",FRAM_FS_CREATE),FRAM_NO_ERROR);
+        CHECK_EQ(FRAM_fs_write(&file,data,sizeof(data)),FRAM_NO_ERROR);
+
+        sim_power_cut(budget);
+        FRAM_fs_remove(&fs,"calib");
+        lost=sim_power_lost();
+        sim_power_cut(-1);
+
+        remount();
+        exists[0]=FRAM_fs_open(&fs,&file,"calib",0)==FRAM_NO_ERROR;
+        if(!lost)
+            CHECK(!exists[0]);
+        if(exists[0]){
+            size[0]=sizeof(data);
+            memcpy(content[0],data,sizeof(data));
+            check_files();
+            CHECK_EQ(FRAM_fs_remove(&fs,"calib"),FRAM_NO_ERROR);
+        }
+        check_heap();
+
+        if(!lost)
+            break;
+    }
+    exists[0]=0;
+}
+
+static void test_random(void){
+
+    FRAM_fs_file_t file;
+    uint8_t data[600];
+    uint8_t buffer[FILE_MAX];
+    uint32_t cuts=0;
+    uint32_t result;
+    uint32_t round;
+    uint32_t length;
+    uint32_t count;
+    uint32_t pos;
+    uint32_t end;
+    uint32_t op;
+    uint32_t n;
+    uint32_t i;
+    uint8_t cut;
+    uint8_t found;
+
+    CHECK_EQ(FRAM_fs_format(&fs),FRAM_NO_ERROR);
+    memset(exists,0,sizeof(exists));
+
+    for(round=0;round<ROUNDS;round++){
+
+        n=test_rand()%NAMES;
+        op=test_rand()%10;
+        pos=exists[n]?test_rand()%(size[n]+1):0;
+        count=1+test_rand()%sizeof(data);
+        if(pos+count>FILE_MAX)
+            count=FILE_MAX-pos;
+        for(i=0;i<count;i++)
+            data[i]=(uint8_t)test_rand();
+        end=pos+count>size[n]||!exists[n]?pos+count:size[n];
+
+        cut=round%10==9;
+        if(cut)
+            sim_power_cut(test_rand()%(count+100));
+
+        if(op<6){
+            result=FRAM_fs_open(&fs,&file,name[n],FRAM_FS_CREATE);
+            if(result==FRAM_NO_ERROR){
+                FRAM_fs_seek(&file,pos);
+                result=FRAM_fs_write(&file,data,count);
+            }
+        }
+        else if(op<7)
+            result=FRAM_fs_open(&fs,&file,name[n],FRAM_FS_TRUNCATE);
+        else if(op<9)
+            result=FRAM_fs_remove(&fs,name[n]);
+        else
+            result=read_file(name[n],buffer,&length)?FRAM_NO_ERROR:FRAM_FS_NOT_FOUND;
+
+        //after a cut the file is in its old or its new state, the model follows the chip
+        if(cut&&sim_power_lost()){
+            sim_power_cut(-1);
+            remount();
+            cuts++;
+
+            found=read_file(name[n],buffer,&length);
+            if(op<6&&found){
+                if(!exists[n])
+                    CHECK(length==0||length==end);
+                else
+                    CHECK(length==size[n]||length==end);
+                if(length==end&&(!exists[n]||end>size[n]))
+                    CHECK(memcmp(buffer+pos,data,count)==0);
+                CHECK(memcmp(buffer,content[n],pos<length?pos:length)==0);
+                if(exists[n]&&size[n]>pos+count&&length==size[n])
+                    CHECK(memcmp(buffer+pos+count,content[n]+pos+count,size[n]-pos-count)==0);
+            }
+            else if(op==6&&found)
+                CHECK(length==0||length==size[n]);
+            else if(found)
+                CHECK(exists[n]&&length==size[n]&&memcmp(buffer,content[n],length)==0);
+
+            exists[n]=found;
+            if(found){
+                size[n]=length;
+                memcpy(content[n],buffer,length);
+            }
+            check_files();
+            check_heap();
+            continue;
+        }
+        sim_power_cut(-1);
+
+        if(op<6){
+            //a full directory or heap writes nothing
+            if(result==FRAM_MEMORY_ERROR)
+                continue;
+            CHECK_EQ(result,FRAM_NO_ERROR);
+            if(!exists[n])
+                size[n]=0;
+            exists[n]=1;
+            memcpy(content[n]+pos,data,count);
+            size[n]=end;
+        }
+        else if(op<9){
+            CHECK_EQ(result,exists[n]?FRAM_NO_ERROR:FRAM_FS_NOT_FOUND);
+            if(op==6)
+                size[n]=0;
+            else
+                exists[n]=0;
+        }
+        else{
+            CHECK_EQ(result,exists[n]?FRAM_NO_ERROR:FRAM_FS_NOT_FOUND);
+            if(exists[n]){
+                CHECK_EQ(length,size[n]);
+                CHECK(memcmp(buffer,content[n],length)==0);
+            }
+        }
+
+        if(test_rand()%100==0){
+            remount();
+            check_files();
+            check_heap();
+        }
+    }
+
+    remount();
+    check_files();
+    check_heap();
+
+    for(n=0;n<NAMES;n++)
+        if(exists[n])
+            CHECK_EQ(FRAM_fs_remove(&fs,name[n]),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_heap_get_free(&fs.heap),fs.heap.units*FRAM_HEAP_UNIT);
+
+    printf("fs: %u random operations, %u cut by a power loss\n",ROUNDS,cuts);
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_create();
+    test_random();
+
+    printf("fs: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
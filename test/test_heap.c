@@ -0,0 +1,202 @@
+/**
+ * @file test_heap.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Persistent heap of 256, 140 and 3 units: random allocs and frees with remounts, every fifth one cut by a power loss at a random byte
+ * of its map write. Blocks never overlap, the free lists hold exactly the free units, and blocks plus free units make up the heap.
+ * A cut alloc leaves no new block or one of the full size asked for, a cut free leaves the block whole or frees it, never a smaller block.
+ * Freeing all blocks merges the heap into one block again.
+ */
+
+#include <string.h>
+#include "FRAM_heap.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x100u
+#define BLOCKS                  300u
+#define ROUNDS                  20000u
+#define NIL                     0xffffu                 //end of a free list
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_heap_t heap;
+static uint32_t block[BLOCKS];                          //addresses of the allocated blocks
+static uint32_t block_size[BLOCKS];
+static uint32_t blocks;
+
+//mounts the heap again after a reset
+static void remount(uint32_t size){
+
+    sim_reboot(&fram);
+    CHECK_EQ(FRAM_heap_init(&heap,&fram,BASE,size),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_heap_mount(&heap),FRAM_NO_ERROR);
+}
+
+//the allocated blocks and the free lists cover every unit exactly once
+static void check_heap(void){
+
+    uint8_t owner[FRAM_HEAP_UNITS];
+    uint32_t used=0;
+    uint32_t listed=0;
+    uint32_t unit;
+    uint32_t size;
+    uint32_t i;
+    uint32_t k;
+    uint16_t u;
+
+    memset(owner,0,sizeof(owner));
+
+    for(i=0;i<blocks;i++){
+        size=FRAM_heap_get_size(&heap,block[i]);
+        CHECK_EQ(size,block_size[i]);
+        unit=(block[i]-heap.data)/FRAM_HEAP_UNIT;
+        for(k=0;k<size/FRAM_HEAP_UNIT;k++){
+            CHECK(!owner[unit+k]);
+            owner[unit+k]=1;
+        }
+        used+=size;
+    }
+
+    for(k=0;k<FRAM_HEAP_CLASSES;k++)
+        for(u=heap.head[k];u!=NIL;u=heap.next[u]){
+            CHECK_EQ(heap.order[u],k);
+            CHECK_EQ(u%(1u<<k),0);
+            for(i=0;i<1u<<k;i++){
+                CHECK(!owner[u+i]);
+                owner[u+i]=2;
+            }
+            listed+=1u<<k;
+        }
+
+    CHECK_EQ(listed,heap.free);
+    CHECK_EQ(used+FRAM_heap_get_free(&heap),heap.units*FRAM_HEAP_UNIT);
+}
+
+static void drop(uint32_t i){
+
+    blocks--;
+    block[i]=block[blocks];
+    block_size[i]=block_size[blocks];
+}
+
+static void test_heap(uint32_t size){
+
+    uint32_t repaired=0;
+    uint32_t cuts=0;
+    uint32_t result;
+    uint32_t round;
+    uint32_t adr;
+    uint32_t bytes;
+    uint32_t unit;
+    uint32_t found;
+    uint32_t expect;
+    uint32_t i;
+    uint32_t k;
+    uint8_t alloc;
+    uint8_t known;
+
+    blocks=0;
+    CHECK_EQ(FRAM_heap_init(&heap,&fram,BASE,size),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_heap_format(&heap),FRAM_NO_ERROR);
+
+    for(round=0;round<ROUNDS;round++){
+
+        alloc=blocks==0||(blocks<BLOCKS&&test_rand()%2);
+        i=blocks>0?test_rand()%blocks:0;
+        bytes=1+test_rand()%(test_rand()%4?300:3000);
+
+        if(round%5==0){
+
+            sim_power_cut(test_rand()%20);
+            if(alloc)
+                FRAM_heap_alloc(&heap,bytes,&adr);
+            else
+                FRAM_heap_free(&heap,block[i]);
+            sim_power_cut(-1);
+
+            remount(size);
+            repaired+=heap.stats.repaired;
+            cuts++;
+
+            //a cut alloc may have left its whole block allocated, a cut free its block free
+            if(alloc){
+                for(expect=FRAM_HEAP_UNIT;expect<bytes;expect*=2);
+                found=0;
+                for(unit=0;unit<heap.units;unit++){
+                    adr=heap.data+unit*FRAM_HEAP_UNIT;
+                    if(FRAM_heap_get_size(&heap,adr)==0)
+                        continue;
+                    for(known=0,k=0;k<blocks;k++)
+                        known|=block[k]==adr;
+                    if(!known){
+                        CHECK_EQ(FRAM_heap_get_size(&heap,adr),expect);
+                        block[blocks]=adr;
+                        block_size[blocks]=FRAM_heap_get_size(&heap,adr);
+                        blocks++;
+                        found++;
+                    }
+                }
+                CHECK(found<=1);
+            }
+            else if(FRAM_heap_get_size(&heap,block[i])==0)
+                drop(i);
+
+            check_heap();
+            continue;
+        }
+
+        if(alloc){
+            result=FRAM_heap_alloc(&heap,bytes,&adr);
+            if(result==FRAM_MEMORY_ERROR)
+                continue;
+            CHECK_EQ(result,FRAM_NO_ERROR);
+            block[blocks]=adr;
+            block_size[blocks]=FRAM_heap_get_size(&heap,adr);
+            CHECK(block_size[blocks]>=bytes);
+            blocks++;
+        }
+        else{
+            CHECK_EQ(FRAM_heap_free(&heap,block[i]),FRAM_NO_ERROR);
+            CHECK_EQ(FRAM_heap_free(&heap,block[i]),FRAM_PARAMTER_ERROR);
+            drop(i);
+        }
+        check_heap();
+
+        if(round%97==0){
+            remount(size);
+            check_heap();
+        }
+    }
+
+    while(blocks>0)
+        CHECK_EQ(FRAM_heap_free(&heap,block[--blocks]),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_heap_get_free(&heap),heap.units*FRAM_HEAP_UNIT);
+
+    //a heap of a power of two units is one block again
+    if((heap.units&(heap.units-1u))==0){
+        CHECK_EQ(FRAM_heap_alloc(&heap,heap.units*FRAM_HEAP_UNIT,&adr),FRAM_NO_ERROR);
+        CHECK_EQ(adr,heap.data);
+    }
+
+    printf("heap: %u units, %u cut operations, %u blocks repaired by the mount\n",heap.units,cuts,repaired);
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_heap(FRAM_HEAP_UNITS/4+FRAM_HEAP_UNITS*FRAM_HEAP_UNIT);
+    test_heap(35+140*FRAM_HEAP_UNIT);
+    test_heap(1+3*FRAM_HEAP_UNIT);
+
+    printf("heap: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,100 @@
+/**
+ * @file test_instances.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Independent driver instances: one thread per bus drives four chips at the same time, each chip keeps its own latch, statistics and data.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include "sim.h"
+#include "test.h"
+
+#define SIZE                    0x8000u
+
+typedef struct {
+    uint8_t     n;                                      //number of the bus
+    FRAM_bus_t  bus;
+    FRAM_t      fram[SIM_CHIPS];
+    uint8_t     model[SIM_CHIPS][SIZE];
+    uint8_t     buffer[SIZE];
+    uint32_t    failed;
+} worker_t;
+
+static worker_t workers[SIM_BUSES];
+
+static void* work(void *arg){
+
+    worker_t * const w=arg;
+    unsigned long long state=w->n+1;
+    uint32_t adr;
+    uint32_t count;
+    uint32_t chip;
+    uint32_t i;
+    int it;
+
+    FRAM_bus_init(&w->bus,&sim_i2c[w->n]);
+    for(chip=0;chip<SIM_CHIPS;chip++)
+        FRAM_init(&w->fram[chip],&w->bus,FRAM_SLAVE_ADR+2*chip);
+
+    for(it=0;it<20000;it++){
+
+        //a generator per thread, test_rand is not thread safe
+        state=state*6364136223846793005ull+1442695040888963407ull;
+        chip=(state>>20)%SIM_CHIPS;
+        adr=(state>>24)%SIZE;
+        count=1+(state>>40)%128;
+        if(count>SIZE-adr)
+            count=SIZE-adr;
+
+        if(state>>63){
+            for(i=0;i<count;i++)
+                w->buffer[i]=(uint8_t)(state>>(i%56));
+            w->failed|=FRAM_write_to_adr(&w->fram[chip],adr,w->buffer,count)!=FRAM_NO_ERROR;
+            memcpy(&w->model[chip][adr],w->buffer,count);
+        }
+        else{
+            w->failed|=FRAM_read_from_adr(&w->fram[chip],adr,w->buffer,count)!=FRAM_NO_ERROR;
+            w->failed|=memcmp(w->buffer,&w->model[chip][adr],count)!=0;
+        }
+    }
+
+    return NULL;
+}
+
+int main(void){
+
+    pthread_t threads[SIM_BUSES];
+    uint32_t writes;
+    uint8_t n;
+    uint8_t chip;
+
+    sim_reset();
+
+    for(n=0;n<SIM_BUSES;n++){
+        workers[n].n=n;
+        CHECK(pthread_create(&threads[n],NULL,work,&workers[n])==0);
+    }
+
+    for(n=0;n<SIM_BUSES;n++)
+        pthread_join(threads[n],NULL);
+
+    //every chip holds exactly the data of its own model, the statistics add up per bus
+    for(n=0;n<SIM_BUSES;n++){
+        CHECK_EQ(workers[n].failed,0);
+        writes=0;
+        for(chip=0;chip<SIM_CHIPS;chip++){
+            CHECK(memcmp(sim_mem(n,FRAM_SLAVE_ADR+2*chip),workers[n].model[chip],SIZE)==0);
+            writes+=workers[n].fram[chip].stats.writes+workers[n].fram[chip].stats.reads+workers[n].fram[chip].stats.set_adrs;
+        }
+        CHECK_EQ(writes,sim_get_stats(n)->transfers);
+    }
+
+    printf("instances: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,103 @@
+/**
+ * @file test_iterator.cpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Iterators over FRAM containers: standard algorithms see the stored elements, a sequential pass costs one transfer per window
+ * (std::find over 2500 records with a window of 32 takes 80 transfers), also backwards where each window ends at the element that missed it,
+ * and transfer errors end up in "status" of the container.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include "FRAM_containers.hpp"
+#include "sim.h"
+#include "test.h"
+
+FRAM_CPP_BUS(SimBus,SIM0);
+
+using Chip=fram::Fram<fram::FM24V10<FRAM_SLAVE_ADR>,SimBus,64>;
+
+struct record_t {
+    uint32_t id;
+    uint16_t value;
+    uint16_t flags;
+};
+
+#define RECORDS                 2500u
+#define ADR                     0x400u
+
+static Chip chip;
+
+int main(){
+
+    fram::array<record_t,RECORDS,Chip,32> records(chip,ADR);
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    record_t record;
+    uint32_t i;
+
+    sim_reset();
+    chip.start();
+    CHECK_EQ(records.open(),FRAM_NO_ERROR);
+
+    //the records are put straight into the chip, sorted by id
+    for(i=0;i<RECORDS;i++){
+        record=record_t{i*2,static_cast<uint16_t>(i%1000),0};
+        std::memcpy(&mem[ADR+i*sizeof(record_t)],&record,sizeof(record));
+    }
+
+    //a linear search over all records: one transfer setting the latch, then one read per window of 32 records
+    sim_clear_stats();
+    auto found=std::find_if(records.begin(),records.end(),[](const record_t &r){return r.id==(RECORDS-1)*2;});
+    CHECK(found!=records.end());
+    CHECK_EQ(found.index(),RECORDS-1);
+    CHECK_EQ(sim_get_stats(0)->transfers,80);
+    CHECK_EQ(records.status(),FRAM_NO_ERROR);
+
+    //random access algorithms
+    auto lower=std::lower_bound(records.begin(),records.end(),1001u,[](const record_t &r, uint32_t id){return r.id<id;});
+    CHECK_EQ(lower.index(),501);
+    CHECK_EQ((*lower).id,1002);
+    CHECK_EQ(records.end()-records.begin(),RECORDS);
+    CHECK_EQ(records.begin()[7].id,14);
+    CHECK_EQ(std::accumulate(records.begin(),records.end(),0ull,[](unsigned long long sum, const record_t &r){return sum+r.value;}),
+             2ull*(999ull*1000ull/2ull)+(499ull*500ull/2ull));
+    CHECK_EQ(std::count_if(records.begin(),records.end(),[](const record_t &r){return r.value==0;}),3);
+
+    //backwards: the last records are still in the window of count_if, every further window ends at the element before the previous one,
+    //so the other 2496 records take 78 windows of one transfer setting the latch and one read instead of two transfers per record
+    i=RECORDS;
+    sim_clear_stats();
+    for(auto it=records.end();it!=records.begin();){
+        --it;
+        CHECK_EQ((*it).id,(--i)*2);
+    }
+    CHECK_EQ(sim_get_stats(0)->transfers,2*78);
+
+    //a vector and a view of raw FRAM
+    fram::vector<uint16_t,Chip,8> vec(chip,0x10000,100);
+    CHECK_EQ(vec.open(),FRAM_NO_ERROR);
+    for(i=0;i<50;i++)
+        CHECK_EQ(vec.push_back(static_cast<uint16_t>(50-i)),FRAM_NO_ERROR);
+    CHECK(std::is_sorted(vec.begin(),vec.end(),[](uint16_t a, uint16_t b){return a>b;}));
+    CHECK_EQ(*std::min_element(vec.begin(),vec.end()),1);
+
+    fram::range<uint8_t,Chip> raw(chip,ADR,8);
+    CHECK_EQ(raw.open(),FRAM_NO_ERROR);
+    CHECK(std::equal(raw.begin(),raw.end(),&mem[ADR]));
+
+    //an element that can not be read is a default value, the error is kept by the container
+    sim_fail(0,1);
+    CHECK_EQ(records.begin()[2000].id,0);
+    CHECK_EQ(records.status(),SIM_I2C_MSTR_ERR_LB_NAK);
+    CHECK_EQ(records.status(),FRAM_NO_ERROR);
+    CHECK_EQ(records.begin()[2000].id,4000);
+
+    printf("iterator: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,238 @@
+/**
+ * @file test_kv.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Key-value store: 500 keys in 1024 slots survive a remount and a lookup missing the cache reads about one group of slots,
+ * values grow by moving, reserved records grow and keep their value, and a full region is reported.
+ * A put cut by a power loss at every byte leaves the old value, the new one or, for a rewrite in place, a record failing its CRC,
+ * and the store stays usable.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "FRAM_kv.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x1000u
+#define SIZE                    0x10000u
+#define SLOTS                   1024u
+#define KEYS                    500u
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_kv_t kv;
+
+static void key_name(char * const key, uint32_t n){sprintf(key,"key/%u",n);}
+
+static void fill(uint8_t * const value, uint32_t seed, uint16_t count){
+
+    uint16_t i;
+
+    for(i=0;i<count;i++)
+        value[i]=(uint8_t)(seed*13+i*5+1);
+}
+
+//mounts the store again after a reset
+static void remount(void){
+
+    sim_reboot(&fram);
+    CHECK_EQ(FRAM_kv_init(&kv,&fram,BASE,SIZE,SLOTS),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_kv_mount(&kv),FRAM_NO_ERROR);
+}
+
+//the value of a key is the one filled with seed
+static void check_value(const char * const key, uint32_t seed, uint16_t count){
+
+    uint8_t expect[256];
+    uint8_t value[256];
+    uint16_t length;
+
+    fill(expect,seed,count);
+    CHECK_EQ(FRAM_kv_get(&kv,key,value,sizeof(value),&length),FRAM_NO_ERROR);
+    CHECK_EQ(length,count);
+    CHECK(memcmp(value,expect,count)==0);
+}
+
+static void test_keys(void){
+
+    uint8_t value[256];
+    char key[16];
+    uint32_t n;
+    uint16_t length;
+
+    CHECK_EQ(FRAM_kv_init(&kv,&fram,BASE,SIZE,SLOTS),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_kv_mount(&kv),FRAM_KV_NO_STORE);
+    CHECK_EQ(FRAM_kv_format(&kv),FRAM_NO_ERROR);
+
+    for(n=0;n<KEYS;n++){
+        key_name(key,n);
+        fill(value,n,n%40);
+        CHECK_EQ(FRAM_kv_put(&kv,key,value,n%40),FRAM_NO_ERROR);
+    }
+
+    //after a remount the cache is empty, every lookup probes the index
+    remount();
+    for(n=0;n<KEYS;n++){
+        key_name(key,n);
+        check_value(key,n,n%40);
+    }
+    CHECK_EQ(kv.stats.cache_hits,0);
+    CHECK(kv.stats.probes<KEYS*11/10);
+    printf("kv: %u keys in %u slots, %.2f slot reads per lookup missing the cache\n",KEYS,SLOTS,(double)kv.stats.probes/KEYS);
+
+    CHECK_EQ(FRAM_kv_get(&kv,"missing",value,sizeof(value),&length),FRAM_KV_NOT_FOUND);
+    CHECK_EQ(FRAM_kv_get(&kv,"key/39",value,10,&length),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(length,39);
+
+    //a longer value moves, a shorter one stays in its record
+    fill(value,1000,100);
+    CHECK_EQ(FRAM_kv_put(&kv,"key/7",value,100),FRAM_NO_ERROR);
+    CHECK_EQ(kv.stats.moved,1);
+    CHECK_EQ(kv.stats.wasted,8+5+7);                    //record header, key and capacity of the old record
+    fill(value,1001,3);
+    CHECK_EQ(FRAM_kv_put(&kv,"key/7",value,3),FRAM_NO_ERROR);
+    CHECK_EQ(kv.stats.moved,1);
+
+    CHECK_EQ(FRAM_kv_delete(&kv,"key/8"),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_kv_delete(&kv,"key/8"),FRAM_KV_NOT_FOUND);
+
+    remount();
+    check_value("key/7",1001,3);
+    check_value("key/9",9,9);
+    CHECK_EQ(FRAM_kv_get(&kv,"key/8",value,sizeof(value),&length),FRAM_KV_NOT_FOUND);
+
+    //a reserved record grows and keeps its value, a put up to the capacity stays in it
+    CHECK_EQ(FRAM_kv_reserve(&kv,"cfg",8),FRAM_NO_ERROR);
+    fill(value,2000,8);
+    CHECK_EQ(FRAM_kv_put(&kv,"cfg",value,8),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_kv_reserve(&kv,"cfg",4),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_kv_reserve(&kv,"cfg",200),FRAM_NO_ERROR);
+    CHECK_EQ(kv.stats.moved,1);
+    remount();
+    check_value("cfg",2000,8);
+    fill(value,2001,200);
+    CHECK_EQ(FRAM_kv_put(&kv,"cfg",value,200),FRAM_NO_ERROR);
+    CHECK_EQ(kv.stats.moved,0);
+    check_value("cfg",2001,200);
+}
+
+static void test_full(void){
+
+    uint8_t value[256];
+    uint32_t result;
+    uint32_t n;
+    uint16_t length;
+
+    //new records use up the region, the space of deleted ones is not reclaimed
+    CHECK_EQ(FRAM_kv_format(&kv),FRAM_NO_ERROR);
+    for(n=0;;n++){
+        if(n>0)
+            CHECK_EQ(FRAM_kv_delete(&kv,"grow"),FRAM_NO_ERROR);
+        fill(value,n,n%200+1);
+        result=FRAM_kv_put(&kv,"grow",value,n%200+1);
+        if(result!=FRAM_NO_ERROR)
+            break;
+    }
+    CHECK_EQ(result,FRAM_MEMORY_ERROR);
+    CHECK(kv.stats.wasted>SIZE/2);
+
+    remount();
+    CHECK_EQ(FRAM_kv_get(&kv,"grow",value,sizeof(value),&length),FRAM_KV_NOT_FOUND);
+}
+
+//a put of seed over a key holding old, cut at every byte. A new key takes the old value, so the put moves it, otherwise it is rewritten in place.
+static void test_cut(const char * const key, uint8_t move, uint32_t old, uint16_t old_count, uint32_t seed, uint16_t count, uint32_t * const corrupt, uint32_t * const lost){
+
+    uint8_t expect_old[256];
+    uint8_t expect_new[256];
+    uint8_t value[256];
+    uint32_t result;
+    uint16_t length;
+    long budget;
+    uint8_t done;
+
+    for(budget=0;;budget++){
+
+        //restore the old value
+        if(move)
+            FRAM_kv_delete(&kv,key);
+        fill(value,old,old_count);
+        CHECK_EQ(FRAM_kv_put(&kv,key,value,old_count),FRAM_NO_ERROR);
+        check_value(key,old,old_count);
+
+        fill(value,seed,count);
+        sim_power_cut(budget);
+        FRAM_kv_put(&kv,key,value,count);
+        done=!sim_power_lost();
+        sim_power_cut(-1);
+
+        remount();
+        fill(expect_old,old,old_count);
+        fill(expect_new,seed,count);
+        result=FRAM_kv_get(&kv,key,value,sizeof(value),&length);
+        if(result==FRAM_NO_ERROR)
+            CHECK((length==old_count&&memcmp(value,expect_old,length)==0)||(length==count&&memcmp(value,expect_new,length)==0));
+        else if(result==FRAM_KV_CORRUPT)
+            (*corrupt)++;
+        else{
+            CHECK_EQ(result,FRAM_KV_NOT_FOUND);
+            (*lost)++;
+        }
+
+        //the other keys are untouched and the store takes further puts
+        check_value("key/0",0,0);
+        check_value("key/13",13,13);
+        fill(value,3000+budget,20);
+        CHECK_EQ(FRAM_kv_put(&kv,"after",value,20),FRAM_NO_ERROR);
+        check_value("key/39",39,39);
+        check_value("after",3000+budget,20);
+
+        if(done)
+            break;
+    }
+    check_value(key,seed,count);
+}
+
+int main(void){
+
+    uint8_t value[256];
+    char key[16];
+    uint32_t corrupt=0;
+    uint32_t lost=0;
+    uint32_t n;
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_keys();
+    test_full();
+
+    CHECK_EQ(FRAM_kv_format(&kv),FRAM_NO_ERROR);
+    for(n=0;n<40;n++){
+        key_name(key,n);
+        fill(value,n,n);
+        CHECK_EQ(FRAM_kv_put(&kv,key,value,n),FRAM_NO_ERROR);
+    }
+
+    //a rewrite in place is the old value, the new one or fails its CRC, never a mix
+    CHECK_EQ(FRAM_kv_reserve(&kv,"fixed",64),FRAM_NO_ERROR);
+    test_cut("fixed",0,1,64,2,64,&corrupt,&lost);
+    CHECK(corrupt>0);
+    CHECK_EQ(lost,0);
+
+    //a moved value is the old one or the new one, only a torn slot loses the key
+    corrupt=0;
+    test_cut("key/20",1,20,20,4000,120,&corrupt,&lost);
+    CHECK_EQ(corrupt,0);
+    CHECK(lost<=3);
+
+    printf("kv: ok, %u keys lost to a torn slot\n",lost);
+    return 0;
+}
+
+/* [] END OF FILE */
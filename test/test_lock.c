@@ -0,0 +1,203 @@
+/**
+ * @file test_lock.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Bus lock with pthread hooks, once blocking on a semaphore per thread and once polling:
+ * a yield hands the lock to the higher class and takes it back before the tasks of its own class,
+ * without counting a new acquisition, and many threads of all classes never hold the lock at the same time.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include "FRAM_lock.h"
+#include "test.h"
+
+#define THREADS                 8
+#define ROUNDS                  20000
+
+static pthread_mutex_t critical=PTHREAD_MUTEX_INITIALIZER;
+static volatile uint32_t ticks;
+static __thread sem_t semaphore;
+static __thread int semaphore_init;
+
+static uint32_t enter(void){pthread_mutex_lock(&critical); return 0;}
+static void     leave(uint32_t state){(void)state; pthread_mutex_unlock(&critical);}
+static void     spin(void){sched_yield();}
+static void     sleep_on(void){sem_wait(&semaphore);}
+static void     wake(void *task){sem_post(task);}
+static uint32_t now(void){return ticks;}
+
+static void* self(void){
+
+    if(!semaphore_init)
+        semaphore_init=sem_init(&semaphore,0,0)==0;
+
+    return &semaphore;
+}
+
+static const FRAM_lock_hooks_t blocking={enter,leave,spin,now,self,sleep_on,wake};
+static const FRAM_lock_hooks_t polling={enter,leave,spin,now,NULL,NULL,NULL};
+
+static FRAM_lock_t lock;
+static char order[8];
+static volatile uint32_t orders;
+static volatile uint32_t inside;
+static uint32_t overlaps;
+
+static void log_order(char c){
+
+    enter();
+    order[orders++]=c;
+    leave(0);
+}
+
+static uint32_t drawn(FRAM_prio_t prio){
+
+    uint32_t next;
+
+    enter();
+    next=lock.next[prio];
+    leave(0);
+
+    return next;
+}
+
+static void* normal(void *arg){
+
+    (void)arg;
+    FRAM_lock_acquire(&lock,FRAM_PRIO_NORMAL);
+    log_order('N');
+    FRAM_lock_release(&lock);
+
+    return NULL;
+}
+
+static void* urgent(void *arg){
+
+    (void)arg;
+    FRAM_lock_acquire(&lock,FRAM_PRIO_URGENT);
+    log_order('U');
+    ticks+=100;
+    FRAM_lock_release(&lock);
+
+    return NULL;
+}
+
+//the holder yields to an urgent task while another task of its class waits
+static void test_yield(const FRAM_lock_hooks_t *hooks){
+
+    pthread_t n;
+    pthread_t u;
+    const FRAM_lock_stats_t *stats;
+
+    FRAM_lock_init(&lock,hooks);
+    orders=0;
+    ticks=0;
+
+    FRAM_lock_acquire(&lock,FRAM_PRIO_NORMAL);
+    CHECK_EQ(FRAM_lock_yield(&lock),0);
+
+    CHECK(pthread_create(&n,NULL,normal,NULL)==0);
+    while(drawn(FRAM_PRIO_NORMAL)<2)
+        sched_yield();
+    CHECK_EQ(FRAM_lock_yield(&lock),0);
+
+    CHECK(pthread_create(&u,NULL,urgent,NULL)==0);
+    while(drawn(FRAM_PRIO_URGENT)<1)
+        sched_yield();
+
+    ticks+=10;
+    CHECK_EQ(FRAM_lock_yield(&lock),1);
+    log_order('H');
+    ticks+=10;
+    FRAM_lock_release(&lock);
+
+    pthread_join(u,NULL);
+    pthread_join(n,NULL);
+
+    //the urgent task came first, the holder got the lock back before the waiting task of its class
+    CHECK_EQ(orders,3);
+    CHECK(order[0]=='U'&&order[1]=='H'&&order[2]=='N');
+
+    //the yield is neither a new acquisition nor part of the hold time
+    stats=FRAM_lock_get_stats(&lock);
+    CHECK_EQ(stats->acquisitions[FRAM_PRIO_URGENT],1);
+    CHECK_EQ(stats->acquisitions[FRAM_PRIO_NORMAL],2);
+    CHECK_EQ(stats->yields,1);
+    CHECK_EQ(stats->hold_max,100);
+    CHECK_EQ(stats->hold_total,120);
+    CHECK_EQ(stats->wait_total[FRAM_PRIO_NORMAL],120);
+    CHECK_EQ(lock.sleepers,0);
+}
+
+static void* hammer(void *arg){
+
+    unsigned long long state=(uintptr_t)arg+1;
+    FRAM_prio_t prio;
+    int it;
+    int chunk;
+
+    for(it=0;it<ROUNDS;it++){
+        state=state*6364136223846793005ull+1442695040888963407ull;
+        prio=(FRAM_prio_t)((state>>33)%FRAM_PRIO_COUNT);
+
+        FRAM_lock_acquire(&lock,prio);
+
+        //a long transfer of up to four chunks, yielding between them
+        for(chunk=0;chunk<=(int)((state>>40)%4);chunk++){
+            if(chunk>0)
+                FRAM_lock_yield(&lock);
+            if(__sync_fetch_and_add(&inside,1)!=0)
+                __sync_fetch_and_add(&overlaps,1);
+            sched_yield();
+            __sync_fetch_and_sub(&inside,1);
+        }
+
+        FRAM_lock_release(&lock);
+    }
+
+    return NULL;
+}
+
+//many threads of all classes share the lock
+static void test_hammer(const FRAM_lock_hooks_t *hooks){
+
+    pthread_t threads[THREADS];
+    const FRAM_lock_stats_t *stats;
+    uintptr_t i;
+
+    FRAM_lock_init(&lock,hooks);
+    overlaps=0;
+
+    for(i=0;i<THREADS;i++)
+        CHECK(pthread_create(&threads[i],NULL,hammer,(void*)i)==0);
+    for(i=0;i<THREADS;i++)
+        pthread_join(threads[i],NULL);
+
+    stats=FRAM_lock_get_stats(&lock);
+    CHECK_EQ(overlaps,0);
+    CHECK_EQ(stats->acquisitions[0]+stats->acquisitions[1]+stats->acquisitions[2],THREADS*ROUNDS);
+    CHECK_EQ(lock.held,0);
+    CHECK_EQ(lock.sleepers,0);
+    for(i=0;i<FRAM_PRIO_COUNT;i++){
+        CHECK_EQ(lock.next[i],lock.serving[i]);
+        CHECK_EQ(lock.parked[i],0);
+    }
+}
+
+int main(void){
+
+    test_yield(&blocking);
+    test_yield(&polling);
+    test_hammer(&blocking);
+    test_hammer(&polling);
+
+    printf("lock: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
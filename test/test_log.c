@@ -0,0 +1,325 @@
+/**
+ * @file test_log.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Ring log: appends of random lengths cut by a power loss at random bytes, each followed by a remount. After every remount
+ * the log reads back from its oldest record up to the newest without a gap, every completed append is in it and a torn one
+ * is either complete or missing, also when the next record no longer fits into the sector of the torn one.
+ * A torn record passes its CRC-16 with a chance of 1/65536, the seed is one where none of the torn appends does.
+ * The binary search of the recovery finds the same position as the log that was written at every fill level,
+ * also with a corrupted sector start, and the scan it falls back to with a corrupted sector 0 does as well.
+ * Batches that fill a sector exactly or reach the end of the region never write behind the sector or the region, and the log reads back
+ * the same before and after a remount. Sequence numbers wrapping around 0xffffffff keep their order, also for the recovery.
+ */
+
+#include <string.h>
+#include "FRAM_log.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x4000u
+#define SECTORS                 8u
+#define ROUNDS                  20000u
+#define RECORDS                 (ROUNDS+1u)
+#define SEARCH_BASE             0x10000u
+#define SEARCH_SECTORS          32u
+#define BATCH_BASE              0x1000u
+#define BATCH_SECTORS           2u
+#define BATCH_SIZE              (BATCH_SECTORS*FRAM_LOG_SECTOR_SIZE)
+#define WRAP_SEQ                0xfffffff0u             //sequence number the wrap test starts at
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_log_t log_;
+static uint8_t length[RECORDS+1];                       //payload length of every sequence number
+
+static uint8_t payload(uint32_t seq, uint32_t i){return (uint8_t)(seq*31+i*7+1);}
+
+//mounts the log again after a reset
+static void remount(void){
+
+    sim_reboot(&fram);
+    CHECK_EQ(FRAM_log_init(&log_,&fram,BASE,SECTORS*FRAM_LOG_SECTOR_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_log_recover(&log_),FRAM_NO_ERROR);
+}
+
+//the log holds the records up to the newest one without a gap and reaches back at least over the records of one sector
+static void check_log(uint32_t newest){
+
+    FRAM_log_cursor_t cursor;
+    uint8_t buffer[FRAM_LOG_RECORD_MAX];
+    uint32_t first=0;
+    uint32_t last=0;
+    uint32_t seq;
+    uint32_t i;
+    uint16_t count;
+
+    CHECK_EQ(FRAM_log_get_seq(&log_),newest+1);
+    if(newest==0){
+        CHECK_EQ(FRAM_log_first(&log_,&cursor),FRAM_LOG_END);
+        return;
+    }
+
+    CHECK_EQ(FRAM_log_first(&log_,&cursor),FRAM_NO_ERROR);
+    for(;;){
+        uint32_t result=FRAM_log_read(&log_,&cursor,buffer,sizeof(buffer),&count,&seq);
+        if(result==FRAM_LOG_END)
+            break;
+        CHECK_EQ(result,FRAM_NO_ERROR);
+
+        if(first==0)
+            first=seq;
+        else
+            CHECK_EQ(seq,last+1);
+        CHECK_EQ(count,length[seq]);
+        for(i=0;i<count;i++)
+            CHECK_EQ(buffer[i],payload(seq,i));
+        last=seq;
+    }
+
+    CHECK_EQ(last,newest);
+    CHECK(newest-first+1>=FRAM_LOG_SECTOR_SIZE/(FRAM_LOG_HEADER_SIZE+FRAM_LOG_RECORD_MAX));
+}
+
+//recovers a second log from the region of the given one, it has to continue at the same position.
+//The oldest sector is the same unless a sector start was corrupted.
+static void check_search(const FRAM_log_t * const live, uint8_t first){
+
+    FRAM_log_t log;
+
+    CHECK_EQ(FRAM_log_init(&log,&fram,live->base,live->sectors*FRAM_LOG_SECTOR_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_log_recover(&log),FRAM_NO_ERROR);
+    CHECK_EQ(log.seq,live->seq);
+    CHECK_EQ(log.head,live->head);
+    if(first)
+        CHECK_EQ(log.first,live->first);
+}
+
+//reads a log from its oldest record up to the newest, the sequence numbers follow each other and every payload is the one of its number,
+//returns the number of records
+static uint32_t read_all(FRAM_log_t * const log){
+
+    FRAM_log_cursor_t cursor;
+    uint8_t buffer[FRAM_LOG_RECORD_MAX];
+    uint32_t records=0;
+    uint32_t last=0;
+    uint32_t result;
+    uint32_t seq;
+    uint32_t i;
+    uint16_t count;
+
+    if(FRAM_log_first(log,&cursor)==FRAM_LOG_END)
+        return 0;
+
+    while((result=FRAM_log_read(log,&cursor,buffer,sizeof(buffer),&count,&seq))!=FRAM_LOG_END){
+        CHECK_EQ(result,FRAM_NO_ERROR);
+        if(records>0)
+            CHECK_EQ(seq,last+1u+(last==0xffffffffu));
+        for(i=0;i<count;i++)
+            CHECK_EQ(buffer[i],payload(seq,i));
+        last=seq;
+        records++;
+    }
+    CHECK_EQ(last+1u+(last==0xffffffffu),FRAM_log_get_seq(log));
+
+    return records;
+}
+
+//appends a batch of records with the given payload lengths, the bytes around the region stay untouched
+static void append_batch(FRAM_log_t * const log, const uint16_t * const lengths, uint8_t count){
+
+    static uint8_t data[FRAM_LOG_BATCH_MAX][FRAM_LOG_RECORD_MAX];
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    FRAM_part_t records[FRAM_LOG_BATCH_MAX];
+    uint32_t seq=FRAM_log_get_seq(log);
+    uint32_t i;
+    uint8_t n;
+
+    for(n=0;n<count;n++){
+        for(i=0;i<lengths[n];i++)
+            data[n][i]=payload(seq,i);
+        seq+=1u+(seq==0xffffffffu);
+        records[n].buffer=data[n];
+        records[n].count=lengths[n];
+    }
+
+    CHECK_EQ(FRAM_log_append_batch(log,records,count),FRAM_NO_ERROR);
+    CHECK_EQ(mem[BATCH_BASE-1],0xaa);
+    CHECK_EQ(mem[BATCH_BASE+BATCH_SIZE],0xaa);
+}
+
+static void test_batch(void){
+
+    static const uint16_t full[2]={FRAM_LOG_RECORD_MAX,FRAM_LOG_RECORD_MAX};
+    static const uint16_t quarter[FRAM_LOG_BATCH_MAX]={56,56,56,56,56,56,56,56};
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    uint16_t lengths[FRAM_LOG_BATCH_MAX];
+    FRAM_log_t log;
+    uint32_t writes;
+    uint32_t round;
+    uint8_t count;
+    uint8_t n;
+
+    mem[BATCH_BASE-1]=0xaa;
+    mem[BATCH_BASE+BATCH_SIZE]=0xaa;
+    CHECK_EQ(FRAM_log_init(&log,&fram,BATCH_BASE,BATCH_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_log_format(&log),FRAM_NO_ERROR);
+
+    //a record filling sector 0, then a batch of two more: one goes to sector 1, the other wraps to sector 0 and drops it
+    append_batch(&log,full,1);
+    writes=log.stats.writes;
+    append_batch(&log,full,2);
+    CHECK_EQ(log.stats.writes,writes+2);
+    CHECK_EQ(log.head,FRAM_LOG_SECTOR_SIZE);
+    CHECK_EQ(log.first,1);
+    CHECK_EQ(FRAM_log_get_seq(&log),4);
+    CHECK_EQ(read_all(&log),2);
+    check_search(&log,1);
+
+    //records of 64 bytes, four of them fill a sector exactly, so a batch of eight takes one transfer per sector
+    writes=log.stats.writes;
+    append_batch(&log,quarter,FRAM_LOG_BATCH_MAX);
+    CHECK_EQ(log.stats.writes,writes+2);
+    CHECK_EQ(read_all(&log),FRAM_LOG_BATCH_MAX);
+    check_search(&log,1);
+
+    //random batches, many of them reaching the end of the region
+    for(round=0;round<2000;round++){
+
+        count=1+test_rand()%FRAM_LOG_BATCH_MAX;
+        for(n=0;n<count;n++)
+            lengths[n]=test_rand()%3?(uint16_t)(FRAM_LOG_SECTOR_SIZE/(1+test_rand()%4)-FRAM_LOG_HEADER_SIZE):(uint16_t)(1+test_rand()%FRAM_LOG_RECORD_MAX);
+
+        append_batch(&log,lengths,count);
+        CHECK(read_all(&log)>0);
+        check_search(&log,1);
+    }
+}
+
+static void test_wrap(void){
+
+    uint16_t lengths[FRAM_LOG_BATCH_MAX];
+    FRAM_log_t log;
+    uint32_t round;
+    uint32_t seq;
+    uint8_t count;
+    uint8_t n;
+
+    CHECK_EQ(FRAM_log_init(&log,&fram,SEARCH_BASE,SEARCH_SECTORS*FRAM_LOG_SECTOR_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_log_format(&log),FRAM_NO_ERROR);
+
+    //the numbers start right in front of the wrap, like after 2^32 appends
+    log.seq=WRAP_SEQ;
+
+    for(round=0;round<200;round++){
+
+        count=1+test_rand()%4;
+        for(n=0;n<count;n++)
+            lengths[n]=(uint16_t)(1+test_rand()%FRAM_LOG_RECORD_MAX);
+        seq=FRAM_log_get_seq(&log);
+        append_batch(&log,lengths,count);
+        CHECK(FRAM_LOG_BEFORE(seq,FRAM_log_get_seq(&log)));
+        CHECK(FRAM_log_get_seq(&log)!=0);
+        check_search(&log,1);
+    }
+
+    CHECK(FRAM_log_get_seq(&log)<WRAP_SEQ);
+    CHECK(read_all(&log)>0);
+}
+
+static void test_search(void){
+
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR)+SEARCH_BASE;
+    uint8_t buffer[FRAM_LOG_RECORD_MAX];
+    FRAM_log_t log;
+    uint32_t newest;
+    uint32_t sector;
+    uint32_t round;
+
+    CHECK_EQ(FRAM_log_init(&log,&fram,SEARCH_BASE,SEARCH_SECTORS*FRAM_LOG_SECTOR_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_log_format(&log),FRAM_NO_ERROR);
+    check_search(&log,1);
+
+    //three laps around the region
+    for(round=0;round<SEARCH_SECTORS*3*2;round++){
+
+        memset(buffer,round,sizeof(buffer));
+        CHECK_EQ(FRAM_log_append(&log,buffer,1+test_rand()%FRAM_LOG_RECORD_MAX),FRAM_NO_ERROR);
+        check_search(&log,1);
+
+        //a payload byte of the first record of a sector not holding the newest records
+        newest=(log.head+SEARCH_SECTORS*FRAM_LOG_SECTOR_SIZE-1)/FRAM_LOG_SECTOR_SIZE%SEARCH_SECTORS;
+        sector=test_rand()%SEARCH_SECTORS;
+        if(sector==newest)
+            continue;
+
+        mem[sector*FRAM_LOG_SECTOR_SIZE+FRAM_LOG_HEADER_SIZE]^=0x80;
+        check_search(&log,0);
+        mem[sector*FRAM_LOG_SECTOR_SIZE+FRAM_LOG_HEADER_SIZE]^=0x80;
+    }
+}
+
+int main(void){
+
+    uint8_t buffer[FRAM_LOG_RECORD_MAX];
+    uint32_t newest=0;
+    uint32_t seq;
+    uint32_t torn=0;
+    uint32_t round;
+    uint32_t i;
+
+    sim_reset();
+    test_seed(1);
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_search();
+    test_batch();
+    test_wrap();
+
+    CHECK_EQ(FRAM_log_init(&log_,&fram,BASE,SECTORS*FRAM_LOG_SECTOR_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_log_format(&log_),FRAM_NO_ERROR);
+    check_log(0);
+
+    for(round=0;round<ROUNDS;round++){
+
+        seq=FRAM_log_get_seq(&log_);
+        length[seq]=1+test_rand()%200;
+        for(i=0;i<length[seq];i++)
+            buffer[i]=payload(seq,i);
+
+        //every 8th append is cut somewhere in its header or payload and the chip is remounted
+        if(test_rand()%8==0){
+            sim_power_cut(test_rand()%(FRAM_LOG_HEADER_SIZE+length[seq]));
+            FRAM_log_append(&log_,buffer,length[seq]);
+            sim_power_cut(-1);
+            torn++;
+
+            remount();
+            CHECK(FRAM_log_get_seq(&log_)==newest+1||FRAM_log_get_seq(&log_)==newest+2);
+            newest=FRAM_log_get_seq(&log_)-1;
+            check_log(newest);
+            continue;
+        }
+
+        CHECK_EQ(FRAM_log_append(&log_,buffer,length[seq]),FRAM_NO_ERROR);
+        newest=seq;
+
+        if(test_rand()%32==0){
+            remount();
+            check_log(newest);
+        }
+    }
+
+    remount();
+    check_log(newest);
+    CHECK(newest>ROUNDS/2);
+
+    printf("log: ok, %u records, %u torn appends\n",newest,torn);
+    return 0;
+}
+
+/* [] END OF FILE */
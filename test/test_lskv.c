@@ -0,0 +1,231 @@
+/**
+ * @file test_lskv.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Log-structured key-value store: random puts and deletes of 60 keys in a 32 sector region match a model after every remount,
+ * also when a put or delete is cut by a power loss at a random byte. The cut key holds its old or its new value, the records
+ * the compactor was copying stay. Puts rarely compact more than FRAM_LSKV_STEP records.
+ * A region full of live records returns FRAM_LSKV_FULL and can still be emptied, a full index returns FRAM_MEMORY_ERROR.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "FRAM_lskv.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x2000u
+#define SECTORS                 32u
+#define KEYS                    60u
+#define ROUNDS                  20000u
+#define VALUE_MAX               100u
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_lskv_t kv;
+static int length[KEYS];                                //length of the value of every key, -1 if the key is not in the store
+static uint8_t value[KEYS][VALUE_MAX];
+static uint32_t writes;
+static uint32_t stalls;
+
+static void key_name(char * const key, uint32_t n){sprintf(key,"key/%u",n);}
+
+//mounts the store again after a reset
+static void remount(uint32_t base, uint32_t sectors){
+
+    sim_reboot(&fram);
+    writes+=kv.stats.puts;
+    stalls+=kv.stats.stalls;
+
+    CHECK_EQ(FRAM_lskv_init(&kv,&fram,base,sectors*FRAM_LOG_SECTOR_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_lskv_mount(&kv),FRAM_NO_ERROR);
+}
+
+//the store holds the model, a key holding new instead takes it into the model
+static void check_model(int pending, int new_length, const uint8_t * const new_value){
+
+    uint8_t buffer[VALUE_MAX];
+    char key[16];
+    uint32_t result;
+    uint32_t n;
+    uint16_t count;
+
+    for(n=0;n<KEYS;n++){
+        key_name(key,n);
+        result=FRAM_lskv_get(&kv,key,buffer,sizeof(buffer),&count);
+
+        if(result==FRAM_LSKV_NOT_FOUND?length[n]<0:result==FRAM_NO_ERROR&&length[n]==count&&memcmp(buffer,value[n],count)==0)
+            continue;
+
+        CHECK_EQ(n,pending);
+        if(new_length<0)
+            CHECK_EQ(result,FRAM_LSKV_NOT_FOUND);
+        else{
+            CHECK_EQ(result,FRAM_NO_ERROR);
+            CHECK_EQ(count,new_length);
+            CHECK(memcmp(buffer,new_value,count)==0);
+            memcpy(value[n],new_value,count);
+        }
+        length[n]=new_length;
+    }
+}
+
+//random puts and deletes, with crash set some are cut by a power loss and the store is remounted now and then
+static void test_random(uint8_t crash){
+
+    uint8_t buffer[VALUE_MAX];
+    char key[16];
+    uint32_t result;
+    uint32_t cuts=0;
+    uint32_t i;
+    uint32_t n;
+    int count;
+    uint8_t cut;
+
+    CHECK_EQ(FRAM_lskv_init(&kv,&fram,BASE,SECTORS*FRAM_LOG_SECTOR_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_lskv_format(&kv),FRAM_NO_ERROR);
+
+    for(n=0;n<KEYS;n++)
+        length[n]=-1;
+    writes=0;
+    stalls=0;
+
+    for(i=0;i<ROUNDS;i++){
+
+        n=test_rand()%KEYS;
+        key_name(key,n);
+        count=test_rand()%6==0?-1:(int)(test_rand()%VALUE_MAX);
+        for(result=0;(int)result<count;result++)
+            buffer[result]=(uint8_t)test_rand();
+
+        //a put may compact a few records before its own, the cut hits any of them
+        cut=crash&&i%8==7;
+        if(cut)
+            sim_power_cut(test_rand()%400);
+
+        result=count<0?FRAM_lskv_delete(&kv,key):FRAM_lskv_put(&kv,key,buffer,(uint16_t)count);
+
+        if(cut&&sim_power_lost()){
+            sim_power_cut(-1);
+            remount(BASE,SECTORS);
+            check_model(n,count,buffer);
+            cuts++;
+            continue;
+        }
+        sim_power_cut(-1);
+
+        if(count<0)
+            CHECK(result==FRAM_NO_ERROR||(result==FRAM_LSKV_NOT_FOUND&&length[n]<0));
+        else{
+            CHECK_EQ(result,FRAM_NO_ERROR);
+            memcpy(value[n],buffer,count);
+        }
+        length[n]=count;
+
+        if(test_rand()%20==0)
+            CHECK_EQ(FRAM_lskv_compact(&kv,4),FRAM_NO_ERROR);
+
+        if(crash&&test_rand()%50==0){
+            remount(BASE,SECTORS);
+            check_model(-1,0,NULL);
+        }
+    }
+
+    remount(BASE,SECTORS);
+    check_model(-1,0,NULL);
+
+    //a mount starts the compactor at the oldest record, so the puts after it compact more until it has caught up
+    if(!crash)
+        CHECK(stalls*500u<writes);
+    printf("lskv: %u puts and deletes, %u cut by a power loss, %u compacted more than %u records\n",writes,cuts,stalls,FRAM_LSKV_STEP);
+}
+
+static void test_full(void){
+
+    uint8_t buffer[200];
+    char key[16];
+    uint32_t result;
+    uint32_t keys;
+    uint32_t n;
+    uint16_t count;
+
+    CHECK_EQ(FRAM_lskv_init(&kv,&fram,BASE,SECTORS*FRAM_LOG_SECTOR_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_lskv_format(&kv),FRAM_NO_ERROR);
+
+    //every record takes a sector of its own
+    for(keys=0;;keys++){
+        key_name(key,keys);
+        memset(buffer,keys,sizeof(buffer));
+        result=FRAM_lskv_put(&kv,key,buffer,sizeof(buffer));
+        if(result!=FRAM_NO_ERROR)
+            break;
+    }
+    CHECK_EQ(result,FRAM_LSKV_FULL);
+    CHECK(keys>SECTORS/2);
+    result=FRAM_lskv_compact(&kv,SECTORS);
+    CHECK(result==FRAM_NO_ERROR||result==FRAM_LSKV_FULL);
+
+    //nothing was lost, all keys can be deleted and the space is used again
+    remount(BASE,SECTORS);
+    for(n=0;n<keys;n++){
+        key_name(key,n);
+        CHECK_EQ(FRAM_lskv_get(&kv,key,buffer,sizeof(buffer),&count),FRAM_NO_ERROR);
+        CHECK_EQ(count,sizeof(buffer));
+        CHECK_EQ(buffer[count-1],(uint8_t)n);
+    }
+    for(n=0;n<keys;n++){
+        key_name(key,n);
+        CHECK_EQ(FRAM_lskv_delete(&kv,key),FRAM_NO_ERROR);
+    }
+    for(n=0;n<keys;n++){
+        key_name(key,n);
+        CHECK_EQ(FRAM_lskv_put(&kv,key,buffer,sizeof(buffer)),FRAM_NO_ERROR);
+    }
+
+    printf("lskv: %u values of %u bytes fill %u sectors\n",keys,(unsigned)sizeof(buffer),SECTORS);
+}
+
+static void test_index(void){
+
+    uint8_t buffer[1];
+    char key[16];
+    uint32_t n;
+    uint16_t count;
+
+    CHECK_EQ(FRAM_lskv_init(&kv,&fram,0x10000,256*FRAM_LOG_SECTOR_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_lskv_format(&kv),FRAM_NO_ERROR);
+
+    //the index keeps one slot empty
+    for(n=0;n<FRAM_LSKV_SLOTS-1u;n++){
+        key_name(key,n);
+        buffer[0]=(uint8_t)n;
+        CHECK_EQ(FRAM_lskv_put(&kv,key,buffer,1),FRAM_NO_ERROR);
+    }
+    CHECK_EQ(FRAM_lskv_put(&kv,"one more",buffer,1),FRAM_MEMORY_ERROR);
+    CHECK_EQ(FRAM_lskv_put(&kv,"key/5",buffer,1),FRAM_NO_ERROR);
+
+    remount(0x10000,256);
+    CHECK_EQ(FRAM_lskv_get(&kv,"key/126",buffer,sizeof(buffer),&count),FRAM_NO_ERROR);
+    CHECK_EQ(buffer[0],126);
+    CHECK_EQ(FRAM_lskv_get(&kv,"one more",buffer,sizeof(buffer),&count),FRAM_LSKV_NOT_FOUND);
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_random(0);
+    test_random(1);
+    test_full();
+    test_index();
+
+    printf("lskv: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,212 @@
+/**
+ * @file test_lz.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Compressed region: blocks of zeros, incompressible data, long runs and matches reaching back to the start of the block or ending
+ * at its last byte read back unchanged and take the expected room on the chip. 20000 random partial writes and reads of several kinds
+ * of data match a model. Random bytes in the slots give FRAM_LZ_CORRUPT or some data, but never a write behind the buffer.
+ */
+
+#include <string.h>
+#include "FRAM_lz.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x100u
+#define BLOCKS                  256u
+#define SIZE                    (BLOCKS*FRAM_LZ_BLOCK_SIZE)
+#define ROUNDS                  20000u
+#define GUARD                   16u                     //bytes behind a read buffer that have to stay untouched
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_lz_t lz;
+static uint8_t model[SIZE];
+static uint8_t buffer[SIZE+GUARD];
+
+//fills data of a kind an application would write
+static void fill(uint8_t * const data, uint32_t count, uint32_t kind){
+
+    static const char text[]="the quick brown fox jumps over the lazy dog ";
+    uint32_t run=0;
+    uint8_t byte=0;
+    uint32_t i;
+
+    for(i=0;i<count;i++){
+        switch(kind){
+            case 0: data[i]=(uint8_t)test_rand(); break;
+            case 1: data[i]=0; break;
+
+            //runs of up to 600 bytes, longer than a match and than a block
+            case 2:
+                if(run==0){
+                    run=1+test_rand()%600;
+                    byte=(uint8_t)test_rand();
+                }
+                run--;
+                data[i]=byte;
+                break;
+            case 3: data[i]=(uint8_t)text[(i+test_rand()%2)%(sizeof(text)-1)]; break;
+
+            //records of 16 bytes: a counter, a constant, a small value and padding
+            default: data[i]=i%16<4?(uint8_t)((i/16*3)>>(8*(i%16))):i%16<8?0x5a:i%16<12?(uint8_t)(test_rand()%3):0; break;
+        }
+    }
+}
+
+//writes a whole block, checks its room on the chip and reads it back
+static uint32_t check_block(uint32_t block, const uint8_t * const data){
+
+    uint32_t packed=lz.stats.packed;
+
+    CHECK_EQ(FRAM_lz_write_to_adr(&lz,block*FRAM_LZ_BLOCK_SIZE,data,FRAM_LZ_BLOCK_SIZE),FRAM_NO_ERROR);
+    memset(buffer,0xee,FRAM_LZ_BLOCK_SIZE+GUARD);
+    CHECK_EQ(FRAM_lz_read_from_adr(&lz,block*FRAM_LZ_BLOCK_SIZE,buffer,FRAM_LZ_BLOCK_SIZE),FRAM_NO_ERROR);
+    CHECK(memcmp(buffer,data,FRAM_LZ_BLOCK_SIZE)==0);
+    memcpy(&model[block*FRAM_LZ_BLOCK_SIZE],data,FRAM_LZ_BLOCK_SIZE);
+
+    return lz.stats.packed-packed;
+}
+
+static void test_blocks(void){
+
+    uint8_t data[FRAM_LZ_BLOCK_SIZE];
+    uint32_t stored;
+    uint32_t i;
+
+    CHECK_EQ(FRAM_lz_init(&lz,&fram,BASE,BLOCKS*FRAM_LZ_SLOT_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_lz_format(&lz),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_lz_get_size(&lz),SIZE);
+    memset(model,0,sizeof(model));
+
+    //a block of zeros is an empty record
+    memset(data,0,sizeof(data));
+    CHECK_EQ(check_block(0,data),FRAM_LZ_HEADER_SIZE);
+
+    //incompressible data is stored as it is
+    stored=lz.stats.stored;
+    fill(data,sizeof(data),0);
+    CHECK_EQ(check_block(1,data),FRAM_LZ_SLOT_SIZE);
+    CHECK_EQ(lz.stats.stored,stored+1);
+
+    //a run of the whole block is a literal and a match of 255 bytes at a distance of 1
+    memset(data,0xa5,sizeof(data));
+    CHECK_EQ(check_block(2,data),FRAM_LZ_HEADER_SIZE+1+1+2);
+
+    //a single byte differing at either end
+    data[0]=0;
+    CHECK(check_block(3,data)<16);
+    data[0]=0xa5;
+    data[FRAM_LZ_BLOCK_SIZE-1]=0;
+    CHECK(check_block(4,data)<16);
+
+    //a match reaching back to the first byte of the block and ending at its last byte
+    memset(data,0x11,sizeof(data));
+    fill(data,8,0);
+    memcpy(&data[FRAM_LZ_BLOCK_SIZE-8],data,8);
+    CHECK(check_block(5,data)<24);
+
+    //copies of every length ending at the last byte, from the first byte of the block or from a random one
+    for(i=1;i<FRAM_LZ_BLOCK_SIZE;i++){
+        fill(data,sizeof(data),0);
+        memmove(&data[FRAM_LZ_BLOCK_SIZE-i],&data[i%2?0:test_rand()%(FRAM_LZ_BLOCK_SIZE-i)],i);
+        check_block(6+i%8,data);
+    }
+
+    //a partial write across blocks keeps the rest of both
+    fill(data,sizeof(data),2);
+    CHECK_EQ(FRAM_lz_write_to_adr(&lz,2*FRAM_LZ_BLOCK_SIZE-100,data,200),FRAM_NO_ERROR);
+    memcpy(&model[2*FRAM_LZ_BLOCK_SIZE-100],data,200);
+    CHECK_EQ(FRAM_lz_read_from_adr(&lz,0,buffer,16*FRAM_LZ_BLOCK_SIZE),FRAM_NO_ERROR);
+    CHECK(memcmp(buffer,model,16*FRAM_LZ_BLOCK_SIZE)==0);
+
+    CHECK_EQ(FRAM_lz_write_to_adr(&lz,0,NULL,1),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_lz_write_to_adr(&lz,0,data,0),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_lz_write_to_adr(&lz,SIZE-1,data,2),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_lz_read_from_adr(&lz,SIZE,buffer,1),FRAM_PARAMTER_ERROR);
+}
+
+static void test_random(void){
+
+    uint32_t round;
+    uint32_t adr;
+    uint32_t count;
+
+    for(round=0;round<ROUNDS;round++){
+
+        adr=test_rand()%SIZE;
+        count=1+test_rand()%(test_rand()%4?100:3000);
+        if(count>SIZE-adr)
+            count=SIZE-adr;
+
+        if(test_rand()%2){
+            fill(buffer,count,test_rand()%5);
+            CHECK_EQ(FRAM_lz_write_to_adr(&lz,adr,buffer,count),FRAM_NO_ERROR);
+            memcpy(&model[adr],buffer,count);
+        }
+        else{
+            memset(&buffer[count],0xee,GUARD);
+            CHECK_EQ(FRAM_lz_read_from_adr(&lz,adr,buffer,count),FRAM_NO_ERROR);
+            CHECK(memcmp(buffer,&model[adr],count)==0);
+            for(adr=0;adr<GUARD;adr++)
+                CHECK_EQ(buffer[count+adr],0xee);
+        }
+    }
+
+    CHECK_EQ(FRAM_lz_read_from_adr(&lz,0,buffer,SIZE),FRAM_NO_ERROR);
+    CHECK(memcmp(buffer,model,SIZE)==0);
+
+    printf("lz: %u random writes and reads, %u of %u bytes on the chip\n",ROUNDS,lz.stats.packed,lz.stats.bytes);
+}
+
+static void test_garbage(void){
+
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    uint32_t corrupt=0;
+    uint32_t result;
+    uint32_t block;
+    uint32_t i;
+
+    //random bytes in the records, some of them with a valid length
+    for(i=0;i<4000;i++)
+        mem[BASE+test_rand()%(BLOCKS*FRAM_LZ_SLOT_SIZE)]=(uint8_t)test_rand();
+    for(block=0;block<BLOCKS;block+=2){
+        mem[BASE+block*FRAM_LZ_SLOT_SIZE]=(uint8_t)(1+test_rand()%(FRAM_LZ_BLOCK_SIZE-1));
+        mem[BASE+block*FRAM_LZ_SLOT_SIZE+1]=0;
+    }
+
+    for(block=0;block<BLOCKS;block++){
+        memset(buffer,0xee,FRAM_LZ_BLOCK_SIZE+GUARD);
+        result=FRAM_lz_read_from_adr(&lz,block*FRAM_LZ_BLOCK_SIZE,buffer,FRAM_LZ_BLOCK_SIZE);
+        CHECK(result==FRAM_NO_ERROR||result==FRAM_LZ_CORRUPT);
+        corrupt+=result==FRAM_LZ_CORRUPT;
+        for(i=0;i<GUARD;i++)
+            CHECK_EQ(buffer[FRAM_LZ_BLOCK_SIZE+i],0xee);
+    }
+    CHECK(corrupt>0);
+
+    //a partial write into a corrupt block keeps it corrupt
+    for(block=0;FRAM_lz_read_from_adr(&lz,block*FRAM_LZ_BLOCK_SIZE,buffer,1)!=FRAM_LZ_CORRUPT;block++);
+    CHECK_EQ(FRAM_lz_write_to_adr(&lz,block*FRAM_LZ_BLOCK_SIZE,buffer,1),FRAM_LZ_CORRUPT);
+
+    printf("lz: %u of %u blocks with random bytes found corrupt\n",corrupt,BLOCKS);
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_blocks();
+    test_random();
+    test_garbage();
+
+    printf("lz: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,130 @@
+/**
+ * @file test_mirror.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Mirrored pair on two buses: a refused write or a mismatch only resyncs the affected range, and reads stay correct meanwhile.
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "test.h"
+
+#define SIZE                    0x4000u
+
+static uint8_t model[SIZE];
+static uint8_t buffer[SIZE];
+
+static void write(FRAM_mirror_t * const mirror, uint32_t adr, uint32_t count, uint32_t expect){
+
+    uint32_t i;
+
+    for(i=0;i<count;i++)
+        buffer[i]=test_rand();
+
+    CHECK_EQ(FRAM_mirror_write_to_adr(mirror,adr,buffer,count),expect);
+    memcpy(&model[adr],buffer,count);
+}
+
+static void check_copies(void){
+
+    CHECK(memcmp(sim_mem(0,FRAM_SLAVE_ADR),model,SIZE)==0);
+    CHECK(memcmp(sim_mem(1,FRAM_SLAVE_ADR),model,SIZE)==0);
+}
+
+int main(void){
+
+    FRAM_bus_t bus[2];
+    FRAM_t fram[2];
+    FRAM_mirror_t mirror;
+    uint32_t steps;
+    uint32_t i;
+    int it;
+
+    sim_reset();
+    for(i=0;i<2;i++){
+        FRAM_bus_init(&bus[i],&sim_i2c[i]);
+        FRAM_init(&fram[i],&bus[i],FRAM_SLAVE_ADR);
+    }
+    FRAM_mirror_init(&mirror,&fram[0],&fram[1]);
+
+    write(&mirror,0,SIZE,FRAM_NO_ERROR);
+    check_copies();
+
+    //a refused write of the secondary copy resyncs only the written range
+    sim_fail(1,1);
+    write(&mirror,0x1000,100,SIM_I2C_MSTR_ERR_LB_NAK);
+    CHECK_EQ(FRAM_mirror_get_resync_adr(&mirror),0x1000);
+
+    //the range is read from the primary copy until it is restored
+    CHECK_EQ(FRAM_mirror_read_from_adr(&mirror,0x1000,buffer,100),FRAM_NO_ERROR);
+    CHECK(memcmp(buffer,&model[0x1000],100)==0);
+
+    for(steps=0;FRAM_mirror_get_resync_adr(&mirror)!=FRAM_INVALID_ADR;steps++)
+        CHECK_EQ(FRAM_mirror_resync(&mirror),FRAM_NO_ERROR);
+    CHECK_EQ(steps,(100+FRAM_MIRROR_CHUNK-1)/FRAM_MIRROR_CHUNK);
+    check_copies();
+
+    //two failures of the same copy are merged into one range
+    sim_fail(0,1);
+    write(&mirror,0x2000,10,SIM_I2C_MSTR_ERR_LB_NAK);
+    sim_fail(0,1);
+    write(&mirror,0x2100,10,SIM_I2C_MSTR_ERR_LB_NAK);
+    CHECK_EQ(mirror.resync_adr,0x2000);
+    CHECK_EQ(mirror.resync_end,0x2109);
+    CHECK_EQ(mirror.src,1);
+
+    //a failure of the other copy finishes the running resync first, the newer data wins
+    sim_fail(1,1);
+    write(&mirror,0x2004,0x200,SIM_I2C_MSTR_ERR_LB_NAK);
+    CHECK_EQ(mirror.src,0);
+    CHECK_EQ(mirror.resync_adr,0x2004);
+    while(FRAM_mirror_get_resync_adr(&mirror)!=FRAM_INVALID_ADR)
+        CHECK_EQ(FRAM_mirror_resync(&mirror),FRAM_NO_ERROR);
+    check_copies();
+
+    //a mismatch resyncs from the first to the last differing address
+    sim_mem(1,FRAM_SLAVE_ADR)[0x3005]^=1;
+    sim_mem(1,FRAM_SLAVE_ADR)[0x3010]^=1;
+    CHECK_EQ(FRAM_mirror_verify(&mirror,0,SIZE),FRAM_MIRROR_MISMATCH);
+    CHECK_EQ(mirror.resync_adr,0x3005);
+    CHECK_EQ(mirror.resync_end,0x3010);
+    CHECK_EQ(FRAM_mirror_resync(&mirror),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_mirror_get_resync_adr(&mirror),FRAM_INVALID_ADR);
+    CHECK_EQ(FRAM_mirror_verify(&mirror,0,SIZE),FRAM_NO_ERROR);
+
+    //random writes with random refusals, every read sees the newest data
+    for(it=0;it<3000;it++){
+        uint32_t adr=test_rand()%SIZE;
+        uint32_t count=1+test_rand()%300;
+        if(count>SIZE-adr)
+            count=SIZE-adr;
+
+        switch(test_rand()%4){
+        case 0:
+            sim_fail(test_rand()%2,1);
+            write(&mirror,adr,count,SIM_I2C_MSTR_ERR_LB_NAK);
+            break;
+        case 1:
+            write(&mirror,adr,count,FRAM_NO_ERROR);
+            break;
+        case 2:
+            CHECK_EQ(FRAM_mirror_resync(&mirror),FRAM_NO_ERROR);
+            break;
+        default:
+            CHECK_EQ(FRAM_mirror_read_from_adr(&mirror,adr,buffer,count),FRAM_NO_ERROR);
+            CHECK(memcmp(buffer,&model[adr],count)==0);
+        }
+    }
+
+    while(FRAM_mirror_get_resync_adr(&mirror)!=FRAM_INVALID_ADR)
+        CHECK_EQ(FRAM_mirror_resync(&mirror),FRAM_NO_ERROR);
+    check_copies();
+
+    printf("mirror: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
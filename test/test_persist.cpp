@@ -0,0 +1,96 @@
+/**
+ * @file test_persist.cpp
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Typed persistent variables: placed variables follow each other, pinned ones keep their offset and the next placed one follows them.
+ * Whole variables read back unchanged from their offsets, a field write puts only the bytes of the member on the bus and leaves the other members.
+ */
+
+#include <cstring>
+#include "FRAM_persist.hpp"
+#include "sim.h"
+#include "test.h"
+
+FRAM_CPP_BUS(SimBus,SIM0);
+
+using Chip=fram::Fram<fram::FM24V10<FRAM_SLAVE_ADR>,SimBus,64>;
+
+struct Calib {
+    float       gain;
+    float       offset;
+    uint16_t    table[20];
+};
+
+struct CalibTag;
+struct BootsTag;
+struct NameTag;
+struct TopTag;
+
+using Vars=fram::layout<Chip,0x100,fram::var<CalibTag,Calib>,fram::var<BootsTag,uint32_t,0x1000>,fram::var<NameTag,char[12]>,
+                        fram::var<TopTag,uint64_t,fram::FM24V10<>::adr_max-7u>>;
+
+static_assert(Vars::offset_of<CalibTag>()==0x100,"the first placed variable starts at the base");
+static_assert(Vars::offset_of<BootsTag>()==0x1000,"pinned");
+static_assert(Vars::offset_of<NameTag>()==0x1004,"placed right after the pinned variable");
+static_assert(Vars::offset_of<TopTag>()==0x1fff8,"pinned at the end of the chip");
+static_assert(Vars::end()==0x1ffff,"last byte of the layout");
+
+int main(){
+
+    Chip chip;
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    Calib calib{};
+    Calib read{};
+    uint32_t boots=0;
+    char name[12]={};
+    uint64_t top=0;
+    float gain=0;
+
+    sim_reset();
+    chip.start();
+
+    //whole variables read back from their offsets
+    calib.gain=1.5f;
+    calib.offset=-0.25f;
+    for(std::size_t i=0;i<20;i++)
+        calib.table[i]=static_cast<uint16_t>(i*1000+7);
+    CHECK_EQ(Vars::set<CalibTag>(chip,calib),FRAM_NO_ERROR);
+    CHECK_EQ(Vars::set<BootsTag>(chip,0x12345678u),FRAM_NO_ERROR);
+    strcpy(name,"persistent");
+    CHECK_EQ(Vars::set<NameTag>(chip,name),FRAM_NO_ERROR);
+    CHECK_EQ(Vars::set<TopTag>(chip,0x0102030405060708ull),FRAM_NO_ERROR);
+
+    CHECK(memcmp(&mem[0x100],&calib,sizeof(calib))==0);
+    CHECK(memcmp(&mem[0x1004],"persistent",11)==0);
+    CHECK_EQ(Vars::get<CalibTag>(chip,read),FRAM_NO_ERROR);
+    CHECK(memcmp(&read,&calib,sizeof(calib))==0);
+    CHECK_EQ(Vars::get<BootsTag>(chip,boots),FRAM_NO_ERROR);
+    CHECK_EQ(boots,0x12345678u);
+    memset(name,0,sizeof(name));
+    CHECK_EQ(Vars::get<NameTag>(chip,name),FRAM_NO_ERROR);
+    CHECK(strcmp(name,"persistent")==0);
+    CHECK_EQ(Vars::get<TopTag>(chip,top),FRAM_NO_ERROR);
+    CHECK_EQ(top,0x0102030405060708ull);
+
+    //a field write sends the address and the member only
+    sim_clear_stats();
+    CHECK_EQ((Vars::set_field<CalibTag,FRAM_FIELD(Calib,offset)>(chip,2.0f)),FRAM_NO_ERROR);
+    CHECK_EQ(sim_get_stats(0)->transfers,1);
+    CHECK_EQ(sim_get_stats(0)->bytes,1+2+sizeof(float));
+    calib.offset=2.0f;
+    CHECK(memcmp(&mem[0x100],&calib,sizeof(calib))==0);
+
+    CHECK_EQ((Vars::set_field<CalibTag,FRAM_FIELD(Calib,table)>(chip,read.table)),FRAM_NO_ERROR);
+    CHECK_EQ((Vars::get_field<CalibTag,FRAM_FIELD(Calib,gain)>(chip,gain)),FRAM_NO_ERROR);
+    CHECK_EQ(gain,1.5f);
+    CHECK_EQ(Vars::get<CalibTag>(chip,read),FRAM_NO_ERROR);
+    CHECK(memcmp(&read,&calib,sizeof(calib))==0);
+
+    printf("persist: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,149 @@
+/**
+ * @file test_prio.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Chunked transfers on a bus with a lock: urgent reads get the bus between the chunks of a long bulk write,
+ * which keeps its place in front of a bulk write queued after it. The lock counts one acquisition per call and leaves the handed-over time out of the hold time.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <string.h>
+#include "sim.h"
+#include "test.h"
+
+#define LONG                    (32u*FRAM_CHUNK_SIZE)
+
+static pthread_mutex_t critical=PTHREAD_MUTEX_INITIALIZER;
+static __thread sem_t semaphore;
+static __thread int semaphore_init;
+
+static uint32_t enter(void){pthread_mutex_lock(&critical); return 0;}
+static void     leave(uint32_t state){(void)state; pthread_mutex_unlock(&critical);}
+static void     spin(void){sched_yield();}
+static uint32_t now(void){return (uint32_t)(sim_now()/1000u);}
+static void     sleep_on(void){sem_wait(&semaphore);}
+static void     wake(void *task){sem_post(task);}
+
+static void* self(void){
+
+    if(!semaphore_init)
+        semaphore_init=sem_init(&semaphore,0,0)==0;
+
+    return &semaphore;
+}
+
+static const FRAM_lock_hooks_t hooks={enter,leave,spin,now,self,sleep_on,wake};
+
+static FRAM_bus_t bus;
+static FRAM_lock_t lock;
+static FRAM_t fram[3];
+static uint8_t data[2][LONG];
+static volatile uint8_t done[2];
+static volatile uint32_t urgent_reads;
+
+static void* bulk(void *arg){
+
+    const uintptr_t n=(uintptr_t)arg;
+
+    CHECK_EQ(FRAM_write_to_adr_prio(&fram[n],FRAM_PRIO_BULK,0,data[n],n==0?LONG:FRAM_CHUNK_SIZE),FRAM_NO_ERROR);
+
+    //the short write queued behind the long one only got the bus once the long one was complete
+    if(n==1)
+        CHECK(memcmp(sim_mem(0,FRAM_SLAVE_ADR),data[0],LONG)==0);
+    done[n]=1;
+
+    return NULL;
+}
+
+static void* urgent(void *arg){
+
+    uint8_t buffer[16];
+    uint64_t next=0;
+
+    (void)arg;
+    while(!done[0]){
+
+        //a read every 3 ms of bus time, so the bulk writes make progress in between
+        while(sim_now()<next&&!done[0])
+            sched_yield();
+        next=sim_now()+3000000u;
+
+        CHECK_EQ(FRAM_read_from_adr_prio(&fram[2],FRAM_PRIO_URGENT,0x100,buffer,sizeof(buffer)),FRAM_NO_ERROR);
+        urgent_reads++;
+    }
+
+    return NULL;
+}
+
+static void queued(FRAM_prio_t prio, uint32_t tickets){
+
+    uint32_t next;
+
+    do{
+        sched_yield();
+        enter();
+        next=lock.next[prio];
+        leave(0);
+    }while(next<tickets);
+}
+
+int main(void){
+
+    pthread_t threads[3];
+    const FRAM_lock_stats_t *stats;
+    uint32_t chunk_us;
+    uint32_t i;
+
+    sim_reset();
+    sim_yield(1);
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_lock_init(&lock,&hooks);
+    FRAM_bus_set_lock(&bus,&lock);
+    for(i=0;i<3;i++)
+        FRAM_init(&fram[i],&bus,FRAM_SLAVE_ADR+2*i);
+    for(i=0;i<LONG;i++){
+        data[0][i]=(uint8_t)(i*7+1);
+        data[1][i]=(uint8_t)(i*13+5);
+    }
+
+    //the long write queues first and a short one of the same class behind it, the urgent reads start meanwhile
+    FRAM_lock_acquire(&lock,FRAM_PRIO_BULK);
+    CHECK(pthread_create(&threads[0],NULL,bulk,(void*)0)==0);
+    queued(FRAM_PRIO_BULK,2);
+    CHECK(pthread_create(&threads[1],NULL,bulk,(void*)1)==0);
+    queued(FRAM_PRIO_BULK,3);
+    CHECK(pthread_create(&threads[2],NULL,urgent,NULL)==0);
+    queued(FRAM_PRIO_URGENT,1);
+    FRAM_lock_release(&lock);
+
+    for(i=0;i<3;i++)
+        pthread_join(threads[i],NULL);
+
+    //the long write kept its place in its class although it handed the bus to the urgent reads
+    CHECK(memcmp(sim_mem(0,FRAM_SLAVE_ADR),data[0],LONG)==0);
+    CHECK(memcmp(sim_mem(0,FRAM_SLAVE_ADR+2),data[1],FRAM_CHUNK_SIZE)==0);
+
+    //one acquisition per call (and the one of the setup), the urgent class waited about one chunk at most
+    stats=FRAM_lock_get_stats(&lock);
+    chunk_us=(uint32_t)((FRAM_CHUNK_SIZE+8u)*(uint64_t)SIM_BYTE_NS/1000u);
+    CHECK(urgent_reads>0);
+    CHECK(stats->yields>0);
+    CHECK_EQ(stats->acquisitions[FRAM_PRIO_BULK],3);
+    CHECK_EQ(stats->acquisitions[FRAM_PRIO_URGENT],urgent_reads);
+    CHECK(stats->wait_max[FRAM_PRIO_URGENT]<=chunk_us);
+
+    //the time the long write handed the bus to the urgent reads is not part of its hold time
+    CHECK(stats->hold_max<=(LONG/FRAM_CHUNK_SIZE)*chunk_us);
+    CHECK_EQ(lock.sleepers,0);
+
+    printf("prio: ok, %u urgent reads, %u yields, urgent wait max %u us, bulk hold max %u us\n",
+        urgent_reads,stats->yields,stats->wait_max[FRAM_PRIO_URGENT],stats->hold_max);
+    return 0;
+}
+
+/* [] END OF FILE */
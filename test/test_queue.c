@@ -0,0 +1,160 @@
+/**
+ * @file test_queue.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Submission queue: records are written in the order they were pushed, a full queue drops and counts records, a drain stops after max records,
+ * a refused write keeps its record for the next drain. Four producer threads, standing in for interrupt handlers, push with "FRAM_queue_push_mp"
+ * while a consumer thread drains: every record reaches the chip and the last record of every producer is written last.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "FRAM_queue.h"
+#include "sim.h"
+#include "test.h"
+
+#define PRODUCERS               4u
+#define RECORDS                 3000u                   //records per producer
+#define RECORD                  8u                      //bytes of a record of the threaded test: producer, sequence
+#define LAST                    0x18000u                //address of the sequence number written last by every producer
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_queue_t queue;
+static volatile uint32_t running;
+
+static void test_single(void){
+
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    uint8_t data[FRAM_QUEUE_SLOT_SIZE];
+    uint32_t i;
+
+    FRAM_queue_init(&queue,&fram);
+    CHECK_EQ(FRAM_queue_drain(&queue,1),FRAM_NO_ERROR);
+
+    //records of every length, the last two to the same address
+    for(i=0;i<FRAM_QUEUE_DEPTH;i++){
+        memset(data,(int)i+1,sizeof(data));
+        CHECK_EQ(FRAM_queue_push(&queue,i<FRAM_QUEUE_DEPTH-1?0x100*i:0x100*(i-1),data,1+i*(FRAM_QUEUE_SLOT_SIZE-1)/(FRAM_QUEUE_DEPTH-1)),FRAM_NO_ERROR);
+    }
+    CHECK_EQ(FRAM_queue_pending(&queue),FRAM_QUEUE_DEPTH);
+
+    //a full queue drops the record
+    CHECK_EQ(FRAM_queue_push(&queue,0,data,1),FRAM_QUEUE_FULL);
+    CHECK_EQ(FRAM_queue_push_mp(&queue,0,data,1),FRAM_QUEUE_FULL);
+    CHECK_EQ(FRAM_queue_get_stats(&queue)->overflows,2);
+
+    //max limits the records of one drain, nothing reaches the chip before
+    CHECK_EQ(mem[0],0);
+    CHECK_EQ(FRAM_queue_drain(&queue,3),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_queue_pending(&queue),FRAM_QUEUE_DEPTH-3);
+    CHECK_EQ(mem[0x100],2);
+    CHECK_EQ(mem[0x300],0);
+
+    //a refused write stays in the queue
+    sim_fail(0,1);
+    CHECK(FRAM_queue_drain(&queue,FRAM_QUEUE_DEPTH)!=FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_queue_get_stats(&queue)->errors,1);
+    CHECK_EQ(FRAM_queue_pending(&queue),FRAM_QUEUE_DEPTH-3);
+    CHECK_EQ(FRAM_queue_drain(&queue,FRAM_QUEUE_DEPTH),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_queue_pending(&queue),0);
+    CHECK_EQ(FRAM_queue_get_stats(&queue)->written,FRAM_QUEUE_DEPTH);
+
+    //the later of two records to the same address wins
+    CHECK_EQ(mem[0x100*(FRAM_QUEUE_DEPTH-2)],FRAM_QUEUE_DEPTH);
+    CHECK_EQ(mem[0x100*(FRAM_QUEUE_DEPTH-2)+FRAM_QUEUE_SLOT_SIZE-1],FRAM_QUEUE_DEPTH);
+
+    //the slots are free again
+    CHECK_EQ(FRAM_queue_push(&queue,0,data,1),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_queue_drain(&queue,FRAM_QUEUE_DEPTH),FRAM_NO_ERROR);
+
+    CHECK_EQ(FRAM_queue_push(&queue,0,NULL,1),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_queue_push(&queue,0,data,0),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_queue_push_mp(&queue,0,data,FRAM_QUEUE_SLOT_SIZE+1),FRAM_PARAMTER_ERROR);
+}
+
+static void* produce(void *arg){
+
+    const uint32_t producer=(uint32_t)(uintptr_t)arg;
+    uint8_t record[RECORD];
+    uint32_t seq;
+
+    for(seq=0;seq<RECORDS;seq++){
+
+        FRAM_store32(record,producer);
+        FRAM_store32(record+4,seq);
+
+        //like an interrupt handler that comes back later
+        while(FRAM_queue_push_mp(&queue,(producer*RECORDS+seq)*RECORD,record,RECORD)==FRAM_QUEUE_FULL)
+            sched_yield();
+        while(FRAM_queue_push_mp(&queue,LAST+producer*4u,record+4,4)==FRAM_QUEUE_FULL)
+            sched_yield();
+    }
+
+    return NULL;
+}
+
+static void* consume(void *arg){
+
+    (void)arg;
+
+    while(running||FRAM_queue_pending(&queue)>0){
+        CHECK_EQ(FRAM_queue_drain(&queue,4),FRAM_NO_ERROR);
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+static void test_threads(void){
+
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    pthread_t producers[PRODUCERS];
+    pthread_t consumer;
+    uint32_t producer;
+    uint32_t seq;
+
+    FRAM_queue_init(&queue,&fram);
+    running=1;
+
+    CHECK_EQ(pthread_create(&consumer,NULL,consume,NULL),0);
+    for(producer=0;producer<PRODUCERS;producer++)
+        CHECK_EQ(pthread_create(&producers[producer],NULL,produce,(void*)(uintptr_t)producer),0);
+    for(producer=0;producer<PRODUCERS;producer++)
+        pthread_join(producers[producer],NULL);
+    running=0;
+    pthread_join(consumer,NULL);
+
+    CHECK_EQ(FRAM_queue_get_stats(&queue)->written,PRODUCERS*RECORDS*2u);
+    CHECK_EQ(FRAM_queue_get_stats(&queue)->pushed,PRODUCERS*RECORDS*2u);
+
+    for(producer=0;producer<PRODUCERS;producer++){
+        for(seq=0;seq<RECORDS;seq++){
+            CHECK_EQ(FRAM_load32(&mem[(producer*RECORDS+seq)*RECORD]),producer);
+            CHECK_EQ(FRAM_load32(&mem[(producer*RECORDS+seq)*RECORD+4]),seq);
+        }
+        CHECK_EQ(FRAM_load32(&mem[LAST+producer*4u]),RECORDS-1u);
+    }
+
+    printf("queue: %u producers pushed %u records, %u pushes found the queue full\n",PRODUCERS,PRODUCERS*RECORDS*2u,
+           FRAM_queue_get_stats(&queue)->overflows);
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_single();
+    test_threads();
+
+    printf("queue: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
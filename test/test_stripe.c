@@ -0,0 +1,82 @@
+/**
+ * @file test_stripe.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Striped address space over two chips on separate buses: data ends up on the chips in units of the stripe size and reads back unchanged.
+ */
+
+#include <string.h>
+#include "sim.h"
+#include "test.h"
+
+#define SIZE                    (2u*SIM_CHIP_SIZE)
+
+static uint8_t model[SIZE];
+static uint8_t buffer[SIZE];
+
+int main(void){
+
+    FRAM_bus_t bus[2];
+    FRAM_t fram[2];
+    FRAM_t * const devices[2]={&fram[0],&fram[1]};
+    FRAM_stripe_t stripe={devices,2,64};
+    uint32_t adr;
+    uint32_t count;
+    uint32_t unit;
+    uint64_t start;
+    uint32_t i;
+    int it;
+
+    sim_reset();
+    for(i=0;i<2;i++){
+        FRAM_bus_init(&bus[i],&sim_i2c[i]);
+        FRAM_init(&fram[i],&bus[i],FRAM_SLAVE_ADR);
+    }
+
+    //parameters
+    CHECK_EQ(FRAM_stripe_write_to_adr(&stripe,SIZE-1,buffer,2),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_stripe_read_from_adr(&stripe,0,NULL,1),FRAM_PARAMTER_ERROR);
+    stripe.stripe_size=48;
+    CHECK_EQ(FRAM_stripe_read_from_adr(&stripe,0,buffer,1),FRAM_PARAMTER_ERROR);
+    stripe.stripe_size=64;
+
+    //random ranges against a model of the address space
+    for(it=0;it<4000;it++){
+        adr=test_rand()%SIZE;
+        count=1+test_rand()%(test_rand()%8==0?4096:200);
+        if(count>SIZE-adr)
+            count=SIZE-adr;
+
+        if(test_rand()%2){
+            for(i=0;i<count;i++)
+                buffer[i]=test_rand();
+            CHECK_EQ(FRAM_stripe_write_to_adr(&stripe,adr,buffer,count),FRAM_NO_ERROR);
+            memcpy(&model[adr],buffer,count);
+        }
+        else{
+            CHECK_EQ(FRAM_stripe_read_from_adr(&stripe,adr,buffer,count),FRAM_NO_ERROR);
+            CHECK(memcmp(buffer,&model[adr],count)==0);
+        }
+    }
+
+    //unit n is stored on chip n%2 at the address (n/2)*stripe_size
+    for(unit=0;unit<SIZE/64;unit++)
+        CHECK(memcmp(sim_mem(unit%2,FRAM_SLAVE_ADR)+unit/2*64,&model[unit*64],64)==0);
+
+    //the reads of both chips run at the same time: a read of 8 units takes about the time of 4
+    sim_clear_stats();
+    FRAM_clear_stats(&fram[0]);
+    fram[0].current_adr=FRAM_INVALID_ADR;
+    start=sim_now();
+    CHECK_EQ(FRAM_stripe_read_from_adr(&stripe,0,buffer,512),FRAM_NO_ERROR);
+    CHECK_EQ(fram[0].stats.set_adrs,1);
+    CHECK(sim_now()-start<300u*SIM_BYTE_NS);
+
+    printf("stripe: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
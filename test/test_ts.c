@@ -0,0 +1,251 @@
+/**
+ * @file test_ts.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Time series: 100000 samples at one per tick changing by -3..3 counts take less than a third of the 8 bytes per sample
+ * without encoding and read back unchanged. A seek in a ring of 64 blocks costs a binary search over the headers and the read of one block.
+ * A cursor at the end sees samples appended later. Random appends, flushes, seeks and remounts on a 16 block ring, some flushes cut
+ * by a power loss at a random byte: after every mount the time series reads back an unbroken tail of the flushed samples.
+ */
+
+#include <string.h>
+#include "FRAM_ts.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x6000u
+#define BLOCKS                  64u
+#define RING                    16u                     //blocks of the ring of the random test
+#define SAMPLES                 100000u
+#define ROUNDS                  100000u
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_ts_t ts;
+static FRAM_ts_cursor_t cursor;
+static uint32_t sample_time[ROUNDS+RING*FRAM_TS_PAYLOAD_MAX];
+static int32_t sample_value[ROUNDS+RING*FRAM_TS_PAYLOAD_MAX];
+
+//mounts the time series again after a reset
+static void remount(uint32_t blocks){
+
+    sim_reboot(&fram);
+    CHECK_EQ(FRAM_ts_init(&ts,&fram,BASE,blocks*FRAM_TS_BLOCK_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ts_mount(&ts),FRAM_NO_ERROR);
+}
+
+//the time series holds the samples first..end-1, returns first
+static uint32_t check_tail(uint32_t end){
+
+    uint32_t first=0;
+    uint32_t index;
+    uint32_t result;
+    uint32_t time;
+    int32_t value;
+
+    result=FRAM_ts_seek(&ts,&cursor,0);
+    if(end==0){
+        CHECK_EQ(result,FRAM_TS_END);
+        return 0;
+    }
+    CHECK_EQ(result,FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ts_next(&ts,&cursor,&time,&value),FRAM_NO_ERROR);
+
+    //the times of the encoding test are unique, so are the values of the random test
+    while(first<end&&(sample_time[first]!=time||sample_value[first]!=value))
+        first++;
+    CHECK(first<end);
+
+    for(index=first+1;index<end;index++){
+        CHECK_EQ(FRAM_ts_next(&ts,&cursor,&time,&value),FRAM_NO_ERROR);
+        CHECK_EQ(time,sample_time[index]);
+        CHECK_EQ(value,sample_value[index]);
+    }
+    CHECK_EQ(FRAM_ts_next(&ts,&cursor,&time,&value),FRAM_TS_END);
+
+    return first;
+}
+
+//a seek finds the first sample not older than the time
+static void check_seek(uint32_t first, uint32_t end, uint32_t seeks){
+
+    uint32_t index;
+    uint32_t target;
+    uint32_t time;
+    int32_t value;
+
+    while(seeks--){
+
+        index=first+test_rand()%(end-first);
+        target=sample_time[index]-(test_rand()%3==0&&sample_time[index]>0);
+        for(index=first;sample_time[index]<target;index++);
+
+        CHECK_EQ(FRAM_ts_seek(&ts,&cursor,target),FRAM_NO_ERROR);
+        CHECK_EQ(FRAM_ts_next(&ts,&cursor,&time,&value),FRAM_NO_ERROR);
+        CHECK_EQ(time,sample_time[index]);
+        CHECK_EQ(value,sample_value[index]);
+    }
+
+    CHECK_EQ(FRAM_ts_seek(&ts,&cursor,sample_time[end-1]+1),FRAM_TS_END);
+}
+
+static void test_encoding(void){
+
+    FRAM_ts_cursor_t follow;
+    uint32_t reads=0;
+    uint32_t seeks=0;
+    uint32_t time=0;
+    int32_t value=0;
+    uint32_t i;
+    uint32_t read_time;
+    int32_t read_value;
+
+    CHECK_EQ(FRAM_ts_init(&ts,&fram,BASE,BLOCKS*FRAM_TS_BLOCK_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ts_format(&ts),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ts_seek(&ts,&follow,0),FRAM_TS_END);
+
+    for(i=0;i<SAMPLES;i++){
+
+        time++;
+        value+=(int32_t)(test_rand()%7)-3;
+        sample_time[i]=time;
+        sample_value[i]=value;
+        CHECK_EQ(FRAM_ts_append(&ts,time,value),FRAM_NO_ERROR);
+
+        //a cursor at the end reads the samples appended after it, also across blocks
+        if(i<2000){
+            CHECK_EQ(FRAM_ts_next(&ts,&follow,&read_time,&read_value),FRAM_NO_ERROR);
+            CHECK_EQ(read_time,time);
+            CHECK_EQ(read_value,value);
+            CHECK_EQ(FRAM_ts_next(&ts,&follow,&read_time,&read_value),FRAM_TS_END);
+        }
+    }
+    CHECK_EQ(FRAM_ts_append(&ts,time-1,value),FRAM_PARAMTER_ERROR);
+    CHECK_EQ(FRAM_ts_flush(&ts),FRAM_NO_ERROR);
+
+    CHECK_EQ(ts.stats.samples,SAMPLES);
+    CHECK(ts.stats.bytes*3u<SAMPLES*8u);
+    printf("ts: %u samples took %u bytes in %u blocks instead of %u, %.1fx less\n",SAMPLES,ts.stats.bytes,ts.stats.blocks,
+           SAMPLES*8u,SAMPLES*8.0/ts.stats.bytes);
+
+    //the ring holds the newest blocks
+    remount(BLOCKS);
+    CHECK_EQ(ts.used,BLOCKS);
+    check_tail(SAMPLES);
+
+    for(i=0;i<100;i++){
+        time=sample_time[SAMPLES-1-test_rand()%(BLOCKS*FRAM_TS_PAYLOAD_MAX/2u)];
+        reads-=fram.stats.reads;
+        CHECK_EQ(FRAM_ts_seek(&ts,&cursor,time),FRAM_NO_ERROR);
+        reads+=fram.stats.reads;
+        seeks++;
+        CHECK_EQ(FRAM_ts_next(&ts,&cursor,&read_time,&read_value),FRAM_NO_ERROR);
+        CHECK_EQ(read_time,time);
+    }
+
+    //6 headers of the binary search, the header and the payload of the block found
+    CHECK(reads<=seeks*8u);
+    printf("ts: a seek in %u blocks took %.1f reads\n",BLOCKS,(double)reads/seeks);
+}
+
+static void test_random(void){
+
+    uint32_t cuts=0;
+    uint32_t mounts=0;
+    uint32_t count=0;
+    uint32_t durable=0;
+    uint32_t first;
+    uint32_t blocks;
+    uint32_t round;
+    uint32_t time=0;
+    int32_t value;
+    uint8_t armed=0;
+
+    CHECK_EQ(FRAM_ts_init(&ts,&fram,BASE,RING*FRAM_TS_BLOCK_SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_ts_format(&ts),FRAM_NO_ERROR);
+
+    for(round=0;round<ROUNDS;round++){
+
+        //the time stands still now and then, or jumps
+        time+=test_rand()%10==0?test_rand()%1000:test_rand()%3;
+        value=(int32_t)(round*4u+test_rand()%4);
+        if(test_rand()%50==0)
+            value=-value;
+
+        //the power cut stays armed until the next block is written
+        blocks=ts.stats.blocks;
+        if(round%200==100){
+            sim_power_cut(test_rand()%FRAM_TS_BLOCK_SIZE);
+            armed=1;
+        }
+
+        if(round%400==300)
+            FRAM_ts_flush(&ts);
+        else{
+            CHECK_EQ(FRAM_ts_append(&ts,time,value),FRAM_NO_ERROR);
+            sample_time[count]=time;
+            sample_value[count]=value;
+            count++;
+        }
+
+        //the block cut by the power loss is lost, with all samples not written before
+        if(sim_power_lost()){
+            sim_power_cut(-1);
+            armed=0;
+            count=durable;
+            time=count>0?sample_time[count-1]:0;
+            remount(RING);
+            first=check_tail(count);
+            if(count>0)
+                check_seek(first,count,20);
+            cuts++;
+            continue;
+        }
+        //the sample filling the block starts the next one
+        if(ts.stats.blocks!=blocks){
+            durable=ts.count>0?count-1:count;
+            sim_power_cut(-1);
+            armed=0;
+        }
+        if(armed)
+            continue;
+
+        if(test_rand()%300==0){
+            CHECK_EQ(FRAM_ts_flush(&ts),FRAM_NO_ERROR);
+            durable=count;
+        }
+
+        if(test_rand()%500==0){
+            CHECK_EQ(FRAM_ts_flush(&ts),FRAM_NO_ERROR);
+            durable=count;
+            remount(RING);
+            first=check_tail(count);
+            check_seek(first,count,20);
+
+            //once the ring has wrapped around, it is never short of more than the block torn last
+            if(round>=ROUNDS/10u)
+                CHECK(ts.used>=RING-1u);
+            mounts++;
+        }
+    }
+
+    printf("ts: %u appends and flushes on %u blocks, %u flushes cut by a power loss, %u remounts\n",ROUNDS,RING,cuts,mounts);
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_encoding();
+    test_random();
+
+    printf("ts: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */
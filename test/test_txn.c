@@ -0,0 +1,153 @@
+/**
+ * @file test_txn.c
+ * @author  Thomas Barth <thomas@barth-dev.de>
+ * @version 2.0
+ *
+ * @section DESCRIPTION
+ *
+ * Redo journal: groups of random transactions cut by a power loss at every byte of their journal writes and their flush.
+ * After "FRAM_txn_recover" the target region holds either the state before the group or the state after all of it, never a part.
+ * A marker torn right after its magic does not commit the start of a journal that repeats the journal of the previous flush.
+ */
+
+#include <string.h>
+#include "FRAM_txn.h"
+#include "sim.h"
+#include "test.h"
+
+#define BASE                    0x1000u
+#define SIZE                    1024u
+#define TARGET                  0x8000u
+#define TARGET_SIZE             256u
+#define GROUPS                  60u
+
+static FRAM_bus_t bus;
+static FRAM_t fram;
+static FRAM_txn_t txn;
+
+//mounts the journal again after a reset
+static void remount(void){
+
+    sim_reboot(&fram);
+    CHECK_EQ(FRAM_txn_init(&txn,&fram,BASE,SIZE),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_txn_recover(&txn),FRAM_NO_ERROR);
+}
+
+//the previous flush left a journal starting like the new one
+static void test_stale(void){
+
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    static uint8_t d[4]={1,2,3,4};
+    static uint8_t e[4]={9,9,9,9};
+    static uint8_t f[4]={7,7,7,7};
+    static uint8_t zero[4]={0};
+
+    remount();
+    CHECK_EQ(FRAM_write_to_adr(&fram,TARGET+0x10,zero,4),FRAM_NO_ERROR);
+
+    CHECK_EQ(FRAM_txn_begin(&txn),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_txn_write(&txn,TARGET,d,4),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_txn_commit(&txn,FRAM_WAIT),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_write_to_adr(&fram,TARGET,e,4),FRAM_NO_ERROR);
+
+    //the reset hits right behind the magic of the new marker
+    CHECK_EQ(FRAM_txn_begin(&txn),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_txn_write(&txn,TARGET,d,4),FRAM_NO_ERROR);
+    CHECK_EQ(FRAM_txn_write(&txn,TARGET+0x10,f,4),FRAM_NO_ERROR);
+    sim_power_cut(4);
+    FRAM_txn_commit(&txn,FRAM_WAIT);
+    CHECK(sim_power_lost());
+    sim_power_cut(-1);
+
+    remount();
+    CHECK(memcmp(mem+TARGET,e,4)==0);
+    CHECK(memcmp(mem+TARGET+0x10,zero,4)==0);
+}
+
+static void test_groups(void){
+
+    uint8_t * const mem=sim_mem(0,FRAM_SLAVE_ADR);
+    uint8_t before[TARGET_SIZE];
+    uint8_t after[TARGET_SIZE];
+    uint8_t data[3][3][32];
+    uint32_t adr[3][3];
+    uint32_t count[3][3];
+    uint32_t ranges[3];
+    uint32_t transactions;
+    uint32_t points=0;
+    uint32_t old=0;
+    uint32_t group;
+    uint32_t t;
+    uint32_t r;
+    uint32_t i;
+    long budget;
+    uint8_t lost;
+
+    remount();
+
+    for(group=0;group<GROUPS;group++){
+
+        //up to three transactions of up to three ranges, later ranges overwrite earlier ones
+        transactions=1+test_rand()%3;
+        for(t=0;t<transactions;t++){
+            ranges[t]=1+test_rand()%3;
+            for(r=0;r<ranges[t];r++){
+                count[t][r]=1+test_rand()%32;
+                adr[t][r]=TARGET+test_rand()%(TARGET_SIZE-count[t][r]+1);
+                for(i=0;i<count[t][r];i++)
+                    data[t][r][i]=(uint8_t)test_rand();
+            }
+        }
+
+        memcpy(before,mem+TARGET,TARGET_SIZE);
+        memcpy(after,before,TARGET_SIZE);
+        for(t=0;t<transactions;t++)
+            for(r=0;r<ranges[t];r++)
+                memcpy(after+adr[t][r]-TARGET,data[t][r],count[t][r]);
+
+        for(budget=0;;budget++){
+
+            CHECK_EQ(FRAM_write_to_adr(&fram,TARGET,before,TARGET_SIZE),FRAM_NO_ERROR);
+
+            //the last transaction flushes the group
+            sim_power_cut(budget);
+            for(t=0;t<transactions;t++){
+                FRAM_txn_begin(&txn);
+                for(r=0;r<ranges[t];r++)
+                    FRAM_txn_write(&txn,adr[t][r],data[t][r],count[t][r]);
+                FRAM_txn_commit(&txn,t+1==transactions?FRAM_WAIT:FRAM_DONT_WAIT);
+            }
+            lost=sim_power_lost();
+            sim_power_cut(-1);
+
+            remount();
+            if(memcmp(mem+TARGET,after,TARGET_SIZE)!=0){
+                CHECK(lost);
+                CHECK(memcmp(mem+TARGET,before,TARGET_SIZE)==0);
+                old++;
+            }
+            points++;
+
+            if(!lost)
+                break;
+        }
+    }
+
+    CHECK(old>0);
+    printf("txn: %u groups cut at %u points, %u recovered to the state before the group\n",GROUPS,points,old);
+}
+
+int main(void){
+
+    sim_reset();
+    FRAM_bus_init(&bus,&sim_i2c[0]);
+    FRAM_init(&fram,&bus,FRAM_SLAVE_ADR);
+
+    test_stale();
+    test_groups();
+
+    printf("txn: ok\n");
+    return 0;
+}
+
+/* [] END OF FILE */